@@ -29,16 +29,30 @@
 
 static AudioFormat configured_audio_format;
 
+/**
+ * Convert all PCM data to floating point in the decoder thread?
+ */
+static bool float_pipeline;
+
 AudioFormat
 getOutputAudioFormat(AudioFormat inAudioFormat)
 {
 	AudioFormat out_audio_format = inAudioFormat;
 	out_audio_format.ApplyMask(configured_audio_format);
+
+	/* DSD is passed through unmodified, because it's not PCM;
+	   if it is converted to PCM, it's converted to float
+	   anyway */
+	if (float_pipeline && out_audio_format.format != SampleFormat::DSD)
+		out_audio_format.format = SampleFormat::FLOAT;
+
 	return out_audio_format;
 }
 
 void initAudioConfig(void)
 {
+	float_pipeline = config_get_bool(CONF_FLOAT_PIPELINE, false);
+
 	const struct config_param *param = config_get_param(CONF_AUDIO_OUTPUT_FORMAT);
 
 	if (param == nullptr)
@@ -22,6 +22,12 @@
 
 struct AudioFormat;
 
+/**
+ * Determine the audio format of the music pipe for the given
+ * decoder output format.  This applies the "audio_output_format"
+ * setting, and with "float_pipeline", it chooses floating point
+ * samples.
+ */
 AudioFormat
 getOutputAudioFormat(AudioFormat inFormat);
 
@@ -21,6 +21,9 @@
 #define MPD_CROSSFADE_HXX
 
 #include "Compiler.h"
+#include "pcm/PcmMix.hxx"
+
+#include <stddef.h>
 
 struct AudioFormat;
 
@@ -38,10 +41,16 @@ struct CrossFadeSettings {
 	 */
 	float mixramp_delay;
 
+	/**
+	 * The gain curve of a (non-MixRamp) cross-fade.
+	 */
+	MixCurve curve;
+
 	CrossFadeSettings()
 		:duration(0),
 		 mixramp_db(0),
-		 mixramp_delay(-1)
+		 mixramp_delay(-1),
+		 curve(MixCurve::SINE)
 	{}
 
 
@@ -55,6 +64,7 @@ struct CrossFadeSettings {
 	 * @param mixramp_prev_end the last songs mixramp_end setting
 	 * @param af the audio format of the new song
 	 * @param old_format the audio format of the current song
+	 * @param chunk_size the number of bytes in each chunk
 	 * @param max_chunks the maximum number of chunks
 	 * @return the number of chunks for crossfading, or 0 if cross fading
 	 * should be disabled for this song change
@@ -65,6 +75,7 @@ struct CrossFadeSettings {
 			   const char *mixramp_start,
 			   const char *mixramp_prev_end,
 			   AudioFormat af, AudioFormat old_format,
+			   size_t chunk_size,
 			   unsigned max_chunks) const;
 };
 
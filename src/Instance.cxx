@@ -20,8 +20,13 @@
 #include "config.h"
 #include "Instance.hxx"
 #include "Partition.hxx"
+#include "PlayerThread.hxx"
+#include "ReplayGainConfig.hxx"
 #include "Idle.hxx"
 #include "Stats.hxx"
+#include "client/ClientList.hxx"
+
+#include <assert.h>
 
 #ifdef ENABLE_DATABASE
 #include "db/DatabaseError.hxx"
@@ -42,16 +47,67 @@ Instance::GetDatabase(Error &error)
 
 #endif
 
+Partition *
+Instance::FindPartition(const char *name) const
+{
+	for (auto *p : partitions)
+		if (p->name == name)
+			return p;
+
+	return nullptr;
+}
+
+Partition &
+Instance::NewPartition(const char *name)
+{
+	assert(FindPartition(name) == nullptr);
+
+	const PlayerControl &default_pc = partition->pc;
+	Partition *p = new Partition(*this, name,
+				     partition->playlist.queue.max_length,
+				     default_pc.buffer_chunks,
+				     default_pc.buffer_chunk_size,
+				     default_pc.buffer_chunk_time,
+				     default_pc.buffered_before_play);
+	p->pc.decoder_lookahead = default_pc.decoder_lookahead;
+	p->pc.cross_fade.curve = default_pc.cross_fade.curve;
+	p->outputs.SetReplayGainMode(replay_gain_get_real_mode(p->playlist.queue.random));
+
+	partitions.push_back(p);
+	player_create(p->pc);
+	return *p;
+}
+
 void
 Instance::TagModified()
 {
-	partition->TagModified();
+	for (auto *p : partitions)
+		p->TagModified();
 }
 
 void
 Instance::SyncWithPlayer()
 {
-	partition->SyncWithPlayer();
+	for (auto *p : partitions)
+		p->SyncWithPlayer();
+}
+
+unsigned
+Instance::FlushIdle()
+{
+	unsigned flags = idle_get();
+	if (flags != 0)
+		client_list->IdleAdd(flags);
+
+	for (auto *p : partitions) {
+		const unsigned partition_flags = p->ReadIdle();
+		if (partition_flags != 0) {
+			client_list->IdleAdd(*p, partition_flags);
+			flags |= partition_flags;
+		}
+	}
+
+	return flags;
 }
 
 #ifdef ENABLE_DATABASE
@@ -64,7 +120,8 @@ Instance::OnDatabaseModified()
 	/* propagate the change to all subsystems */
 
 	stats_invalidate();
-	partition->DatabaseModified(*database);
+	for (auto *p : partitions)
+		p->DatabaseModified(*database);
 	idle_add(IDLE_DATABASE);
 }
 
@@ -80,7 +137,8 @@ Instance::OnDatabaseSongRemoved(const LightSong &song)
 #endif
 
 	const auto uri = song.GetURI();
-	partition->DeleteSong(uri.c_str());
+	for (auto *p : partitions)
+		p->DeleteSong(uri.c_str());
 }
 
 #endif
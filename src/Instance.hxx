@@ -23,6 +23,8 @@
 #include "check.h"
 #include "Compiler.h"
 
+#include <list>
+
 #ifdef ENABLE_NEIGHBOR_PLUGINS
 #include "neighbor/Listener.hxx"
 class NeighborGlue;
@@ -74,8 +76,19 @@ struct Instance final
 
 	ClientList *client_list;
 
+	/**
+	 * The default partition.  New clients are bound to it.  It
+	 * is also the first element of #partitions.
+	 */
 	Partition *partition;
 
+	/**
+	 * All partitions, including the default one.  They share the
+	 * database, the storage and the clients, but each one has its
+	 * own play queue, player and outputs.
+	 */
+	std::list<Partition *> partitions;
+
 	Instance() {
 #ifdef ENABLE_DATABASE
 		storage = nullptr;
@@ -93,16 +106,46 @@ struct Instance final
 #endif
 
 	/**
-	 * A tag in the play queue has been modified by the player
-	 * thread.  Propagate the change to all subsystems.
+	 * Look up a partition by its name.
+	 *
+	 * @return the partition or nullptr if there is no such
+	 * partition
+	 */
+	gcc_pure
+	Partition *FindPartition(const char *name) const;
+
+	/**
+	 * Create a new partition at runtime and start its player.  It
+	 * copies the settings of the default partition, but it has
+	 * no audio outputs.
+	 *
+	 * @param name the name of the new partition; the caller
+	 * must make sure that no such partition exists
+	 */
+	Partition &NewPartition(const char *name);
+
+	/**
+	 * A tag in the play queue of one of the partitions has been
+	 * modified by the player thread.  Propagate the change to all
+	 * subsystems.
 	 */
 	void TagModified();
 
 	/**
-	 * Synchronize the player with the play queue.
+	 * Synchronize the players with their play queues.
 	 */
 	void SyncWithPlayer();
 
+	/**
+	 * Send the pending idle events to the clients: global ones
+	 * (idle_add()) to all clients, and those of each partition
+	 * (Partition::EmitIdle()) only to the clients which are bound
+	 * to it.
+	 *
+	 * @return all flags which were sent
+	 */
+	unsigned FlushIdle();
+
 private:
 #ifdef ENABLE_DATABASE
 	virtual void OnDatabaseModified() override;
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "LatencyPrint.hxx"
+#include "util/LatencyHistogram.hxx"
+#include "client/Client.hxx"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+void
+latency_print(Client &client, const char *stage,
+	      const LatencyHistogram &histogram)
+{
+	client_printf(client,
+		      "stage: %s\n"
+		      "count: %" PRIu64 "\n"
+		      "avg_us: %" PRIu64 "\n"
+		      "p50_us: %" PRIu64 "\n"
+		      "p99_us: %" PRIu64 "\n"
+		      "max_us: %" PRIu64 "\n",
+		      stage,
+		      histogram.GetCount(),
+		      histogram.GetAverage(),
+		      histogram.GetPercentile(50),
+		      histogram.GetPercentile(99),
+		      histogram.GetMax());
+
+	/* one number per bucket; see LatencyHistogram for the
+	   bucket boundaries */
+	char buffer[LatencyHistogram::N_BUCKETS * 21 + 1], *p = buffer;
+	for (unsigned i = 0; i < LatencyHistogram::N_BUCKETS; ++i)
+		p += sprintf(p, i > 0 ? " %" PRIu64 : "%" PRIu64,
+			     histogram.GetBucket(i));
+
+	client_printf(client, "histogram: %s\n", buffer);
+}
@@ -24,6 +24,7 @@
 #include "PlaylistFile.hxx"
 #include "PlaylistGlobal.hxx"
 #include "MusicChunk.hxx"
+#include "AudioFormat.hxx"
 #include "StateFile.hxx"
 #include "PlayerThread.hxx"
 #include "Mapper.hxx"
@@ -47,14 +48,18 @@
 #include "playlist/PlaylistRegistry.hxx"
 #include "zeroconf/ZeroconfGlue.hxx"
 #include "decoder/DecoderList.hxx"
+#include "decoder/DecoderCache.hxx"
 #include "AudioConfig.hxx"
 #include "pcm/PcmConvert.hxx"
+#include "pcm/PcmMix.hxx"
+#include "pcm/Volume.hxx"
 #include "unix/SignalHandlers.hxx"
 #include "unix/Daemon.hxx"
 #include "system/FatalError.hxx"
 #include "util/UriUtil.hxx"
 #include "util/Error.hxx"
 #include "util/Domain.hxx"
+#include "util/HugeAllocator.hxx"
 #include "thread/Id.hxx"
 #include "thread/Slack.hxx"
 #include "lib/icu/Collate.hxx"
@@ -98,6 +103,7 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 
 #ifdef HAVE_LOCALE_H
 #include <locale.h>
@@ -113,6 +119,18 @@
 static constexpr unsigned DEFAULT_BUFFER_SIZE = 4096;
 static constexpr unsigned DEFAULT_BUFFER_BEFORE_PLAY = 10;
 
+static constexpr size_t MIN_CHUNK_SIZE = 1024;
+static constexpr size_t MAX_CHUNK_SIZE = 1024 * 1024;
+
+/**
+ * With "audio_chunk_time", the number of chunks is calculated for
+ * this audio format, so the buffer holds the same duration of
+ * CD-quality (and lower) audio as without the time limit.
+ */
+static constexpr AudioFormat CHUNK_TIME_REFERENCE_FORMAT(44100,
+							 SampleFormat::S16,
+							 2);
+
 static constexpr Domain main_domain("main");
 
 Instance *instance;
@@ -257,8 +275,7 @@ glue_state_file_init(Error &error)
 	if (path_fs.IsNull())
 		return !error.IsDefined();
 
-	state_file = new StateFile(std::move(path_fs),
-				   *instance->partition,
+	state_file = new StateFile(std::move(path_fs), *instance,
 				   *instance->event_loop);
 	state_file->Read();
 	return true;
@@ -283,6 +300,29 @@ static void winsock_init(void)
 #endif
 }
 
+/**
+ * Configure the allocator of the audio buffers.  This must be done
+ * before the first #MusicBuffer or #PcmBuffer gets allocated.
+ */
+static void
+initialize_huge_allocator(void)
+{
+	HugePages pages = HugePages::TRANSPARENT;
+
+	const char *value = config_get_string(CONF_BUFFER_HUGE_PAGES,
+					      nullptr);
+	if (value == nullptr || strcmp(value, "transparent") == 0)
+		pages = HugePages::TRANSPARENT;
+	else if (strcmp(value, "no") == 0)
+		pages = HugePages::NONE;
+	else if (strcmp(value, "explicit") == 0)
+		pages = HugePages::EXPLICIT;
+	else
+		FormatFatalError("Unknown buffer_huge_pages \"%s\"", value);
+
+	HugeConfigure(pages, config_get_bool(CONF_BUFFER_LOCK, false));
+}
+
 /**
  * Initialize the decoder and player core, including the music pipe.
  */
@@ -306,12 +346,42 @@ initialize_decoder_and_player(void)
 
 	buffer_size *= 1024;
 
-	const unsigned buffered_chunks = buffer_size / CHUNK_SIZE;
+	const size_t chunk_size =
+		config_get_positive(CONF_AUDIO_CHUNK_SIZE, DEFAULT_CHUNK_SIZE);
+	if (chunk_size < MIN_CHUNK_SIZE || chunk_size > MAX_CHUNK_SIZE)
+		FormatFatalError("audio chunk size \"%lu\" is out of range",
+				 (unsigned long)chunk_size);
+
+	const unsigned chunk_time =
+		config_get_unsigned(CONF_AUDIO_CHUNK_TIME, 0);
+
+	/* with a time limit, most chunks are not filled up to
+	   chunk_size; count the bytes they actually hold, or a large
+	   chunk_size would leave only a few short chunks */
+	size_t used_chunk_size = chunk_size;
+	if (chunk_time > 0) {
+		const size_t time_size =
+			size_t(CHUNK_TIME_REFERENCE_FORMAT.GetTimeToSize())
+			* chunk_time / 1000;
+		if (time_size < used_chunk_size)
+			used_chunk_size = time_size;
+
+		if (used_chunk_size == 0)
+			FormatFatalError("audio chunk time \"%u\" is too small",
+					 chunk_time);
+	}
+
+	const unsigned buffered_chunks = buffer_size / used_chunk_size;
 
 	if (buffered_chunks >= 1 << 15)
 		FormatFatalError("buffer size \"%lu\" is too big",
 				 (unsigned long)buffer_size);
 
+	if (buffered_chunks < 2)
+		FormatFatalError("buffer size \"%lu\" is too small for "
+				 "the audio chunk size",
+				 (unsigned long)buffer_size);
+
 	float perc;
 	param = config_get_param(CONF_BUFFER_BEFORE_PLAY);
 	if (param != nullptr) {
@@ -335,9 +405,55 @@ initialize_decoder_and_player(void)
 				    DEFAULT_PLAYLIST_MAX_LENGTH);
 
 	instance->partition = new Partition(*instance,
+					    Partition::DEFAULT_NAME,
 					    max_length,
 					    buffered_chunks,
+					    chunk_size, chunk_time,
 					    buffered_before_play);
+	instance->partitions.push_back(instance->partition);
+
+	for (param = config_get_param(CONF_PARTITION); param != nullptr;
+	     param = param->next) {
+		const char *name = param->GetBlockValue("name");
+		if (name == nullptr || *name == 0)
+			FormatFatalError("partition without name, line %i",
+					 param->line);
+
+		if (instance->FindPartition(name) != nullptr)
+			FormatFatalError("duplicate partition \"%s\", line %i",
+					 name, param->line);
+
+		instance->partitions.push_back(new Partition(*instance,
+							     name,
+							     max_length,
+							     buffered_chunks,
+							     chunk_size,
+							     chunk_time,
+							     buffered_before_play));
+	}
+
+	for (param = config_get_param(CONF_AUDIO_OUTPUT); param != nullptr;
+	     param = param->next) {
+		const char *name = param->GetBlockValue("partition");
+		if (name != nullptr && instance->FindPartition(name) == nullptr)
+			FormatFatalError("no such partition \"%s\", line %i",
+					 name, param->line);
+	}
+
+	const bool decoder_lookahead =
+		config_get_bool(CONF_DECODER_LOOKAHEAD, false);
+
+	MixCurve curve = MixCurve::SINE;
+	const char *curve_name = config_get_string(CONF_CROSSFADE_CURVE,
+						   nullptr);
+	if (curve_name != nullptr && !mix_curve_parse(curve_name, curve))
+		FormatFatalError("Unknown crossfade_curve \"%s\"",
+				 curve_name);
+
+	for (auto *partition : instance->partitions) {
+		partition->pc.decoder_lookahead = decoder_lookahead;
+		partition->pc.cross_fade.curve = curve;
+	}
 }
 
 /**
@@ -348,9 +464,7 @@ idle_event_emitted(void)
 {
 	/* send "idle" notifications to all subscribed
 	   clients */
-	unsigned flags = idle_get();
-	if (flags != 0)
-		instance->client_list->IdleAdd(flags);
+	const unsigned flags = instance->FlushIdle();
 
 	if (flags & (IDLE_PLAYLIST|IDLE_PLAYER|IDLE_MIXER|IDLE_OUTPUT) &&
 	    state_file != nullptr)
@@ -457,6 +571,8 @@ int mpd_main(int argc, char *argv[])
 	const unsigned max_clients = config_get_positive(CONF_MAX_CONN, 10);
 	instance->client_list = new ClientList(max_clients);
 
+	initialize_huge_allocator();
+	pcm_volume_global_init(config_get_bool(CONF_VOLUME_DITHER, true));
 	initialize_decoder_and_player();
 
 	if (!listen_global_init(*instance->event_loop, *instance->partition,
@@ -496,6 +612,7 @@ int mpd_main(int argc, char *argv[])
 	}
 
 	decoder_plugin_init_all();
+	decoder_cache_global_init();
 
 #ifdef ENABLE_DATABASE
 	const bool create_db = InitDatabaseAndStorage();
@@ -505,8 +622,11 @@ int mpd_main(int argc, char *argv[])
 
 	command_init();
 	initAudioConfig();
-	instance->partition->outputs.Configure(*instance->event_loop,
-					       instance->partition->pc);
+	for (auto *partition : instance->partitions)
+		partition->outputs.Configure(*instance->event_loop,
+					     partition->pc,
+					     partition->name.c_str(),
+					     partition == instance->partition);
 	client_manager_init();
 	replay_gain_global_init();
 
@@ -535,7 +655,8 @@ int mpd_main(int argc, char *argv[])
 
 	ZeroconfInit(*instance->event_loop);
 
-	player_create(instance->partition->pc);
+	for (auto *partition : instance->partitions)
+		player_create(partition->pc);
 
 #ifdef ENABLE_DATABASE
 	if (create_db) {
@@ -552,7 +673,8 @@ int mpd_main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
-	instance->partition->outputs.SetReplayGainMode(replay_gain_get_real_mode(instance->partition->playlist.queue.random));
+	for (auto *partition : instance->partitions)
+		partition->outputs.SetReplayGainMode(replay_gain_get_real_mode(partition->playlist.queue.random));
 
 #ifdef ENABLE_DATABASE
 	if (config_get_bool(CONF_AUTO_UPDATE, false)) {
@@ -575,7 +697,8 @@ int mpd_main(int argc, char *argv[])
 
 	/* enable all audio outputs (if not already done by
 	   playlist_state_restore() */
-	instance->partition->pc.UpdateAudio();
+	for (auto *partition : instance->partitions)
+		partition->pc.UpdateAudio();
 
 #ifdef WIN32
 	win32_app_started();
@@ -603,7 +726,8 @@ int mpd_main(int argc, char *argv[])
 		delete state_file;
 	}
 
-	instance->partition->pc.Kill();
+	for (auto *partition : instance->partitions)
+		partition->pc.Kill();
 	ZeroconfDeinit();
 	listen_global_finish();
 	delete instance->client_list;
@@ -637,8 +761,11 @@ int mpd_main(int argc, char *argv[])
 	mapper_finish();
 #endif
 
-	delete instance->partition;
+	for (auto *partition : instance->partitions)
+		delete partition;
 	command_finish();
+	decoder_cache_global_finish();
+	pcm_convert_global_finish();
 	decoder_plugin_deinit_all();
 #ifdef ENABLE_ARCHIVE
 	archive_plugin_deinit_all();
@@ -20,21 +20,56 @@
 #include "config.h"
 #include "MusicBuffer.hxx"
 #include "MusicChunk.hxx"
+#include "AudioFormat.hxx"
 #include "system/FatalError.hxx"
 
 #include <assert.h>
 
-MusicBuffer::MusicBuffer(unsigned num_chunks)
-	:buffer(num_chunks) {
+MusicBuffer::MusicBuffer(unsigned num_chunks, size_t _chunk_size,
+			 unsigned _chunk_time)
+	:buffer(num_chunks, sizeof(music_chunk) + _chunk_size),
+	 chunk_size(_chunk_size), chunk_time(_chunk_time) {
 	if (buffer.IsOOM())
 		FatalError("Failed to allocate buffer");
 }
 
+size_t
+MusicBuffer::GetChunkSize(const AudioFormat af) const
+{
+	assert(af.IsValid());
+
+	const size_t frame_size = af.GetFrameSize();
+	size_t size = chunk_size;
+
+	if (chunk_time > 0) {
+		const size_t time_size =
+			size_t(af.GetTimeToSize()) * chunk_time / 1000;
+		if (time_size < size)
+			size = time_size;
+	}
+
+	/* round down to whole frames, but hold at least one */
+	size -= size % frame_size;
+	if (size == 0)
+		size = frame_size;
+
+	return size;
+}
+
 music_chunk *
-MusicBuffer::Allocate()
+MusicBuffer::Allocate(const AudioFormat af)
 {
-	const ScopeLock protect(mutex);
-	return buffer.Allocate();
+	music_chunk *chunk = buffer.Allocate();
+	if (chunk == nullptr)
+		return nullptr;
+
+	/* the payload is stored in the same slice, right after the
+	   music_chunk object */
+	chunk->data = reinterpret_cast<uint8_t *>(chunk + 1);
+	chunk->capacity = GetChunkSize(af);
+	assert(sizeof(*chunk) + chunk->capacity <= buffer.GetSliceSize());
+
+	return chunk;
 }
 
 void
@@ -42,8 +77,6 @@ MusicBuffer::Return(music_chunk *chunk)
 {
 	assert(chunk != nullptr);
 
-	const ScopeLock protect(mutex);
-
 	if (chunk->other != nullptr) {
 		assert(chunk->other->other == nullptr);
 		buffer.Free(chunk->other);
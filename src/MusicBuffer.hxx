@@ -21,33 +21,50 @@
 #define MPD_MUSIC_BUFFER_HXX
 
 #include "util/SliceBuffer.hxx"
-#include "thread/Mutex.hxx"
+#include "Compiler.h"
+
+#include <stddef.h>
 
 struct music_chunk;
+struct AudioFormat;
 
 /**
- * An allocator for #music_chunk objects.
+ * An allocator for #music_chunk objects.  It is lock-free, and may be
+ * used by the decoder and the player thread concurrently.
  */
 class MusicBuffer {
-	/** a mutex which protects #buffer */
-	Mutex mutex;
-
 	SliceBuffer<music_chunk> buffer;
 
+	/**
+	 * The maximum payload size of each chunk in bytes.
+	 */
+	const size_t chunk_size;
+
+	/**
+	 * If non-zero, then chunks are only filled up to this
+	 * duration (in milliseconds), even if #chunk_size would allow
+	 * more.
+	 */
+	const unsigned chunk_time;
+
 public:
 	/**
 	 * Creates a new #MusicBuffer object.
 	 *
 	 * @param num_chunks the number of #music_chunk reserved in
 	 * this buffer
+	 * @param chunk_size the maximum payload size of each chunk
+	 * @param chunk_time the target duration of each chunk in
+	 * milliseconds; 0 means always fill up to #chunk_size
 	 */
-	MusicBuffer(unsigned num_chunks);
+	MusicBuffer(unsigned num_chunks, size_t chunk_size,
+		    unsigned chunk_time=0);
 
 #ifndef NDEBUG
 	/**
-	 * Check whether the buffer is empty.  This call is not
-	 * protected with the mutex, and may only be used while this
-	 * object is inaccessible to other threads.
+	 * Check whether the buffer is empty.  The result is only
+	 * reliable while this object is inaccessible to other
+	 * threads.
 	 */
 	bool IsEmptyUnsafe() const {
 		return buffer.IsEmpty();
@@ -64,14 +81,25 @@ public:
 		return buffer.GetCapacity();
 	}
 
+	/**
+	 * Returns the number of bytes a chunk carrying the specified
+	 * audio format will hold.  This is #chunk_size, unless the
+	 * chunk duration is limited; it is always a multiple of the
+	 * frame size.
+	 */
+	gcc_pure
+	size_t GetChunkSize(AudioFormat af) const;
+
 	/**
 	 * Allocates a chunk from the buffer.  When it is not used anymore,
 	 * call Return().
 	 *
+	 * @param af the audio format of the data which will be
+	 * written to the chunk; it determines the chunk's capacity
 	 * @return an empty chunk or nullptr if there are no chunks
 	 * available
 	 */
-	music_chunk *Allocate();
+	music_chunk *Allocate(AudioFormat af);
 
 	/**
 	 * Returns a chunk to the buffer.  It can be reused by
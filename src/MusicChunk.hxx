@@ -21,6 +21,7 @@
 #define MPD_MUSIC_CHUNK_HXX
 
 #include "ReplayGainInfo.hxx"
+#include "pcm/PcmMix.hxx"
 #include "util/WritableBuffer.hxx"
 
 #ifndef NDEBUG
@@ -30,7 +31,11 @@
 #include <stdint.h>
 #include <stddef.h>
 
-static constexpr size_t CHUNK_SIZE = 4096;
+/**
+ * The default payload size of a #music_chunk in bytes.  It can be
+ * changed with the "audio_chunk_size" setting.
+ */
+static constexpr size_t DEFAULT_CHUNK_SIZE = 4096;
 
 struct AudioFormat;
 struct Tag;
@@ -40,8 +45,11 @@ struct Tag;
  * MusicPipe::Push() caller.
  */
 struct music_chunk {
-	/** the next chunk in a linked list */
-	struct music_chunk *next;
+	/**
+	 * The position of this chunk in the #MusicPipe it is
+	 * currently enqueued in.  Only valid while it is enqueued.
+	 */
+	unsigned pipe_position;
 
 	/**
 	 * An optional chunk which should be mixed into this chunk.
@@ -55,8 +63,28 @@ struct music_chunk {
 	 */
 	float mix_ratio;
 
+	/**
+	 * The mix ratio at the end of this chunk, i.e. the
+	 * #mix_ratio of the next one.  The output interpolates
+	 * between both for each frame, to avoid audible steps at
+	 * chunk boundaries.
+	 */
+	float mix_ratio_end;
+
+	/**
+	 * The gain curve for cross-fading with the #other chunk.
+	 */
+	MixCurve mix_curve;
+
 	/** number of bytes stored in this chunk */
-	uint16_t length;
+	uint32_t length;
+
+	/**
+	 * The maximum number of bytes which may be stored in this
+	 * chunk.  It is chosen by MusicBuffer::Allocate() and may
+	 * depend on the audio format.
+	 */
+	uint32_t capacity;
 
 	/** current bit rate of the source file */
 	uint16_t bit_rate;
@@ -85,8 +113,20 @@ struct music_chunk {
 	 */
 	unsigned replay_gain_serial;
 
-	/** the data (probably PCM) */
-	uint8_t data[CHUNK_SIZE];
+	/**
+	 * The data (probably PCM).  It points to #capacity bytes
+	 * which are owned by the #MusicBuffer this chunk was
+	 * allocated from.
+	 */
+	uint8_t *data;
+
+	/**
+	 * MonotonicClockUS() time stamps for latency tracing: when
+	 * the decoder allocated this chunk, when it was pushed into
+	 * the decoder's #MusicPipe, and when the player passed it to
+	 * the outputs.  0 means "not recorded".
+	 */
+	uint64_t decode_time, push_time, play_time;
 
 #ifndef NDEBUG
 	AudioFormat audio_format;
@@ -94,9 +134,12 @@ struct music_chunk {
 
 	music_chunk()
 		:other(nullptr),
-		 length(0),
+		 mix_curve(MixCurve::SINE),
+		 length(0), capacity(0),
 		 tag(nullptr),
-		 replay_gain_serial(0) {}
+		 replay_gain_serial(0),
+		 data(nullptr),
+		 decode_time(0), push_time(0), play_time(0) {}
 
 	~music_chunk();
 
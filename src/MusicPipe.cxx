@@ -22,15 +22,46 @@
 #include "MusicBuffer.hxx"
 #include "MusicChunk.hxx"
 
+/**
+ * Round up to the next power of two.
+ */
+gcc_const
+static unsigned
+RoundUpPowerOfTwo(unsigned n)
+{
+	unsigned result = 1;
+	while (result < n)
+		result <<= 1;
+	return result;
+}
+
+MusicPipe::MusicPipe(unsigned max_size)
+	:ring(new music_chunk *[RoundUpPowerOfTwo(max_size)]),
+	 mask(RoundUpPowerOfTwo(max_size) - 1),
+	 head(0), tail(0)
+{
+	assert(max_size > 0);
+
+#ifndef NDEBUG
+	audio_format.Clear();
+#endif
+}
+
+MusicPipe::~MusicPipe()
+{
+	assert(IsEmpty());
+
+	delete[] ring;
+}
+
 #ifndef NDEBUG
 
 bool
 MusicPipe::Contains(const music_chunk *chunk) const
 {
-	const ScopeLock protect(mutex);
-
-	for (const struct music_chunk *i = head; i != nullptr; i = i->next)
-		if (i == chunk)
+	const unsigned t = tail.load(std::memory_order_acquire);
+	for (unsigned i = head.load(std::memory_order_acquire); i != t; ++i)
+		if (ring[i & mask] == chunk)
 			return true;
 
 	return false;
@@ -38,36 +69,43 @@ MusicPipe::Contains(const music_chunk *chunk) const
 
 #endif
 
-music_chunk *
-MusicPipe::Shift()
+const music_chunk *
+MusicPipe::GetNext(const music_chunk &chunk) const
 {
-	const ScopeLock protect(mutex);
+	assert(Contains(&chunk));
 
-	music_chunk *chunk = head;
-	if (chunk != nullptr) {
-		assert(!chunk->IsEmpty());
+	const unsigned position = chunk.pipe_position + 1;
+	if (position == tail.load(std::memory_order_acquire))
+		return nullptr;
 
-		head = chunk->next;
-		--size;
+	return ring[position & mask];
+}
 
-		if (head == nullptr) {
-			assert(size == 0);
-			assert(tail_r == &chunk->next);
+music_chunk *
+MusicPipe::Shift()
+{
+	const unsigned h = head.load(std::memory_order_relaxed);
+	if (h == tail.load(std::memory_order_acquire))
+		return nullptr;
 
-			tail_r = &head;
-		} else {
-			assert(size > 0);
-			assert(tail_r != &chunk->next);
-		}
+	music_chunk *chunk = ring[h & mask];
+	assert(chunk != nullptr);
+	assert(!chunk->IsEmpty());
+	assert(chunk->pipe_position == h);
 
 #ifndef NDEBUG
-		/* poison the "next" reference */
-		chunk->next = (music_chunk *)(void *)0x01010101;
+	/* poison the ring slot and the position */
+	ring[h & mask] = nullptr;
+	chunk->pipe_position = h - 1;
+#endif
+
+	head.store(h + 1, std::memory_order_release);
 
-		if (size == 0)
-			audio_format.Clear();
+#ifndef NDEBUG
+	const ScopeLock protect(mutex);
+	if (IsEmpty())
+		audio_format.Clear();
 #endif
-	}
 
 	return chunk;
 }
@@ -87,20 +125,23 @@ MusicPipe::Push(music_chunk *chunk)
 	assert(!chunk->IsEmpty());
 	assert(chunk->length == 0 || chunk->audio_format.IsValid());
 
-	const ScopeLock protect(mutex);
-
-	assert(size > 0 || !audio_format.IsDefined());
-	assert(!audio_format.IsDefined() ||
-	       chunk->CheckFormat(audio_format));
+	const unsigned t = tail.load(std::memory_order_relaxed);
+	assert(t - head.load(std::memory_order_acquire) <= mask);
 
 #ifndef NDEBUG
-	if (!audio_format.IsDefined() && chunk->length > 0)
-		audio_format = chunk->audio_format;
+	{
+		const ScopeLock protect(mutex);
+
+		assert(!audio_format.IsDefined() ||
+		       chunk->CheckFormat(audio_format));
+
+		if (!audio_format.IsDefined() && chunk->length > 0)
+			audio_format = chunk->audio_format;
+	}
 #endif
 
-	chunk->next = nullptr;
-	*tail_r = chunk;
-	tail_r = &chunk->next;
+	chunk->pipe_position = t;
+	ring[t & mask] = chunk;
 
-	++size;
+	tail.store(t + 1, std::memory_order_release);
 }
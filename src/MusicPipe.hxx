@@ -20,13 +20,15 @@
 #ifndef MPD_PIPE_H
 #define MPD_PIPE_H
 
-#include "thread/Mutex.hxx"
 #include "Compiler.h"
 
 #ifndef NDEBUG
+#include "thread/Mutex.hxx"
 #include "AudioFormat.hxx"
 #endif
 
+#include <atomic>
+
 #include <assert.h>
 
 struct music_chunk;
@@ -35,42 +37,65 @@ class MusicBuffer;
 /**
  * A queue of #music_chunk objects.  One party appends chunks at the
  * tail, and the other consumes them from the head.
+ *
+ * This is a lock-free bounded ring of chunk pointers.  There may be
+ * only one producer (calling Push()) and one consumer (calling
+ * Shift() and Clear()) at a time; any number of readers may walk the
+ * queue with Peek() and GetNext(), as long as the consumer is
+ * prevented from shifting the chunk they are looking at (see
+ * MultipleOutputs::IsChunkConsumed()).
  */
 class MusicPipe {
-	/** the first chunk */
-	music_chunk *head;
+	/**
+	 * The ring buffer.  Its size is a power of two, and it is at
+	 * least as large as the #MusicBuffer which the chunks are
+	 * allocated from, so Push() can never overflow.
+	 */
+	music_chunk **const ring;
 
-	/** a pointer to the tail of the chunk */
-	music_chunk **tail_r;
+	/**
+	 * The bit mask for converting a position to a #ring index.
+	 */
+	const unsigned mask;
 
-	/** the current number of chunks */
-	unsigned size;
+	/**
+	 * The position of the first chunk.  It is only modified by
+	 * the consumer.
+	 */
+	std::atomic_uint head;
 
-	/** a mutex which protects #head and #tail_r */
-	mutable Mutex mutex;
+	/**
+	 * The position after the last chunk.  It is only modified by
+	 * the producer.
+	 */
+	std::atomic_uint tail;
 
 #ifndef NDEBUG
+	/**
+	 * A mutex which protects #audio_format.  It is only used for
+	 * debugging, the pipe itself does not need it.
+	 */
+	mutable Mutex mutex;
+
 	AudioFormat audio_format;
 #endif
 
 public:
 	/**
 	 * Creates a new #MusicPipe object.  It is empty.
+	 *
+	 * @param max_size the maximum number of chunks in this
+	 * pipe; this is usually MusicBuffer::GetSize()
 	 */
-	MusicPipe()
-		:head(nullptr), tail_r(&head), size(0) {
-#ifndef NDEBUG
-		audio_format.Clear();
-#endif
-	}
+	explicit MusicPipe(unsigned max_size);
 
 	/**
 	 * Frees the object.  It must be empty now.
 	 */
-	~MusicPipe() {
-		assert(head == nullptr);
-		assert(tail_r == &head);
-	}
+	~MusicPipe();
+
+	MusicPipe(const MusicPipe &) = delete;
+	MusicPipe &operator=(const MusicPipe &) = delete;
 
 #ifndef NDEBUG
 	/**
@@ -79,6 +104,7 @@ public:
 	 */
 	gcc_pure
 	bool CheckFormat(AudioFormat other) const {
+		const ScopeLock protect(mutex);
 		return !audio_format.IsDefined() ||
 			audio_format == other;
 	}
@@ -96,7 +122,29 @@ public:
 	 */
 	gcc_pure
 	const music_chunk *Peek() const {
-		return head;
+		const unsigned h = head.load(std::memory_order_acquire);
+		if (h == tail.load(std::memory_order_acquire))
+			return nullptr;
+
+		return ring[h & mask];
+	}
+
+	/**
+	 * Returns the chunk following the specified one, or nullptr
+	 * if it is the last chunk (so far).  The specified chunk must
+	 * be enqueued in this pipe, and the consumer must not shift
+	 * it during this call.
+	 */
+	gcc_pure
+	const music_chunk *GetNext(const music_chunk &chunk) const;
+
+	/**
+	 * Is the specified chunk (which must be enqueued in this
+	 * pipe) the last one?
+	 */
+	gcc_pure
+	bool IsTail(const music_chunk &chunk) const {
+		return GetNext(chunk) == nullptr;
 	}
 
 	/**
@@ -121,7 +169,10 @@ public:
 	 */
 	gcc_pure
 	unsigned GetSize() const {
-		return size;
+		/* load the head first: it is never ahead of the
+		   tail, and the tail never moves backwards */
+		const unsigned h = head.load(std::memory_order_acquire);
+		return tail.load(std::memory_order_acquire) - h;
 	}
 
 	gcc_pure
@@ -25,6 +25,18 @@
 #include "Idle.hxx"
 #include "GlobalEvents.hxx"
 
+#include <assert.h>
+
+void
+Partition::EmitIdle(unsigned mask)
+{
+	assert(mask != 0);
+
+	const unsigned old_flags = idle_flags.fetch_or(mask);
+	if ((old_flags & mask) != mask)
+		GlobalEvents::Emit(GlobalEvents::IDLE);
+}
+
 #ifdef ENABLE_DATABASE
 
 void
@@ -51,6 +63,24 @@ Partition::SyncWithPlayer()
 	playlist.SyncWithPlayer(pc);
 }
 
+void
+Partition::OnQueueModified()
+{
+	EmitIdle(IDLE_PLAYLIST);
+}
+
+void
+Partition::OnQueueOptionsChanged()
+{
+	EmitIdle(IDLE_OPTIONS);
+}
+
+void
+Partition::OnQueueSongStarted()
+{
+	EmitIdle(IDLE_PLAYER);
+}
+
 void
 Partition::OnPlayerSync()
 {
@@ -63,11 +93,23 @@ Partition::OnPlayerTagModified()
 	GlobalEvents::Emit(GlobalEvents::TAG);
 }
 
+void
+Partition::OnPlayerStateChanged()
+{
+	EmitIdle(IDLE_PLAYER);
+}
+
+void
+Partition::OnPlayerOptionsChanged()
+{
+	EmitIdle(IDLE_OPTIONS);
+}
+
 void
 Partition::OnMixerVolumeChanged(gcc_unused Mixer &mixer, gcc_unused int volume)
 {
 	InvalidateHardwareVolume();
 
 	/* notify clients */
-	idle_add(IDLE_MIXER);
+	EmitIdle(IDLE_MIXER);
 }
@@ -21,11 +21,15 @@
 #define MPD_PARTITION_HXX
 
 #include "Playlist.hxx"
+#include "QueueListener.hxx"
 #include "output/MultipleOutputs.hxx"
 #include "mixer/Listener.hxx"
 #include "PlayerControl.hxx"
 #include "PlayerListener.hxx"
 
+#include <string>
+#include <atomic>
+
 struct Instance;
 class MultipleOutputs;
 class SongLoader;
@@ -34,22 +38,62 @@ class SongLoader;
  * A partition of the Music Player Daemon.  It is a separate unit with
  * a playlist, a player, outputs etc.
  */
-struct Partition final : private PlayerListener, private MixerListener {
+struct Partition final
+	: private QueueListener, private PlayerListener, private MixerListener {
+	/**
+	 * The name of the default partition, which always exists.
+	 */
+	static constexpr const char *DEFAULT_NAME = "default";
+
 	Instance &instance;
 
+	/**
+	 * The name of this partition, as used in the configuration
+	 * and by the "partition" command.
+	 */
+	const std::string name;
+
 	struct playlist playlist;
 
 	MultipleOutputs outputs;
 
 	PlayerControl pc;
 
+	/**
+	 * Idle events which concern only this partition (see
+	 * EmitIdle()), and have not been sent to its clients yet.
+	 */
+	std::atomic_uint idle_flags;
+
 	Partition(Instance &_instance,
+		  const char *_name,
 		  unsigned max_length,
 		  unsigned buffer_chunks,
+		  size_t buffer_chunk_size,
+		  unsigned buffer_chunk_time,
 		  unsigned buffered_before_play)
-		:instance(_instance), playlist(max_length),
+		:instance(_instance), name(_name),
+		 playlist(max_length, *this),
 		 outputs(*this),
-		 pc(*this, outputs, buffer_chunks, buffered_before_play) {}
+		 pc(*this, outputs, buffer_chunks,
+		    buffer_chunk_size, buffer_chunk_time,
+		    buffered_before_play),
+		 idle_flags(0) {}
+
+	/**
+	 * Emit an idle event to the clients which are bound to this
+	 * partition (see idle_add() for global events).  This method
+	 * is thread-safe.
+	 */
+	void EmitIdle(unsigned mask);
+
+	/**
+	 * Atomically reads and resets the flags which were passed to
+	 * EmitIdle().
+	 */
+	unsigned ReadIdle() {
+		return idle_flags.exchange(0);
+	}
 
 	void ClearQueue() {
 		playlist.Clear(pc);
@@ -193,9 +237,16 @@ struct Partition final : private PlayerListener, private MixerListener {
 	void SyncWithPlayer();
 
 private:
+	/* virtual methods from class QueueListener */
+	virtual void OnQueueModified() override;
+	virtual void OnQueueOptionsChanged() override;
+	virtual void OnQueueSongStarted() override;
+
 	/* virtual methods from class PlayerListener */
 	virtual void OnPlayerSync() override;
 	virtual void OnPlayerTagModified() override;
+	virtual void OnPlayerStateChanged() override;
+	virtual void OnPlayerOptionsChanged() override;
 
 	/* virtual methods from class MixerListener */
 	virtual void OnMixerVolumeChanged(Mixer &mixer, int volume) override;
@@ -19,7 +19,7 @@
 
 #include "config.h"
 #include "PlayerControl.hxx"
-#include "Idle.hxx"
+#include "PlayerListener.hxx"
 #include "DetachedSong.hxx"
 
 #include <algorithm>
@@ -29,10 +29,15 @@
 PlayerControl::PlayerControl(PlayerListener &_listener,
 			     MultipleOutputs &_outputs,
 			     unsigned _buffer_chunks,
+			     size_t _buffer_chunk_size,
+			     unsigned _buffer_chunk_time,
 			     unsigned _buffered_before_play)
 	:listener(_listener), outputs(_outputs),
 	 buffer_chunks(_buffer_chunks),
+	 buffer_chunk_size(_buffer_chunk_size),
+	 buffer_chunk_time(_buffer_chunk_time),
 	 buffered_before_play(_buffered_before_play),
+	 decoder_lookahead(false),
 	 command(PlayerCommand::NONE),
 	 state(PlayerState::STOP),
 	 error_type(PlayerError::NONE),
@@ -81,7 +86,7 @@ PlayerControl::Stop()
 	LockSynchronousCommand(PlayerCommand::CLOSE_AUDIO);
 	assert(next_song == nullptr);
 
-	idle_add(IDLE_PLAYER);
+	listener.OnPlayerStateChanged();
 }
 
 void
@@ -98,7 +103,7 @@ PlayerControl::Kill()
 	LockSynchronousCommand(PlayerCommand::EXIT);
 	thread.Join();
 
-	idle_add(IDLE_PLAYER);
+	listener.OnPlayerStateChanged();
 }
 
 void
@@ -106,7 +111,7 @@ PlayerControl::PauseLocked()
 {
 	if (state != PlayerState::STOP) {
 		SynchronousCommand(PlayerCommand::PAUSE);
-		idle_add(IDLE_PLAYER);
+		listener.OnPlayerStateChanged();
 	}
 }
 
@@ -235,7 +240,7 @@ PlayerControl::Seek(DetachedSong *song, float seek_time)
 
 	assert(next_song == nullptr);
 
-	idle_add(IDLE_PLAYER);
+	listener.OnPlayerStateChanged();
 
 	return true;
 }
@@ -247,7 +252,7 @@ PlayerControl::SetCrossFade(float _cross_fade_seconds)
 		_cross_fade_seconds = 0;
 	cross_fade.duration = _cross_fade_seconds;
 
-	idle_add(IDLE_OPTIONS);
+	listener.OnPlayerOptionsChanged();
 }
 
 void
@@ -255,7 +260,7 @@ PlayerControl::SetMixRampDb(float _mixramp_db)
 {
 	cross_fade.mixramp_db = _mixramp_db;
 
-	idle_add(IDLE_OPTIONS);
+	listener.OnPlayerOptionsChanged();
 }
 
 void
@@ -263,5 +268,5 @@ PlayerControl::SetMixRampDelay(float _mixramp_delay_seconds)
 {
 	cross_fade.mixramp_delay = _mixramp_delay_seconds;
 
-	idle_add(IDLE_OPTIONS);
+	listener.OnPlayerOptionsChanged();
 }
@@ -26,8 +26,10 @@
 #include "thread/Thread.hxx"
 #include "util/Error.hxx"
 #include "CrossFade.hxx"
+#include "util/LatencyHistogram.hxx"
 
 #include <stdint.h>
+#include <stddef.h>
 
 class PlayerListener;
 class MultipleOutputs;
@@ -99,8 +101,25 @@ struct PlayerControl {
 
 	unsigned buffer_chunks;
 
+	/**
+	 * The maximum payload size of each chunk in bytes.
+	 */
+	size_t buffer_chunk_size;
+
+	/**
+	 * The target duration of each chunk in milliseconds, or 0 to
+	 * always fill chunks up to #buffer_chunk_size.
+	 */
+	unsigned buffer_chunk_time;
+
 	unsigned int buffered_before_play;
 
+	/**
+	 * Open the next song on a second decoder thread while the
+	 * current one is still being decoded?
+	 */
+	bool decoder_lookahead;
+
 	/**
 	 * The handle of the player thread.
 	 */
@@ -167,6 +186,20 @@ struct PlayerControl {
 
 	double total_play_time;
 
+	/**
+	 * How long the decoder took to fill a chunk, i.e. the time
+	 * between music_chunk::decode_time and
+	 * music_chunk::push_time.  Only the player thread adds
+	 * values.
+	 */
+	LatencyHistogram decode_latency;
+
+	/**
+	 * How long a chunk waited in the decoder's #MusicPipe before
+	 * the player passed it to the outputs.
+	 */
+	LatencyHistogram pipe_latency;
+
 	/**
 	 * If this flag is set, then the player will be auto-paused at
 	 * the end of the song, before the next song starts to play.
@@ -179,6 +212,8 @@ struct PlayerControl {
 	PlayerControl(PlayerListener &_listener,
 		      MultipleOutputs &_outputs,
 		      unsigned buffer_chunks,
+		      size_t buffer_chunk_size,
+		      unsigned buffer_chunk_time,
 		      unsigned buffered_before_play);
 	~PlayerControl();
 
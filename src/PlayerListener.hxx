@@ -31,6 +31,16 @@ public:
 	 * The current song's tag has changed.
 	 */
 	virtual void OnPlayerTagModified() = 0;
+
+	/**
+	 * The player state has changed: play, stop, pause, seek, ...
+	 */
+	virtual void OnPlayerStateChanged() = 0;
+
+	/**
+	 * A player option (e.g. cross-fading) has changed.
+	 */
+	virtual void OnPlayerOptionsChanged() = 0;
 };
 
 #endif
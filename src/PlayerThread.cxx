@@ -27,15 +27,17 @@
 #include "MusicChunk.hxx"
 #include "DetachedSong.hxx"
 #include "system/FatalError.hxx"
+#include "system/Clock.hxx"
 #include "CrossFade.hxx"
 #include "PlayerControl.hxx"
 #include "output/MultipleOutputs.hxx"
 #include "tag/Tag.hxx"
-#include "Idle.hxx"
 #include "util/Domain.hxx"
 #include "thread/Name.hxx"
 #include "Log.hxx"
 
+#include <algorithm>
+
 #include <string.h>
 
 static constexpr Domain player_domain("player");
@@ -49,7 +51,20 @@ enum class CrossFadeState : int8_t {
 class Player {
 	PlayerControl &pc;
 
-	DecoderControl &dc;
+	/**
+	 * The decoder which is decoding the current song, or which
+	 * has already begun decoding the next one.
+	 */
+	DecoderControl *dc;
+
+	/**
+	 * The look-ahead decoder: it opens and initializes the next
+	 * song while #dc is still busy with the current one, and the
+	 * two are swapped when #dc has finished.  nullptr if this
+	 * feature is disabled.  It is busy if its "pipe" attribute is
+	 * set.
+	 */
+	DecoderControl *lookahead;
 
 	MusicBuffer &buffer;
 
@@ -60,6 +75,12 @@ class Player {
 	 */
 	bool buffering;
 
+	/**
+	 * The MonotonicClockUS() value when #buffering was set.  It
+	 * is used to measure how fast the decoder fills the pipe.
+	 */
+	uint64_t buffering_start;
+
 	/**
 	 * true if the decoder is starting and did not provide data
 	 * yet
@@ -133,9 +154,10 @@ class Player {
 
 public:
 	Player(PlayerControl &_pc, DecoderControl &_dc,
+	       DecoderControl *_lookahead,
 	       MusicBuffer &_buffer)
-		:pc(_pc), dc(_dc), buffer(_buffer),
-		 buffering(true),
+		:pc(_pc), dc(&_dc), lookahead(_lookahead), buffer(_buffer),
+		 buffering(true), buffering_start(MonotonicClockUS()),
 		 decoder_starting(false),
 		 decoder_woken(false),
 		 paused(false),
@@ -164,6 +186,26 @@ private:
 		pipe = _pipe;
 	}
 
+	/**
+	 * Wait until the pipe has been filled enough to begin
+	 * playback (again).
+	 */
+	void StartBuffering() {
+		buffering = true;
+		buffering_start = MonotonicClockUS();
+	}
+
+	/**
+	 * Has the pipe been filled enough to begin playback?  This
+	 * compares the rate at which the decoder has filled the pipe
+	 * since StartBuffering() with the playback rate: a fast local
+	 * source may begin before "buffered_before_play" has been
+	 * reached, and a slow remote source has to fill more.
+	 *
+	 * Player lock is not held.
+	 */
+	bool IsBufferingComplete() const;
+
 	/**
 	 * Start the decoder.
 	 *
@@ -187,6 +229,37 @@ private:
 	 */
 	void StopDecoder();
 
+	/**
+	 * Start the look-ahead decoder on the queued song.
+	 *
+	 * Player lock is not held.
+	 */
+	void StartLookahead();
+
+	/**
+	 * Stop the look-ahead decoder (if it is busy) and clear its
+	 * music pipe.
+	 *
+	 * Player lock is not held.
+	 */
+	void StopLookahead();
+
+	/**
+	 * The decoder has finished the current song: make the
+	 * look-ahead decoder the main decoder, and lift its
+	 * #DecoderControl::pipe_limit.
+	 *
+	 * Player lock is not held.
+	 */
+	void PromoteLookahead();
+
+	/**
+	 * Is the look-ahead decoder working on the queued song?
+	 */
+	bool IsLookaheadBusy() const {
+		return lookahead != nullptr && lookahead->pipe != nullptr;
+	}
+
 	/**
 	 * Is the decoder still busy on the same song as the player?
 	 *
@@ -197,7 +270,7 @@ private:
 	bool IsDecoderAtCurrentSong() const {
 		assert(pipe != nullptr);
 
-		return dc.pipe == pipe;
+		return dc->pipe == pipe;
 	}
 
 	/**
@@ -207,7 +280,7 @@ private:
 	 */
 	gcc_pure
 	bool IsDecoderAtNextSong() const {
-		return dc.pipe != nullptr && !IsDecoderAtCurrentSong();
+		return dc->pipe != nullptr && !IsDecoderAtCurrentSong();
 	}
 
 	/**
@@ -217,6 +290,22 @@ private:
 	 */
 	bool SeekDecoder();
 
+	/**
+	 * Attempt to fulfil a seek within the current song by
+	 * dropping chunks from the pipe, without restarting the
+	 * decoder.  This works only if the target position lies
+	 * inside the range which has already been decoded.
+	 *
+	 * The player lock is not held.
+	 *
+	 * @param where the target position; on success, it is
+	 * updated with the position which was actually reached
+	 * (rounded to whole frames)
+	 * @return true if the seek has been completed, false if the
+	 * decoder has to seek
+	 */
+	bool SeekBuffered(double &where);
+
 	/**
 	 * After the decoder has been started asynchronously, wait for
 	 * the "START" command to finish.  The decoder may not be
@@ -295,25 +384,151 @@ Player::StartDecoder(MusicPipe &_pipe)
 	if (pc.command == PlayerCommand::SEEK)
 		start_ms += (unsigned)(pc.seek_where * 1000);
 
-	dc.Start(new DetachedSong(*pc.next_song),
+	dc->Start(new DetachedSong(*pc.next_song),
 		 start_ms, pc.next_song->GetEndMS(),
 		 buffer, _pipe);
 }
 
+/**
+ * The minimum number of chunks in the pipe before playback may
+ * begin, no matter how fast the decoder is.
+ */
+static constexpr unsigned MIN_BUFFERED_CHUNKS = 4;
+
+/**
+ * A local song which is decoded at least this many times faster than
+ * it is played does not need to wait for "buffered_before_play".
+ */
+static constexpr double FAST_DECODER_RATIO = 4.0;
+
+/**
+ * A remote song which is received at least this many times faster
+ * than it is played begins at "buffered_before_play".
+ */
+static constexpr double SAFE_REMOTE_RATIO = 1.25;
+
+/**
+ * A slower remote song fills enough chunks to bridge the deficit for
+ * this many seconds of playback.
+ */
+static constexpr double REMOTE_PROTECT_S = 30;
+
+bool
+Player::IsBufferingComplete() const
+{
+	const unsigned size = pipe->GetSize();
+
+	dc->Lock();
+	const AudioFormat format = dc->out_audio_format;
+	dc->Unlock();
+
+	if (!format.IsDefined() || size < MIN_BUFFERED_CHUNKS)
+		return size >= pc.buffered_before_play;
+
+	/* how many seconds of audio has the decoder delivered per
+	   second of waiting? */
+
+	const double chunk_s = buffer.GetChunkSize(format) /
+		format.GetTimeToSize();
+	const double elapsed_s =
+		(MonotonicClockUS() - buffering_start) / 1000000.;
+	const double ratio = elapsed_s > 0
+		? size * chunk_s / elapsed_s
+		: FAST_DECODER_RATIO;
+
+	if (song == nullptr || !song->IsRemote())
+		return ratio >= FAST_DECODER_RATIO ||
+			size >= pc.buffered_before_play;
+
+	if (size < pc.buffered_before_play)
+		return false;
+
+	if (ratio >= SAFE_REMOTE_RATIO)
+		return true;
+
+	/* the stream is slow: fill the pipe until it can compensate
+	   for the deficit, but leave room for the outputs */
+
+	unsigned target = ratio < 1
+		? unsigned(REMOTE_PROTECT_S * (1 - ratio) / chunk_s) + 1
+		: 0;
+	const unsigned max_target = buffer.GetSize() * 3 / 4;
+	if (target > max_target)
+		target = max_target;
+
+	return size >= target;
+}
+
+void
+Player::StartLookahead()
+{
+	assert(queued);
+	assert(pc.next_song != nullptr);
+	assert(lookahead != nullptr);
+	assert(lookahead->pipe == nullptr);
+
+	/* don't let it take more chunks than it needs to begin
+	   playback; the current song needs the rest of the buffer */
+	const unsigned limit = std::max(pc.buffered_before_play, 1u);
+
+	lookahead->Start(new DetachedSong(*pc.next_song),
+			 pc.next_song->GetStartMS(),
+			 pc.next_song->GetEndMS(),
+			 buffer, *new MusicPipe(buffer.GetSize()),
+			 limit);
+}
+
+void
+Player::StopLookahead()
+{
+	if (!IsLookaheadBusy())
+		return;
+
+	lookahead->Stop();
+
+	lookahead->pipe->Clear(buffer);
+	delete lookahead->pipe;
+	lookahead->pipe = nullptr;
+}
+
+void
+Player::PromoteLookahead()
+{
+	assert(IsLookaheadBusy());
+	assert(dc->pipe == pipe);
+
+	pc.Lock();
+
+	/* the MixRamp and ReplayGain data of the previous song comes
+	   from the other decoder */
+	lookahead->previous_mix_ramp = std::move(dc->mix_ramp);
+	dc->mix_ramp.Clear();
+	lookahead->replay_gain_prev_db = dc->replay_gain_db;
+
+	/* the old decoder is idle; it doesn't own the player's pipe */
+	dc->pipe = nullptr;
+
+	pc.Unlock();
+
+	std::swap(dc, lookahead);
+
+	dc->LockClearPipeLimit();
+}
+
 void
 Player::StopDecoder()
 {
-	dc.Stop();
+	dc->Stop();
 
-	if (dc.pipe != nullptr) {
+	if (dc->pipe != nullptr) {
 		/* clear and free the decoder pipe */
 
-		dc.pipe->Clear(buffer);
+		dc->pipe->Clear(buffer);
 
-		if (dc.pipe != pipe)
-			delete dc.pipe;
+		if (dc->pipe != pipe)
+			delete dc->pipe;
 
-		dc.pipe = nullptr;
+		dc->pipe = nullptr;
 	}
 }
 
@@ -326,7 +541,7 @@ Player::WaitForDecoder()
 	queued = false;
 
 	pc.Lock();
-	Error error = dc.GetError();
+	Error error = dc->GetError();
 	if (error.IsDefined()) {
 		pc.SetError(PlayerError::DECODER, std::move(error));
 
@@ -401,7 +616,7 @@ Player::OpenOutput()
 		pc.state = PlayerState::PLAY;
 		pc.Unlock();
 
-		idle_add(IDLE_PLAYER);
+		pc.listener.OnPlayerStateChanged();
 
 		return true;
 	} else {
@@ -418,7 +633,7 @@ Player::OpenOutput()
 		pc.state = PlayerState::PAUSE;
 		pc.Unlock();
 
-		idle_add(IDLE_PLAYER);
+		pc.listener.OnPlayerStateChanged();
 
 		return false;
 	}
@@ -431,14 +646,14 @@ Player::CheckDecoderStartup()
 
 	pc.Lock();
 
-	Error error = dc.GetError();
+	Error error = dc->GetError();
 	if (error.IsDefined()) {
 		/* the decoder failed */
 		pc.SetError(PlayerError::DECODER, std::move(error));
 		pc.Unlock();
 
 		return false;
-	} else if (!dc.IsStarting()) {
+	} else if (!dc->IsStarting()) {
 		/* the decoder is ready and ok */
 
 		pc.Unlock();
@@ -450,20 +665,20 @@ Player::CheckDecoderStartup()
 			return true;
 
 		pc.Lock();
-		pc.total_time = real_song_duration(*dc.song, dc.total_time);
-		pc.audio_format = dc.in_audio_format;
+		pc.total_time = real_song_duration(*dc->song, dc->total_time);
+		pc.audio_format = dc->in_audio_format;
 		pc.Unlock();
 
-		idle_add(IDLE_PLAYER);
+		pc.listener.OnPlayerStateChanged();
 
-		play_audio_format = dc.out_audio_format;
+		play_audio_format = dc->out_audio_format;
 		decoder_starting = false;
 
 		if (!paused && !OpenOutput()) {
 			FormatError(player_domain,
 				    "problems opening audio device "
 				    "while playing \"%s\"",
-				    dc.song->GetURI());
+				    dc->song->GetURI());
 			return true;
 		}
 
@@ -471,7 +686,7 @@ Player::CheckDecoderStartup()
 	} else {
 		/* the decoder is not yet ready; wait
 		   some more */
-		dc.WaitForDecoder();
+		dc->WaitForDecoder();
 		pc.Unlock();
 
 		return true;
@@ -484,7 +699,7 @@ Player::SendSilence()
 	assert(output_open);
 	assert(play_audio_format.IsDefined());
 
-	struct music_chunk *chunk = buffer.Allocate();
+	struct music_chunk *chunk = buffer.Allocate(play_audio_format);
 	if (chunk == nullptr) {
 		LogError(player_domain, "Failed to allocate silence buffer");
 		return false;
@@ -494,13 +709,10 @@ Player::SendSilence()
 	chunk->audio_format = play_audio_format;
 #endif
 
-	const size_t frame_size = play_audio_format.GetFrameSize();
-	/* this formula ensures that we don't send
-	   partial frames */
-	unsigned num_frames = sizeof(chunk->data) / frame_size;
-
+	/* the capacity is a multiple of the frame size, which
+	   ensures that we don't send partial frames */
 	chunk->times = -1.0; /* undefined time stamp */
-	chunk->length = num_frames * frame_size;
+	chunk->length = chunk->capacity;
 	memset(chunk->data, 0, chunk->length);
 
 	Error error;
@@ -520,7 +732,10 @@ Player::SeekDecoder()
 
 	const unsigned start_ms = pc.next_song->GetStartMS();
 
-	if (!dc.LockIsCurrentSong(*pc.next_song)) {
+	/* the queued song has been replaced by the song to seek in */
+	StopLookahead();
+
+	if (!dc->LockIsCurrentSong(*pc.next_song)) {
 		/* the decoder is already decoding the "next" song -
 		   stop it and start the previous song again */
 
@@ -541,7 +756,7 @@ Player::SeekDecoder()
 		if (!IsDecoderAtCurrentSong()) {
 			/* the decoder is already decoding the "next" song,
 			   but it is the same song file; exchange the pipe */
-			ClearAndReplacePipe(dc.pipe);
+			ClearAndReplacePipe(dc->pipe);
 		}
 
 		delete pc.next_song;
@@ -559,15 +774,22 @@ Player::SeekDecoder()
 		}
 	}
 
-	/* send the SEEK command */
-
 	double where = pc.seek_where;
 	if (where > pc.total_time)
 		where = pc.total_time - 0.1;
 	if (where < 0.0)
 		where = 0.0;
 
-	if (!dc.Seek(where + start_ms / 1000.0)) {
+	if (SeekBuffered(where)) {
+		elapsed_time = where;
+		player_command_finished(pc);
+		pc.outputs.Cancel();
+		return true;
+	}
+
+	/* send the SEEK command */
+
+	if (!dc->Seek(where + start_ms / 1000.0)) {
 		/* decoder failure */
 		player_command_finished(pc);
 		return false;
@@ -580,13 +802,86 @@ Player::SeekDecoder()
 	xfade_state = CrossFadeState::UNKNOWN;
 
 	/* re-fill the buffer after seeking */
-	buffering = true;
+	StartBuffering();
 
 	pc.outputs.Cancel();
 
 	return true;
 }
 
+bool
+Player::SeekBuffered(double &where)
+{
+	if (!IsDecoderAtCurrentSong())
+		return false;
+
+	/* find the chunk which contains the target position; it
+	   must be followed by another chunk, or else we don't know
+	   where it ends */
+
+	const music_chunk *chunk = pipe->Peek();
+	if (chunk == nullptr || chunk->times < 0 || chunk->times > where)
+		return false;
+
+	unsigned n = 0;
+	while (true) {
+		const music_chunk *next = pipe->GetNext(*chunk);
+		if (next == nullptr || next->times < 0)
+			/* beyond the decoded range */
+			return false;
+
+		if (next->times > where)
+			break;
+
+		if (chunk->tag != nullptr)
+			/* don't drop tags */
+			return false;
+
+		chunk = next;
+		++n;
+	}
+
+	/* drop all chunks before it */
+
+	for (unsigned i = 0; i < n; ++i)
+		buffer.Return(pipe->Shift());
+
+	/* ... and the part of it before the target position; the
+	   player is the pipe's only consumer, and nobody else looks
+	   at the chunk, so it may be modified in place */
+
+	music_chunk &head = *const_cast<music_chunk *>(pipe->Peek());
+	assert(&head == chunk);
+
+	const AudioFormat format = dc->out_audio_format;
+	const size_t frame_size = format.GetFrameSize();
+	size_t skip = size_t((where - head.times) * format.sample_rate)
+		* frame_size;
+	if (skip >= head.length)
+		/* keep at least one frame */
+		skip = head.length > frame_size
+			? head.length - frame_size
+			: 0;
+
+	head.data += skip;
+	head.length -= skip;
+	head.capacity -= skip;
+	head.times += double(skip / frame_size) / format.sample_rate;
+	where = head.times;
+
+	FormatDebug(player_domain,
+		    "seeked to %.3f within the buffer, dropped %u chunks "
+		    "and %u bytes",
+		    where, n, (unsigned)skip);
+
+	/* the decoder may be waiting for free buffer space */
+	pc.Lock();
+	dc->Signal();
+	pc.Unlock();
+
+	return true;
+}
+
 inline void
 Player::ProcessCommand()
 {
@@ -608,6 +903,7 @@ Player::ProcessCommand()
 		assert(pc.next_song != nullptr);
 		assert(!queued);
 		assert(!IsDecoderAtNextSong());
+		assert(!IsLookaheadBusy());
 
 		queued = true;
 		pc.CommandFinished();
@@ -658,6 +954,10 @@ Player::ProcessCommand()
 			pc.Unlock();
 			StopDecoder();
 			pc.Lock();
+		} else if (IsLookaheadBusy()) {
+			pc.Unlock();
+			StopLookahead();
+			pc.Lock();
 		}
 
 		delete pc.next_song;
@@ -700,7 +1000,7 @@ update_song_tag(PlayerControl &pc, DetachedSong &song, const Tag &new_tag)
 
 	/* notify all clients that the tag of the current song has
 	   changed */
-	idle_add(IDLE_PLAYER);
+	pc.listener.OnPlayerStateChanged();
 }
 
 /**
@@ -754,7 +1054,7 @@ Player::PlayNextChunk()
 	if (xfade_state == CrossFadeState::ENABLED && IsDecoderAtNextSong() &&
 	    (cross_fade_position = pipe->GetSize()) <= cross_fade_chunks) {
 		/* perform cross fade */
-		music_chunk *other_chunk = dc.pipe->Shift();
+		music_chunk *other_chunk = dc->pipe->Shift();
 
 		if (!cross_fading) {
 			/* beginning of the cross fade - adjust
@@ -781,8 +1081,13 @@ Player::PlayNextChunk()
 			if (pc.cross_fade.mixramp_delay <= 0) {
 				chunk->mix_ratio = ((float)cross_fade_position)
 					     / cross_fade_chunks;
+				chunk->mix_ratio_end =
+					((float)(cross_fade_position - 1))
+					/ cross_fade_chunks;
+				chunk->mix_curve = pc.cross_fade.curve;
 			} else {
 				chunk->mix_ratio = -1;
+				chunk->mix_ratio_end = -1;
 			}
 
 			if (other_chunk->IsEmpty()) {
@@ -803,7 +1108,7 @@ Player::PlayNextChunk()
 
 			pc.Lock();
 
-			if (dc.IsIdle()) {
+			if (dc->IsIdle()) {
 				/* the decoder isn't running, abort
 				   cross fading */
 				pc.Unlock();
@@ -811,8 +1116,8 @@ Player::PlayNextChunk()
 				xfade_state = CrossFadeState::DISABLED;
 			} else {
 				/* wait for the decoder */
-				dc.Signal();
-				dc.WaitForDecoder();
+				dc->Signal();
+				dc->WaitForDecoder();
 				pc.Unlock();
 
 				return true;
@@ -832,6 +1137,13 @@ Player::PlayNextChunk()
 		cross_fade_tag = nullptr;
 	}
 
+	/* latency tracing */
+
+	const uint64_t now = MonotonicClockUS();
+	pc.decode_latency.AddSince(chunk->decode_time, chunk->push_time);
+	pc.pipe_latency.AddSince(chunk->push_time, now);
+	chunk->play_time = now;
+
 	/* play the current chunk */
 
 	Error error;
@@ -851,7 +1163,7 @@ Player::PlayNextChunk()
 
 		pc.Unlock();
 
-		idle_add(IDLE_PLAYER);
+		pc.listener.OnPlayerStateChanged();
 
 		return false;
 	}
@@ -860,12 +1172,12 @@ Player::PlayNextChunk()
 	   with each chunk; it is more efficient to make it decode a
 	   larger block at a time */
 	pc.Lock();
-	if (!dc.IsIdle() &&
-	    dc.pipe->GetSize() <= (pc.buffered_before_play +
+	if (!dc->IsIdle() &&
+	    dc->pipe->GetSize() <= (pc.buffered_before_play +
 				   buffer.GetSize() * 3) / 4) {
 		if (!decoder_woken) {
 			decoder_woken = true;
-			dc.Signal();
+			dc->Signal();
 		}
 	} else
 		decoder_woken = false;
@@ -881,7 +1193,7 @@ Player::SongBorder()
 
 	FormatDefault(player_domain, "played \"%s\"", song->GetURI());
 
-	ReplacePipe(dc.pipe);
+	ReplacePipe(dc->pipe);
 
 	pc.outputs.SongBorder();
 
@@ -899,7 +1211,7 @@ Player::SongBorder()
 	pc.Unlock();
 
 	if (border_pause)
-		idle_add(IDLE_PLAYER);
+		pc.listener.OnPlayerStateChanged();
 
 	return true;
 }
@@ -907,7 +1219,7 @@ Player::SongBorder()
 inline void
 Player::Run()
 {
-	pipe = new MusicPipe();
+	pipe = new MusicPipe(buffer.GetSize());
 
 	StartDecoder(*pipe);
 	if (!WaitForDecoder()) {
@@ -944,8 +1256,7 @@ Player::Run()
 			   until the buffer is large enough, to
 			   prevent stuttering on slow machines */
 
-			if (pipe->GetSize() < pc.buffered_before_play &&
-			    !dc.LockIsIdle()) {
+			if (!IsBufferingComplete() && !dc->LockIsIdle()) {
 				/* not enough decoded buffer space yet */
 
 				if (!paused && output_open &&
@@ -955,11 +1266,17 @@ Player::Run()
 
 				pc.Lock();
 				/* XXX race condition: check decoder again */
-				dc.WaitForDecoder();
+				dc->WaitForDecoder();
 				continue;
 			} else {
 				/* buffering is complete */
 				buffering = false;
+
+				FormatDebug(player_domain,
+					    "buffered %u chunks in %u ms",
+					    pipe->GetSize(),
+					    unsigned((MonotonicClockUS() -
+						      buffering_start) / 1000));
 			}
 		}
 
@@ -977,17 +1294,26 @@ Player::Run()
 		/*
 		music_pipe_check_format(&play_audio_format,
 					next_song_chunk,
-					&dc.out_audio_format);
+					&dc->out_audio_format);
 		*/
 #endif
 
-		if (dc.LockIsIdle() && queued && dc.pipe == pipe) {
+		if (dc->LockIsIdle() && queued && dc->pipe == pipe) {
 			/* the decoder has finished the current song;
 			   make it decode the next song */
 
-			assert(dc.pipe == nullptr || dc.pipe == pipe);
-
-			StartDecoder(*new MusicPipe());
+			assert(dc->pipe == nullptr || dc->pipe == pipe);
+
+			if (IsLookaheadBusy())
+				/* the next song has already been opened */
+				PromoteLookahead();
+			else
+				StartDecoder(*new MusicPipe(buffer.GetSize()));
+		} else if (lookahead != nullptr && queued &&
+			   dc->pipe == pipe && !IsLookaheadBusy()) {
+			/* the decoder is still busy with the current
+			   song; meanwhile, open the next one */
+			StartLookahead();
 		}
 
 		if (/* no cross-fading if MPD is going to pause at the
@@ -995,18 +1321,19 @@ Player::Run()
 		    !pc.border_pause &&
 		    IsDecoderAtNextSong() &&
 		    xfade_state == CrossFadeState::UNKNOWN &&
-		    !dc.LockIsStarting()) {
+		    !dc->LockIsStarting()) {
 			/* enable cross fading in this song?  if yes,
 			   calculate how many chunks will be required
 			   for it */
 			cross_fade_chunks =
-				pc.cross_fade.Calculate(dc.total_time,
-							dc.replay_gain_db,
-							dc.replay_gain_prev_db,
-							dc.GetMixRampStart(),
-							dc.GetMixRampPreviousEnd(),
-							dc.out_audio_format,
+				pc.cross_fade.Calculate(dc->total_time,
+							dc->replay_gain_db,
+							dc->replay_gain_prev_db,
+							dc->GetMixRampStart(),
+							dc->GetMixRampPreviousEnd(),
+							dc->out_audio_format,
 							play_audio_format,
+							buffer.GetChunkSize(dc->out_audio_format),
 							buffer.GetSize() -
 							pc.buffered_before_play);
 			if (cross_fade_chunks > 0) {
@@ -1039,15 +1366,15 @@ Player::Run()
 			/* wake up the decoder (just in case it's
 			   waiting for space in the MusicBuffer) and
 			   wait for it */
-			dc.Signal();
-			dc.WaitForDecoder();
+			dc->Signal();
+			dc->WaitForDecoder();
 			continue;
 		} else if (IsDecoderAtNextSong()) {
 			/* at the beginning of a new song */
 
 			if (!SongBorder())
 				break;
-		} else if (dc.LockIsIdle()) {
+		} else if (dc->LockIsIdle()) {
 			/* check the size of the pipe again, because
 			   the decoder thread may have added something
 			   since we last checked */
@@ -1068,6 +1395,7 @@ Player::Run()
 		pc.Lock();
 	}
 
+	StopLookahead();
 	StopDecoder();
 
 	ClearAndDeletePipe();
@@ -1095,10 +1423,10 @@ Player::Run()
 }
 
 static void
-do_play(PlayerControl &pc, DecoderControl &dc,
+do_play(PlayerControl &pc, DecoderControl &dc, DecoderControl *lookahead,
 	MusicBuffer &buffer)
 {
-	Player player(pc, dc, buffer);
+	Player player(pc, dc, lookahead, buffer);
 	player.Run();
 }
 
@@ -1112,7 +1440,14 @@ player_task(void *arg)
 	DecoderControl dc(pc.mutex, pc.cond);
 	decoder_thread_start(dc);
 
-	MusicBuffer buffer(pc.buffer_chunks);
+	DecoderControl *lookahead = nullptr;
+	if (pc.decoder_lookahead) {
+		lookahead = new DecoderControl(pc.mutex, pc.cond);
+		decoder_thread_start(*lookahead);
+	}
+
+	MusicBuffer buffer(pc.buffer_chunks, pc.buffer_chunk_size,
+			   pc.buffer_chunk_time);
 
 	pc.Lock();
 
@@ -1123,7 +1458,7 @@ player_task(void *arg)
 			assert(pc.next_song != nullptr);
 
 			pc.Unlock();
-			do_play(pc, dc, buffer);
+			do_play(pc, dc, lookahead, buffer);
 			pc.listener.OnPlayerSync();
 			pc.Lock();
 			break;
@@ -1166,6 +1501,11 @@ player_task(void *arg)
 
 			dc.Quit();
 
+			if (lookahead != nullptr) {
+				lookahead->Quit();
+				delete lookahead;
+			}
+
 			pc.outputs.Close();
 
 			player_command_finished(pc);
@@ -22,7 +22,7 @@
 #include "PlaylistError.hxx"
 #include "PlayerControl.hxx"
 #include "DetachedSong.hxx"
-#include "Idle.hxx"
+#include "QueueListener.hxx"
 #include "Log.hxx"
 
 #include <assert.h>
@@ -41,7 +41,7 @@ playlist::TagModified(DetachedSong &&song)
 
 	queue.ModifyAtOrder(current);
 	queue.IncrementVersion();
-	idle_add(IDLE_PLAYLIST);
+	listener.OnQueueModified();
 }
 
 /**
@@ -82,7 +82,7 @@ playlist_song_started(playlist &playlist, PlayerControl &pc)
 	if(playlist.queue.consume)
 		playlist.DeleteOrder(pc, current);
 
-	idle_add(IDLE_PLAYER);
+	playlist.listener.OnQueueSongStarted();
 }
 
 const DetachedSong *
@@ -233,7 +233,7 @@ playlist::SetRepeat(PlayerControl &pc, bool status)
 	   might change when repeat mode is toggled */
 	UpdateQueuedSong(pc, GetQueuedSong());
 
-	idle_add(IDLE_OPTIONS);
+	listener.OnQueueOptionsChanged();
 }
 
 static void
@@ -260,7 +260,7 @@ playlist::SetSingle(PlayerControl &pc, bool status)
 	   might change when single mode is toggled */
 	UpdateQueuedSong(pc, GetQueuedSong());
 
-	idle_add(IDLE_OPTIONS);
+	listener.OnQueueOptionsChanged();
 }
 
 void
@@ -270,7 +270,7 @@ playlist::SetConsume(bool status)
 		return;
 
 	queue.consume = status;
-	idle_add(IDLE_OPTIONS);
+	listener.OnQueueOptionsChanged();
 }
 
 void
@@ -305,7 +305,7 @@ playlist::SetRandom(PlayerControl &pc, bool status)
 
 	UpdateQueuedSong(pc, queued_song);
 
-	idle_add(IDLE_OPTIONS);
+	listener.OnQueueOptionsChanged();
 }
 
 int
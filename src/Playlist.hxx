@@ -24,6 +24,7 @@
 #include "PlaylistError.hxx"
 
 enum TagType : uint8_t;
+class QueueListener;
 struct PlayerControl;
 class DetachedSong;
 class Database;
@@ -72,8 +73,15 @@ struct playlist {
 	 */
 	int queued;
 
-	playlist(unsigned max_length)
-		:queue(max_length), playing(false), current(-1), queued(-1) {
+	/**
+	 * Receives notifications about changes, e.g. to emit idle
+	 * events.
+	 */
+	QueueListener &listener;
+
+	playlist(unsigned max_length, QueueListener &_listener)
+		:queue(max_length), playing(false), current(-1), queued(-1),
+		 listener(_listener) {
 	}
 
 	~playlist() {
@@ -114,7 +122,8 @@ struct playlist {
 protected:
 	/**
 	 * Called by all editing methods after a modification.
-	 * Updates the queue version and emits #IDLE_PLAYLIST.
+	 * Updates the queue version and notifies the
+	 * #QueueListener.
 	 */
 	void OnModified();
 
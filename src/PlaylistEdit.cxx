@@ -31,7 +31,7 @@
 #include "util/Error.hxx"
 #include "DetachedSong.hxx"
 #include "SongLoader.hxx"
-#include "Idle.hxx"
+#include "QueueListener.hxx"
 #include "Log.hxx"
 
 #include <stdlib.h>
@@ -41,7 +41,7 @@ playlist::OnModified()
 {
 	queue.IncrementVersion();
 
-	idle_add(IDLE_PLAYLIST);
+	listener.OnQueueModified();
 }
 
 void
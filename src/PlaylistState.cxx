@@ -186,6 +186,10 @@ playlist_state_restore(const char *line, TextFile &file,
 		} else if (StringStartsWith(line,
 					    PLAYLIST_STATE_FILE_PLAYLIST_BEGIN)) {
 			playlist_state_load(file, song_loader, playlist);
+
+			/* the play queue ends this partition's
+			   section of the state file */
+			break;
 		}
 	}
 
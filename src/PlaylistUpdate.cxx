@@ -23,7 +23,7 @@
 #include "db/LightSong.hxx"
 #include "DetachedSong.hxx"
 #include "tag/Tag.hxx"
-#include "Idle.hxx"
+#include "QueueListener.hxx"
 #include "util/Error.hxx"
 
 static bool
@@ -68,6 +68,6 @@ playlist::DatabaseModified(const Database &db)
 
 	if (modified) {
 		queue.IncrementVersion();
-		idle_add(IDLE_PLAYLIST);
+		listener.OnQueueModified();
 	}
 }
@@ -28,29 +28,42 @@
 #include "SongLoader.hxx"
 #include "fs/FileSystem.hxx"
 #include "util/Domain.hxx"
+#include "util/StringUtil.hxx"
 #include "Log.hxx"
 
 #include <string.h>
 
+#define STATE_FILE_PARTITION "partition: "
+
 static constexpr Domain state_file_domain("state_file");
 
 StateFile::StateFile(AllocatedPath &&_path,
-		     Partition &_partition, EventLoop &_loop)
+		     Instance &_instance, EventLoop &_loop)
 	:TimeoutMonitor(_loop),
 	 path(std::move(_path)), path_utf8(path.ToUTF8()),
-	 partition(_partition),
+	 instance(_instance),
 	 prev_volume_version(0), prev_output_version(0),
 	 prev_playlist_version(0)
 {
 }
 
+unsigned
+StateFile::GetPlaylistHash() const
+{
+	unsigned hash = 0;
+	for (auto *partition : instance.partitions)
+		hash = (hash << 1 | hash >> 31) ^
+			playlist_state_get_hash(partition->playlist,
+						partition->pc);
+	return hash;
+}
+
 void
 StateFile::RememberVersions()
 {
 	prev_volume_version = sw_volume_state_get_hash();
 	prev_output_version = audio_output_state_get_version();
-	prev_playlist_version = playlist_state_get_hash(partition.playlist,
-							partition.pc);
+	prev_playlist_version = GetPlaylistHash();
 }
 
 bool
@@ -58,8 +71,14 @@ StateFile::IsModified() const
 {
 	return prev_volume_version != sw_volume_state_get_hash() ||
 		prev_output_version != audio_output_state_get_version() ||
-		prev_playlist_version != playlist_state_get_hash(partition.playlist,
-								 partition.pc);
+		prev_playlist_version != GetPlaylistHash();
+}
+
+void
+StateFile::Write(FILE *fp, Partition &partition)
+{
+	audio_output_state_save(fp, partition.outputs);
+	playlist_state_save(fp, partition.playlist, partition.pc);
 }
 
 void
@@ -76,14 +95,36 @@ StateFile::Write()
 	}
 
 	save_sw_volume_state(fp);
-	audio_output_state_save(fp, partition.outputs);
-	playlist_state_save(fp, partition.playlist, partition.pc);
+
+	/* the default partition comes first, without a "partition"
+	   line, which keeps the file compatible with older MPD
+	   versions */
+	Write(fp, *instance.partition);
+
+	for (auto *partition : instance.partitions) {
+		if (partition == instance.partition)
+			continue;
+
+		fprintf(fp, STATE_FILE_PARTITION "%s\n",
+			partition->name.c_str());
+		Write(fp, *partition);
+	}
 
 	fclose(fp);
 
 	RememberVersions();
 }
 
+bool
+StateFile::ReadLine(const char *line, TextFile &file,
+		    const SongLoader &song_loader, Partition &partition)
+{
+	return audio_output_state_read(line, partition.outputs) ||
+		playlist_state_restore(line, file, song_loader,
+				       partition.playlist,
+				       partition.pc);
+}
+
 void
 StateFile::Read()
 {
@@ -99,19 +140,39 @@ StateFile::Read()
 	}
 
 #ifdef ENABLE_DATABASE
-	const SongLoader song_loader(partition.instance.database,
-				     partition.instance.storage);
+	const SongLoader song_loader(instance.database, instance.storage);
 #else
 	const SongLoader song_loader(nullptr, nullptr);
 #endif
 
+	/* the section being read; nullptr if that partition does
+	   not exist (anymore) */
+	Partition *partition = instance.partition;
+
 	const char *line;
 	while ((line = file.ReadLine()) != NULL) {
-		success = read_sw_volume_state(line, partition.outputs) ||
-			audio_output_state_read(line, partition.outputs) ||
-			playlist_state_restore(line, file, song_loader,
-					       partition.playlist,
-					       partition.pc);
+		if (StringStartsWith(line, STATE_FILE_PARTITION)) {
+			const char *name =
+				line + sizeof(STATE_FILE_PARTITION) - 1;
+			partition = instance.FindPartition(name);
+			if (partition == nullptr)
+				FormatDebug(state_file_domain,
+					    "Ignoring state of partition '%s'",
+					    name);
+			continue;
+		}
+
+		if (partition == nullptr)
+			continue;
+
+		success = ReadLine(line, file, song_loader, *partition);
+		if (!success)
+			/* the software volume is global; apply it
+			   to the outputs of all partitions */
+			for (auto *p : instance.partitions)
+				success = read_sw_volume_state(line,
+							       p->outputs);
+
 		if (!success)
 			FormatError(state_file_domain,
 				    "Unrecognized line in state file: %s",
@@ -26,13 +26,24 @@
 
 #include <string>
 
+#include <stdio.h>
+
+struct Instance;
 struct Partition;
+class TextFile;
+class SongLoader;
 
+/**
+ * The state file.  It contains the software volume and one section
+ * per partition with its output states and its play queue.  Each
+ * section but the first one (which belongs to the default
+ * partition) begins with a "partition" line.
+ */
 class StateFile final : private TimeoutMonitor {
 	AllocatedPath path;
 	std::string path_utf8;
 
-	Partition &partition;
+	Instance &instance;
 
 	/**
 	 * These version numbers determine whether we need to save the state
@@ -42,7 +53,7 @@ class StateFile final : private TimeoutMonitor {
 		prev_playlist_version;
 
 public:
-	StateFile(AllocatedPath &&path, Partition &partition, EventLoop &loop);
+	StateFile(AllocatedPath &&path, Instance &instance, EventLoop &loop);
 
 	void Read();
 	void Write();
@@ -53,6 +64,20 @@ public:
 	void CheckModified();
 
 private:
+	static void Write(FILE *fp, Partition &partition);
+
+	/**
+	 * Restore one line of a partition's section.
+	 *
+	 * @return false if the line was not recognized
+	 */
+	static bool ReadLine(const char *line, TextFile &file,
+			     const SongLoader &song_loader,
+			     Partition &partition);
+
+	gcc_pure
+	unsigned GetPlaylistHash() const;
+
 	/**
 	 * Save the current state versions for use with IsModified().
 	 */
@@ -26,7 +26,9 @@
 #include "db/Selection.hxx"
 #include "db/Interface.hxx"
 #include "db/Stats.hxx"
+#include "decoder/DecoderCache.hxx"
 #include "util/Error.hxx"
+#include "util/HugeAllocator.hxx"
 #include "system/Clock.hxx"
 #include "Log.hxx"
 
@@ -129,10 +131,33 @@ stats_print(Client &client)
 #else
 		      MonotonicClockS() - start_time,
 #endif
-		      (unsigned long)(client.player_control.GetTotalPlayTime() + 0.5));
+		      (unsigned long)(client.GetPlayerControl().GetTotalPlayTime() + 0.5));
+
+	if (decoder_cache_is_enabled()) {
+		const DecoderCacheStats cache = decoder_cache_get_stats();
+		client_printf(client,
+			      "decoder_cache_hits: %lu\n"
+			      "decoder_cache_misses: %lu\n"
+			      "decoder_cache_songs: %u\n"
+			      "decoder_cache_size: %lu\n",
+			      cache.hits, cache.misses,
+			      cache.n_entries,
+			      (unsigned long)cache.size);
+	}
+
+#ifdef __linux__
+	const HugeStats buffer = HugeGetStats();
+	client_printf(client,
+		      "buffer_size: %lu\n"
+		      "buffer_resident: %lu\n"
+		      "buffer_locked: %lu\n",
+		      (unsigned long)buffer.size,
+		      (unsigned long)buffer.resident,
+		      (unsigned long)buffer.locked);
+#endif
 
 #ifdef ENABLE_DATABASE
-	const Database *db = client.partition.instance.database;
+	const Database *db = client.GetPartition().instance.database;
 	if (db != nullptr)
 		db_stats_print(client, *db);
 #endif
@@ -25,18 +25,30 @@
 
 const Domain client_domain("client");
 
+playlist &
+Client::GetPlaylist()
+{
+	return partition->playlist;
+}
+
+PlayerControl &
+Client::GetPlayerControl()
+{
+	return partition->pc;
+}
+
 #ifdef ENABLE_DATABASE
 
 const Database *
 Client::GetDatabase(Error &error) const
 {
-	return partition.instance.GetDatabase(error);
+	return partition->instance.GetDatabase(error);
 }
 
 const Storage *
 Client::GetStorage() const
 {
-	return partition.instance.storage;
+	return partition->instance.storage;
 }
 
 #endif
@@ -42,11 +42,13 @@ class Database;
 class Storage;
 
 class Client final : private FullyBufferedSocket, TimeoutMonitor {
-public:
-	Partition &partition;
-	struct playlist &playlist;
-	struct PlayerControl &player_control;
+	/**
+	 * The partition this client is currently bound to.  It may be
+	 * changed with the "partition" command.
+	 */
+	Partition *partition;
 
+public:
 	unsigned permission;
 
 	/** the uid of the client process, or -1 if unknown */
@@ -120,6 +122,27 @@ public:
 		return uid > 0;
 	}
 
+	Partition &GetPartition() {
+		return *partition;
+	}
+
+	const Partition &GetPartition() const {
+		return *partition;
+	}
+
+	/**
+	 * Bind this client to another partition.
+	 */
+	void SetPartition(Partition &_partition) {
+		partition = &_partition;
+	}
+
+	gcc_pure
+	struct playlist &GetPlaylist();
+
+	gcc_pure
+	struct PlayerControl &GetPlayerControl();
+
 	unsigned GetPermission() const {
 		return permission;
 	}
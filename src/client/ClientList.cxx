@@ -60,3 +60,13 @@ ClientList::IdleAdd(unsigned flags)
 	for (const auto &client : list)
 		client->IdleAdd(flags);
 }
+
+void
+ClientList::IdleAdd(const Partition &partition, unsigned flags)
+{
+	assert(flags != 0);
+
+	for (const auto &client : list)
+		if (&client->GetPartition() == &partition)
+			client->IdleAdd(flags);
+}
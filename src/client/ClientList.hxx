@@ -23,6 +23,7 @@
 #include <list>
 
 class Client;
+struct Partition;
 
 class ClientList {
 	const unsigned max_size;
@@ -59,6 +60,12 @@ public:
 	void CloseAll();
 
 	void IdleAdd(unsigned flags);
+
+	/**
+	 * Add idle flags to the clients which are bound to the given
+	 * partition.
+	 */
+	void IdleAdd(const Partition &partition, unsigned flags);
 };
 
 #endif
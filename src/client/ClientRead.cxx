@@ -54,7 +54,7 @@ Client::OnSocketInput(void *data, size_t length)
 
 	case CommandResult::KILL:
 		Close();
-		partition.instance.event_loop->Break();
+		partition->instance.event_loop->Break();
 		return InputResult::CLOSED;
 
 	case CommandResult::FINISH:
@@ -91,7 +91,7 @@ handle_match_add(Client &client, int argc, char *argv[], bool fold_case)
 
 	const DatabaseSelection selection("", true, &filter);
 	Error error;
-	return AddFromDatabase(client.partition, selection, error)
+	return AddFromDatabase(client.GetPartition(), selection, error)
 		? CommandResult::OK
 		: print_error(client, error);
 }
@@ -81,7 +81,7 @@ handle_channels(Client &client,
 	assert(argc == 1);
 
 	std::set<std::string> channels;
-	for (const auto &c : *client.partition.instance.client_list)
+	for (const auto &c : *client.GetPartition().instance.client_list)
 		channels.insert(c->subscriptions.begin(),
 				c->subscriptions.end());
 
@@ -122,7 +122,7 @@ handle_send_message(Client &client,
 
 	bool sent = false;
 	const ClientMessage msg(argv[1], argv[2]);
-	for (const auto &c : *client.partition.instance.client_list)
+	for (const auto &c : *client.GetPartition().instance.client_list)
 		if (c->PushMessage(msg))
 			sent = true;
 
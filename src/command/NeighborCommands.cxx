@@ -42,7 +42,7 @@ handle_listneighbors(Client &client,
 		     gcc_unused int argc, gcc_unused char *argv[])
 {
 	const NeighborGlue *const neighbors =
-		client.partition.instance.neighbors;
+		client.GetPartition().instance.neighbors;
 	if (neighbors == nullptr) {
 		command_error(client, ACK_ERROR_UNKNOWN,
 			      "No neighbor plugin configured");
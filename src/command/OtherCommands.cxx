@@ -211,7 +211,7 @@ handle_update(Client &client, int argc, char *argv[], bool discard)
 		}
 	}
 
-	UpdateService *update = client.partition.instance.update;
+	UpdateService *update = client.GetPartition().instance.update;
 	if (update == nullptr) {
 		command_error(client, ACK_ERROR_NO_EXIST, "No database");
 		return CommandResult::ERROR;
@@ -263,7 +263,7 @@ handle_setvol(Client &client, gcc_unused int argc, char *argv[])
 		return CommandResult::ERROR;
 	}
 
-	success = volume_level_change(client.partition.outputs, level);
+	success = volume_level_change(client.GetPartition().outputs, level);
 	if (!success) {
 		command_error(client, ACK_ERROR_SYSTEM,
 			      "problems setting volume");
@@ -285,7 +285,7 @@ handle_volume(Client &client, gcc_unused int argc, char *argv[])
 		return CommandResult::ERROR;
 	}
 
-	const int old_volume = volume_level_get(client.partition.outputs);
+	const int old_volume = volume_level_get(client.GetPartition().outputs);
 	if (old_volume < 0) {
 		command_error(client, ACK_ERROR_SYSTEM, "No mixer");
 		return CommandResult::ERROR;
@@ -298,7 +298,7 @@ handle_volume(Client &client, gcc_unused int argc, char *argv[])
 		new_volume = 100;
 
 	if (new_volume != old_volume &&
-	    !volume_level_change(client.partition.outputs, new_volume)) {
+	    !volume_level_change(client.GetPartition().outputs, new_volume)) {
 		command_error(client, ACK_ERROR_SYSTEM,
 			      "problems setting volume");
 		return CommandResult::ERROR;
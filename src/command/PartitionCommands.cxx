@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "PartitionCommands.hxx"
+#include "protocol/Result.hxx"
+#include "client/Client.hxx"
+#include "Partition.hxx"
+#include "Instance.hxx"
+#include "util/CharUtil.hxx"
+
+CommandResult
+handle_partition(Client &client, gcc_unused int argc, char *argv[])
+{
+	Partition *partition =
+		client.GetPartition().instance.FindPartition(argv[1]);
+	if (partition == nullptr) {
+		command_error(client, ACK_ERROR_NO_EXIST,
+			      "No such partition");
+		return CommandResult::ERROR;
+	}
+
+	client.SetPartition(*partition);
+	return CommandResult::OK;
+}
+
+CommandResult
+handle_listpartitions(Client &client,
+		      gcc_unused int argc, gcc_unused char *argv[])
+{
+	for (const auto *partition : client.GetPartition().instance.partitions)
+		client_printf(client, "partition: %s\n",
+			      partition->name.c_str());
+
+	return CommandResult::OK;
+}
+
+gcc_pure
+static bool
+IsValidPartitionChar(char ch)
+{
+	return IsAlphaNumericASCII(ch) || ch == '-' || ch == '_';
+}
+
+gcc_pure
+static bool
+IsValidPartitionName(const char *name)
+{
+	do {
+		if (!IsValidPartitionChar(*name))
+			return false;
+	} while (*++name != 0);
+
+	return true;
+}
+
+CommandResult
+handle_newpartition(Client &client, gcc_unused int argc, char *argv[])
+{
+	const char *name = argv[1];
+	if (!IsValidPartitionName(name)) {
+		command_error(client, ACK_ERROR_ARG,
+			      "bad partition name");
+		return CommandResult::ERROR;
+	}
+
+	Instance &instance = client.GetPartition().instance;
+	if (instance.FindPartition(name) != nullptr) {
+		command_error(client, ACK_ERROR_EXIST,
+			      "name already exists");
+		return CommandResult::ERROR;
+	}
+
+	instance.NewPartition(name);
+	return CommandResult::OK;
+}
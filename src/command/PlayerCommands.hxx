@@ -42,6 +42,9 @@ handle_pause(Client &client, int argc, char *argv[]);
 CommandResult
 handle_status(Client &client, int argc, char *argv[]);
 
+CommandResult
+handle_latency(Client &client, int argc, char *argv[]);
+
 CommandResult
 handle_next(Client &client, int argc, char *argv[]);
 
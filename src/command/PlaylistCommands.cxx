@@ -51,7 +51,7 @@ print_spl_list(Client &client, const PlaylistVector &list)
 CommandResult
 handle_save(Client &client, gcc_unused int argc, char *argv[])
 {
-	PlaylistResult result = spl_save_playlist(argv[1], client.playlist);
+	PlaylistResult result = spl_save_playlist(argv[1], client.GetPlaylist());
 	return print_playlist_result(client, result);
 }
 
@@ -70,13 +70,13 @@ handle_load(Client &client, int argc, char *argv[])
 	const PlaylistResult result =
 		playlist_open_into_queue(argv[1],
 					 start_index, end_index,
-					 client.playlist,
-					 client.player_control, loader);
+					 client.GetPlaylist(),
+					 client.GetPlayerControl(), loader);
 	if (result != PlaylistResult::NO_SUCH_LIST)
 		return print_playlist_result(client, result);
 
 	Error error;
-	if (playlist_load_spl(client.playlist, client.player_control,
+	if (playlist_load_spl(client.GetPlaylist(), client.GetPlayerControl(),
 			      argv[1], start_index, end_index,
 			      error))
 		return CommandResult::OK;
@@ -64,14 +64,14 @@ handle_add(Client &client, gcc_unused int argc, char *argv[])
 
 	if (uri_has_scheme(uri) || PathTraitsUTF8::IsAbsolute(uri)) {
 		const SongLoader loader(client);
-		auto result = client.partition.AppendURI(loader, uri);
+		auto result = client.GetPartition().AppendURI(loader, uri);
 		return print_playlist_result(client, result);
 	}
 
 #ifdef ENABLE_DATABASE
 	const DatabaseSelection selection(uri, true);
 	Error error;
-	return AddFromDatabase(client.partition, selection, error)
+	return AddFromDatabase(client.GetPartition(), selection, error)
 		? CommandResult::OK
 		: print_error(client, error);
 #else
@@ -90,7 +90,7 @@ handle_addid(Client &client, int argc, char *argv[])
 	const SongLoader loader(client);
 
 	unsigned added_id;
-	auto result = client.partition.AppendURI(loader, uri, &added_id);
+	auto result = client.GetPartition().AppendURI(loader, uri, &added_id);
 
 	if (result != PlaylistResult::SUCCESS)
 		return print_playlist_result(client, result);
@@ -99,11 +99,11 @@ handle_addid(Client &client, int argc, char *argv[])
 		unsigned to;
 		if (!check_unsigned(client, &to, argv[2]))
 			return CommandResult::ERROR;
-		result = client.partition.MoveId(added_id, to);
+		result = client.GetPartition().MoveId(added_id, to);
 		if (result != PlaylistResult::SUCCESS) {
 			CommandResult ret =
 				print_playlist_result(client, result);
-			client.partition.DeleteId(added_id);
+			client.GetPartition().DeleteId(added_id);
 			return ret;
 		}
 	}
@@ -120,7 +120,7 @@ handle_delete(Client &client, gcc_unused int argc, char *argv[])
 	if (!check_range(client, &start, &end, argv[1]))
 		return CommandResult::ERROR;
 
-	PlaylistResult result = client.partition.DeleteRange(start, end);
+	PlaylistResult result = client.GetPartition().DeleteRange(start, end);
 	return print_playlist_result(client, result);
 }
 
@@ -132,7 +132,7 @@ handle_deleteid(Client &client, gcc_unused int argc, char *argv[])
 	if (!check_unsigned(client, &id, argv[1]))
 		return CommandResult::ERROR;
 
-	PlaylistResult result = client.partition.DeleteId(id);
+	PlaylistResult result = client.GetPartition().DeleteId(id);
 	return print_playlist_result(client, result);
 }
 
@@ -140,7 +140,7 @@ CommandResult
 handle_playlist(Client &client,
 		gcc_unused int argc, gcc_unused char *argv[])
 {
-	playlist_print_uris(client, client.playlist);
+	playlist_print_uris(client, client.GetPlaylist());
 	return CommandResult::OK;
 }
 
@@ -148,11 +148,11 @@ CommandResult
 handle_shuffle(gcc_unused Client &client,
 	       gcc_unused int argc, gcc_unused char *argv[])
 {
-	unsigned start = 0, end = client.playlist.queue.GetLength();
+	unsigned start = 0, end = client.GetPlaylist().queue.GetLength();
 	if (argc == 2 && !check_range(client, &start, &end, argv[1]))
 		return CommandResult::ERROR;
 
-	client.partition.Shuffle(start, end);
+	client.GetPartition().Shuffle(start, end);
 	return CommandResult::OK;
 }
 
@@ -160,7 +160,7 @@ CommandResult
 handle_clear(gcc_unused Client &client,
 	     gcc_unused int argc, gcc_unused char *argv[])
 {
-	client.partition.ClearQueue();
+	client.GetPartition().ClearQueue();
 	return CommandResult::OK;
 }
 
@@ -172,7 +172,7 @@ handle_plchanges(Client &client, gcc_unused int argc, char *argv[])
 	if (!check_uint32(client, &version, argv[1]))
 		return CommandResult::ERROR;
 
-	playlist_print_changes_info(client, client.playlist, version);
+	playlist_print_changes_info(client, client.GetPlaylist(), version);
 	return CommandResult::OK;
 }
 
@@ -184,7 +184,7 @@ handle_plchangesposid(Client &client, gcc_unused int argc, char *argv[])
 	if (!check_uint32(client, &version, argv[1]))
 		return CommandResult::ERROR;
 
-	playlist_print_changes_position(client, client.playlist, version);
+	playlist_print_changes_position(client, client.GetPlaylist(), version);
 	return CommandResult::OK;
 }
 
@@ -197,7 +197,7 @@ handle_playlistinfo(Client &client, int argc, char *argv[])
 	if (argc == 2 && !check_range(client, &start, &end, argv[1]))
 		return CommandResult::ERROR;
 
-	ret = playlist_print_info(client, client.playlist, start, end);
+	ret = playlist_print_info(client, client.GetPlaylist(), start, end);
 	if (!ret)
 		return print_playlist_result(client,
 					     PlaylistResult::BAD_RANGE);
@@ -213,12 +213,12 @@ handle_playlistid(Client &client, int argc, char *argv[])
 		if (!check_unsigned(client, &id, argv[1]))
 			return CommandResult::ERROR;
 
-		bool ret = playlist_print_id(client, client.playlist, id);
+		bool ret = playlist_print_id(client, client.GetPlaylist(), id);
 		if (!ret)
 			return print_playlist_result(client,
 						     PlaylistResult::NO_SUCH_SONG);
 	} else {
-		playlist_print_info(client, client.playlist,
+		playlist_print_info(client, client.GetPlaylist(),
 				    0, std::numeric_limits<unsigned>::max());
 	}
 
@@ -235,7 +235,7 @@ handle_playlist_match(Client &client, int argc, char *argv[],
 		return CommandResult::ERROR;
 	}
 
-	playlist_print_find(client, client.playlist, filter);
+	playlist_print_find(client, client.GetPlaylist(), filter);
 	return CommandResult::OK;
 }
 
@@ -272,7 +272,7 @@ handle_prio(Client &client, int argc, char *argv[])
 			return CommandResult::ERROR;
 
 		PlaylistResult result =
-			client.partition.SetPriorityRange(start_position,
+			client.GetPartition().SetPriorityRange(start_position,
 							   end_position,
 							   priority);
 		if (result != PlaylistResult::SUCCESS)
@@ -302,7 +302,7 @@ handle_prioid(Client &client, int argc, char *argv[])
 			return CommandResult::ERROR;
 
 		PlaylistResult result =
-			client.partition.SetPriorityId(song_id, priority);
+			client.GetPartition().SetPriorityId(song_id, priority);
 		if (result != PlaylistResult::SUCCESS)
 			return print_playlist_result(client, result);
 	}
@@ -322,7 +322,7 @@ handle_move(Client &client, gcc_unused int argc, char *argv[])
 		return CommandResult::ERROR;
 
 	PlaylistResult result =
-		client.partition.MoveRange(start, end, to);
+		client.GetPartition().MoveRange(start, end, to);
 	return print_playlist_result(client, result);
 }
 
@@ -336,7 +336,7 @@ handle_moveid(Client &client, gcc_unused int argc, char *argv[])
 		return CommandResult::ERROR;
 	if (!check_int(client, &to, argv[2]))
 		return CommandResult::ERROR;
-	PlaylistResult result = client.partition.MoveId(id, to);
+	PlaylistResult result = client.GetPartition().MoveId(id, to);
 	return print_playlist_result(client, result);
 }
 
@@ -351,7 +351,7 @@ handle_swap(Client &client, gcc_unused int argc, char *argv[])
 		return CommandResult::ERROR;
 
 	PlaylistResult result =
-		client.partition.SwapPositions(song1, song2);
+		client.GetPartition().SwapPositions(song1, song2);
 	return print_playlist_result(client, result);
 }
 
@@ -365,6 +365,6 @@ handle_swapid(Client &client, gcc_unused int argc, char *argv[])
 	if (!check_unsigned(client, &id2, argv[2]))
 		return CommandResult::ERROR;
 
-	PlaylistResult result = client.partition.SwapIds(id1, id2);
+	PlaylistResult result = client.GetPartition().SwapIds(id1, id2);
 	return print_playlist_result(client, result);
 }
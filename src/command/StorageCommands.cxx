@@ -60,7 +60,7 @@ print_storage_uri(Client &client, const Storage &storage)
 CommandResult
 handle_listmounts(Client &client, gcc_unused int argc, gcc_unused char *argv[])
 {
-	Storage *_composite = client.partition.instance.storage;
+	Storage *_composite = client.GetPartition().instance.storage;
 	if (_composite == nullptr) {
 		command_error(client, ACK_ERROR_NO_EXIST, "No database");
 		return CommandResult::ERROR;
@@ -82,7 +82,7 @@ handle_listmounts(Client &client, gcc_unused int argc, gcc_unused char *argv[])
 CommandResult
 handle_mount(Client &client, gcc_unused int argc, char *argv[])
 {
-	Storage *_composite = client.partition.instance.storage;
+	Storage *_composite = client.GetPartition().instance.storage;
 	if (_composite == nullptr) {
 		command_error(client, ACK_ERROR_NO_EXIST, "No database");
 		return CommandResult::ERROR;
@@ -117,7 +117,7 @@ handle_mount(Client &client, gcc_unused int argc, char *argv[])
 CommandResult
 handle_unmount(Client &client, gcc_unused int argc, char *argv[])
 {
-	Storage *_composite = client.partition.instance.storage;
+	Storage *_composite = client.GetPartition().instance.storage;
 	if (_composite == nullptr) {
 		command_error(client, ACK_ERROR_NO_EXIST, "No database");
 		return CommandResult::ERROR;
@@ -53,6 +53,16 @@ enum ConfigOption {
 	CONF_SAMPLERATE_CONVERTER,
 	CONF_AUDIO_BUFFER_SIZE,
 	CONF_BUFFER_BEFORE_PLAY,
+	CONF_AUDIO_CHUNK_SIZE,
+	CONF_AUDIO_CHUNK_TIME,
+	CONF_DECODER_LOOKAHEAD,
+	CONF_DECODER_CACHE_SIZE,
+	CONF_CROSSFADE_CURVE,
+	CONF_BUFFER_HUGE_PAGES,
+	CONF_BUFFER_LOCK,
+	CONF_PARTITION,
+	CONF_VOLUME_DITHER,
+	CONF_FLOAT_PIPELINE,
 	CONF_HTTP_PROXY_HOST,
 	CONF_HTTP_PROXY_PORT,
 	CONF_HTTP_PROXY_USER,
@@ -53,6 +53,16 @@ const ConfigTemplate config_templates[] = {
 	{ "samplerate_converter", false, false },
 	{ "audio_buffer_size", false, false },
 	{ "buffer_before_play", false, false },
+	{ "audio_chunk_size", false, false },
+	{ "audio_chunk_time", false, false },
+	{ "decoder_lookahead", false, false },
+	{ "decoder_cache_size", false, false },
+	{ "crossfade_curve", false, false },
+	{ "buffer_huge_pages", false, false },
+	{ "buffer_lock", false, false },
+	{ "partition", true, true },
+	{ "volume_dither", false, false },
+	{ "float_pipeline", false, false },
 	{ "http_proxy_host", false, false },
 	{ "http_proxy_port", false, false },
 	{ "http_proxy_user", false, false },
@@ -28,6 +28,7 @@
 #include "MusicPipe.hxx"
 #include "DecoderControl.hxx"
 #include "DecoderInternal.hxx"
+#include "DecoderCache.hxx"
 #include "DetachedSong.hxx"
 #include "input/InputStream.hxx"
 #include "util/Error.hxx"
@@ -60,6 +61,11 @@ decoder_initialized(Decoder &decoder,
 	dc.seekable = seekable;
 	dc.total_time = total_time;
 
+	if (decoder.cache_entry != nullptr) {
+		decoder.cache_entry->SetAudioFormat(audio_format);
+		decoder.cache_entry->total_time = total_time;
+	}
+
 	FormatDebug(decoder_domain, "audio_format=%s, seekable=%s",
 		    audio_format_to_string(dc.in_audio_format, &af_string),
 		    seekable ? "true" : "false");
@@ -110,6 +116,10 @@ decoder_prepare_initial_seek(Decoder &decoder)
 		if (!dc.seekable) {
 			/* seeking is not possible */
 			decoder.initial_seek_pending = false;
+
+			/* the decoded data doesn't begin at the
+			   start of the range */
+			decoder.AbortCacheRecording();
 			return false;
 		}
 
@@ -186,6 +196,8 @@ decoder_command_finished(Decoder &decoder)
 	if (decoder.seeking) {
 		decoder.seeking = false;
 
+		decoder.AbortCacheRecording();
+
 		/* delete frames from the old song position */
 
 		if (decoder.chunk != nullptr) {
@@ -229,6 +241,7 @@ void decoder_seek_error(Decoder & decoder)
 		/* d'oh, we can't seek to the sub-song start position,
 		   what now? - no idea, ignoring the problem for now. */
 		decoder.initial_seek_running = false;
+		decoder.AbortCacheRecording();
 		return;
 	}
 
@@ -398,42 +411,104 @@ update_stream_tag(Decoder &decoder, InputStream *is)
 	return true;
 }
 
-DecoderCommand
-decoder_data(Decoder &decoder,
-	     InputStream *is,
-	     const void *data, size_t length,
-	     uint16_t kbit_rate)
+/**
+ * Send the stream tag if it has changed.
+ */
+static DecoderCommand
+decoder_send_stream_tag(Decoder &decoder, InputStream *is)
 {
-	DecoderControl &dc = decoder.dc;
-	DecoderCommand cmd;
+	if (!update_stream_tag(decoder, is))
+		return DecoderCommand::NONE;
+
+	if (decoder.decoder_tag != nullptr) {
+		/* merge with tag from decoder plugin */
+		Tag *tag = Tag::Merge(*decoder.decoder_tag,
+				      *decoder.stream_tag);
+		DecoderCommand cmd = do_send_tag(decoder, *tag);
+		delete tag;
+		return cmd;
+	} else
+		/* send only the stream tag */
+		return do_send_tag(decoder, *decoder.stream_tag);
+}
 
-	assert(dc.state == DecoderState::DECODE);
-	assert(dc.pipe != nullptr);
-	assert(length % dc.in_audio_format.GetFrameSize() == 0);
+/**
+ * Returns the free space at the end of the current chunk, and
+ * allocates a new chunk if there is none.
+ *
+ * @return the buffer, or a "nulled" buffer if a command is pending
+ */
+static WritableBuffer<void>
+decoder_get_chunk_tail(Decoder &decoder, uint16_t kbit_rate)
+{
+	const DecoderControl &dc = decoder.dc;
 
-	dc.Lock();
-	cmd = decoder_get_virtual_command(decoder);
-	dc.Unlock();
+	while (true) {
+		music_chunk *chunk = decoder.GetChunk();
+		if (chunk == nullptr) {
+			assert(dc.command != DecoderCommand::NONE);
+			return WritableBuffer<void>::Null();
+		}
 
-	if (cmd == DecoderCommand::STOP || cmd == DecoderCommand::SEEK ||
-	    length == 0)
-		return cmd;
+		const auto dest =
+			chunk->Write(dc.out_audio_format,
+				     decoder.timestamp -
+				     dc.song->GetStartMS() / 1000.0,
+				     kbit_rate);
+		if (!dest.IsNull())
+			return dest;
 
-	/* send stream tags */
+		/* the chunk is full, flush it */
+		decoder.FlushChunk();
+	}
+}
 
-	if (update_stream_tag(decoder, is)) {
-		if (decoder.decoder_tag != nullptr) {
-			/* merge with tag from decoder plugin */
-			Tag *tag = Tag::Merge(*decoder.decoder_tag,
-					      *decoder.stream_tag);
-			cmd = do_send_tag(decoder, *tag);
-			delete tag;
-		} else
-			/* send only the stream tag */
-			cmd = do_send_tag(decoder, *decoder.stream_tag);
+/**
+ * Commit data which has been written into the buffer returned by
+ * decoder_get_chunk_tail().
+ *
+ * @return DecoderCommand::STOP if the end of the range has been
+ * reached, DecoderCommand::NONE otherwise
+ */
+static DecoderCommand
+decoder_expand_chunk(Decoder &decoder, size_t nbytes)
+{
+	const DecoderControl &dc = decoder.dc;
 
-		if (cmd != DecoderCommand::NONE)
-			return cmd;
+	/* expand the music pipe chunk */
+
+	if (decoder.chunk->Expand(dc.out_audio_format, nbytes))
+		/* the chunk is full, flush it */
+		decoder.FlushChunk();
+
+	decoder.timestamp += (double)nbytes /
+		dc.out_audio_format.GetTimeToSize();
+
+	if (dc.end_ms > 0 &&
+	    decoder.timestamp >= dc.end_ms / 1000.0)
+		/* the end of this range has been reached:
+		   stop decoding */
+		return DecoderCommand::STOP;
+
+	return DecoderCommand::NONE;
+}
+
+/**
+ * Convert PCM data from the decoder plugin to the output format, and
+ * copy it into the music pipe.
+ */
+static DecoderCommand
+decoder_copy_pcm(Decoder &decoder,
+		 const void *data, size_t length,
+		 uint16_t kbit_rate)
+{
+	DecoderControl &dc = decoder.dc;
+
+	if (decoder.cache_entry != nullptr) {
+		decoder.cache_entry->bit_rate = kbit_rate;
+		if (!decoder.cache_entry->Append(data, length))
+			/* too large for the cache */
+			decoder.AbortCacheRecording();
 	}
 
 	if (decoder.convert != nullptr) {
@@ -455,25 +530,9 @@ decoder_data(Decoder &decoder,
 	}
 
 	while (length > 0) {
-		struct music_chunk *chunk;
-		bool full;
-
-		chunk = decoder.GetChunk();
-		if (chunk == nullptr) {
-			assert(dc.command != DecoderCommand::NONE);
+		const auto dest = decoder_get_chunk_tail(decoder, kbit_rate);
+		if (dest.IsNull())
 			return dc.command;
-		}
-
-		const auto dest =
-			chunk->Write(dc.out_audio_format,
-				     decoder.timestamp -
-				     dc.song->GetStartMS() / 1000.0,
-				     kbit_rate);
-		if (dest.IsNull()) {
-			/* the chunk is full, flush it */
-			decoder.FlushChunk();
-			continue;
-		}
 
 		size_t nbytes = dest.size;
 		assert(nbytes > 0);
@@ -485,30 +544,123 @@ decoder_data(Decoder &decoder,
 
 		memcpy(dest.data, data, nbytes);
 
-		/* expand the music pipe chunk */
-
-		full = chunk->Expand(dc.out_audio_format, nbytes);
-		if (full) {
-			/* the chunk is full, flush it */
-			decoder.FlushChunk();
-		}
-
 		data = (const uint8_t *)data + nbytes;
 		length -= nbytes;
 
-		decoder.timestamp += (double)nbytes /
-			dc.out_audio_format.GetTimeToSize();
+		DecoderCommand cmd = decoder_expand_chunk(decoder, nbytes);
+		if (cmd != DecoderCommand::NONE)
+			return cmd;
+	}
 
-		if (dc.end_ms > 0 &&
-		    decoder.timestamp >= dc.end_ms / 1000.0)
-			/* the end of this range has been reached:
-			   stop decoding */
-			return DecoderCommand::STOP;
+	return DecoderCommand::NONE;
+}
+
+DecoderCommand
+decoder_data(Decoder &decoder,
+	     InputStream *is,
+	     const void *data, size_t length,
+	     uint16_t kbit_rate)
+{
+	DecoderControl &dc = decoder.dc;
+	DecoderCommand cmd;
+
+	assert(dc.state == DecoderState::DECODE);
+	assert(dc.pipe != nullptr);
+	assert(length % dc.in_audio_format.GetFrameSize() == 0);
+
+	dc.Lock();
+	cmd = decoder_get_virtual_command(decoder);
+	dc.Unlock();
+
+	if (cmd == DecoderCommand::STOP || cmd == DecoderCommand::SEEK ||
+	    length == 0)
+		return cmd;
+
+	/* send stream tags */
+
+	cmd = decoder_send_stream_tag(decoder, is);
+	if (cmd != DecoderCommand::NONE)
+		return cmd;
+
+	return decoder_copy_pcm(decoder, data, length, kbit_rate);
+}
+
+DecoderCommand
+decoder_write_begin(Decoder &decoder, InputStream *is,
+		    WritableBuffer<void> &buffer)
+{
+	DecoderControl &dc = decoder.dc;
+	DecoderCommand cmd;
+
+	assert(dc.state == DecoderState::DECODE);
+	assert(dc.pipe != nullptr);
+
+	dc.Lock();
+	cmd = decoder_get_virtual_command(decoder);
+	dc.Unlock();
+
+	if (cmd == DecoderCommand::STOP || cmd == DecoderCommand::SEEK)
+		return cmd;
+
+	/* send stream tags */
+
+	cmd = decoder_send_stream_tag(decoder, is);
+	if (cmd != DecoderCommand::NONE)
+		return cmd;
+
+	if (decoder.convert != nullptr) {
+		/* the data needs to be converted; let the plugin
+		   decode into a staging buffer, and do the
+		   conversion in decoder_write_end() */
+		const size_t size = dc.buffer->GetChunkSize(dc.in_audio_format);
+		buffer = { decoder.write_buffer.Get(size), size };
+		return DecoderCommand::NONE;
 	}
 
+	buffer = decoder_get_chunk_tail(decoder, 0);
+	if (buffer.IsNull())
+		return dc.command;
+
 	return DecoderCommand::NONE;
 }
 
+DecoderCommand
+decoder_write_end(Decoder &decoder, size_t length, uint16_t kbit_rate)
+{
+	gcc_unused const DecoderControl &dc = decoder.dc;
+
+	assert(dc.state == DecoderState::DECODE);
+	assert(length % dc.in_audio_format.GetFrameSize() == 0);
+
+	if (length == 0)
+		return DecoderCommand::NONE;
+
+	if (decoder.convert != nullptr)
+		/* this returns the staging buffer filled by the
+		   plugin, because it is already large enough */
+		return decoder_copy_pcm(decoder,
+					decoder.write_buffer.Get(length),
+					length, kbit_rate);
+
+	music_chunk &chunk = *decoder.chunk;
+	assert(chunk.length + length <= chunk.capacity);
+
+	if (decoder.cache_entry != nullptr) {
+		decoder.cache_entry->bit_rate = kbit_rate;
+		if (!decoder.cache_entry->Append(chunk.data + chunk.length,
+						 length))
+			/* too large for the cache */
+			decoder.AbortCacheRecording();
+	}
+
+	if (chunk.length == 0)
+		/* decoder_write_begin() didn't know the bit rate
+		   yet */
+		chunk.bit_rate = kbit_rate;
+
+	return decoder_expand_chunk(decoder, length);
+}
+
 DecoderCommand
 decoder_tag(Decoder &decoder, InputStream *is,
 	    Tag &&tag)
@@ -578,6 +730,12 @@ decoder_replay_gain(Decoder &decoder,
 		decoder.replay_gain_info = *replay_gain_info;
 		decoder.replay_gain_serial = serial;
 
+		if (decoder.cache_entry != nullptr) {
+			decoder.cache_entry->has_replay_gain = true;
+			decoder.cache_entry->replay_gain_info =
+				*replay_gain_info;
+		}
+
 		if (decoder.chunk != nullptr) {
 			/* flush the current chunk because the new
 			   replay gain values affect the following
@@ -593,5 +751,8 @@ decoder_mixramp(Decoder &decoder, MixRampInfo &&mix_ramp)
 {
 	DecoderControl &dc = decoder.dc;
 
+	if (decoder.cache_entry != nullptr)
+		decoder.cache_entry->mix_ramp = mix_ramp;
+
 	dc.SetMixRamp(std::move(mix_ramp));
 }
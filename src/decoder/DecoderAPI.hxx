@@ -37,9 +37,12 @@
 #include "AudioFormat.hxx"
 #include "MixRampInfo.hxx"
 #include "config/ConfigData.hxx"
+#include "util/WritableBuffer.hxx"
 
 // IWYU pragma: end_exports
 
+#include <assert.h>
+
 /**
  * Notify the player thread that it has finished initialization and
  * that it has read the song's meta data.
@@ -169,6 +172,87 @@ decoder_data(Decoder &decoder, InputStream &is,
 	return decoder_data(decoder, &is, data, length, kbit_rate);
 }
 
+/**
+ * Obtain a buffer into which the decoder plugin can decode PCM data
+ * (in the audio format passed to decoder_initialized()) directly,
+ * which saves the copy done by decoder_data().  Usually, this is the
+ * free space at the end of the current music pipe chunk.  If the
+ * data needs to be converted, it is a staging buffer instead.
+ *
+ * The buffer holds at least one frame, and may be smaller than what
+ * the plugin has decoded; the rest is submitted with another
+ * decoder_write_begin() / decoder_write_end() pair.  The plugin must
+ * not call any other decoder API function until it calls
+ * decoder_write_end().
+ *
+ * @param is an input stream which is buffering while we are waiting
+ * for the player
+ * @param buffer the buffer is returned here
+ * @return the current command; the buffer is only valid if this is
+ * DecoderCommand::NONE
+ */
+DecoderCommand
+decoder_write_begin(Decoder &decoder, InputStream *is,
+		    WritableBuffer<void> &buffer);
+
+static inline DecoderCommand
+decoder_write_begin(Decoder &decoder, InputStream &is,
+		    WritableBuffer<void> &buffer)
+{
+	return decoder_write_begin(decoder, &is, buffer);
+}
+
+/**
+ * Submit the PCM data which was written into the buffer returned by
+ * decoder_write_begin().
+ *
+ * @param length the number of bytes written (whole frames)
+ * @return DecoderCommand::STOP if decoding shall stop,
+ * DecoderCommand::NONE otherwise
+ */
+DecoderCommand
+decoder_write_end(Decoder &decoder, size_t length, uint16_t kbit_rate);
+
+/**
+ * Decode PCM data with decoder_write_begin() and
+ * decoder_write_end().  The given function is called (possibly
+ * several times) with a destination pointer, the index of the first
+ * frame and the number of frames it shall write there.
+ *
+ * @return the current command, or DecoderCommand::NONE if there is no
+ * command pending
+ */
+template<typename F>
+static inline DecoderCommand
+decoder_write_frames(Decoder &decoder, InputStream *is,
+		     size_t frame_size, unsigned n_frames,
+		     uint16_t kbit_rate, F &&f)
+{
+	if (n_frames == 0)
+		return decoder_get_command(decoder);
+
+	for (unsigned position = 0; position < n_frames;) {
+		WritableBuffer<void> dest;
+		auto cmd = decoder_write_begin(decoder, is, dest);
+		if (cmd != DecoderCommand::NONE)
+			return cmd;
+
+		unsigned n = dest.size / frame_size;
+		assert(n > 0);
+		if (n > n_frames - position)
+			n = n_frames - position;
+
+		f(dest.data, position, n);
+		position += n;
+
+		cmd = decoder_write_end(decoder, n * frame_size, kbit_rate);
+		if (cmd != DecoderCommand::NONE)
+			return cmd;
+	}
+
+	return DecoderCommand::NONE;
+}
+
 /**
  * This function is called by the decoder plugin when it has
  * successfully decoded a tag.
@@ -0,0 +1,368 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "DecoderCache.hxx"
+#include "config/ConfigGlobal.hxx"
+#include "config/ConfigOption.hxx"
+#include "thread/Mutex.hxx"
+
+#include <algorithm>
+#include <iterator>
+#include <list>
+
+#include <assert.h>
+#include <string.h>
+
+/**
+ * The approximate size of each #DecoderCacheEntry block.
+ */
+static constexpr size_t DECODER_CACHE_BLOCK_SIZE = 256 * 1024;
+
+static Mutex decoder_cache_mutex;
+
+/**
+ * The configured maximum size; 0 means the cache is disabled.  This
+ * is only modified during initialization, and may be read without
+ * holding the mutex.
+ */
+static size_t decoder_cache_max_size;
+
+/**
+ * The sum of DecoderCacheEntry::GetAllocatedSize() of all entries in
+ * #decoder_cache_entries.
+ */
+static size_t decoder_cache_size;
+
+/**
+ * The number of bytes allocated by all entries, i.e. #decoder_cache_size
+ * plus the entries which are being recorded and the evicted entries
+ * which are still being read.  This is what is limited by
+ * #decoder_cache_max_size.
+ */
+static size_t decoder_cache_total_size;
+
+/**
+ * All entries, the most recently used one first.
+ */
+static std::list<DecoderCacheEntry *> decoder_cache_entries;
+
+static unsigned long decoder_cache_hits, decoder_cache_misses;
+
+bool
+decoder_cache_reserve(size_t size);
+
+DecoderCacheEntry::~DecoderCacheEntry()
+{
+	assert(readers == 0);
+
+	for (auto block : blocks)
+		delete[] block;
+}
+
+void
+DecoderCacheEntry::SetAudioFormat(const AudioFormat _audio_format)
+{
+	assert(_audio_format.IsValid());
+	assert(size == 0);
+
+	audio_format = _audio_format;
+
+	const size_t frame_size = audio_format.GetFrameSize();
+	block_size = std::max(DECODER_CACHE_BLOCK_SIZE / frame_size,
+			      size_t(1)) * frame_size;
+}
+
+bool
+DecoderCacheEntry::Append(const void *data, size_t length)
+{
+	assert(block_size > 0);
+	assert(length % audio_format.GetFrameSize() == 0);
+
+	const uint8_t *p = (const uint8_t *)data;
+
+	while (length > 0) {
+		size_t position = size % block_size;
+		if (position == 0 && size == GetAllocatedSize()) {
+			/* all blocks are full */
+			if (!decoder_cache_reserve(block_size))
+				return false;
+
+			blocks.push_back(new uint8_t[block_size]);
+		}
+
+		size_t nbytes = std::min(block_size - position, length);
+		memcpy(blocks[size / block_size] + position, p, nbytes);
+
+		size += nbytes;
+		p += nbytes;
+		length -= nbytes;
+	}
+
+	return true;
+}
+
+ConstBuffer<uint8_t>
+DecoderCacheEntry::Read(size_t offset) const
+{
+	if (offset >= size)
+		return { nullptr, 0 };
+
+	const size_t position = offset % block_size;
+	const size_t end = std::min(offset - position + block_size, size);
+	return { blocks[offset / block_size] + position, end - offset };
+}
+
+uint64_t
+DecoderCacheEntry::TimeToOffset(double t) const
+{
+	assert(audio_format.IsValid());
+
+	t -= start_ms / 1000.;
+	if (t <= 0)
+		return 0;
+
+	return uint64_t(t * audio_format.sample_rate)
+		* audio_format.GetFrameSize();
+}
+
+void
+decoder_cache_init(size_t max_size)
+{
+	assert(decoder_cache_entries.empty());
+
+	decoder_cache_max_size = max_size;
+	decoder_cache_size = decoder_cache_total_size = 0;
+	decoder_cache_hits = decoder_cache_misses = 0;
+}
+
+void
+decoder_cache_global_init()
+{
+	decoder_cache_init(size_t(config_get_unsigned(CONF_DECODER_CACHE_SIZE,
+						      0)) * 1024);
+}
+
+void
+decoder_cache_global_finish()
+{
+	for (auto entry : decoder_cache_entries)
+		delete entry;
+
+	decoder_cache_entries.clear();
+	decoder_cache_size = decoder_cache_total_size = 0;
+}
+
+bool
+decoder_cache_is_enabled()
+{
+	return decoder_cache_max_size > 0;
+}
+
+/**
+ * Remove an entry from the cache, and free it unless it is still
+ * being played.  Caller must lock the mutex.
+ */
+void
+decoder_cache_evict(std::list<DecoderCacheEntry *>::iterator i)
+{
+	DecoderCacheEntry *entry = *i;
+	decoder_cache_entries.erase(i);
+	decoder_cache_size -= entry->GetAllocatedSize();
+
+	if (entry->readers == 0) {
+		decoder_cache_total_size -= entry->GetAllocatedSize();
+		delete entry;
+	} else
+		/* still being played; decoder_cache_release() will
+		   free it */
+		entry->evicted = true;
+}
+
+/**
+ * Count the given number of bytes for an entry which is being
+ * recorded.  The least recently used entries which are not being
+ * read are evicted to make room.
+ *
+ * @return false if the cache is full
+ */
+bool
+decoder_cache_reserve(size_t size)
+{
+	const ScopeLock protect(decoder_cache_mutex);
+
+	auto i = decoder_cache_entries.end();
+	while (decoder_cache_total_size + size > decoder_cache_max_size) {
+		/* evicting an entry which is being read would not
+		   free any memory */
+		do {
+			if (i == decoder_cache_entries.begin())
+				return false;
+			--i;
+		} while ((*i)->readers > 0);
+
+		decoder_cache_evict(i++);
+	}
+
+	decoder_cache_total_size += size;
+	return true;
+}
+
+/**
+ * Find the entry for the given song and range, regardless of its
+ * modification time.
+ */
+gcc_pure
+static std::list<DecoderCacheEntry *>::iterator
+decoder_cache_find(const char *uri, unsigned start_ms, unsigned end_ms)
+{
+	return std::find_if(decoder_cache_entries.begin(),
+			    decoder_cache_entries.end(),
+			    [=](const DecoderCacheEntry *entry){
+				    return entry->start_ms == start_ms &&
+					    entry->end_ms == end_ms &&
+					    entry->uri == uri;
+			    });
+}
+
+DecoderCacheEntry *
+decoder_cache_lookup(const char *uri, time_t mtime,
+		     unsigned start_ms, unsigned end_ms)
+{
+	if (!decoder_cache_is_enabled())
+		return nullptr;
+
+	const ScopeLock protect(decoder_cache_mutex);
+
+	auto i = decoder_cache_find(uri, start_ms, end_ms);
+	if (i == decoder_cache_entries.end()) {
+		++decoder_cache_misses;
+		return nullptr;
+	}
+
+	if ((*i)->mtime != mtime) {
+		/* the file has been modified since it was decoded */
+		decoder_cache_evict(i);
+		++decoder_cache_misses;
+		return nullptr;
+	}
+
+	++decoder_cache_hits;
+
+	/* move to the front of the LRU list */
+	DecoderCacheEntry *entry = *i;
+	decoder_cache_entries.splice(decoder_cache_entries.begin(),
+				     decoder_cache_entries, i);
+
+	++entry->readers;
+	return entry;
+}
+
+void
+decoder_cache_release(DecoderCacheEntry &entry)
+{
+	const ScopeLock protect(decoder_cache_mutex);
+
+	assert(entry.readers > 0);
+
+	if (--entry.readers == 0 && entry.evicted) {
+		decoder_cache_total_size -= entry.GetAllocatedSize();
+		delete &entry;
+	}
+}
+
+DecoderCacheEntry *
+decoder_cache_begin(const char *uri, time_t mtime,
+		    unsigned start_ms, unsigned end_ms)
+{
+	if (!decoder_cache_is_enabled())
+		return nullptr;
+
+	return new DecoderCacheEntry(uri, mtime, start_ms, end_ms);
+}
+
+/**
+ * Free an entry which is not in #decoder_cache_entries.  Caller must
+ * lock the mutex.
+ */
+static void
+decoder_cache_free(DecoderCacheEntry *entry)
+{
+	decoder_cache_total_size -= entry->GetAllocatedSize();
+	delete entry;
+}
+
+void
+decoder_cache_store(DecoderCacheEntry *entry)
+{
+	assert(entry != nullptr);
+	assert(entry->readers == 0);
+	assert(!entry->evicted);
+
+	const ScopeLock protect(decoder_cache_mutex);
+
+	const size_t entry_size = entry->GetAllocatedSize();
+	if (entry_size == 0) {
+		decoder_cache_free(entry);
+		return;
+	}
+
+	/* another decoder may have recorded the same song (or a
+	   newer version of it) meanwhile; or the cache holds an older
+	   version of the file */
+	auto i = decoder_cache_find(entry->uri.c_str(),
+				    entry->start_ms, entry->end_ms);
+	if (i != decoder_cache_entries.end()) {
+		if ((*i)->mtime >= entry->mtime) {
+			decoder_cache_free(entry);
+			return;
+		}
+
+		decoder_cache_evict(i);
+	}
+
+	/* the memory has been counted by Append() already */
+	assert(decoder_cache_size + entry_size <= decoder_cache_total_size);
+	assert(decoder_cache_total_size <= decoder_cache_max_size);
+
+	decoder_cache_entries.push_front(entry);
+	decoder_cache_size += entry_size;
+}
+
+void
+decoder_cache_discard(DecoderCacheEntry *entry)
+{
+	assert(entry != nullptr);
+
+	const ScopeLock protect(decoder_cache_mutex);
+	decoder_cache_free(entry);
+}
+
+DecoderCacheStats
+decoder_cache_get_stats()
+{
+	const ScopeLock protect(decoder_cache_mutex);
+
+	DecoderCacheStats stats;
+	stats.hits = decoder_cache_hits;
+	stats.misses = decoder_cache_misses;
+	stats.n_entries = decoder_cache_entries.size();
+	stats.size = decoder_cache_total_size;
+	return stats;
+}
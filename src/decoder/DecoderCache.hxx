@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/** \file
+ *
+ * A bounded in-memory cache of decoded PCM data.  When a song has
+ * been decoded completely, its PCM data (as emitted by the decoder
+ * plugin) is kept, and the next time the same song (and range) is
+ * played or seeked in, it is served from the cache instead of
+ * running the decoder plugin again.  Entries are keyed by the file's
+ * modification time, so a file which was replaced is decoded again.
+ */
+
+#ifndef MPD_DECODER_CACHE_HXX
+#define MPD_DECODER_CACHE_HXX
+
+#include "AudioFormat.hxx"
+#include "ReplayGainInfo.hxx"
+#include "MixRampInfo.hxx"
+#include "util/ConstBuffer.hxx"
+#include "Compiler.h"
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * The decoded PCM data of one song.  While it is being recorded, it
+ * is owned by the decoder; after decoder_cache_store(), it is owned
+ * by the cache, and decoder_cache_lookup() hands out references.
+ */
+class DecoderCacheEntry {
+	friend DecoderCacheEntry *decoder_cache_lookup(const char *uri,
+						       time_t mtime,
+						       unsigned start_ms,
+						       unsigned end_ms);
+	friend void decoder_cache_store(DecoderCacheEntry *entry);
+	friend void decoder_cache_release(DecoderCacheEntry &entry);
+	friend void decoder_cache_evict(std::list<DecoderCacheEntry *>::iterator i);
+	friend bool decoder_cache_reserve(size_t size);
+
+	/**
+	 * The PCM data, split into blocks of #block_size bytes each.
+	 */
+	std::vector<uint8_t *> blocks;
+
+	/**
+	 * The size of each block.  It is a multiple of the frame
+	 * size, so every block contains only whole frames.
+	 */
+	size_t block_size;
+
+	/**
+	 * The number of bytes stored in #blocks.
+	 */
+	size_t size;
+
+	/**
+	 * The number of decoder_cache_lookup() callers which are
+	 * still using this entry.  Protected by the cache's mutex.
+	 */
+	unsigned readers;
+
+	/**
+	 * Has this entry been evicted from the cache while it was
+	 * still being read?  Then decoder_cache_release() frees it.
+	 */
+	bool evicted;
+
+public:
+	const std::string uri;
+
+	/**
+	 * The modification time of the file when it was decoded.
+	 */
+	const time_t mtime;
+
+	const unsigned start_ms, end_ms;
+
+	/**
+	 * The audio format emitted by the decoder plugin.
+	 */
+	AudioFormat audio_format;
+
+	float total_time;
+	uint16_t bit_rate;
+
+	bool has_replay_gain;
+	ReplayGainInfo replay_gain_info;
+
+	MixRampInfo mix_ramp;
+
+	DecoderCacheEntry(const char *_uri, time_t _mtime,
+			  unsigned _start_ms, unsigned _end_ms)
+		:block_size(0), size(0), readers(0), evicted(false),
+		 uri(_uri), mtime(_mtime),
+		 start_ms(_start_ms), end_ms(_end_ms),
+		 audio_format(AudioFormat::Undefined()),
+		 total_time(-1), bit_rate(0),
+		 has_replay_gain(false) {}
+
+	~DecoderCacheEntry();
+
+	DecoderCacheEntry(const DecoderCacheEntry &) = delete;
+	DecoderCacheEntry &operator=(const DecoderCacheEntry &) = delete;
+
+	/**
+	 * Returns the number of bytes of PCM data in this entry.
+	 */
+	size_t GetSize() const {
+		return size;
+	}
+
+	/**
+	 * Returns the number of bytes allocated by this entry.
+	 */
+	size_t GetAllocatedSize() const {
+		return blocks.size() * block_size;
+	}
+
+	/**
+	 * Set the audio format.  Must be called before the first
+	 * Append() call.
+	 */
+	void SetAudioFormat(AudioFormat _audio_format);
+
+	/**
+	 * Append PCM data (whole frames).  New blocks are counted
+	 * against the cache size; the least recently used entries
+	 * which are not being played are evicted to make room.
+	 *
+	 * @return false if the cache has no room left; the entry
+	 * should then be discarded
+	 */
+	bool Append(const void *data, size_t length);
+
+	/**
+	 * Returns the data at the given byte offset, up to the end of
+	 * the block containing it.  Returns an empty buffer at the
+	 * end.
+	 */
+	gcc_pure
+	ConstBuffer<uint8_t> Read(size_t offset) const;
+
+	/**
+	 * Convert a song position (in seconds, relative to the start
+	 * of the file) to a byte offset.  The result is aligned to
+	 * whole frames and may be past the end of the data.
+	 */
+	gcc_pure
+	uint64_t TimeToOffset(double t) const;
+};
+
+struct DecoderCacheStats {
+	/**
+	 * The number of songs which were served from the cache.
+	 */
+	unsigned long hits;
+
+	/**
+	 * The number of songs which were not in the cache.
+	 */
+	unsigned long misses;
+
+	/**
+	 * The number of cached songs.
+	 */
+	unsigned n_entries;
+
+	/**
+	 * The number of bytes allocated by the cache, including songs
+	 * which are being recorded and evicted songs which are still
+	 * being played.
+	 */
+	size_t size;
+};
+
+/**
+ * Initialize the cache.  A size of 0 disables it.
+ */
+void
+decoder_cache_init(size_t max_size);
+
+/**
+ * Read the "decoder_cache_size" setting and initialize the cache.
+ */
+void
+decoder_cache_global_init();
+
+void
+decoder_cache_global_finish();
+
+gcc_pure
+bool
+decoder_cache_is_enabled();
+
+/**
+ * Look up the decoded data of a song, and count a hit or a miss.
+ * The caller must call decoder_cache_release() when finished.  An
+ * entry with a different modification time is stale; it is evicted.
+ *
+ * @param mtime the current modification time of the file
+ * @return the entry or nullptr if it is not in the cache
+ */
+DecoderCacheEntry *
+decoder_cache_lookup(const char *uri, time_t mtime,
+		     unsigned start_ms, unsigned end_ms);
+
+/**
+ * Release an entry obtained by decoder_cache_lookup().
+ */
+void
+decoder_cache_release(DecoderCacheEntry &entry);
+
+/**
+ * Create a new entry for recording a song, or return nullptr if the
+ * cache is disabled.  It must either be passed to
+ * decoder_cache_store() or to decoder_cache_discard().
+ */
+DecoderCacheEntry *
+decoder_cache_begin(const char *uri, time_t mtime,
+		    unsigned start_ms, unsigned end_ms);
+
+/**
+ * Insert a completely recorded entry into the cache, evicting the
+ * least recently used entries and a stale entry of the same song to
+ * make room.  The cache takes over ownership.
+ */
+void
+decoder_cache_store(DecoderCacheEntry *entry);
+
+/**
+ * Free an entry obtained by decoder_cache_begin() which shall not be
+ * stored, and give its memory back to the cache.
+ */
+void
+decoder_cache_discard(DecoderCacheEntry *entry);
+
+gcc_pure
+DecoderCacheStats
+decoder_cache_get_stats();
+
+#endif
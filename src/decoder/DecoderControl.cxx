@@ -30,6 +30,7 @@ DecoderControl::DecoderControl(Mutex &_mutex, Cond &_client_cond)
 	 command(DecoderCommand::NONE),
 	 client_is_waiting(false),
 	 song(nullptr),
+	 pipe(nullptr), pipe_limit(0),
 	 replay_gain_db(0), replay_gain_prev_db(0) {}
 
 DecoderControl::~DecoderControl()
@@ -71,7 +72,8 @@ DecoderControl::IsCurrentSong(const DetachedSong &_song) const
 void
 DecoderControl::Start(DetachedSong *_song,
 		      unsigned _start_ms, unsigned _end_ms,
-		      MusicBuffer &_buffer, MusicPipe &_pipe)
+		      MusicBuffer &_buffer, MusicPipe &_pipe,
+		      unsigned _pipe_limit)
 {
 	assert(_song != nullptr);
 	assert(_pipe.IsEmpty());
@@ -82,10 +84,18 @@ DecoderControl::Start(DetachedSong *_song,
 	end_ms = _end_ms;
 	buffer = &_buffer;
 	pipe = &_pipe;
+	pipe_limit = _pipe_limit;
 
 	LockSynchronousCommand(DecoderCommand::START);
 }
 
+bool
+DecoderControl::IsPipeLimitReached() const
+{
+	const unsigned limit = pipe_limit.load(std::memory_order_relaxed);
+	return limit > 0 && pipe->GetSize() >= limit;
+}
+
 void
 DecoderControl::Stop()
 {
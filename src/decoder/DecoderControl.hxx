@@ -28,6 +28,8 @@
 #include "thread/Thread.hxx"
 #include "util/Error.hxx"
 
+#include <atomic>
+
 #include <assert.h>
 #include <stdint.h>
 
@@ -153,6 +155,17 @@ struct DecoderControl {
 	 */
 	MusicPipe *pipe;
 
+	/**
+	 * If non-zero, the decoder waits while #pipe contains this
+	 * many chunks.  This allows priming a decoder for the next
+	 * song without letting it take over the #MusicBuffer.
+	 *
+	 * This attribute is modified while #mutex is locked, but the
+	 * decoder reads it without the lock, so it doesn't need the
+	 * lock for each chunk.
+	 */
+	std::atomic<unsigned> pipe_limit;
+
 	float replay_gain_db;
 	float replay_gain_prev_db;
 
@@ -359,9 +372,29 @@ public:
 	 * @param end_ms see #DecoderControl
 	 * @param pipe the pipe which receives the decoded chunks (owned by
 	 * the caller)
+	 * @param pipe_limit see #pipe_limit
 	 */
 	void Start(DetachedSong *song, unsigned start_ms, unsigned end_ms,
-		   MusicBuffer &buffer, MusicPipe &pipe);
+		   MusicBuffer &buffer, MusicPipe &pipe,
+		   unsigned pipe_limit=0);
+
+	/**
+	 * Allow the decoder to fill the whole #MusicBuffer again
+	 * after it was started with a #pipe_limit.
+	 */
+	void LockClearPipeLimit() {
+		Lock();
+		pipe_limit = 0;
+		Signal();
+		Unlock();
+	}
+
+	/**
+	 * Has the decoder reached the #pipe_limit?  This may be called
+	 * without locking the object.
+	 */
+	gcc_pure
+	bool IsPipeLimitReached() const;
 
 	void Stop();
 
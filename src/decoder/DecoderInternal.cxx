@@ -24,7 +24,9 @@
 #include "MusicPipe.hxx"
 #include "MusicBuffer.hxx"
 #include "MusicChunk.hxx"
+#include "DecoderCache.hxx"
 #include "tag/Tag.hxx"
+#include "system/Clock.hxx"
 
 #include <assert.h>
 
@@ -33,6 +35,9 @@ Decoder::~Decoder()
 	/* caller must flush the chunk */
 	assert(chunk == nullptr);
 
+	if (cache_entry != nullptr)
+		decoder_cache_discard(cache_entry);
+
 	if (convert != nullptr) {
 		convert->Close();
 		delete convert;
@@ -65,17 +70,29 @@ Decoder::GetChunk()
 		return chunk;
 
 	do {
-		chunk = dc.buffer->Allocate();
-		if (chunk != nullptr) {
-			chunk->replay_gain_serial = replay_gain_serial;
-			if (replay_gain_serial != 0)
-				chunk->replay_gain_info = replay_gain_info;
-
-			return chunk;
+		/* neither the pipe limit nor the buffer needs the
+		   lock; it's only taken to wait */
+		const bool limited = dc.IsPipeLimitReached();
+		if (!limited) {
+			chunk = dc.buffer->Allocate(dc.out_audio_format);
+			if (chunk != nullptr) {
+				chunk->decode_time = MonotonicClockUS();
+				chunk->replay_gain_serial = replay_gain_serial;
+				if (replay_gain_serial != 0)
+					chunk->replay_gain_info = replay_gain_info;
+
+				return chunk;
+			}
 		}
 
 		dc.Lock();
-		cmd = need_chunks(dc);
+
+		/* LockClearPipeLimit() may have signalled before we
+		   got the lock; check again so we don't wait for that
+		   signal */
+		cmd = limited && !dc.IsPipeLimitReached()
+			? dc.command
+			: need_chunks(dc);
 		dc.Unlock();
 	} while (cmd == DecoderCommand::NONE);
 
@@ -89,8 +106,10 @@ Decoder::FlushChunk()
 
 	if (chunk->IsEmpty())
 		dc.buffer->Return(chunk);
-	else
+	else {
+		chunk->push_time = MonotonicClockUS();
 		dc.pipe->Push(chunk);
+	}
 
 	chunk = nullptr;
 
@@ -99,3 +118,11 @@ Decoder::FlushChunk()
 		dc.client_cond.signal();
 	dc.Unlock();
 }
+
+void
+Decoder::AbortCacheRecording()
+{
+	if (cache_entry != nullptr)
+		decoder_cache_discard(cache_entry);
+	cache_entry = nullptr;
+}
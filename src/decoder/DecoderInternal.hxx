@@ -21,9 +21,11 @@
 #define MPD_DECODER_INTERNAL_HXX
 
 #include "ReplayGainInfo.hxx"
+#include "pcm/PcmBuffer.hxx"
 #include "util/Error.hxx"
 
 class PcmConvert;
+class DecoderCacheEntry;
 struct DecoderControl;
 struct Tag;
 
@@ -78,6 +80,18 @@ struct Decoder {
 	/** the chunk currently being written to */
 	struct music_chunk *chunk;
 
+	/**
+	 * The decoded data is being recorded into this
+	 * #DecoderCacheEntry, or nullptr if it is not.
+	 */
+	DecoderCacheEntry *cache_entry;
+
+	/**
+	 * The buffer returned by decoder_write_begin() if the PCM
+	 * data must be converted before it can be added to a chunk.
+	 */
+	PcmBuffer write_buffer;
+
 	ReplayGainInfo replay_gain_info;
 
 	/**
@@ -101,6 +115,7 @@ struct Decoder {
 		 seeking(false),
 		 song_tag(_tag), stream_tag(nullptr), decoder_tag(nullptr),
 		 chunk(nullptr),
+		 cache_entry(nullptr),
 		 replay_gain_serial(0) {
 	}
 
@@ -120,6 +135,12 @@ struct Decoder {
 	 * Caller must not lock the #DecoderControl object.
 	 */
 	void FlushChunk();
+
+	/**
+	 * Stop recording into #cache_entry, because the decoded data
+	 * will be incomplete.
+	 */
+	void AbortCacheRecording();
 };
 
 #endif
@@ -22,6 +22,7 @@
 #include "DecoderControl.hxx"
 #include "DecoderInternal.hxx"
 #include "DecoderError.hxx"
+#include "DecoderCache.hxx"
 #include "DecoderPlugin.hxx"
 #include "DetachedSong.hxx"
 #include "system/FatalError.hxx"
@@ -355,6 +356,53 @@ decoder_run_file(Decoder &decoder, const char *uri_utf8, Path path_fs)
 	return false;
 }
 
+/**
+ * Play a song from the #DecoderCache, using the same API as a decoder
+ * plugin.
+ *
+ * DecoderControl::mutex is not locked by caller.
+ */
+static void
+decoder_run_cached(Decoder &decoder, const DecoderCacheEntry &entry)
+{
+	FormatDebug(decoder_thread_domain, "playing %s from the cache",
+		    entry.uri.c_str());
+
+	decoder_initialized(decoder, entry.audio_format, true,
+			    entry.total_time);
+
+	if (entry.has_replay_gain)
+		decoder_replay_gain(decoder, &entry.replay_gain_info);
+
+	if (entry.mix_ramp.IsDefined()) {
+		MixRampInfo mix_ramp(entry.mix_ramp);
+		decoder_mixramp(decoder, std::move(mix_ramp));
+	}
+
+	size_t offset = 0;
+	while (true) {
+		const auto src = entry.Read(offset);
+		if (src.IsEmpty())
+			break;
+
+		const DecoderCommand cmd =
+			decoder_data(decoder, nullptr, src.data, src.size,
+				     entry.bit_rate);
+		if (cmd == DecoderCommand::SEEK) {
+			const uint64_t where =
+				entry.TimeToOffset(decoder_seek_where(decoder));
+			if (where <= entry.GetSize()) {
+				offset = size_t(where);
+				decoder_command_finished(decoder);
+			} else
+				decoder_seek_error(decoder);
+		} else if (cmd != DecoderCommand::NONE)
+			break;
+		else
+			offset += src.size;
+	}
+}
+
 static void
 decoder_run_song(DecoderControl &dc,
 		 const DetachedSong &song, const char *uri, Path path_fs)
@@ -367,12 +415,45 @@ decoder_run_song(DecoderControl &dc,
 
 	decoder_command_finished_locked(dc);
 
-	ret = !path_fs.IsNull()
-		? decoder_run_file(decoder, uri, path_fs)
-		: decoder_run_stream(decoder, uri);
+	/* only local files are cached; remote streams may change
+	   any time; the modification time is part of the key, because
+	   a file may be replaced (the database update refreshes it in
+	   the queue) */
+	DecoderCacheEntry *cached = nullptr;
+	if (!path_fs.IsNull()) {
+		const time_t mtime = song.GetLastModified();
+		cached = decoder_cache_lookup(uri, mtime,
+					      dc.start_ms, dc.end_ms);
+		if (cached == nullptr)
+			decoder.cache_entry =
+				decoder_cache_begin(uri, mtime, dc.start_ms,
+						    dc.end_ms);
+	}
+
+	if (cached != nullptr) {
+		dc.Unlock();
+		decoder_run_cached(decoder, *cached);
+		decoder_cache_release(*cached);
+		dc.Lock();
+		ret = true;
+	} else
+		ret = !path_fs.IsNull()
+			? decoder_run_file(decoder, uri, path_fs)
+			: decoder_run_stream(decoder, uri);
+
+	/* keep the recorded data only if the song has been decoded
+	   completely */
+	const bool store_cache = decoder.cache_entry != nullptr && ret &&
+		!decoder.error.IsDefined() &&
+		dc.command == DecoderCommand::NONE;
 
 	dc.Unlock();
 
+	if (store_cache) {
+		decoder_cache_store(decoder.cache_entry);
+		decoder.cache_entry = nullptr;
+	}
+
 	/* flush the last chunk */
 
 	if (decoder.chunk != nullptr)
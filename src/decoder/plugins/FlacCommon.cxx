@@ -151,28 +151,30 @@ flac_common_write(struct flac_data *data, const FLAC__Frame * frame,
 		  const FLAC__int32 *const buf[],
 		  FLAC__uint64 nbytes)
 {
-	void *buffer;
 	unsigned bit_rate;
 
 	if (!data->initialized && !flac_got_first_frame(data, &frame->header))
 		return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
 
-	size_t buffer_size = frame->header.blocksize * data->frame_size;
-	buffer = data->buffer.Get(buffer_size);
-
-	flac_convert(buffer, frame->header.channels,
-		     data->audio_format.format, buf,
-		     0, frame->header.blocksize);
-
 	if (nbytes > 0)
 		bit_rate = nbytes * 8 * frame->header.sample_rate /
 			(1000 * frame->header.blocksize);
 	else
 		bit_rate = 0;
 
-	auto cmd = decoder_data(data->decoder, data->input_stream,
-				buffer, buffer_size,
-				bit_rate);
+	/* convert straight into the music pipe */
+	const unsigned channels = frame->header.channels;
+	const SampleFormat format = data->audio_format.format;
+	auto cmd = decoder_write_frames(data->decoder, &data->input_stream,
+					data->frame_size,
+					frame->header.blocksize, bit_rate,
+					[=](void *dest, unsigned position,
+					    unsigned n){
+						flac_convert(dest, channels,
+							     format, buf,
+							     position,
+							     position + n);
+					});
 	data->next_frame += frame->header.blocksize;
 	switch (cmd) {
 	case DecoderCommand::NONE:
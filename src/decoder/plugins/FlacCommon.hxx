@@ -26,13 +26,10 @@
 
 #include "FlacInput.hxx"
 #include "../DecoderAPI.hxx"
-#include "pcm/PcmBuffer.hxx"
 
 #include <FLAC/stream_decoder.h>
 
 struct flac_data : public FlacInput {
-	PcmBuffer buffer;
-
 	/**
 	 * The size of one frame in the output buffer.
 	 */
@@ -112,15 +112,12 @@ mp3_plugin_init(gcc_unused const config_param &param)
 	return true;
 }
 
-#define MP3_DATA_OUTPUT_BUFFER_SIZE 2048
-
 struct MadDecoder {
 	struct mad_stream stream;
 	struct mad_frame frame;
 	struct mad_synth synth;
 	mad_timer_t timer;
 	unsigned char input_buffer[READ_BUFFER_SIZE];
-	int32_t output_buffer[MP3_DATA_OUTPUT_BUFFER_SIZE];
 	float total_time;
 	float elapsed_time;
 	float seek_where;
@@ -171,13 +168,14 @@ struct MadDecoder {
 	void UpdateTimerNextFrame();
 
 	/**
-	 * Sends the synthesized current frame via decoder_data().
+	 * Sends the synthesized current frame via
+	 * decoder_write_frames().
 	 */
 	DecoderCommand SendPCM(unsigned i, unsigned pcm_length);
 
 	/**
 	 * Synthesize the current frame and send it via
-	 * decoder_data().
+	 * decoder_write_frames().
 	 */
 	DecoderCommand SyncAndSend();
 
@@ -931,32 +929,24 @@ MadDecoder::UpdateTimerNextFrame()
 DecoderCommand
 MadDecoder::SendPCM(unsigned i, unsigned pcm_length)
 {
-	unsigned max_samples;
-
-	max_samples = sizeof(output_buffer) /
-		sizeof(output_buffer[0]) /
-		MAD_NCHANNELS(&frame.header);
-
-	while (i < pcm_length) {
-		unsigned int num_samples = pcm_length - i;
-		if (num_samples > max_samples)
-			num_samples = max_samples;
-
-		i += num_samples;
+	const unsigned num_channels = MAD_NCHANNELS(&frame.header);
 
-		mad_fixed_to_24_buffer(output_buffer, &synth,
-				       i - num_samples, i,
-				       MAD_NCHANNELS(&frame.header));
-		num_samples *= MAD_NCHANNELS(&frame.header);
-
-		auto cmd = decoder_data(*decoder, input_stream, output_buffer,
-					sizeof(output_buffer[0]) * num_samples,
-					bit_rate / 1000);
-		if (cmd != DecoderCommand::NONE)
-			return cmd;
-	}
+	if (i >= pcm_length)
+		return DecoderCommand::NONE;
 
-	return DecoderCommand::NONE;
+	/* convert straight into the music pipe */
+	return decoder_write_frames(*decoder, &input_stream,
+				    sizeof(int32_t) * num_channels,
+				    pcm_length - i, bit_rate / 1000,
+				    [this, i, num_channels](void *dest,
+							    unsigned position,
+							    unsigned n){
+					    mad_fixed_to_24_buffer((int32_t *)dest,
+								   &synth,
+								   i + position,
+								   i + position + n,
+								   num_channels);
+				    });
 }
 
 inline DecoderCommand
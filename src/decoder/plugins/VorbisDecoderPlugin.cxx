@@ -25,7 +25,6 @@
 #include "input/InputStream.hxx"
 #include "OggCodec.hxx"
 #include "util/Error.hxx"
-#include "util/Macros.hxx"
 #include "CheckAudioFormat.hxx"
 #include "tag/TagHandler.hxx"
 #include "Log.hxx"
@@ -158,12 +157,12 @@ vorbis_send_comments(Decoder &decoder, InputStream &is,
 #ifndef HAVE_TREMOR
 static void
 vorbis_interleave(float *dest, const float *const*src,
-		  unsigned nframes, unsigned channels)
+		  unsigned offset, unsigned nframes, unsigned channels)
 {
 	for (const float *const*src_end = src + channels;
 	     src != src_end; ++src, ++dest) {
 		float *d = dest;
-		for (const float *s = *src, *s_end = s + nframes;
+		for (const float *s = *src + offset, *s_end = s + nframes;
 		     s != s_end; ++s, d += channels)
 			*d = *s;
 	}
@@ -215,10 +214,11 @@ vorbis_stream_decode(Decoder &decoder,
 #ifdef HAVE_TREMOR
 	char buffer[4096];
 #else
-	float buffer[2048];
-	const int frames_per_buffer =
-		ARRAY_SIZE(buffer) / audio_format.channels;
-	const unsigned frame_size = sizeof(buffer[0]) * audio_format.channels;
+	/* the maximum number of frames obtained from libvorbis at a
+	   time */
+	const int frames_per_read = 2048 / audio_format.channels;
+	const unsigned channels = audio_format.channels;
+	const unsigned frame_size = sizeof(float) * channels;
 #endif
 
 	int prev_section = -1;
@@ -242,16 +242,9 @@ vorbis_stream_decode(Decoder &decoder,
 				      &current_section);
 #else
 		float **per_channel;
-		long nframes = ov_read_float(&vf, &per_channel,
-					     frames_per_buffer,
-					     &current_section);
-		long nbytes = nframes;
-		if (nframes > 0) {
-			vorbis_interleave(buffer,
-					  (const float*const*)per_channel,
-					  nframes, audio_format.channels);
-			nbytes *= frame_size;
-		}
+		long nbytes = ov_read_float(&vf, &per_channel,
+					    frames_per_read,
+					    &current_section);
 #endif
 
 		if (nbytes == OV_HOLE) /* bad packet */
@@ -291,9 +284,25 @@ vorbis_stream_decode(Decoder &decoder,
 		if (test > 0)
 			kbit_rate = test / 1000;
 
+#ifdef HAVE_TREMOR
 		cmd = decoder_data(decoder, input_stream,
 				   buffer, nbytes,
 				   kbit_rate);
+#else
+		/* "nbytes" is a number of frames here; interleave
+		   them straight into the music pipe */
+		const float *const*src = per_channel;
+		cmd = decoder_write_frames(decoder, &input_stream,
+					   frame_size, nbytes, kbit_rate,
+					   [=](void *dest, unsigned position,
+					       unsigned n){
+						   vorbis_interleave((float *)dest,
+								     src,
+								     position,
+								     n,
+								     channels);
+					   });
+#endif
 	} while (cmd != DecoderCommand::STOP);
 
 	ov_clear(&vf);
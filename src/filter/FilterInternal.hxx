@@ -25,9 +25,12 @@
 #ifndef MPD_FILTER_INTERNAL_HXX
 #define MPD_FILTER_INTERNAL_HXX
 
+#include "Compiler.h"
+
 #include <stddef.h>
 
 struct AudioFormat;
+struct SampleOp;
 class Error;
 
 class Filter {
@@ -69,6 +72,43 @@ public:
 	virtual const void *FilterPCM(const void *src, size_t src_size,
 				      size_t *dest_size_r,
 				      Error &error) = 0;
+
+	/**
+	 * Discard the data which is buffered inside this filter,
+	 * e.g. after a seek.
+	 */
+	virtual void Reset() {}
+
+	/**
+	 * Return the data which is still buffered inside this
+	 * filter, e.g. at the end of playback.  Call this repeatedly
+	 * until it returns nullptr.
+	 *
+	 * @param dest_size_r the size of the returned buffer
+	 * @param error location to store the error occurring
+	 * @return the destination buffer (with the same lifetime as
+	 * the one returned by FilterPCM()), or nullptr if there is no
+	 * more data or on error
+	 */
+	virtual const void *Flush(gcc_unused size_t *dest_size_r,
+				  gcc_unused Error &error) {
+		return nullptr;
+	}
+
+	/**
+	 * Describe this filter as a per-sample operation, which
+	 * allows a filter chain to fuse it with its neighbours into
+	 * one pass over the buffer.  FilterPCM() is not called while
+	 * the filter is being fused.  This is called for each chunk
+	 * after Open(), so the description may change at any time.
+	 *
+	 * @param op a no-op for the input format of this filter,
+	 * which shall be modified to describe the filter
+	 * @return false if the filter cannot be described this way
+	 */
+	virtual bool GetSampleOp(gcc_unused SampleOp &op) const {
+		return false;
+	}
 };
 
 #endif
@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "SampleOp.hxx"
+#include "pcm/Domain.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/Error.hxx"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <string.h>
+
+void
+SampleOp::SetRoute(const int8_t *sources, unsigned n)
+{
+	assert(n > 0 && n <= MAX_CHANNELS);
+
+	routed = n != in_channels;
+	out_channels = n;
+
+	for (unsigned i = 0; i < n; ++i) {
+		int8_t source = sources[i];
+		if (source < 0 || unsigned(source) >= in_channels)
+			source = -1;
+
+		map[i] = source;
+		if (source != int8_t(i))
+			routed = true;
+	}
+}
+
+void
+SampleOp::Append(const SampleOp &next)
+{
+	assert(next.in_channels == out_channels);
+
+	volume = (uint64_t(volume) * next.volume + PCM_VOLUME_1 / 2)
+		>> PCM_VOLUME_BITS;
+
+	if (next.routed) {
+		int8_t combined[MAX_CHANNELS];
+		for (unsigned i = 0; i < next.out_channels; ++i) {
+			const int8_t source = next.map[i];
+			combined[i] = source < 0 || !routed
+				? source
+				: map[unsigned(source)];
+		}
+
+		std::copy_n(combined, next.out_channels, map);
+		routed = true;
+	}
+
+	out_channels = next.out_channels;
+}
+
+/**
+ * The number of frames described by one #SampleOpTable.
+ */
+static constexpr unsigned SAMPLE_OP_TABLE_FRAMES = 8;
+
+/**
+ * Precomputed gather offsets for #SAMPLE_OP_TABLE_FRAMES frames.
+ * Silent output channels read input channel 0 and mask it with zero,
+ * which keeps the kernel free of branches.
+ */
+template<typename T>
+struct SampleOpTable {
+	unsigned offset[SAMPLE_OP_TABLE_FRAMES * MAX_CHANNELS];
+	T mask[SAMPLE_OP_TABLE_FRAMES * MAX_CHANNELS];
+
+	explicit SampleOpTable(const SampleOp &op) {
+		unsigned i = 0;
+		for (unsigned f = 0; f < SAMPLE_OP_TABLE_FRAMES; ++f) {
+			for (unsigned c = 0; c < op.out_channels; ++c, ++i) {
+				const int8_t source = op.map[c];
+				offset[i] = f * op.in_channels +
+					(source >= 0 ? source : 0);
+				mask[i] = source >= 0 ? ~T(0) : T(0);
+			}
+		}
+	}
+};
+
+/**
+ * Copy the samples to their destination channels.  This works on
+ * the bit patterns, so #T is an unsigned integer of the sample size.
+ */
+template<typename T>
+static void
+sample_op_route(T *gcc_restrict dest, const T *gcc_restrict src,
+		size_t n_frames, const SampleOpTable<T> &table,
+		const SampleOp &op)
+{
+	while (n_frames > 0) {
+		const size_t n = std::min<size_t>(n_frames,
+						  SAMPLE_OP_TABLE_FRAMES);
+		const size_t n_samples = n * op.out_channels;
+
+		for (size_t i = 0; i != n_samples; ++i)
+			dest[i] = src[table.offset[i]] & table.mask[i];
+
+		src += n * op.in_channels;
+		dest += n_samples;
+		n_frames -= n;
+	}
+}
+
+/**
+ * The number of frames which are routed into a scratch buffer before
+ * the volume is applied.  The buffer is small enough to stay in the
+ * L1 cache.
+ */
+static constexpr size_t SAMPLE_OP_BLOCK_FRAMES = 128;
+
+/**
+ * Route the samples and apply the volume.  This is done in small
+ * blocks, so each sample is read from main memory only once, and the
+ * volume can still be applied by the SIMD kernels of #PcmVolume.
+ */
+template<typename T>
+static void
+sample_op_route_volume(PcmVolume &volume, T *dest, const T *src,
+		       size_t n_frames, const SampleOp &op)
+{
+	const SampleOpTable<T> table(op);
+
+	if (volume.GetVolume() == PCM_VOLUME_1) {
+		sample_op_route(dest, src, n_frames, table, op);
+		return;
+	}
+
+	T block[SAMPLE_OP_BLOCK_FRAMES * MAX_CHANNELS];
+
+	while (n_frames > 0) {
+		const size_t n = std::min(n_frames, SAMPLE_OP_BLOCK_FRAMES);
+		const size_t n_samples = n * op.out_channels;
+
+		sample_op_route(block, src, n, table, op);
+		volume.Apply(dest, {block, n_samples * sizeof(T)});
+
+		src += n * op.in_channels;
+		dest += n_samples;
+		n_frames -= n;
+	}
+}
+
+bool
+SampleOpProcessor::Open(SampleFormat _format, unsigned channels,
+			Error &error)
+{
+	assert(format == SampleFormat::UNDEFINED);
+
+	switch (_format) {
+	case SampleFormat::UNDEFINED:
+	case SampleFormat::DSD:
+		error.Format(pcm_domain,
+			     "Sample operations on %s are not implemented",
+			     sample_format_to_string(_format));
+		return false;
+
+	case SampleFormat::S8:
+	case SampleFormat::S16:
+	case SampleFormat::S24_P32:
+	case SampleFormat::S32:
+	case SampleFormat::FLOAT:
+		break;
+	}
+
+	if (!volume.Open(_format, channels, error))
+		return false;
+
+	format = _format;
+	return true;
+}
+
+void
+SampleOpProcessor::Close()
+{
+	assert(format != SampleFormat::UNDEFINED);
+
+	volume.Close();
+
+#ifndef NDEBUG
+	format = SampleFormat::UNDEFINED;
+#endif
+}
+
+ConstBuffer<void>
+SampleOpProcessor::Apply(const SampleOp &op, ConstBuffer<void> src)
+{
+	assert(format != SampleFormat::UNDEFINED);
+
+	volume.SetVolume(op.volume);
+
+	/* the volume is applied after routing */
+	volume.SetChannels(op.out_channels);
+
+	if (!op.routed)
+		/* the volume kernels alone are faster for this case */
+		return volume.Apply(src);
+
+	const size_t sample_size = sample_format_size(format);
+	const size_t n_frames = src.size / (sample_size * op.in_channels);
+	const size_t dest_size = n_frames * sample_size * op.out_channels;
+	void *dest = buffer.Get(dest_size);
+
+	switch (sample_size) {
+	case 1:
+		sample_op_route_volume(volume, (uint8_t *)dest,
+				       (const uint8_t *)src.data,
+				       n_frames, op);
+		break;
+
+	case 2:
+		sample_op_route_volume(volume, (uint16_t *)dest,
+				       (const uint16_t *)src.data,
+				       n_frames, op);
+		break;
+
+	case 4:
+		sample_op_route_volume(volume, (uint32_t *)dest,
+				       (const uint32_t *)src.data,
+				       n_frames, op);
+		break;
+
+	default:
+		assert(false);
+		gcc_unreachable();
+	}
+
+	return { dest, dest_size };
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/** \file
+ *
+ * Describe a filter as a per-sample operation, so a chain of such
+ * filters can be applied in a single pass.
+ */
+
+#ifndef MPD_FILTER_SAMPLE_OP_HXX
+#define MPD_FILTER_SAMPLE_OP_HXX
+
+#include "AudioFormat.hxx"
+#include "pcm/Volume.hxx"
+#include "pcm/PcmBuffer.hxx"
+
+#include <stdint.h>
+
+class Error;
+template<typename T> struct ConstBuffer;
+
+/**
+ * An operation which computes each output sample from one input
+ * sample of the same frame: it may choose the source channel and
+ * scale the sample, but it does not change the sample format or the
+ * sample rate.
+ */
+struct SampleOp {
+	/**
+	 * The volume applied to all channels, see #PCM_VOLUME_1.
+	 */
+	unsigned volume;
+
+	unsigned in_channels, out_channels;
+
+	/**
+	 * If false, then the channels are passed through unmodified,
+	 * and #map is undefined.
+	 */
+	bool routed;
+
+	/**
+	 * Output channel i is copied from input channel map[i].  -1
+	 * means silence.
+	 */
+	int8_t map[MAX_CHANNELS];
+
+	/**
+	 * Initialize this object as a no-op for the given number of
+	 * channels.
+	 */
+	void Clear(unsigned channels) {
+		volume = PCM_VOLUME_1;
+		in_channels = out_channels = channels;
+		routed = false;
+	}
+
+	gcc_pure
+	bool IsNop() const {
+		return volume == PCM_VOLUME_1 && !routed;
+	}
+
+	/**
+	 * Set the channel map.
+	 *
+	 * @param sources output channel i is copied from input
+	 * channel sources[i]; -1 or values not below #in_channels
+	 * mean silence
+	 * @param n the number of output channels
+	 */
+	void SetRoute(const int8_t *sources, unsigned n);
+
+	/**
+	 * Append another operation, which will be applied to the
+	 * output of this one.  Its #in_channels must be equal to our
+	 * #out_channels.
+	 *
+	 * Unlike applying both operations in a row, there is only one
+	 * rounding step, and no clipping in between.
+	 */
+	void Append(const SampleOp &next);
+};
+
+/**
+ * Applies a #SampleOp to a buffer in one pass.
+ */
+class SampleOpProcessor {
+	SampleFormat format;
+
+	/**
+	 * Applies the volume with its SIMD kernels.
+	 */
+	PcmVolume volume;
+
+	PcmScratchBuffer buffer;
+
+public:
+#ifndef NDEBUG
+	SampleOpProcessor()
+		:format(SampleFormat::UNDEFINED) {}
+#endif
+
+	/**
+	 * Opens the object, prepare for Apply().
+	 *
+	 * @param format the sample format
+	 * @param channels the initial number of channels; Apply()
+	 * adjusts it to the #SampleOp::out_channels of each operation
+	 * @param error location to store the error
+	 * @return true on success
+	 */
+	bool Open(SampleFormat format, unsigned channels, Error &error);
+
+	/**
+	 * Closes the object.  After that, you may call Open() again.
+	 */
+	void Close();
+
+	/**
+	 * Apply the operation.  The returned buffer is invalidated
+	 * by the next call.
+	 */
+	ConstBuffer<void> Apply(const SampleOp &op, ConstBuffer<void> src);
+};
+
+#endif
@@ -51,6 +51,18 @@ public:
 	virtual const void *FilterPCM(const void *src, size_t src_size,
 				      size_t *dest_size_r,
 				      Error &error) override;
+
+	virtual void Reset() override {
+		if (convert != nullptr)
+			convert->Reset();
+
+		filter->Reset();
+	}
+
+	virtual const void *Flush(size_t *dest_size_r,
+				  Error &error) override {
+		return filter->Flush(dest_size_r, error);
+	}
 };
 
 AudioFormat
@@ -22,7 +22,10 @@
 #include "filter/FilterPlugin.hxx"
 #include "filter/FilterInternal.hxx"
 #include "filter/FilterRegistry.hxx"
+#include "filter/SampleOp.hxx"
+#include "pcm/PcmArena.hxx"
 #include "AudioFormat.hxx"
+#include "util/ConstBuffer.hxx"
 #include "util/Error.hxx"
 #include "util/Domain.hxx"
 
@@ -35,14 +38,55 @@ class ChainFilter final : public Filter {
 		const char *name;
 		Filter *filter;
 
+		/**
+		 * The input channel count of this filter, set by
+		 * Open().
+		 */
+		unsigned channels;
+
+		/**
+		 * May this filter be fused with its neighbours?
+		 * This is true if #processor could be opened.
+		 */
+		bool fusable;
+
+		/**
+		 * Applies the fused operation of all filters
+		 * beginning with this one.
+		 */
+		SampleOpProcessor processor;
+
 		Child(const char *_name, Filter *_filter)
-			:name(_name), filter(_filter) {}
+			:name(_name), filter(_filter), fusable(false) {}
 		~Child() {
 			delete filter;
 		}
 
 		Child(const Child &) = delete;
 		Child &operator=(const Child &) = delete;
+
+		void Open(const AudioFormat &in_audio_format) {
+			channels = in_audio_format.channels;
+			fusable = processor.Open(in_audio_format.format,
+						 channels, IgnoreError());
+		}
+
+		void Close() {
+			if (fusable) {
+				processor.Close();
+				fusable = false;
+			}
+
+			filter->Close();
+		}
+
+		bool GetSampleOp(SampleOp &op) const {
+			if (!fusable)
+				return false;
+
+			op.Clear(channels);
+			return filter->GetSampleOp(op);
+		}
 	};
 
 	std::list<Child> children;
@@ -56,8 +100,19 @@ public:
 	virtual void Close();
 	virtual const void *FilterPCM(const void *src, size_t src_size,
 				      size_t *dest_size_r, Error &error);
+	virtual void Reset() override;
+	virtual const void *Flush(size_t *dest_size_r,
+				  Error &error) override;
 
 private:
+	/**
+	 * Feed the data into the chain, beginning with the specified
+	 * filter.
+	 */
+	const void *FilterFrom(std::list<Child>::iterator i,
+			       const void *src, size_t src_size,
+			       size_t *dest_size_r, Error &error);
+
 	/**
 	 * Close all filters in the chain until #until is reached.
 	 * #until itself is not closed.
@@ -67,6 +122,14 @@ private:
 
 static constexpr Domain chain_filter_domain("chain_filter");
 
+static bool chain_fuse = true;
+
+void
+filter_chain_global_init(bool fuse)
+{
+	chain_fuse = fuse;
+}
+
 static Filter *
 chain_filter_init(gcc_unused const config_param &param,
 		  gcc_unused Error &error)
@@ -83,7 +146,7 @@ ChainFilter::CloseUntil(const Filter *until)
 			return;
 
 		/* close this filter */
-		child.filter->Close();
+		child.Close();
 	}
 
 	/* this assertion fails if #until does not exist (anymore) */
@@ -123,6 +186,7 @@ ChainFilter::Open(AudioFormat &in_audio_format, Error &error)
 	AudioFormat audio_format = in_audio_format;
 
 	for (auto &child : children) {
+		const AudioFormat child_audio_format = audio_format;
 		audio_format = chain_open_child(child.name, child.filter,
 						audio_format, error);
 		if (!audio_format.IsDefined()) {
@@ -130,6 +194,8 @@ ChainFilter::Open(AudioFormat &in_audio_format, Error &error)
 			CloseUntil(child.filter);
 			break;
 		}
+
+		child.Open(child_audio_format);
 	}
 
 	/* return the output format of the last filter */
@@ -140,14 +206,46 @@ void
 ChainFilter::Close()
 {
 	for (auto &child : children)
-		child.filter->Close();
+		child.Close();
 }
 
 const void *
-ChainFilter::FilterPCM(const void *src, size_t src_size,
-		       size_t *dest_size_r, Error &error)
+ChainFilter::FilterFrom(std::list<Child>::iterator i,
+			const void *src, size_t src_size,
+			size_t *dest_size_r, Error &error)
 {
-	for (auto &child : children) {
+	PcmArena *const arena = PcmArena::GetCurrent();
+
+	const auto end = children.end();
+	while (i != end) {
+		Child &child = *i++;
+
+		/* the output of the filter before the previous one is
+		   not needed anymore */
+		if (arena != nullptr)
+			arena->NextStage(src);
+
+		SampleOp op, next;
+		if (chain_fuse && child.GetSampleOp(op) &&
+		    i != end && i->GetSampleOp(next)) {
+			/* apply this filter and all of its fusable
+			   successors in one pass */
+			do {
+				op.Append(next);
+				++i;
+			} while (i != end && i->GetSampleOp(next));
+
+			if (!op.IsNop()) {
+				const auto dest =
+					child.processor.Apply(op,
+							      {src, src_size});
+				src = dest.data;
+				src_size = dest.size;
+			}
+
+			continue;
+		}
+
 		/* feed the output of the previous filter as input
 		   into the current one */
 		src = child.filter->FilterPCM(src, src_size, &src_size,
@@ -161,6 +259,42 @@ ChainFilter::FilterPCM(const void *src, size_t src_size,
 	return src;
 }
 
+const void *
+ChainFilter::FilterPCM(const void *src, size_t src_size,
+		       size_t *dest_size_r, Error &error)
+{
+	return FilterFrom(children.begin(), src, src_size, dest_size_r,
+			  error);
+}
+
+void
+ChainFilter::Reset()
+{
+	for (auto &child : children)
+		child.filter->Reset();
+}
+
+const void *
+ChainFilter::Flush(size_t *dest_size_r, Error &error)
+{
+	for (auto i = children.begin(), end = children.end(); i != end;) {
+		Child &child = *i++;
+
+		size_t size;
+		const void *data = child.filter->Flush(&size, error);
+		if (data != nullptr)
+			/* feed the remaining data of this filter into
+			   its successors; the next call continues
+			   with the following filters */
+			return FilterFrom(i, data, size, dest_size_r, error);
+
+		if (error.IsDefined())
+			return nullptr;
+	}
+
+	return nullptr;
+}
+
 const struct filter_plugin chain_filter_plugin = {
 	"chain",
 	chain_filter_init,
@@ -29,6 +29,15 @@
 
 class Filter;
 
+/**
+ * Configure whether filter chains shall apply consecutive filters
+ * which can be described as a per-sample operation (see
+ * Filter::GetSampleOp()) in a single pass.  This is enabled by
+ * default.
+ */
+void
+filter_chain_global_init(bool fuse);
+
 /**
  * Creates a new filter chain.
  */
@@ -56,6 +56,7 @@ public:
 	virtual const void *FilterPCM(const void *src, size_t src_size,
 				      size_t *dest_size_r,
 				      Error &error) override;
+	virtual bool GetSampleOp(SampleOp &op) const override;
 };
 
 static Filter *
@@ -134,6 +135,14 @@ ConvertFilter::FilterPCM(const void *src, size_t src_size,
 			      error);
 }
 
+bool
+ConvertFilter::GetSampleOp(gcc_unused SampleOp &op) const
+{
+	/* only the no-op can be fused; a real conversion may change
+	   the sample rate */
+	return !out_audio_format.IsValid();
+}
+
 const struct filter_plugin convert_filter_plugin = {
 	"convert",
 	convert_filter_init,
@@ -17,41 +17,137 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+/** \file
+ *
+ * This filter normalizes the loudness: it amplifies quiet songs up to
+ * a target level, and a look-ahead limiter reduces the gain before
+ * peaks which would clip.  See pcm/PcmLimiter.hxx.
+ *
+ * It is enabled by "volume_normalization", or with a "filter" block
+ * with these optional settings: \\
+ * target: the level to aim for, relative to full scale (0.5) \\
+ * max_gain: the maximum amplification (32) \\
+ * look_ahead: the look-ahead in milliseconds (5) \\
+ * release: the time constant of gain changes in milliseconds (200)
+ */
+
 #include "config.h"
+#include "config/ConfigError.hxx"
+#include "config/ConfigData.hxx"
 #include "filter/FilterPlugin.hxx"
 #include "filter/FilterInternal.hxx"
 #include "filter/FilterRegistry.hxx"
-#include "pcm/PcmBuffer.hxx"
+#include "pcm/PcmLimiter.hxx"
 #include "AudioFormat.hxx"
-#include "AudioCompress/compress.h"
-
-#include <string.h>
+#include "util/ConstBuffer.hxx"
+#include "util/NumberParser.hxx"
+#include "util/Error.hxx"
 
 class NormalizeFilter final : public Filter {
-	struct Compressor *compressor;
-
-	PcmBuffer buffer;
+	PcmLimiter limiter;
 
 public:
+	bool Configure(const config_param &param, Error &error);
+
 	virtual AudioFormat Open(AudioFormat &af, Error &error) override;
 	virtual void Close();
 	virtual const void *FilterPCM(const void *src, size_t src_size,
 				      size_t *dest_size_r, Error &error);
+
+	virtual void Reset() override {
+		limiter.Reset();
+	}
+
+	virtual const void *Flush(size_t *dest_size_r,
+				  Error &error) override;
 };
 
+/**
+ * Parse an optional positive number from the configuration block.
+ */
+static bool
+ParsePositiveFloat(const config_param &param, const char *name,
+		   float &value_r, Error &error)
+{
+	const char *value = param.GetBlockValue(name);
+	if (value == nullptr)
+		return true;
+
+	char *endptr;
+	const float f = ParseFloat(value, &endptr);
+	if (endptr == value || *endptr != 0 || !(f > 0)) {
+		error.Format(config_domain,
+			     "\"%s\" is not a positive number: \"%s\"",
+			     name, value);
+		return false;
+	}
+
+	value_r = f;
+	return true;
+}
+
+bool
+NormalizeFilter::Configure(const config_param &param, Error &error)
+{
+	PcmLimiterConfig config;
+	if (!ParsePositiveFloat(param, "target", config.target, error) ||
+	    !ParsePositiveFloat(param, "max_gain", config.max_gain, error))
+		return false;
+
+	if (config.target > 1) {
+		error.Set(config_domain, "\"target\" must not exceed 1");
+		return false;
+	}
+
+	if (config.max_gain < 1) {
+		error.Set(config_domain, "\"max_gain\" must be at least 1");
+		return false;
+	}
+
+	config.look_ahead = param.GetBlockValue("look_ahead",
+						config.look_ahead);
+	config.release = param.GetBlockValue("release", config.release);
+
+	limiter.Configure(config);
+	return true;
+}
+
 static Filter *
-normalize_filter_init(gcc_unused const config_param &param,
-		      gcc_unused Error &error)
+normalize_filter_init(const config_param &param, Error &error)
 {
-	return new NormalizeFilter();
+	NormalizeFilter *filter = new NormalizeFilter();
+	if (!filter->Configure(param, error)) {
+		delete filter;
+		return nullptr;
+	}
+
+	return filter;
 }
 
 AudioFormat
-NormalizeFilter::Open(AudioFormat &audio_format, gcc_unused Error &error)
+NormalizeFilter::Open(AudioFormat &audio_format, Error &error)
 {
-	audio_format.format = SampleFormat::S16;
+	/* everything else is processed in its own format */
+	switch (audio_format.format) {
+	case SampleFormat::UNDEFINED:
+	case SampleFormat::S8:
+		audio_format.format = SampleFormat::S16;
+		break;
+
+	case SampleFormat::DSD:
+		audio_format.format = SampleFormat::FLOAT;
+		break;
+
+	case SampleFormat::S16:
+	case SampleFormat::S24_P32:
+	case SampleFormat::S32:
+	case SampleFormat::FLOAT:
+		break;
+	}
 
-	compressor = Compressor_new(0);
+	if (!limiter.Open(audio_format.format, audio_format.channels,
+			  audio_format.sample_rate, error))
+		return AudioFormat::Undefined();
 
 	return audio_format;
 }
@@ -59,21 +155,27 @@ NormalizeFilter::Open(AudioFormat &audio_format, gcc_unused Error &error)
 void
 NormalizeFilter::Close()
 {
-	buffer.Clear();
-	Compressor_delete(compressor);
+	limiter.Close();
 }
 
 const void *
 NormalizeFilter::FilterPCM(const void *src, size_t src_size,
 			   size_t *dest_size_r, gcc_unused Error &error)
 {
-	int16_t *dest = (int16_t *)buffer.Get(src_size);
-	memcpy(dest, src, src_size);
+	const auto dest = limiter.Apply({src, src_size});
+	*dest_size_r = dest.size;
+	return dest.data;
+}
 
-	Compressor_Process_int16(compressor, dest, src_size / 2);
+const void *
+NormalizeFilter::Flush(size_t *dest_size_r, gcc_unused Error &error)
+{
+	const auto dest = limiter.Flush();
+	if (dest.size == 0)
+		return nullptr;
 
-	*dest_size_r = src_size;
-	return dest;
+	*dest_size_r = dest.size;
+	return dest.data;
 }
 
 const struct filter_plugin normalize_filter_plugin = {
@@ -22,6 +22,7 @@
 #include "filter/FilterPlugin.hxx"
 #include "filter/FilterInternal.hxx"
 #include "filter/FilterRegistry.hxx"
+#include "filter/SampleOp.hxx"
 #include "AudioFormat.hxx"
 #include "ReplayGainInfo.hxx"
 #include "ReplayGainConfig.hxx"
@@ -116,6 +117,7 @@ public:
 	virtual void Close();
 	virtual const void *FilterPCM(const void *src, size_t src_size,
 				      size_t *dest_size_r, Error &error);
+	virtual bool GetSampleOp(SampleOp &op) const override;
 };
 
 void
@@ -158,7 +160,7 @@ replay_gain_filter_init(gcc_unused const config_param &param,
 AudioFormat
 ReplayGainFilter::Open(AudioFormat &af, gcc_unused Error &error)
 {
-	if (!pv.Open(af.format, error))
+	if (!pv.Open(af.format, af.channels, error))
 		return AudioFormat::Undefined();
 
 	return af;
@@ -179,6 +181,13 @@ ReplayGainFilter::FilterPCM(const void *src, size_t src_size,
 	return dest.data;
 }
 
+bool
+ReplayGainFilter::GetSampleOp(SampleOp &op) const
+{
+	op.volume = pv.GetVolume();
+	return true;
+}
+
 const struct filter_plugin replay_gain_filter_plugin = {
 	"replay_gain",
 	replay_gain_filter_init,
@@ -35,8 +35,13 @@
  * (0) to front left (0) and rear left (2), copying front-right (1) to
  * front-right (1) and rear-right (3).
  *
- * If multiple sources are copied to the same destination channel, only
- * one of them takes effect.
+ * Each pair may be followed by a gain factor: \\
+ * routes "0>0, 2>0*0.707, 1>1, 2>1*0.707" \\
+ * mixes the center channel (2) into front-left and front-right at
+ * -3 dB.  If multiple sources are routed to the same destination
+ * channel, they are summed.  Routes with gain factors or summed
+ * channels are applied by the matrix mixer (see pcm/PcmMatrix.hxx),
+ * which does not support DSD.
  */
 
 #include "config.h"
@@ -46,9 +51,13 @@
 #include "filter/FilterPlugin.hxx"
 #include "filter/FilterInternal.hxx"
 #include "filter/FilterRegistry.hxx"
+#include "filter/SampleOp.hxx"
 #include "pcm/PcmBuffer.hxx"
+#include "pcm/PcmMatrix.hxx"
 #include "util/StringUtil.hxx"
 #include "util/Error.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
 
 #include <algorithm>
 
@@ -57,6 +66,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+static constexpr Domain route_filter_domain("route_filter");
+
 class RouteFilter final : public Filter {
 	/**
 	 * The minimum number of channels we need for output
@@ -80,6 +91,19 @@ class RouteFilter final : public Filter {
 	 */
 	int8_t sources[MAX_CHANNELS];
 
+	/**
+	 * The gain of each route; its source channel count is
+	 * updated by Open().  Only used if #mix is set.
+	 */
+	PcmMatrix matrix;
+
+	/**
+	 * Does the configuration apply gain factors or sum several
+	 * sources into one channel?  Then #sources cannot describe
+	 * it, and #matrix is used.
+	 */
+	bool mix;
+
 	/**
 	 * The actual input format of our signal, once opened
 	 */
@@ -105,14 +129,15 @@ class RouteFilter final : public Filter {
 	/**
 	 * The output buffer used last time around, can be reused if the size doesn't differ.
 	 */
-	PcmBuffer output_buffer;
+	PcmScratchBuffer output_buffer;
 
 public:
 	/**
 	 * Parse the "routes" section, a string on the form
-	 *  a>b, c>d, e>f, ...
+	 *  a>b, c>d*g, e>f, ...
 	 * where a... are non-unique, non-negative integers
-	 * and input channel a gets copied to output channel b, etc.
+	 * and input channel a gets copied to output channel b, etc.;
+	 * the optional factor g is the gain of the route.
 	 * @param param the configuration block to read
 	 * @param filter a route_filter whose min_channels and sources[] to set
 	 * @return true on success, false on error
@@ -123,6 +148,7 @@ public:
 	virtual void Close();
 	virtual const void *FilterPCM(const void *src, size_t src_size,
 				      size_t *dest_size_r, Error &error);
+	virtual bool GetSampleOp(SampleOp &op) const override;
 };
 
 bool
@@ -135,10 +161,17 @@ RouteFilter::Configure(const config_param &param, Error &error) {
 	 */
 
 	std::fill_n(sources, MAX_CHANNELS, -1);
+	matrix.Clear(MAX_CHANNELS, MAX_CHANNELS);
+	mix = false;
 
 	min_input_channels = 0;
 	min_output_channels = 0;
 
+	/* destination channels which have more than one source;
+	   earlier MPD versions used only the last one */
+	bool summed[MAX_CHANNELS];
+	std::fill_n(summed, MAX_CHANNELS, false);
+
 	// A cowardly default, just passthrough stereo
 	const char *routes = param.GetBlockValue("routes", "0>0, 1>1");
 	while (true) {
@@ -183,7 +216,34 @@ RouteFilter::Configure(const config_param &param, Error &error) {
 		if (dest >= min_output_channels)
 			min_output_channels = dest + 1;
 
+		float gain = 1;
+		if (*endptr == '*') {
+			routes = strchug_fast(endptr + 1);
+			gain = strtof(routes, &endptr);
+			endptr = strchug_fast(endptr);
+			if (endptr == routes) {
+				error.Set(config_domain,
+					  "Malformed 'routes' specification");
+				return false;
+			}
+
+			if (gain != 1)
+				mix = true;
+		}
+
+		if (sources[dest] >= 0) {
+			mix = true;
+
+			if (!summed[dest]) {
+				summed[dest] = true;
+				FormatWarning(route_filter_domain,
+					      "Output channel %u has more than one source; they are summed (earlier versions used only the last one)",
+					      dest);
+			}
+		}
+
 		sources[dest] = source;
+		matrix.gain[dest][source] += gain;
 
 		routes = endptr;
 
@@ -199,6 +259,7 @@ RouteFilter::Configure(const config_param &param, Error &error) {
 		++routes;
 	}
 
+	matrix.dest_channels = min_output_channels;
 	return true;
 }
 
@@ -215,8 +276,17 @@ route_filter_init(const config_param &param, Error &error)
 }
 
 AudioFormat
-RouteFilter::Open(AudioFormat &audio_format, gcc_unused Error &error)
+RouteFilter::Open(AudioFormat &audio_format, Error &error)
 {
+	if (mix && audio_format.format == SampleFormat::DSD) {
+		error.Set(route_filter_domain,
+			  "Cannot mix DSD channels, use plain routes");
+		return AudioFormat::Undefined();
+	}
+
+	/* input channels which don't exist are silent */
+	matrix.src_channels = audio_format.channels;
+
 	// Copy the input format for later reference
 	input_format = audio_format;
 	input_frame_size = input_format.GetFrameSize();
@@ -253,6 +323,12 @@ RouteFilter::FilterPCM(const void *src, size_t src_size,
 	*dest_size_r = number_of_frames * output_frame_size;
 	void *const result = output_buffer.Get(*dest_size_r);
 
+	if (mix) {
+		pcm_matrix_mix(input_format.format, result, src,
+			       number_of_frames, matrix);
+		return result;
+	}
+
 	// A moving pointer that always refers to the currently filled channel of the currently handled frame, in the output
 	uint8_t *chan_destination = (uint8_t *)result;
 
@@ -290,6 +366,16 @@ RouteFilter::FilterPCM(const void *src, size_t src_size,
 	return result;
 }
 
+bool
+RouteFilter::GetSampleOp(SampleOp &op) const
+{
+	if (mix)
+		return false;
+
+	op.SetRoute(sources, min_output_channels);
+	return true;
+}
+
 const struct filter_plugin route_filter_plugin = {
 	"route",
 	route_filter_init,
@@ -22,6 +22,7 @@
 #include "filter/FilterPlugin.hxx"
 #include "filter/FilterInternal.hxx"
 #include "filter/FilterRegistry.hxx"
+#include "filter/SampleOp.hxx"
 #include "pcm/Volume.hxx"
 #include "AudioFormat.hxx"
 #include "util/ConstBuffer.hxx"
@@ -47,6 +48,7 @@ public:
 	virtual void Close();
 	virtual const void *FilterPCM(const void *src, size_t src_size,
 				      size_t *dest_size_r, Error &error);
+	virtual bool GetSampleOp(SampleOp &op) const override;
 };
 
 static constexpr Domain volume_domain("pcm_volume");
@@ -61,7 +63,7 @@ volume_filter_init(gcc_unused const config_param &param,
 AudioFormat
 VolumeFilter::Open(AudioFormat &audio_format, Error &error)
 {
-	if (!pv.Open(audio_format.format, error))
+	if (!pv.Open(audio_format.format, audio_format.channels, error))
 		return AudioFormat::Undefined();
 
 	return audio_format;
@@ -82,6 +84,13 @@ VolumeFilter::FilterPCM(const void *src, size_t src_size,
 	return dest.data;
 }
 
+bool
+VolumeFilter::GetSampleOp(SampleOp &op) const
+{
+	op.volume = pv.GetVolume();
+	return true;
+}
+
 const struct filter_plugin volume_filter_plugin = {
 	"volume",
 	volume_filter_init,
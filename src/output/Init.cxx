@@ -48,7 +48,7 @@
 
 AudioOutput::AudioOutput(const AudioOutputPlugin &_plugin)
 	:plugin(_plugin),
-	 enabled(true), really_enabled(false),
+	 enabled(true), share_filter(false), really_enabled(false),
 	 open(false),
 	 pause(false),
 	 allow_play(true),
@@ -57,6 +57,7 @@ AudioOutput::AudioOutput(const AudioOutputPlugin &_plugin)
 	 filter(nullptr),
 	 replay_gain_filter(nullptr),
 	 other_replay_gain_filter(nullptr),
+	 replay_gain_mode(REPLAY_GAIN_OFF),
 	 command(AO_COMMAND_NONE)
 {
 	assert(plugin.finish != nullptr);
@@ -149,6 +150,28 @@ audio_output_load_mixer(EventLoop &event_loop, AudioOutput &ao,
 	gcc_unreachable();
 }
 
+Filter *
+audio_output_new_filter_chain(const char *filters, Error &error)
+{
+	Filter *chain = filter_chain_new();
+	assert(chain != nullptr);
+
+	/* create the normalization filter (if configured) */
+
+	if (config_get_bool(CONF_VOLUME_NORMALIZATION, false)) {
+		Filter *normalize_filter =
+			filter_new(&normalize_filter_plugin, config_param(),
+				   IgnoreError());
+		assert(normalize_filter != nullptr);
+
+		filter_chain_append(*chain, "normalize",
+				    autoconvert_filter_new(normalize_filter));
+	}
+
+	filter_chain_parse(*chain, filters, error);
+	return chain;
+}
+
 bool
 AudioOutput::Configure(const config_param &param, Error &error)
 {
@@ -181,25 +204,11 @@ AudioOutput::Configure(const config_param &param, Error &error)
 
 	/* set up the filter chain */
 
-	filter = filter_chain_new();
-	assert(filter != nullptr);
-
-	/* create the normalization filter (if configured) */
-
-	if (config_get_bool(CONF_VOLUME_NORMALIZATION, false)) {
-		Filter *normalize_filter =
-			filter_new(&normalize_filter_plugin, config_param(),
-				   IgnoreError());
-		assert(normalize_filter != nullptr);
-
-		filter_chain_append(*filter, "normalize",
-				    autoconvert_filter_new(normalize_filter));
-	}
+	filter_spec = param.GetBlockValue(AUDIO_FILTERS, "");
 
 	Error filter_error;
-	filter_chain_parse(*filter,
-			   param.GetBlockValue(AUDIO_FILTERS, ""),
-			   filter_error);
+	filter = audio_output_new_filter_chain(filter_spec, filter_error);
+	assert(filter != nullptr);
 
 	// It's not really fatal - Part of the filter chain has been set up already
 	// and even an empty one will work (if only with unexpected behaviour)
@@ -272,6 +281,20 @@ audio_output_setup(EventLoop &event_loop, AudioOutput &ao,
 		return false;
 	}
 
+	/* may the filter pipeline be shared with other outputs?  Not
+	   if it contains a per-output volume control */
+
+	ao.share_filter = param.GetBlockValue("shared_filter", false);
+	if (ao.share_filter &&
+	    (audio_output_mixer_type(param) == MIXER_TYPE_SOFTWARE ||
+	     strcmp(replay_gain_handler, "mixer") == 0)) {
+		FormatWarning(output_domain,
+			      "Cannot share the filter of output '%s' "
+			      "because it has its own volume control",
+			      ao.name);
+		ao.share_filter = false;
+	}
+
 	/* the "convert" filter must be the last one in the chain */
 
 	ao.convert_filter = filter_new(&convert_filter_plugin, config_param(),
@@ -20,14 +20,17 @@
 #ifndef MPD_OUTPUT_INTERNAL_HXX
 #define MPD_OUTPUT_INTERNAL_HXX
 
+#include "SharedFilter.hxx"
 #include "AudioFormat.hxx"
 #include "pcm/PcmBuffer.hxx"
+#include "pcm/PcmArena.hxx"
 #include "pcm/PcmDither.hxx"
 #include "ReplayGainInfo.hxx"
 #include "thread/Mutex.hxx"
 #include "thread/Cond.hxx"
 #include "thread/Thread.hxx"
 #include "system/PeriodClock.hxx"
+#include "util/LatencyHistogram.hxx"
 
 class Error;
 class Filter;
@@ -101,6 +104,13 @@ struct AudioOutput {
 	 */
 	bool enabled;
 
+	/**
+	 * May this output share its filter pipeline with other
+	 * outputs which have the same configuration?  See
+	 * #SharedOutputFilter.
+	 */
+	bool share_filter;
+
 	/**
 	 * Is this device actually enabled, i.e. the "enable" method
 	 * has succeeded?
@@ -176,7 +186,7 @@ struct AudioOutput {
 	/**
 	 * The buffer used to allocate the cross-fading result.
 	 */
-	PcmBuffer cross_fade_buffer;
+	PcmScratchBuffer cross_fade_buffer;
 
 	/**
 	 * The dithering state for cross-fading two streams.
@@ -189,6 +199,12 @@ struct AudioOutput {
 	 */
 	Filter *filter;
 
+	/**
+	 * The configured "filters" setting; used to find outputs
+	 * with an equivalent filter chain.
+	 */
+	const char *filter_spec;
+
 	/**
 	 * The replay_gain_filter_plugin instance of this audio
 	 * output.
@@ -214,6 +230,12 @@ struct AudioOutput {
 	 */
 	unsigned other_replay_gain_serial;
 
+	/**
+	 * The replay gain mode which was passed to
+	 * SetReplayGainMode().
+	 */
+	ReplayGainMode replay_gain_mode;
+
 	/**
 	 * The convert_filter_plugin instance of this audio output.
 	 * It is the last item in the filter chain, and is responsible
@@ -222,6 +244,12 @@ struct AudioOutput {
 	 */
 	Filter *convert_filter;
 
+	/**
+	 * This output's membership in a #SharedOutputFilter group.
+	 * It is only used by the output thread.
+	 */
+	SharedFilterClient shared_filter;
+
 	/**
 	 * The thread handle, or nullptr if the output thread isn't
 	 * running.
@@ -269,6 +297,26 @@ struct AudioOutput {
 	 */
 	bool current_chunk_finished;
 
+	/**
+	 * The time between music_chunk::play_time and the first
+	 * ao_plugin_play() call for that chunk.  Only the output
+	 * thread adds values.
+	 */
+	LatencyHistogram queue_latency;
+
+	/**
+	 * The duration of each ao_plugin_play() call.
+	 */
+	LatencyHistogram play_latency;
+
+	/**
+	 * Scratch memory for filtering one chunk; the
+	 * #PcmScratchBuffer objects of the filters allocate from here.
+	 * Only the output thread may use it, except for
+	 * PcmArena::GetHighWaterMark().
+	 */
+	PcmArena arena;
+
 	AudioOutput(const AudioOutputPlugin &_plugin);
 	~AudioOutput();
 
@@ -386,6 +434,14 @@ private:
 	void CloseFilter();
 	void ReopenFilter();
 
+	/**
+	 * Play the data which is still buffered inside the filters
+	 * (e.g. the look-ahead of the "normalize" filter).  The
+	 * caller must not hold the mutex, and this output must not
+	 * be playing the results of a #SharedOutputFilter group.
+	 */
+	void DrainFilter();
+
 	/**
 	 * Wait until the output's delay reaches zero.
 	 *
@@ -424,6 +480,14 @@ private:
  */
 extern struct notify audio_output_client_notify;
 
+/**
+ * Create a filter chain with the "normalize" filter (if configured)
+ * and the filters listed in the "filters" setting.  Errors in the
+ * setting are returned in #error, but the chain is created anyway.
+ */
+Filter *
+audio_output_new_filter_chain(const char *filters, Error &error);
+
 AudioOutput *
 audio_output_new(EventLoop &event_loop, const config_param &param,
 		 MixerListener &mixer_listener,
@@ -71,10 +71,15 @@ LoadOutput(EventLoop &event_loop, MixerListener &mixer_listener,
 }
 
 void
-MultipleOutputs::Configure(EventLoop &event_loop, PlayerControl &pc)
+MultipleOutputs::Configure(EventLoop &event_loop, PlayerControl &pc,
+			   const char *partition, bool is_default)
 {
 	for (const config_param *param = config_get_param(CONF_AUDIO_OUTPUT);
 	     param != nullptr; param = param->next) {
+		const char *p = param->GetBlockValue("partition");
+		if (p == nullptr ? !is_default : strcmp(p, partition) != 0)
+			continue;
+
 		auto output = LoadOutput(event_loop, mixer_listener,
 					 pc, *param);
 		if (FindByName(output->name) != nullptr)
@@ -85,6 +90,10 @@ MultipleOutputs::Configure(EventLoop &event_loop, PlayerControl &pc)
 	}
 
 	if (outputs.empty()) {
+		if (!is_default)
+			FormatFatalError("partition \"%s\" has no audio_output",
+					 partition);
+
 		/* auto-detect device */
 		const config_param empty;
 		auto output = LoadOutput(event_loop, mixer_listener,
@@ -224,7 +233,7 @@ MultipleOutputs::Open(const AudioFormat audio_format,
 	assert(pipe == nullptr || pipe->CheckFormat(audio_format));
 
 	if (pipe == nullptr)
-		pipe = new MusicPipe();
+		pipe = new MusicPipe(buffer->GetSize());
 	else
 		/* if the pipe hasn't been cleared, the the audio
 		   format must not have changed */
@@ -276,11 +285,11 @@ chunk_is_consumed_in(const AudioOutput *ao,
 	       pipe->Contains(ao->current_chunk));
 
 	if (chunk != ao->current_chunk) {
-		assert(chunk->next != nullptr);
+		assert(!pipe->IsTail(*chunk));
 		return true;
 	}
 
-	return ao->current_chunk_finished && chunk->next == nullptr;
+	return ao->current_chunk_finished && pipe->IsTail(*chunk);
 }
 
 bool
@@ -299,8 +308,7 @@ inline void
 MultipleOutputs::ClearTailChunk(gcc_unused const struct music_chunk *chunk,
 				bool *locked)
 {
-	assert(chunk->next == nullptr);
-	assert(pipe->Contains(chunk));
+	assert(pipe->IsTail(*chunk));
 
 	for (unsigned i = 0, n = outputs.size(); i != n; ++i) {
 		AudioOutput *ao = outputs[i];
@@ -345,7 +353,7 @@ MultipleOutputs::Check()
 			   provides a defined value */
 			elapsed_time = chunk->times;
 
-		is_tail = chunk->next == nullptr;
+		is_tail = pipe->IsTail(*chunk);
 		if (is_tail)
 			/* this is the tail of the pipe - clear the
 			   chunk reference in all outputs */
@@ -76,7 +76,19 @@ public:
 	MultipleOutputs(MixerListener &_mixer_listener);
 	~MultipleOutputs();
 
-	void Configure(EventLoop &event_loop, PlayerControl &pc);
+	/**
+	 * Load the audio outputs of one partition from the
+	 * configuration file.
+	 *
+	 * @param partition the name of the partition; only
+	 * "audio_output" blocks with a matching "partition" setting
+	 * are loaded
+	 * @param is_default true if this is the default partition;
+	 * it gets all outputs without a "partition" setting, and
+	 * auto-detects an output if there are none
+	 */
+	void Configure(EventLoop &event_loop, PlayerControl &pc,
+		       const char *partition, bool is_default);
 
 	/**
 	 * Returns the total number of audio output devices, including
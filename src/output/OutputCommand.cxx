@@ -27,6 +27,7 @@
 #include "config.h"
 #include "OutputCommand.hxx"
 #include "MultipleOutputs.hxx"
+#include "Partition.hxx"
 #include "Internal.hxx"
 #include "PlayerControl.hxx"
 #include "mixer/MixerControl.hxx"
@@ -35,8 +36,10 @@
 extern unsigned audio_output_state_version;
 
 bool
-audio_output_enable_index(MultipleOutputs &outputs, unsigned idx)
+audio_output_enable_index(Partition &partition, unsigned idx)
 {
+	MultipleOutputs &outputs = partition.outputs;
+
 	if (idx >= outputs.Size())
 		return false;
 
@@ -45,7 +48,7 @@ audio_output_enable_index(MultipleOutputs &outputs, unsigned idx)
 		return true;
 
 	ao.enabled = true;
-	idle_add(IDLE_OUTPUT);
+	partition.EmitIdle(IDLE_OUTPUT);
 
 	ao.player_control->UpdateAudio();
 
@@ -55,8 +58,10 @@ audio_output_enable_index(MultipleOutputs &outputs, unsigned idx)
 }
 
 bool
-audio_output_disable_index(MultipleOutputs &outputs, unsigned idx)
+audio_output_disable_index(Partition &partition, unsigned idx)
 {
+	MultipleOutputs &outputs = partition.outputs;
+
 	if (idx >= outputs.Size())
 		return false;
 
@@ -65,12 +70,12 @@ audio_output_disable_index(MultipleOutputs &outputs, unsigned idx)
 		return true;
 
 	ao.enabled = false;
-	idle_add(IDLE_OUTPUT);
+	partition.EmitIdle(IDLE_OUTPUT);
 
 	Mixer *mixer = ao.mixer;
 	if (mixer != nullptr) {
 		mixer_close(mixer);
-		idle_add(IDLE_MIXER);
+		partition.EmitIdle(IDLE_MIXER);
 	}
 
 	ao.player_control->UpdateAudio();
@@ -81,20 +86,22 @@ audio_output_disable_index(MultipleOutputs &outputs, unsigned idx)
 }
 
 bool
-audio_output_toggle_index(MultipleOutputs &outputs, unsigned idx)
+audio_output_toggle_index(Partition &partition, unsigned idx)
 {
+	MultipleOutputs &outputs = partition.outputs;
+
 	if (idx >= outputs.Size())
 		return false;
 
 	AudioOutput &ao = outputs.Get(idx);
 	const bool enabled = ao.enabled = !ao.enabled;
-	idle_add(IDLE_OUTPUT);
+	partition.EmitIdle(IDLE_OUTPUT);
 
 	if (!enabled) {
 		Mixer *mixer = ao.mixer;
 		if (mixer != nullptr) {
 			mixer_close(mixer);
-			idle_add(IDLE_MIXER);
+			partition.EmitIdle(IDLE_MIXER);
 		}
 	}
 
@@ -27,27 +27,27 @@
 #ifndef MPD_OUTPUT_COMMAND_HXX
 #define MPD_OUTPUT_COMMAND_HXX
 
-class MultipleOutputs;
+struct Partition;
 
 /**
  * Enables an audio output.  Returns false if the specified output
  * does not exist.
  */
 bool
-audio_output_enable_index(MultipleOutputs &outputs, unsigned idx);
+audio_output_enable_index(Partition &partition, unsigned idx);
 
 /**
  * Disables an audio output.  Returns false if the specified output
  * does not exist.
  */
 bool
-audio_output_disable_index(MultipleOutputs &outputs, unsigned idx);
+audio_output_disable_index(Partition &partition, unsigned idx);
 
 /**
  * Toggles an audio output.  Returns false if the specified output
  * does not exist.
  */
 bool
-audio_output_toggle_index(MultipleOutputs &outputs, unsigned idx);
+audio_output_toggle_index(Partition &partition, unsigned idx);
 
 #endif
@@ -71,6 +71,8 @@ AudioOutput::LockCommandWait(audio_output_command cmd)
 void
 AudioOutput::SetReplayGainMode(ReplayGainMode mode)
 {
+	replay_gain_mode = mode;
+
 	if (replay_gain_filter != nullptr)
 		replay_gain_filter_set_mode(replay_gain_filter, mode);
 	if (other_replay_gain_filter != nullptr)
@@ -26,6 +26,7 @@
 #include "OutputPrint.hxx"
 #include "MultipleOutputs.hxx"
 #include "Internal.hxx"
+#include "LatencyPrint.hxx"
 #include "client/Client.hxx"
 
 void
@@ -41,3 +42,20 @@ printAudioDevices(Client &client, const MultipleOutputs &outputs)
 			      i, ao.name, ao.enabled);
 	}
 }
+
+void
+printAudioLatency(Client &client, const MultipleOutputs &outputs)
+{
+	for (unsigned i = 0, n = outputs.Size(); i != n; ++i) {
+		const AudioOutput &ao = outputs.Get(i);
+
+		client_printf(client,
+			      "outputid: %i\n"
+			      "outputname: %s\n"
+			      "scratch_high_water: %zu\n",
+			      i, ao.name, ao.arena.GetHighWaterMark());
+
+		latency_print(client, "queue", ao.queue_latency);
+		latency_print(client, "play", ao.play_latency);
+	}
+}
@@ -31,4 +31,10 @@ class MultipleOutputs;
 void
 printAudioDevices(Client &client, const MultipleOutputs &outputs);
 
+/**
+ * Print the latency histograms of all audio outputs.
+ */
+void
+printAudioLatency(Client &client, const MultipleOutputs &outputs);
+
 #endif
@@ -33,6 +33,7 @@
 #include "thread/Slack.hxx"
 #include "thread/Name.hxx"
 #include "system/FatalError.hxx"
+#include "system/Clock.hxx"
 #include "util/Error.hxx"
 #include "Log.hxx"
 #include "Compiler.h"
@@ -190,6 +191,8 @@ AudioOutput::Open()
 
 	open = true;
 
+	shared_output_filter_join(*this);
+
 	FormatDebug(output_domain,
 		    "opened plugin=%s name=\"%s\" audio_format=%s",
 		    plugin.name, name,
@@ -206,6 +209,13 @@ AudioOutput::Close(bool drain)
 {
 	assert(open);
 
+	/* if this output has played the group's results, its own
+	   filters have not seen them */
+	const bool drain_filter = drain &&
+		(shared_filter.group == nullptr || !shared_filter.synced);
+
+	shared_output_filter_leave(*this);
+
 	pipe = nullptr;
 
 	current_chunk = nullptr;
@@ -213,9 +223,12 @@ AudioOutput::Close(bool drain)
 
 	mutex.unlock();
 
-	if (drain)
+	if (drain) {
+		if (drain_filter)
+			DrainFilter();
+
 		ao_plugin_drain(this);
-	else
+	} else
 		ao_plugin_cancel(this);
 
 	ao_plugin_close(this);
@@ -223,8 +236,12 @@ AudioOutput::Close(bool drain)
 
 	mutex.lock();
 
-	FormatDebug(output_domain, "closed plugin=%s name=\"%s\"",
-		    plugin.name, name);
+	FormatDebug(output_domain,
+		    "closed plugin=%s name=\"%s\" scratch_high_water=%zu",
+		    plugin.name, name, arena.GetHighWaterMark());
+
+	/* give the scratch memory back while the device is closed */
+	arena.Clear();
 }
 
 void
@@ -232,6 +249,8 @@ AudioOutput::ReopenFilter()
 {
 	Error error;
 
+	shared_output_filter_leave(*this);
+
 	CloseFilter();
 	const AudioFormat filter_audio_format =
 		OpenFilter(in_audio_format, error);
@@ -258,6 +277,8 @@ AudioOutput::ReopenFilter()
 
 		return;
 	}
+
+	shared_output_filter_join(*this);
 }
 
 void
@@ -346,13 +367,20 @@ ao_chunk_data(AudioOutput *ao, const struct music_chunk *chunk,
 	return data;
 }
 
+/**
+ * Apply replay gain, cross-fading and the filter chain to a chunk.
+ *
+ * @param f the object which owns the filters: either the
+ * #AudioOutput itself or its #SharedOutputFilter
+ */
+template<typename F>
 static const void *
-ao_filter_chunk(AudioOutput *ao, const struct music_chunk *chunk,
+ao_filter_chunk(AudioOutput *ao, F &f, const struct music_chunk *chunk,
 		size_t *length_r)
 {
 	size_t length;
-	const void *data = ao_chunk_data(ao, chunk, ao->replay_gain_filter,
-					 &ao->replay_gain_serial, &length);
+	const void *data = ao_chunk_data(ao, chunk, f.replay_gain_filter,
+					 &f.replay_gain_serial, &length);
 	if (data == nullptr)
 		return nullptr;
 
@@ -368,8 +396,8 @@ ao_filter_chunk(AudioOutput *ao, const struct music_chunk *chunk,
 		size_t other_length;
 		const void *other_data =
 			ao_chunk_data(ao, chunk->other,
-				      ao->other_replay_gain_filter,
-				      &ao->other_replay_gain_serial,
+				      f.other_replay_gain_filter,
+				      &f.other_replay_gain_serial,
 				      &other_length);
 		if (other_data == nullptr)
 			return nullptr;
@@ -387,11 +415,22 @@ ao_filter_chunk(AudioOutput *ao, const struct music_chunk *chunk,
 		if (length > other_length)
 			length = other_length;
 
-		void *dest = ao->cross_fade_buffer.Get(other_length);
+		void *dest = f.cross_fade_buffer.Get(other_length);
 		memcpy(dest, other_data, other_length);
-		if (!pcm_mix(ao->cross_fade_dither, dest, data, length,
-			     ao->in_audio_format.format,
-			     1.0 - chunk->mix_ratio)) {
+		/* a negative mix_ratio (MixRamp) means plain
+		   addition */
+		const float portion_start = chunk->mix_ratio >= 0
+			? 1.0 - chunk->mix_ratio
+			: -1;
+		const float portion_end = chunk->mix_ratio_end >= 0
+			? 1.0 - chunk->mix_ratio_end
+			: -1;
+
+		if (!pcm_mix_ramp(f.cross_fade_dither, dest, data, length,
+				  ao->in_audio_format.format,
+				  ao->in_audio_format.channels,
+				  portion_start, portion_end,
+				  chunk->mix_curve)) {
 			FormatError(output_domain,
 				    "Cannot cross-fade format %s",
 				    sample_format_to_string(ao->in_audio_format.format));
@@ -405,7 +444,7 @@ ao_filter_chunk(AudioOutput *ao, const struct music_chunk *chunk,
 	/* apply filter chain */
 
 	Error error;
-	data = ao->filter->FilterPCM(data, length, &length, error);
+	data = f.filter->FilterPCM(data, length, &length, error);
 	if (data == nullptr) {
 		FormatError(error, "\"%s\" [%s] failed to filter",
 			    ao->name, ao->plugin.name);
@@ -416,6 +455,77 @@ ao_filter_chunk(AudioOutput *ao, const struct music_chunk *chunk,
 	return data;
 }
 
+/**
+ * Filter a chunk, or obtain the result from the #SharedOutputFilter
+ * group if another output has already filtered it.  If the group's
+ * result is returned, SharedOutputFilter::Release() must be called
+ * after it has been played.
+ */
+static const void *
+ao_filter_chunk(AudioOutput *ao, const struct music_chunk *chunk,
+		size_t *length_r)
+{
+	SharedOutputFilter *group = ao->shared_filter.group;
+	if (group == nullptr)
+		return ao_filter_chunk(ao, *ao, chunk, length_r);
+
+	/* Lookup() may wait for another output thread; release the
+	   mutex meanwhile, or the player thread would block on it;
+	   the chunk cannot disappear, because it has not been
+	   marked as finished yet */
+	const void *data;
+	ao->mutex.unlock();
+	const auto result = group->Lookup(ao->shared_filter, *chunk,
+					  data, *length_r);
+	ao->mutex.lock();
+
+	switch (result) {
+	case SharedOutputFilter::LookupResult::FOUND:
+		return data;
+
+	case SharedOutputFilter::LookupResult::FILTER:
+		group->SetReplayGainMode(ao->replay_gain_mode);
+		data = ao_filter_chunk(ao, *group, chunk, length_r);
+		return group->Commit(ao->shared_filter, *chunk, data,
+				     data != nullptr ? *length_r : 0);
+
+	case SharedOutputFilter::LookupResult::PRIVATE:
+		break;
+	}
+
+	return ao_filter_chunk(ao, *ao, chunk, length_r);
+}
+
+void
+AudioOutput::DrainFilter()
+{
+	arena.Reset();
+	const PcmArena::Scope arena_scope(arena);
+
+	Error error;
+	size_t size;
+	const char *data;
+	while ((data = (const char *)filter->Flush(&size, error)) != nullptr) {
+		while (size > 0) {
+			const size_t nbytes =
+				ao_plugin_play(this, data, size, error);
+			if (nbytes == 0) {
+				FormatError(error,
+					    "\"%s\" [%s] failed to play",
+					    name, plugin.name);
+				return;
+			}
+
+			data += nbytes;
+			size -= nbytes;
+		}
+	}
+
+	if (error.IsDefined())
+		FormatError(error, "\"%s\" [%s] failed to filter",
+			    name, plugin.name);
+}
+
 inline bool
 AudioOutput::PlayChunk(const music_chunk *chunk)
 {
@@ -432,7 +542,19 @@ AudioOutput::PlayChunk(const music_chunk *chunk)
 	/* workaround -Wmaybe-uninitialized false positive */
 	size = 0;
 #endif
-	const char *data = (const char *)ao_filter_chunk(this, chunk, &size);
+
+	/* the previous chunk's scratch memory is not needed anymore;
+	   only the filters use the arena, not the output plugin,
+	   which may still be reading its own buffers
+	   asynchronously */
+	arena.Reset();
+
+	const char *data;
+	{
+		const PcmArena::Scope arena_scope(arena);
+		data = (const char *)ao_filter_chunk(this, chunk, &size);
+	}
+
 	if (data == nullptr) {
 		Close(false);
 
@@ -444,15 +566,24 @@ AudioOutput::PlayChunk(const music_chunk *chunk)
 
 	Error error;
 
+	bool first = true;
 	while (size > 0 && command == AO_COMMAND_NONE) {
 		size_t nbytes;
 
 		if (!WaitForDelay())
 			break;
 
+		const uint64_t start = MonotonicClockUS();
+		if (first) {
+			queue_latency.AddSince(chunk->play_time, start);
+			first = false;
+		}
+
 		mutex.unlock();
 		nbytes = ao_plugin_play(this, data, size, error);
 		mutex.lock();
+
+		play_latency.AddSince(start, MonotonicClockUS());
 		if (nbytes == 0) {
 			/* play()==0 means failure */
 			FormatError(error, "\"%s\" [%s] failed to play",
@@ -475,6 +606,9 @@ AudioOutput::PlayChunk(const music_chunk *chunk)
 		size -= nbytes;
 	}
 
+	if (shared_filter.group != nullptr)
+		shared_filter.group->Release(shared_filter);
+
 	return true;
 }
 
@@ -483,7 +617,7 @@ AudioOutput::GetNextChunk() const
 {
 	return current_chunk != nullptr
 		/* continue the previous play() call */
-		? current_chunk->next
+		? pipe->GetNext(*current_chunk)
 		/* get the first chunk from the pipe */
 		: pipe->Peek();
 }
@@ -514,7 +648,7 @@ AudioOutput::Play()
 		}
 
 		assert(current_chunk == chunk);
-		chunk = chunk->next;
+		chunk = pipe->GetNext(*chunk);
 	}
 
 	assert(in_playback_loop);
@@ -621,7 +755,14 @@ AudioOutput::Task()
 				assert(current_chunk == nullptr);
 				assert(pipe->Peek() == nullptr);
 
+				const bool drain_filter =
+					shared_filter.group == nullptr ||
+					!shared_filter.synced;
+
 				mutex.unlock();
+				if (drain_filter)
+					DrainFilter();
+
 				ao_plugin_drain(this);
 				mutex.lock();
 			}
@@ -632,7 +773,14 @@ AudioOutput::Task()
 		case AO_COMMAND_CANCEL:
 			current_chunk = nullptr;
 
+			if (shared_filter.group != nullptr)
+				shared_filter.group->Cancel(shared_filter);
+
 			if (open) {
+				/* don't play stale data from the
+				   filters after a seek */
+				filter->Reset();
+
 				mutex.unlock();
 				ao_plugin_cancel(this);
 				mutex.lock();
@@ -0,0 +1,500 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "SharedFilter.hxx"
+#include "Internal.hxx"
+#include "Domain.hxx"
+#include "OutputPlugin.hxx"
+#include "filter/FilterPlugin.hxx"
+#include "filter/FilterInternal.hxx"
+#include "filter/FilterRegistry.hxx"
+#include "filter/plugins/ChainFilterPlugin.hxx"
+#include "filter/plugins/ConvertFilterPlugin.hxx"
+#include "filter/plugins/ReplayGainFilterPlugin.hxx"
+#include "config/ConfigData.hxx"
+#include "util/Error.hxx"
+#include "Log.hxx"
+
+#include <list>
+
+#include <assert.h>
+#include <string.h>
+
+struct SharedFilterResult {
+	const music_chunk *chunk;
+
+	uint64_t sequence;
+
+	/**
+	 * The number of synced outputs which have not yet finished
+	 * playing this result.
+	 */
+	unsigned refs;
+
+	PcmBuffer buffer;
+
+	const void *data;
+	size_t length;
+};
+
+/**
+ * All #SharedOutputFilter instances.
+ */
+static std::list<SharedOutputFilter *> shared_filters;
+
+/**
+ * Protects #shared_filters and SharedOutputFilter::n_clients.
+ */
+static Mutex shared_filters_mutex;
+
+SharedOutputFilter::SharedOutputFilter(const MusicPipe *_pipe,
+				       const char *_filter_spec,
+				       bool _replay_gain,
+				       AudioFormat _in_audio_format,
+				       AudioFormat _out_audio_format)
+	:pipe(_pipe), filter_spec(_filter_spec),
+	 replay_gain(_replay_gain),
+	 in_audio_format(_in_audio_format),
+	 out_audio_format(_out_audio_format),
+	 n_clients(0),
+	 next_sequence(0), n_synced(0), filtering(nullptr),
+	 filter(nullptr),
+	 replay_gain_filter(nullptr), replay_gain_serial(0),
+	 other_replay_gain_filter(nullptr), other_replay_gain_serial(0),
+	 convert_filter(nullptr)
+{
+}
+
+SharedOutputFilter::~SharedOutputFilter()
+{
+	assert(n_clients == 0);
+	assert(n_synced == 0);
+	assert(filtering == nullptr);
+
+	for (auto *r : results)
+		delete r;
+	for (auto *r : unused)
+		delete r;
+
+	if (filter != nullptr) {
+		if (replay_gain_filter != nullptr)
+			replay_gain_filter->Close();
+		if (other_replay_gain_filter != nullptr)
+			other_replay_gain_filter->Close();
+		filter->Close();
+	}
+
+	delete replay_gain_filter;
+	delete other_replay_gain_filter;
+	delete filter;
+}
+
+bool
+SharedOutputFilter::Open(Error &error)
+{
+	assert(filter == nullptr);
+
+	if (replay_gain) {
+		replay_gain_filter = filter_new(&replay_gain_filter_plugin,
+						config_param(), IgnoreError());
+		assert(replay_gain_filter != nullptr);
+
+		other_replay_gain_filter =
+			filter_new(&replay_gain_filter_plugin,
+				   config_param(), IgnoreError());
+		assert(other_replay_gain_filter != nullptr);
+	}
+
+	/* errors in the "filters" setting have already been reported
+	   by AudioOutput::Configure() */
+	Filter *chain = audio_output_new_filter_chain(filter_spec,
+						       IgnoreError());
+
+	convert_filter = filter_new(&convert_filter_plugin, config_param(),
+				    IgnoreError());
+	assert(convert_filter != nullptr);
+
+	filter_chain_append(*chain, "convert", convert_filter);
+
+	AudioFormat format = in_audio_format;
+	if (replay_gain_filter != nullptr &&
+	    !replay_gain_filter->Open(format, error).IsDefined())
+		goto fail;
+
+	if (other_replay_gain_filter != nullptr &&
+	    !other_replay_gain_filter->Open(format, error).IsDefined()) {
+		replay_gain_filter->Close();
+		goto fail;
+	}
+
+	if (!chain->Open(format, error).IsDefined()) {
+		if (replay_gain_filter != nullptr) {
+			replay_gain_filter->Close();
+			other_replay_gain_filter->Close();
+		}
+
+		goto fail;
+	}
+
+	filter = chain;
+
+	if (!convert_filter_set(convert_filter, out_audio_format, error))
+		return false;
+
+	return true;
+
+fail:
+	delete chain;
+	convert_filter = nullptr;
+	return false;
+}
+
+bool
+SharedOutputFilter::IsCompatible(const AudioOutput &ao) const
+{
+	return ao.share_filter && ao.pipe == pipe &&
+		(ao.replay_gain_filter != nullptr) == replay_gain &&
+		ao.in_audio_format == in_audio_format &&
+		ao.out_audio_format == out_audio_format &&
+		strcmp(ao.filter_spec, filter_spec) == 0;
+}
+
+void
+SharedOutputFilter::AddClient(SharedFilterClient &client)
+{
+	assert(client.group == nullptr);
+
+	client.group = this;
+	client.synced = false;
+	client.current = nullptr;
+	++n_clients;
+}
+
+bool
+SharedOutputFilter::RemoveClient(SharedFilterClient &client)
+{
+	assert(client.group == this);
+	assert(n_clients > 0);
+
+	Cancel(client);
+
+	client.group = nullptr;
+	return --n_clients == 0;
+}
+
+void
+SharedOutputFilter::SetReplayGainMode(ReplayGainMode mode)
+{
+	if (replay_gain_filter != nullptr) {
+		replay_gain_filter_set_mode(replay_gain_filter, mode);
+		replay_gain_filter_set_mode(other_replay_gain_filter, mode);
+	}
+}
+
+SharedFilterResult *
+SharedOutputFilter::Get(uint64_t sequence) const
+{
+	if (results.empty())
+		return nullptr;
+
+	assert(sequence >= results.front()->sequence);
+
+	const uint64_t i = sequence - results.front()->sequence;
+	return i < results.size()
+		? results[i]
+		: nullptr;
+}
+
+SharedFilterResult *
+SharedOutputFilter::Find(const music_chunk &chunk) const
+{
+	for (auto *r : results)
+		if (r->chunk == &chunk && r->refs > 0)
+			return r;
+
+	return nullptr;
+}
+
+void
+SharedOutputFilter::SyncLocked(SharedFilterClient &client,
+			       SharedFilterResult &result)
+{
+	assert(!client.synced);
+	assert(client.current == nullptr);
+
+	client.synced = true;
+	client.next_sequence = result.sequence;
+	++n_synced;
+
+	/* this output is going to play all results from here on */
+	for (auto *r : results)
+		if (r->sequence >= result.sequence)
+			++r->refs;
+}
+
+void
+SharedOutputFilter::UnsyncLocked(SharedFilterClient &client)
+{
+	assert(client.synced);
+	assert(n_synced > 0);
+
+	ReleaseLocked(client);
+
+	for (auto *r : results) {
+		if (r->sequence >= client.next_sequence) {
+			assert(r->refs > 0);
+			--r->refs;
+		}
+	}
+
+	client.synced = false;
+	--n_synced;
+
+	Trim();
+}
+
+void
+SharedOutputFilter::ReleaseLocked(SharedFilterClient &client)
+{
+	if (client.current == nullptr)
+		return;
+
+	assert(client.current->refs > 0);
+	--client.current->refs;
+	client.current = nullptr;
+}
+
+void
+SharedOutputFilter::Trim()
+{
+	while (!results.empty() && results.front()->refs == 0) {
+		unused.push_back(results.front());
+		results.pop_front();
+	}
+
+	if (n_synced == 0) {
+		/* nobody is going to play the rest; and a later
+		   lookup must not find stale chunk pointers */
+		for (auto *r : results)
+			unused.push_back(r);
+		results.clear();
+	}
+}
+
+SharedOutputFilter::LookupResult
+SharedOutputFilter::Lookup(SharedFilterClient &client,
+			   const music_chunk &chunk,
+			   const void *&data_r, size_t &length_r)
+{
+	assert(client.group == this);
+	assert(client.current == nullptr);
+
+	const ScopeLock protect(mutex);
+
+	while (true) {
+		if (client.synced) {
+			SharedFilterResult *r = Get(client.next_sequence);
+			if (r != nullptr) {
+				if (r->chunk != &chunk) {
+					/* this output has diverged
+					   (e.g. its pipe was cleared) */
+					UnsyncLocked(client);
+					continue;
+				}
+
+				++client.next_sequence;
+				client.current = r;
+				data_r = r->data;
+				length_r = r->length;
+				return LookupResult::FOUND;
+			}
+
+			assert(client.next_sequence == next_sequence);
+
+			if (filtering == nullptr) {
+				filtering = &chunk;
+				return LookupResult::FILTER;
+			}
+
+			if (filtering != &chunk) {
+				UnsyncLocked(client);
+				continue;
+			}
+
+			/* another output is filtering this chunk right
+			   now; wait for its result */
+			cond.wait(mutex);
+		} else {
+			SharedFilterResult *r = Find(chunk);
+			if (r != nullptr) {
+				SyncLocked(client, *r);
+				continue;
+			}
+
+			if (filtering == &chunk) {
+				cond.wait(mutex);
+				continue;
+			}
+
+			if (n_synced > 0 || filtering != nullptr)
+				return LookupResult::PRIVATE;
+
+			/* the group is idle: take over, and drop the
+			   data which is still buffered inside the
+			   filters from the chunks played before */
+			assert(results.empty());
+			filter->Reset();
+
+			client.synced = true;
+			client.next_sequence = next_sequence;
+			++n_synced;
+
+			filtering = &chunk;
+			return LookupResult::FILTER;
+		}
+	}
+}
+
+const void *
+SharedOutputFilter::Commit(SharedFilterClient &client,
+			   const music_chunk &chunk,
+			   const void *data, size_t length)
+{
+	assert(client.group == this);
+	assert(client.synced);
+	assert(client.current == nullptr);
+	assert(client.next_sequence == next_sequence);
+
+	const ScopeLock protect(mutex);
+
+	assert(filtering == &chunk);
+	filtering = nullptr;
+	cond.broadcast();
+
+	if (data == nullptr) {
+		/* the caller is going to close; whoever is waiting
+		   for this chunk will retry */
+		UnsyncLocked(client);
+		return nullptr;
+	}
+
+	SharedFilterResult *r;
+	if (unused.empty())
+		r = new SharedFilterResult();
+	else {
+		r = unused.back();
+		unused.pop_back();
+	}
+
+	r->chunk = &chunk;
+	r->sequence = next_sequence++;
+	r->refs = n_synced;
+
+	void *dest = r->buffer.Get(length);
+	memcpy(dest, data, length);
+	r->data = dest;
+	r->length = length;
+
+	results.push_back(r);
+
+	++client.next_sequence;
+	client.current = r;
+	return r->data;
+}
+
+void
+SharedOutputFilter::Release(SharedFilterClient &client)
+{
+	assert(client.group == this);
+
+	const ScopeLock protect(mutex);
+	ReleaseLocked(client);
+	Trim();
+}
+
+void
+SharedOutputFilter::Cancel(SharedFilterClient &client)
+{
+	assert(client.group == this);
+
+	const ScopeLock protect(mutex);
+	if (client.synced)
+		UnsyncLocked(client);
+	else
+		ReleaseLocked(client);
+}
+
+bool
+shared_output_filter_join(AudioOutput &ao)
+{
+	assert(ao.shared_filter.group == nullptr);
+
+	if (!ao.share_filter)
+		return false;
+
+	const ScopeLock protect(shared_filters_mutex);
+
+	SharedOutputFilter *group = nullptr;
+	for (auto *i : shared_filters) {
+		if (i->IsCompatible(ao)) {
+			group = i;
+			break;
+		}
+	}
+
+	if (group == nullptr) {
+		group = new SharedOutputFilter(ao.pipe, ao.filter_spec,
+					       ao.replay_gain_filter != nullptr,
+					       ao.in_audio_format,
+					       ao.out_audio_format);
+
+		Error error;
+		if (!group->Open(error)) {
+			FormatError(error,
+				    "Failed to open shared filter for \"%s\" [%s]",
+				    ao.name, ao.plugin.name);
+			delete group;
+			return false;
+		}
+
+		shared_filters.push_back(group);
+	}
+
+	group->AddClient(ao.shared_filter);
+
+	FormatDebug(output_domain, "\"%s\" [%s] uses a shared filter",
+		    ao.name, ao.plugin.name);
+	return true;
+}
+
+void
+shared_output_filter_leave(AudioOutput &ao)
+{
+	SharedOutputFilter *group = ao.shared_filter.group;
+	if (group == nullptr)
+		return;
+
+	const ScopeLock protect(shared_filters_mutex);
+
+	if (group->RemoveClient(ao.shared_filter)) {
+		shared_filters.remove(group);
+		delete group;
+	}
+}
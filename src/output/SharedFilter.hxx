@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_OUTPUT_SHARED_FILTER_HXX
+#define MPD_OUTPUT_SHARED_FILTER_HXX
+
+#include "AudioFormat.hxx"
+#include "ReplayGainInfo.hxx"
+#include "pcm/PcmBuffer.hxx"
+#include "pcm/PcmDither.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "Compiler.h"
+
+#include <deque>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Error;
+class Filter;
+class MusicPipe;
+class SharedOutputFilter;
+struct SharedFilterResult;
+struct music_chunk;
+struct AudioOutput;
+
+/**
+ * The state of one #AudioOutput inside a #SharedOutputFilter.  It is
+ * only accessed by the output thread.
+ */
+struct SharedFilterClient {
+	/**
+	 * The group this output has joined, or nullptr if it uses
+	 * its own filter pipeline.
+	 */
+	SharedOutputFilter *group;
+
+	/**
+	 * Does this output play the group's results?  If not, it
+	 * uses its own pipeline until it reaches a chunk which has
+	 * already been filtered by the group.
+	 */
+	bool synced;
+
+	/**
+	 * The sequence number of the next result this output is
+	 * going to play.  Only valid if #synced is true.
+	 */
+	uint64_t next_sequence;
+
+	/**
+	 * The result which is currently being played.
+	 */
+	SharedFilterResult *current;
+
+	SharedFilterClient()
+		:group(nullptr), synced(false), current(nullptr) {}
+};
+
+/**
+ * The replay gain, cross-fade and filter chain pipeline of several
+ * #AudioOutput objects which have an equivalent configuration: the
+ * same input and output audio format, the same "filters" setting and
+ * replay gain handler, and no software mixer.  Each chunk is filtered
+ * only once by the first output thread which needs it, and the other
+ * outputs play the same result.
+ *
+ * The group owns its own filter objects.  Only outputs which are
+ * "synced" use them, and these play the same sequence of chunks, so
+ * the shared filters see every chunk exactly once and in the right
+ * order.  This keeps stateful filters (e.g. resamplers) consistent.
+ * An output which opens while the others are already playing uses its
+ * own pipeline until it reaches a chunk which the group has already
+ * filtered.
+ */
+class SharedOutputFilter {
+	const MusicPipe *const pipe;
+	const char *const filter_spec;
+	const bool replay_gain;
+	const AudioFormat in_audio_format, out_audio_format;
+
+	/**
+	 * The number of outputs which have joined this group.  This
+	 * is protected by the global list's mutex.
+	 */
+	unsigned n_clients;
+
+	/**
+	 * This mutex protects all of the following attributes.
+	 */
+	Mutex mutex;
+
+	/**
+	 * Signalled when the chunk being filtered is done.
+	 */
+	Cond cond;
+
+	/**
+	 * The filtered chunks which have not yet been played by all
+	 * synced outputs, oldest first.  Their sequence numbers are
+	 * consecutive.
+	 */
+	std::deque<SharedFilterResult *> results;
+
+	/**
+	 * Buffers which have been played by all outputs, to be
+	 * reused.
+	 */
+	std::vector<SharedFilterResult *> unused;
+
+	/**
+	 * The sequence number of the next result.
+	 */
+	uint64_t next_sequence;
+
+	/**
+	 * The number of outputs with SharedFilterClient::synced.
+	 */
+	unsigned n_synced;
+
+	/**
+	 * The chunk which is currently being filtered by one of the
+	 * outputs, or nullptr.
+	 */
+	const music_chunk *filtering;
+
+public:
+	/**
+	 * The filter objects, in the same roles as the #AudioOutput
+	 * attributes with the same names.  They may only be used
+	 * after Lookup() has returned LookupResult::FILTER.
+	 */
+	Filter *filter;
+	Filter *replay_gain_filter;
+	unsigned replay_gain_serial;
+	Filter *other_replay_gain_filter;
+	unsigned other_replay_gain_serial;
+	Filter *convert_filter;
+	PcmScratchBuffer cross_fade_buffer;
+	PcmDither cross_fade_dither;
+
+	/**
+	 * @param replay_gain shall the group have replay gain
+	 * filters?
+	 */
+	SharedOutputFilter(const MusicPipe *_pipe, const char *_filter_spec,
+			   bool _replay_gain,
+			   AudioFormat _in_audio_format,
+			   AudioFormat _out_audio_format);
+	~SharedOutputFilter();
+
+	SharedOutputFilter(const SharedOutputFilter &) = delete;
+	SharedOutputFilter &operator=(const SharedOutputFilter &) = delete;
+
+	/**
+	 * Create and open the filter objects.
+	 */
+	bool Open(Error &error);
+
+	/**
+	 * Does the specified output have the same filter pipeline?
+	 */
+	gcc_pure
+	bool IsCompatible(const AudioOutput &ao) const;
+
+	void AddClient(SharedFilterClient &client);
+
+	/**
+	 * @return true if this was the last client
+	 */
+	bool RemoveClient(SharedFilterClient &client);
+
+	/**
+	 * Apply the replay gain mode to the shared replay gain
+	 * filters.  May only be called after Lookup() has returned
+	 * LookupResult::FILTER.
+	 */
+	void SetReplayGainMode(ReplayGainMode mode);
+
+	enum class LookupResult {
+		/**
+		 * The chunk has already been filtered; the result
+		 * was returned.  Call Release() after it has been
+		 * played.
+		 */
+		FOUND,
+
+		/**
+		 * The caller shall filter the chunk with this
+		 * object's filters, and pass the result to
+		 * Commit().
+		 */
+		FILTER,
+
+		/**
+		 * The caller shall filter the chunk with its own
+		 * filters.
+		 */
+		PRIVATE,
+	};
+
+	/**
+	 * Look up the result of filtering the specified chunk.  This
+	 * may block until another output has finished filtering it;
+	 * therefore, the caller must not hold any lock which the
+	 * player thread needs.
+	 */
+	LookupResult Lookup(SharedFilterClient &client,
+			    const music_chunk &chunk,
+			    const void *&data_r, size_t &length_r);
+
+	/**
+	 * Store the result of filtering a chunk after Lookup() has
+	 * returned LookupResult::FILTER.  Call Release() after it
+	 * has been played.
+	 *
+	 * @param data the filtered data, or nullptr if filtering has
+	 * failed
+	 * @return a copy of the data which is valid until Release(),
+	 * or nullptr if data was nullptr
+	 */
+	const void *Commit(SharedFilterClient &client,
+			   const music_chunk &chunk,
+			   const void *data, size_t length);
+
+	/**
+	 * The output has finished playing the result returned by
+	 * Lookup() or Commit().
+	 */
+	void Release(SharedFilterClient &client);
+
+	/**
+	 * The output's pipe has been cleared; forget its position.
+	 */
+	void Cancel(SharedFilterClient &client);
+
+private:
+	/**
+	 * Returns the result with the specified sequence number, or
+	 * nullptr if it has not been filtered yet.
+	 */
+	gcc_pure
+	SharedFilterResult *Get(uint64_t sequence) const;
+
+	gcc_pure
+	SharedFilterResult *Find(const music_chunk &chunk) const;
+
+	void SyncLocked(SharedFilterClient &client,
+			SharedFilterResult &result);
+	void UnsyncLocked(SharedFilterClient &client);
+	void ReleaseLocked(SharedFilterClient &client);
+
+	/**
+	 * Free all results at the front which have been played by
+	 * all outputs.
+	 */
+	void Trim();
+};
+
+/**
+ * Join the group of outputs with the same filter pipeline, or create
+ * a new one.  This is called by the output thread after the output
+ * has been opened.  Does nothing if the output has not enabled
+ * "shared_filter".
+ *
+ * @return false if the output does not share its pipeline
+ */
+bool
+shared_output_filter_join(AudioOutput &ao);
+
+/**
+ * Leave the group joined with shared_output_filter_join() (if any).
+ */
+void
+shared_output_filter_leave(AudioOutput &ao);
+
+#endif
@@ -30,6 +30,10 @@
 #include <string.h>
 
 struct WinmmBuffer {
+	/**
+	 * waveOutWrite() reads this asynchronously, so this must not
+	 * be a #PcmScratchBuffer.
+	 */
 	PcmBuffer buffer;
 
 	WAVEHDR hdr;
@@ -38,7 +38,7 @@ class PcmChannelsConverter {
 	SampleFormat format;
 	unsigned src_channels, dest_channels;
 
-	PcmBuffer buffer;
+	PcmScratchBuffer buffer;
 
 public:
 #ifndef NDEBUG
@@ -20,6 +20,7 @@
 #include "config.h"
 #include "ConfiguredResampler.hxx"
 #include "FallbackResampler.hxx"
+#include "SincResampler.hxx"
 #include "config/ConfigGlobal.hxx"
 #include "config/ConfigOption.hxx"
 #include "config/ConfigError.hxx"
@@ -37,6 +38,7 @@
 
 enum class SelectedResampler {
 	FALLBACK,
+	SINC,
 
 #ifdef HAVE_LIBSAMPLERATE
 	LIBSAMPLERATE,
@@ -58,6 +60,11 @@ pcm_resampler_global_init(Error &error)
 	if (strcmp(converter, "internal") == 0)
 		return true;
 
+	if (memcmp(converter, "sinc", 4) == 0) {
+		selected_resampler = SelectedResampler::SINC;
+		return pcm_resample_sinc_global_init(converter, error);
+	}
+
 #ifdef HAVE_SOXR
 	if (memcmp(converter, "soxr", 4) == 0) {
 		selected_resampler = SelectedResampler::SOXR;
@@ -70,8 +77,12 @@ pcm_resampler_global_init(Error &error)
 	return pcm_resample_lsr_global_init(converter, error);
 #endif
 
-	if (*converter == 0)
+	if (*converter == 0) {
+		/* no resampler library: use the built-in sinc
+		   resampler */
+		selected_resampler = SelectedResampler::SINC;
 		return true;
+	}
 
 	error.Format(config_domain,
 		     "The samplerate_converter '%s' is not available",
@@ -79,6 +90,16 @@ pcm_resampler_global_init(Error &error)
 	return false;
 }
 
+void
+pcm_resampler_global_finish()
+{
+	sinc_filter_cache_clear();
+
+#ifdef HAVE_SOXR
+	pcm_resample_soxr_global_finish();
+#endif
+}
+
 PcmResampler *
 pcm_resampler_create()
 {
@@ -86,6 +107,9 @@ pcm_resampler_create()
 	case SelectedResampler::FALLBACK:
 		return new FallbackPcmResampler();
 
+	case SelectedResampler::SINC:
+		return new SincPcmResampler();
+
 #ifdef HAVE_LIBSAMPLERATE
 	case SelectedResampler::LIBSAMPLERATE:
 		return new LibsampleratePcmResampler();
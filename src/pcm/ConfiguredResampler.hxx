@@ -28,6 +28,13 @@ class PcmResampler;
 bool
 pcm_resampler_global_init(Error &error);
 
+/**
+ * Free the filter state which is cached for resampler instances
+ * created later.
+ */
+void
+pcm_resampler_global_finish();
+
 /**
  * Create a #PcmResampler instance from the implementation class
  * configured in mpd.conf.
@@ -32,7 +32,7 @@ class FallbackPcmResampler final : public PcmResampler {
 	AudioFormat format;
 	unsigned out_rate;
 
-	PcmBuffer buffer;
+	PcmScratchBuffer buffer;
 
 public:
 	virtual AudioFormat Open(AudioFormat &af, unsigned new_sample_rate,
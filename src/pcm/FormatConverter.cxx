@@ -28,13 +28,14 @@
 
 bool
 PcmFormatConverter::Open(SampleFormat _src_format, SampleFormat _dest_format,
-			 gcc_unused Error &error)
+			 unsigned channels, gcc_unused Error &error)
 {
 	assert(_src_format != SampleFormat::UNDEFINED);
 	assert(_dest_format != SampleFormat::UNDEFINED);
 
 	src_format = _src_format;
 	dest_format = _dest_format;
+	dither.SetChannels(channels);
 	return true;
 }
 
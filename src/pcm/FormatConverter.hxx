@@ -38,7 +38,7 @@ template<typename T> struct ConstBuffer;
 class PcmFormatConverter {
 	SampleFormat src_format, dest_format;
 
-	PcmBuffer buffer;
+	PcmScratchBuffer buffer;
 	PcmDither dither;
 
 public:
@@ -58,11 +58,13 @@ public:
 	 *
 	 * @param src_format the sample format of incoming data
 	 * @param dest_format the sample format of outgoing data
+	 * @param channels the number of channels; the dithering state
+	 * is kept per channel
 	 * @param error location to store the error
 	 * @return true on success
 	 */
 	bool Open(SampleFormat src_format, SampleFormat dest_format,
-		  Error &error);
+		  unsigned channels, Error &error);
 
 	/**
 	 * Closes the object.  After that, you may call Open() again.
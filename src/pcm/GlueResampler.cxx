@@ -52,7 +52,7 @@ GluePcmResampler::Open(AudioFormat src_format, unsigned new_sample_rate,
 
 	if (requested_format.format != src_format.format &&
 	    !format_converter.Open(src_format.format, requested_format.format,
-				   error))
+				   src_format.channels, error))
 		return false;
 
 	src_sample_format = src_format.format;
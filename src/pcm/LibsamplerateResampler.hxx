@@ -36,7 +36,7 @@ class LibsampleratePcmResampler final : public PcmResampler {
 	SRC_STATE *state;
 	SRC_DATA data;
 
-	PcmBuffer buffer;
+	PcmScratchBuffer buffer;
 
 public:
 	virtual AudioFormat Open(AudioFormat &af, unsigned new_sample_rate,
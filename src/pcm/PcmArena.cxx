@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "PcmArena.hxx"
+#include "util/HugeAllocator.hxx"
+
+/**
+ * All allocations are rounded up to this many bytes, so they don't
+ * share cache lines.
+ */
+static constexpr size_t ARENA_ALIGNMENT = 64;
+
+/* not C++11 "thread_local", which needs gcc 4.8; a plain pointer
+   doesn't need its features */
+static __thread PcmArena *current_arena;
+
+static constexpr size_t
+ArenaAlign(size_t size)
+{
+	return ((size - 1) | (ARENA_ALIGNMENT - 1)) + 1;
+}
+
+PcmArena::Scope::Scope(PcmArena &arena)
+	:previous(current_arena)
+{
+	current_arena = &arena;
+}
+
+PcmArena::Scope::~Scope()
+{
+	current_arena = previous;
+}
+
+PcmArena *
+PcmArena::GetCurrent()
+{
+	return current_arena;
+}
+
+void
+PcmArena::FreeOverflow()
+{
+	while (overflow != nullptr) {
+		Overflow *o = overflow;
+		overflow = o->next;
+		delete[] (uint8_t *)o;
+	}
+
+	bottom_overflow = top_overflow = 0;
+}
+
+void
+PcmArena::FreeData()
+{
+	if (data == nullptr)
+		return;
+
+	if (huge)
+		HugeFree(data, capacity);
+	else
+		delete[] data;
+
+	data = nullptr;
+	capacity = 0;
+}
+
+void
+PcmArena::Clear()
+{
+	top = false;
+	bottom_used = top_used = 0;
+	FreeOverflow();
+	FreeData();
+}
+
+void *
+PcmArena::Allocate(size_t size)
+{
+	/* never return nullptr, see PcmBuffer::Get() */
+	size = ArenaAlign(size > 0 ? size : 1);
+
+	void *result;
+	if (gcc_likely(size <= capacity - bottom_used - top_used)) {
+		if (top) {
+			top_used += size;
+			result = data + capacity - top_used;
+		} else {
+			result = data + bottom_used;
+			bottom_used += size;
+		}
+	} else {
+		/* doesn't fit; this block lives until Reset() */
+		uint8_t *p = new uint8_t[ARENA_ALIGNMENT + size];
+
+		Overflow *o = (Overflow *)p;
+		o->next = overflow;
+		overflow = o;
+
+		if (top)
+			top_overflow += size;
+		else
+			bottom_overflow += size;
+
+		result = p + ARENA_ALIGNMENT;
+	}
+
+	const size_t total = bottom_used + bottom_overflow +
+		top_used + top_overflow;
+	if (total > high_water.load(std::memory_order_relaxed))
+		high_water.store(total, std::memory_order_relaxed);
+
+	return result;
+}
+
+void
+PcmArena::NextStage(const void *input)
+{
+	const uint8_t *p = (const uint8_t *)input;
+
+	if (p >= data && p < data + bottom_used)
+		top = true;
+	else if (p >= data + capacity - top_used && p < data + capacity)
+		top = false;
+	else
+		/* the input is not on either side (e.g. it's the
+		   chunk itself or a temporary block); release the
+		   side which was not used by the previous stage */
+		top = !top;
+
+	if (top)
+		top_used = top_overflow = 0;
+	else
+		bottom_used = bottom_overflow = 0;
+}
+
+void
+PcmArena::Reset()
+{
+	top = false;
+	bottom_used = top_used = 0;
+
+	if (gcc_likely(overflow == nullptr))
+		return;
+
+	FreeOverflow();
+
+	/* grow to the high-water mark, so the next chunk fits */
+
+	FreeData();
+	capacity = ArenaAlign(GetHighWaterMark());
+
+	/* with locking enabled, the arena must be a separate
+	   mapping, because mlock() works on whole pages */
+	huge = HugeIsLocking();
+	data = huge
+		? (uint8_t *)HugeAllocate(capacity)
+		: nullptr;
+	if (data == nullptr) {
+		huge = false;
+		data = new uint8_t[capacity];
+	}
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_ARENA_HXX
+#define MPD_PCM_ARENA_HXX
+
+#include "Compiler.h"
+
+#include <atomic>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Scratch memory for a thread which filters audio chunk by chunk,
+ * e.g. an output thread.  While a #PcmArena::Scope exists,
+ * #PcmScratchBuffer objects take their memory from the arena instead
+ * of growing their own buffers.
+ *
+ * A stage's output is only needed as input for the next stage.  So
+ * the arena has two sides: one grows from the bottom of the block and
+ * one from the top.  NextStage() switches to the side which does not
+ * hold the stage's input and releases what is on it.  The memory
+ * used is therefore the largest pair of adjacent stages, not the sum
+ * of all stages.  Reset() releases everything before the next chunk.
+ *
+ * If an allocation does not fit, a temporary block is allocated, and
+ * Reset() grows the arena to the high-water mark.
+ */
+class PcmArena {
+	/**
+	 * A temporary allocation which did not fit into the arena;
+	 * the data follows this header.
+	 */
+	struct Overflow {
+		Overflow *next;
+	};
+
+	uint8_t *data;
+	size_t capacity;
+
+	/**
+	 * Was #data obtained from HugeAllocate()?
+	 */
+	bool huge;
+
+	/**
+	 * Allocate from the top side?
+	 */
+	bool top;
+
+	/**
+	 * The number of bytes in use at the bottom and at the top of
+	 * #data.
+	 */
+	size_t bottom_used, top_used;
+
+	/**
+	 * The number of bytes which were allocated in #overflow
+	 * blocks for the bottom and the top side since the side was
+	 * last released.  Together with #bottom_used and #top_used,
+	 * this is the capacity the arena would have needed.
+	 */
+	size_t bottom_overflow, top_overflow;
+
+	Overflow *overflow;
+
+	/**
+	 * The largest amount of memory which was in use at a time,
+	 * since this object was constructed.
+	 */
+	std::atomic<size_t> high_water;
+
+public:
+	/**
+	 * Make this arena the current one for this thread.
+	 */
+	class Scope {
+		PcmArena *const previous;
+
+	public:
+		explicit Scope(PcmArena &arena);
+		~Scope();
+
+		Scope(const Scope &) = delete;
+		Scope &operator=(const Scope &) = delete;
+	};
+
+	PcmArena()
+		:data(nullptr), capacity(0), huge(false), top(false),
+		 bottom_used(0), top_used(0),
+		 bottom_overflow(0), top_overflow(0), overflow(nullptr),
+		 high_water(0) {}
+
+	~PcmArena() {
+		Clear();
+	}
+
+	PcmArena(const PcmArena &) = delete;
+	PcmArena &operator=(const PcmArena &) = delete;
+
+	/**
+	 * Returns the arena of the current #Scope in this thread, or
+	 * nullptr if there is none.
+	 */
+	gcc_pure
+	static PcmArena *GetCurrent();
+
+	/**
+	 * Free all memory.  The high-water mark is kept.
+	 */
+	void Clear();
+
+	/**
+	 * Allocate memory from the current side, which remains valid
+	 * until the next Reset(), or until NextStage() releases this
+	 * side.  The size is rounded up to 64 bytes.  The result is
+	 * never nullptr.
+	 */
+	gcc_malloc
+	void *Allocate(size_t size);
+
+	/**
+	 * Begin a new stage which reads the specified input.  Memory
+	 * allocated before this call is released, unless it is on the
+	 * side which holds the input.
+	 */
+	void NextStage(const void *input);
+
+	/**
+	 * Release all allocations; call this before processing the
+	 * next chunk.  If temporary blocks were needed, the arena is
+	 * enlarged to the high-water mark.
+	 */
+	void Reset();
+
+	/**
+	 * Returns the maximum number of bytes which were in use at a
+	 * time.  This may be called from any thread.
+	 */
+	size_t GetHighWaterMark() const {
+		return high_water.load(std::memory_order_relaxed);
+	}
+
+private:
+	void FreeOverflow();
+	void FreeData();
+};
+
+#endif
@@ -19,6 +19,18 @@
 
 #include "config.h"
 #include "PcmBuffer.hxx"
+#include "PcmArena.hxx"
+#include "util/HugeAllocator.hxx"
+
+void
+PcmBuffer::ClearLocked()
+{
+	if (locked != nullptr) {
+		HugeFree(locked, locked_size);
+		locked = nullptr;
+		locked_size = 0;
+	}
+}
 
 void *
 PcmBuffer::Get(size_t new_size)
@@ -28,5 +40,29 @@ PcmBuffer::Get(size_t new_size)
 		   assumed to be an error condition */
 		new_size = 1;
 
+	if (arena) {
+		PcmArena *current = PcmArena::GetCurrent();
+		if (current != nullptr)
+			return current->Allocate(new_size);
+	}
+
+	if (gcc_unlikely(HugeIsLocking())) {
+		if (new_size <= locked_size)
+			return locked;
+
+		ClearLocked();
+
+		/* grow in the same steps as #buffer */
+		const size_t size = ((new_size - 1) | (8192 - 1)) + 1;
+		locked = HugeAllocate(size);
+		if (locked != nullptr) {
+			locked_size = size;
+			return locked;
+		}
+
+		/* out of address space?  Use the heap instead, and
+		   retry next time */
+	}
+
 	return buffer.Get(new_size);
 }
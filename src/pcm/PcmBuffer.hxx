@@ -33,9 +33,38 @@
 class PcmBuffer {
 	ReusableArray<uint8_t, 8192> buffer;
 
+	/**
+	 * May Get() allocate from the current #PcmArena?
+	 */
+	const bool arena;
+
+	/**
+	 * Memory obtained from HugeAllocate(), used instead of
+	 * #buffer if allocations shall be locked into memory (see
+	 * HugeIsLocking()).  mlock() works on whole pages, so the
+	 * heap cannot be used for that.
+	 */
+	void *locked;
+	size_t locked_size;
+
+protected:
+	explicit PcmBuffer(bool _arena)
+		:arena(_arena), locked(nullptr), locked_size(0) {}
+
 public:
+	PcmBuffer()
+		:arena(false), locked(nullptr), locked_size(0) {}
+
+	~PcmBuffer() {
+		ClearLocked();
+	}
+
+	PcmBuffer(const PcmBuffer &) = delete;
+	PcmBuffer &operator=(const PcmBuffer &) = delete;
+
 	void Clear() {
 		buffer.Clear();
+		ClearLocked();
 	}
 
 	/**
@@ -55,6 +84,21 @@ public:
 	T *GetT(size_t n) {
 		return (T *)Get(n * sizeof(T));
 	}
+
+private:
+	void ClearLocked();
+};
+
+/**
+ * A #PcmBuffer for the output of a filter or conversion stage.
+ * Inside a #PcmArena::Scope, its memory is taken from the arena, and
+ * becomes invalid when the stage after next begins (see
+ * PcmArena::NextStage()).  Don't use it for data which must survive
+ * until the next call, or which is passed to asynchronous I/O.
+ */
+class PcmScratchBuffer : public PcmBuffer {
+public:
+	PcmScratchBuffer():PcmBuffer(true) {}
 };
 
 #endif
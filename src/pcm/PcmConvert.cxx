@@ -36,6 +36,12 @@ pcm_convert_global_init(Error &error)
 	return pcm_resampler_global_init(error);
 }
 
+void
+pcm_convert_global_finish()
+{
+	pcm_resampler_global_finish();
+}
+
 PcmConvert::PcmConvert()
 {
 #ifndef NDEBUG
@@ -77,7 +83,8 @@ PcmConvert::Open(AudioFormat _src_format, AudioFormat _dest_format,
 
 	enable_format = format.format != dest_format.format;
 	if (enable_format &&
-	    !format_converter.Open(format.format, dest_format.format, error)) {
+	    !format_converter.Open(format.format, dest_format.format,
+				   format.channels, error)) {
 		if (enable_resampler)
 			resampler.Close();
 		return false;
@@ -85,4 +85,7 @@ public:
 bool
 pcm_convert_global_init(Error &error);
 
+void
+pcm_convert_global_finish();
+
 #endif
@@ -21,45 +21,133 @@
 #include "PcmDither.hxx"
 #include "PcmPrng.hxx"
 #include "Traits.hxx"
+#include "Compiler.h"
 
+#include <string.h>
+
+/**
+ * Dither one sample with the given channel state.  This is
+ * branch-free, to allow the compiler to vectorize a loop over all
+ * channels of a frame.
+ */
 template<typename T, T MIN, T MAX, unsigned scale_bits>
-inline T
-PcmDither::Dither(T sample)
+gcc_always_inline
+static inline T
+DitherChannel(T sample, int32_t &error0, int32_t &error1, int32_t &error2,
+	      uint32_t &random)
 {
 	constexpr T round = 1 << (scale_bits - 1);
 	constexpr T mask = (1 << scale_bits) - 1;
 
-	sample += error[0] - error[1] + error[2];
+	sample += error0 - error1 + error2;
 
-	error[2] = error[1];
-	error[1] = error[0] / 2;
+	error2 = error1;
+	error1 = error0 / 2;
 
 	/* round */
 	T output = sample + round;
 
-	const T rnd = pcm_prng(random);
-	output += (rnd & mask) - (random & mask);
+	const uint32_t rnd = pcm_prng32(random);
+	output += T(rnd & mask) - T(random & mask);
 
 	random = rnd;
 
 	/* clip */
-	if (output > MAX) {
-		output = MAX;
+	const bool clip_max = output > MAX, clip_min = output < MIN;
+	sample = clip_max && sample > MAX ? MAX : sample;
+	sample = clip_min && sample < MIN ? MIN : sample;
+	output = clip_max ? MAX : output;
+	output = clip_min ? MIN : output;
+
+	output &= ~mask;
+
+	error0 = sample - output;
+
+	return output >> scale_bits;
+}
 
-		if (sample > MAX)
-			sample = MAX;
-	} else if (output < MIN) {
-		output = MIN;
+template<typename T, T MIN, T MAX, unsigned scale_bits>
+inline T
+PcmDither::Dither(T sample)
+{
+	const unsigned c = channel;
+	if (++channel == channels)
+		channel = 0;
+
+	return DitherChannel<T, MIN, MAX, scale_bits>(sample,
+						      error0[c], error1[c],
+						      error2[c], random[c]);
+}
 
-		if (sample < MIN)
-			sample = MIN;
+template<typename T, T MIN, T MAX, unsigned scale_bits,
+	 typename DT, typename S>
+gcc_always_inline
+inline void
+PcmDither::DitherFrames(DT *dest, size_t i, size_t n_frames,
+			unsigned n_channels, S source)
+{
+	/* work on local copies, so the compiler knows they don't
+	   alias the destination buffer and can keep them in
+	   registers */
+	int32_t e0[MAX_CHANNELS], e1[MAX_CHANNELS], e2[MAX_CHANNELS];
+	uint32_t r[MAX_CHANNELS];
+	memcpy(e0, error0, sizeof(e0));
+	memcpy(e1, error1, sizeof(e1));
+	memcpy(e2, error2, sizeof(e2));
+	memcpy(r, random, sizeof(r));
+
+	for (; n_frames > 0; --n_frames, i += n_channels) {
+		T in[MAX_CHANNELS];
+		for (unsigned c = 0; c < n_channels; ++c)
+			in[c] = source(i + c);
+
+		for (unsigned c = 0; c < n_channels; ++c)
+			dest[i + c] = DitherChannel<T, MIN, MAX,
+						    scale_bits>(in[c],
+								e0[c], e1[c],
+								e2[c], r[c]);
 	}
 
-	output &= ~mask;
+	memcpy(error0, e0, sizeof(e0));
+	memcpy(error1, e1, sizeof(e1));
+	memcpy(error2, e2, sizeof(e2));
+	memcpy(random, r, sizeof(r));
+}
 
-	error[0] = sample - output;
+template<typename T, T MIN, T MAX, unsigned scale_bits,
+	 typename DT, typename S>
+gcc_always_inline
+inline void
+PcmDither::Dither(DT *dest, size_t n, S source)
+{
+	size_t i = 0;
+
+	/* continue where the previous call stopped, until we're at
+	   the start of a frame */
+	for (; channel != 0 && i != n; ++i)
+		dest[i] = Dither<T, MIN, MAX, scale_bits>(source(i));
+
+	const size_t n_frames = (n - i) / channels;
+	switch (channels) {
+	case 1:
+		DitherFrames<T, MIN, MAX, scale_bits>(dest, i, n_frames,
+						      1, source);
+		break;
+
+	case 2:
+		DitherFrames<T, MIN, MAX, scale_bits>(dest, i, n_frames,
+						      2, source);
+		break;
+
+	default:
+		DitherFrames<T, MIN, MAX, scale_bits>(dest, i, n_frames,
+						      channels, source);
+		break;
+	}
 
-	return output >> scale_bits;
+	/* the remaining partial frame */
+	for (i += n_frames * channels; i < n; ++i)
+		dest[i] = Dither<T, MIN, MAX, scale_bits>(source(i));
 }
 
 template<typename ST, unsigned SBITS, unsigned DBITS>
@@ -75,6 +163,21 @@ PcmDither::DitherShift(ST sample)
 	return Dither<ST, MIN, MAX, SBITS - DBITS>(sample);
 }
 
+template<typename ST, unsigned SBITS, unsigned DBITS,
+	 typename DT, typename S>
+gcc_always_inline
+inline void
+PcmDither::DitherShift(DT *dest, size_t n, S source)
+{
+	static_assert(sizeof(ST) * 8 > SBITS, "Source type too small");
+	static_assert(SBITS > DBITS, "Non-positive scale_bits");
+
+	static constexpr ST MIN = -(ST(1) << (SBITS - 1));
+	static constexpr ST MAX = (ST(1) << (SBITS - 1)) - 1;
+
+	Dither<ST, MIN, MAX, SBITS - DBITS>(dest, n, source);
+}
+
 template<typename ST, typename DT>
 inline typename DT::value_type
 PcmDither::DitherConvert(typename ST::value_type sample)
@@ -89,15 +192,23 @@ PcmDither::DitherConvert(typename ST::value_type sample)
 }
 
 template<typename ST, typename DT>
+gcc_always_inline
 inline void
 PcmDither::DitherConvert(typename DT::pointer_type dest,
 			 typename ST::const_pointer_type src,
 			 typename ST::const_pointer_type src_end)
 {
-	while (src < src_end)
-		*dest++ = DitherConvert<ST, DT>(*src++);
+	static_assert(ST::BITS > DT::BITS,
+		      "Sample formats cannot be dithered");
+
+	constexpr unsigned scale_bits = ST::BITS - DT::BITS;
+
+	Dither<typename ST::sum_type, ST::MIN, ST::MAX,
+	       scale_bits>(dest, src_end - src,
+			   [src](size_t i){ return src[i]; });
 }
 
+gcc_always_inline
 inline void
 PcmDither::Dither24To16(int16_t *dest, const int32_t *src,
 			const int32_t *src_end)
@@ -107,6 +218,7 @@ PcmDither::Dither24To16(int16_t *dest, const int32_t *src,
 	DitherConvert<ST, DT>(dest, src, src_end);
 }
 
+gcc_always_inline
 inline void
 PcmDither::Dither32To16(int16_t *dest, const int32_t *src,
 			const int32_t *src_end)
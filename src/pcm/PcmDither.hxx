@@ -20,17 +20,62 @@
 #ifndef MPD_PCM_DITHER_HXX
 #define MPD_PCM_DITHER_HXX
 
-#include <stdint.h>
+#include "AudioFormat.hxx"
 
-enum class SampleFormat : uint8_t;
+#include <stdint.h>
+#include <stddef.h>
 
+/**
+ * Dithering with noise shaping for reducing the sample resolution.
+ *
+ * Each channel has its own error feedback and PRNG state, which is
+ * advanced once per frame; SetChannels() tells this object how the
+ * samples are interleaved.  The channels of a frame don't depend on
+ * each other, so the compiler may vectorize across them.
+ */
 class PcmDither {
-	int32_t error[3];
-	int32_t random;
+	int32_t error0[MAX_CHANNELS], error1[MAX_CHANNELS],
+		error2[MAX_CHANNELS];
+	uint32_t random[MAX_CHANNELS];
+
+	unsigned channels;
+
+	/**
+	 * The channel of the next sample.
+	 */
+	unsigned channel;
+
+	/**
+	 * Different PRNG seeds for each channel, or else all
+	 * channels would get the same noise.
+	 */
+	static constexpr uint32_t Seed(unsigned i) {
+		return i * 0x9e3779b9u;
+	}
 
 public:
 	constexpr PcmDither()
-		:error{0, 0, 0}, random(0) {}
+		:error0{0, 0, 0, 0, 0, 0, 0, 0},
+		 error1{0, 0, 0, 0, 0, 0, 0, 0},
+		 error2{0, 0, 0, 0, 0, 0, 0, 0},
+		 random{Seed(0), Seed(1), Seed(2), Seed(3),
+			 Seed(4), Seed(5), Seed(6), Seed(7)},
+		 channels(1), channel(0) {
+		static_assert(MAX_CHANNELS == 8,
+			      "Initializers don't match MAX_CHANNELS");
+	}
+
+	/**
+	 * Set the number of interleaved channels.  If it differs
+	 * from the previous value, the next sample is assumed to be
+	 * the first one of a frame.
+	 */
+	void SetChannels(unsigned _channels) {
+		if (_channels != channels) {
+			channels = _channels;
+			channel = 0;
+		}
+	}
 
 	/**
 	 * Shift the given sample by #SBITS-#DBITS to the right, and
@@ -44,6 +89,19 @@ public:
 	template<typename ST, unsigned SBITS, unsigned DBITS>
 	ST DitherShift(ST sample);
 
+	/**
+	 * Like DitherShift(ST), but for a whole buffer.  The bulk
+	 * of the samples is processed one frame at a time.
+	 *
+	 * @param dest the destination buffer (may be the buffer
+	 * which #source reads from)
+	 * @param n the number of samples
+	 * @param source a function returning input sample number i
+	 */
+	template<typename ST, unsigned SBITS, unsigned DBITS,
+		 typename DT, typename S>
+	void DitherShift(DT *dest, size_t n, S source);
+
 	void Dither24To16(int16_t *dest, const int32_t *src,
 			  const int32_t *src_end);
 
@@ -64,6 +122,22 @@ private:
 	template<typename T, T MIN, T MAX, unsigned scale_bits>
 	T Dither(T sample);
 
+	template<typename T, T MIN, T MAX, unsigned scale_bits,
+		 typename DT, typename S>
+	void Dither(DT *dest, size_t n, S source);
+
+	/**
+	 * Dither whole frames, starting at sample number #i.
+	 *
+	 * @param n_channels the number of channels; callers pass a
+	 * constant for the common channel counts, so the loop over the
+	 * channels can be unrolled
+	 */
+	template<typename T, T MIN, T MAX, unsigned scale_bits,
+		 typename DT, typename S>
+	void DitherFrames(DT *dest, size_t i, size_t n_frames,
+			    unsigned n_channels, S source);
+
 	/**
 	 * Convert the given sample from one sample format to another,
 	 * discarding bits.
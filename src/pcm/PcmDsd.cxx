@@ -20,31 +20,111 @@
 #include "config.h"
 #include "PcmDsd.hxx"
 #include "dsd2pcm/dsd2pcm.h"
-#include "util/Macros.hxx"
+#include "util/bit_reverse.h"
 #include "util/ConstBuffer.hxx"
 
 #include <algorithm>
 
 #include <assert.h>
 
-PcmDsd::PcmDsd()
+/**
+ * The number of lookup tables: one for each input byte which
+ * contributes to an output sample.
+ */
+static constexpr unsigned DSD_TAPS = PcmDsd::HISTORY + 1;
+
+/**
+ * The number of tables in dsd2pcm; each covers 8 taps of one half of
+ * the symmetric filter.
+ */
+static constexpr unsigned DSD2PCM_CTABLES = DSD_TAPS / 2;
+
+/**
+ * The dsd2pcm filter, rearranged into one lookup table per input
+ * byte, indexed by the byte's distance from the current one.
+ * dsd2pcm_translate() bit-reverses bytes in its FIFO when they reach
+ * the second half of the filter; here, this is folded into the
+ * tables of the second half.  Tables for lsb-first input are
+ * bit-reversed once more, which saves reversing each input byte.
+ */
+struct DsdTables {
+	float data[2][DSD_TAPS][256];
+
+	DsdTables() {
+		for (unsigned k = 0; k < DSD2PCM_CTABLES; ++k) {
+			const float *first = dsd2pcm_get_ctable(k);
+			const float *second =
+				dsd2pcm_get_ctable(DSD2PCM_CTABLES - 1 - k);
+
+			for (unsigned e = 0; e < 256; ++e) {
+				data[0][k][e] = first[e];
+				data[0][DSD2PCM_CTABLES + k][e] =
+					second[bit_reverse(e)];
+			}
+		}
+
+		for (unsigned k = 0; k < DSD_TAPS; ++k)
+			for (unsigned e = 0; e < 256; ++e)
+				data[1][k][e] = data[0][k][bit_reverse(e)];
+	}
+};
+
+static const DsdTables &
+dsd_tables()
 {
-	std::fill_n(dsd2pcm, ARRAY_SIZE(dsd2pcm), nullptr);
+	static const DsdTables tables;
+	return tables;
 }
 
-PcmDsd::~PcmDsd()
+/**
+ * Filter one channel.  The sum stays in a register, and each output
+ * sample needs one table lookup per input byte; the loop is unrolled
+ * by hand because the compiler would not do it at -O2.
+ *
+ * @param dest_stride the distance between two output samples
+ * @param src the planar input; it begins with #HISTORY bytes from
+ * the previous call
+ * @param n the number of output samples
+ * @param table the #DsdTables for the bit order
+ */
+static void
+DsdFilter(float *gcc_restrict dest, size_t dest_stride,
+	  const uint8_t *gcc_restrict src, size_t n,
+	  const float *gcc_restrict table)
+{
+	static_assert(DSD_TAPS == 12, "Loop must be adjusted");
+
+	src += PcmDsd::HISTORY;
+
+	for (size_t i = 0; i < n; ++i, dest += dest_stride) {
+		const uint8_t *p = src + i;
+
+		float sum = table[p[0]];
+		sum += table[1 * 256 + p[-1]];
+		sum += table[2 * 256 + p[-2]];
+		sum += table[3 * 256 + p[-3]];
+		sum += table[4 * 256 + p[-4]];
+		sum += table[5 * 256 + p[-5]];
+		sum += table[6 * 256 + p[-6]];
+		sum += table[7 * 256 + p[-7]];
+		sum += table[8 * 256 + p[-8]];
+		sum += table[9 * 256 + p[-9]];
+		sum += table[10 * 256 + p[-10]];
+		sum += table[11 * 256 + p[-11]];
+
+		*dest = sum;
+	}
+}
+
+PcmDsd::PcmDsd()
+	:reset(true)
 {
-	for (unsigned i = 0; i < ARRAY_SIZE(dsd2pcm); ++i)
-		if (dsd2pcm[i] != nullptr)
-			dsd2pcm_destroy(dsd2pcm[i]);
 }
 
 void
 PcmDsd::Reset()
 {
-	for (unsigned i = 0; i < ARRAY_SIZE(dsd2pcm); ++i)
-		if (dsd2pcm[i] != nullptr)
-			dsd2pcm_reset(dsd2pcm[i]);
+	reset = true;
 }
 
 ConstBuffer<float>
@@ -54,7 +134,23 @@ PcmDsd::ToFloat(unsigned channels, bool lsbfirst,
 	assert(!src.IsNull());
 	assert(!src.IsEmpty());
 	assert(src.size % channels == 0);
-	assert(channels <= ARRAY_SIZE(dsd2pcm));
+	assert(channels <= MAX_CHANNELS);
+
+	if (reset) {
+		/* dsd2pcm's silence pattern, as it would appear in
+		   the FIFO of dsd2pcm_translate(); the older bytes
+		   have never been bit-reversed there, so they must
+		   be here */
+		const uint8_t silence = lsbfirst ? bit_reverse(0x69) : 0x69;
+		constexpr unsigned n_old = HISTORY - DSD2PCM_CTABLES;
+		for (unsigned c = 0; c < channels; ++c) {
+			std::fill_n(history[c], n_old, bit_reverse(silence));
+			std::fill_n(history[c] + n_old, HISTORY - n_old,
+				    silence);
+		}
+
+		reset = false;
+	}
 
 	const unsigned num_samples = src.size;
 	const unsigned num_frames = src.size / channels;
@@ -63,16 +159,18 @@ PcmDsd::ToFloat(unsigned channels, bool lsbfirst,
 	const size_t dest_size = num_samples * sizeof(*dest);
 	dest = (float *)buffer.Get(dest_size);
 
+	uint8_t *planar = (uint8_t *)input_buffer.Get(HISTORY + num_frames);
+
+	const float *table = &dsd_tables().data[lsbfirst][0][0];
+
 	for (unsigned c = 0; c < channels; ++c) {
-		if (dsd2pcm[c] == nullptr) {
-			dsd2pcm[c] = dsd2pcm_init();
-			if (dsd2pcm[c] == nullptr)
-				return nullptr;
-		}
+		std::copy_n(history[c], HISTORY, planar);
+		for (unsigned i = 0; i < num_frames; ++i)
+			planar[HISTORY + i] = src.data[i * channels + c];
+
+		DsdFilter(dest + c, channels, planar, num_frames, table);
 
-		dsd2pcm_translate(dsd2pcm[c], num_frames,
-				  src.data + c, channels,
-				  lsbfirst, dest + c, channels);
+		std::copy_n(planar + num_frames, HISTORY, history[c]);
 	}
 
 	return { dest, num_samples };
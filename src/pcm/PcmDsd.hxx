@@ -28,16 +28,38 @@
 template<typename T> struct ConstBuffer;
 
 /**
- * Wrapper for the dsd2pcm library.
+ * Convert DSD to PCM with the FIR filter from the dsd2pcm library.
+ * Instead of calling dsd2pcm_translate() for each channel, this uses
+ * rearranged lookup tables which make the inner loop much simpler.
  */
 class PcmDsd {
-	PcmBuffer buffer;
+public:
+	/**
+	 * The number of input bytes (per channel) which are needed
+	 * in addition to the current one to calculate an output
+	 * sample.
+	 */
+	static constexpr unsigned HISTORY = 11;
+
+	static constexpr unsigned MAX_CHANNELS = 32;
+
+private:
+	PcmScratchBuffer buffer, input_buffer;
+
+	/**
+	 * The last #HISTORY input bytes of each channel.
+	 */
+	uint8_t history[MAX_CHANNELS][HISTORY];
 
-	struct dsd2pcm_ctx_s *dsd2pcm[32];
+	/**
+	 * Must #history be filled with silence before the next
+	 * ToFloat() call?  This is deferred, because the silence
+	 * pattern depends on the bit order.
+	 */
+	bool reset;
 
 public:
 	PcmDsd();
-	~PcmDsd();
 
 	void Reset();
 
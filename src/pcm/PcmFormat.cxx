@@ -20,10 +20,10 @@
 #include "config.h"
 #include "PcmFormat.hxx"
 #include "PcmBuffer.hxx"
-#include "PcmUtils.hxx"
 #include "Traits.hxx"
 #include "util/ConstBuffer.hxx"
 #include "util/WritableBuffer.hxx"
+#include "util/CpuFeatures.hxx"
 
 #include "PcmDither.cxx" // including the .cxx file to get inlined templates
 
@@ -34,374 +34,380 @@ ToConst(WritableBuffer<T> b)
 	return { b.data, b.size };
 }
 
-static void
-pcm_convert_8_to_16(int16_t *out, const int8_t *in, size_t n)
+/**
+ * Convert integer samples by shifting them to the left.  This and
+ * the other converters below are plain loops, which the compiler may
+ * vectorize; they are instantiated for each instruction set by
+ * PCM_FORMAT_KERNELS().
+ */
+template<typename D, typename S, unsigned shift>
+gcc_always_inline
+static inline void
+ShiftLeft(D *gcc_restrict out, const S *gcc_restrict in, size_t n)
 {
 	for (size_t i = 0; i != n; ++i)
-		out[i] = in[i] << 8;
-}
-
-static void
-pcm_convert_24_to_16(PcmDither &dither,
-		     int16_t *out, const int32_t *in, const int32_t *in_end)
-{
-	dither.Dither24To16(out, in, in_end);
+		out[i] = D(in[i]) << shift;
 }
 
-static void
-pcm_convert_32_to_16(PcmDither &dither,
-		     int16_t *out, const int32_t *in, const int32_t *in_end)
+template<typename D, typename S, unsigned shift>
+gcc_always_inline
+static inline void
+ShiftRight(D *gcc_restrict out, const S *gcc_restrict in, size_t n)
 {
-	dither.Dither32To16(out, in, in_end);
+	for (size_t i = 0; i != n; ++i)
+		out[i] = in[i] >> shift;
 }
 
+/**
+ * Convert floating point samples to integers.  The value is clamped
+ * before it is converted (instead of after, as PcmClamp() does),
+ * because the conversion to 32 bit integers can be vectorized, but
+ * the conversion to #Traits::long_type can't.  Since the limits are
+ * integers, the result is the same.
+ */
 template<SampleFormat F, class Traits=SampleTraits<F>>
-static void
-ConvertFromFloat(typename Traits::pointer_type dest,
-		 const float *src, size_t n)
+gcc_always_inline
+static inline void
+ConvertFromFloat(typename Traits::pointer_type gcc_restrict dest,
+		 const float *gcc_restrict src, size_t n)
 {
+	static_assert(Traits::BITS <= 24,
+		      "Float conversion limits not exact");
+
 	constexpr auto bits = Traits::BITS;
 
-	const float factor = 1 << (bits - 1);
+	constexpr float factor = 1 << (bits - 1);
+	constexpr float min = Traits::MIN, max = Traits::MAX;
 
 	for (size_t i = 0; i != n; ++i) {
-		typename Traits::long_type sample(src[i] * factor);
-		dest[i] = PcmClamp<F, Traits>(sample);
+		float sample = src[i] * factor;
+		sample = sample < min ? min : sample;
+		sample = sample > max ? max : sample;
+		dest[i] = int32_t(sample);
 	}
 }
 
 template<SampleFormat F, class Traits=SampleTraits<F>>
-static typename Traits::pointer_type
-AllocateFromFloat(PcmBuffer &buffer, const float *src, size_t src_size,
-		  size_t *dest_size_r)
-{
-	constexpr size_t src_sample_size = sizeof(*src);
-	assert(src_size % src_sample_size == 0);
-
-	const size_t num_samples = src_size / src_sample_size;
-	*dest_size_r = num_samples * sizeof(typename Traits::value_type);
-	auto dest = (typename Traits::pointer_type)buffer.Get(*dest_size_r);
-	ConvertFromFloat<F, Traits>(dest, src, src_size / sizeof(*src));
-	return dest;
-}
-
-template<SampleFormat F, class Traits=SampleTraits<F>>
-static WritableBuffer<typename Traits::value_type>
-AllocateFromFloat(PcmBuffer &buffer, ConstBuffer<float> src)
+gcc_always_inline
+static inline void
+ConvertToFloat(float *gcc_restrict dest,
+	       typename Traits::const_pointer_type gcc_restrict src,
+	       size_t n)
 {
-	auto dest = buffer.GetT<typename Traits::value_type>(src.size);
-	ConvertFromFloat<F, Traits>(dest, src.data, src.size);
-	return { dest, src.size };
+	constexpr float factor = 0.5 / (1 << (Traits::BITS - 2));
+	for (size_t i = 0; i != n; ++i)
+		dest[i] = float(src[i]) * factor;
 }
 
-static ConstBuffer<int16_t>
-pcm_allocate_8_to_16(PcmBuffer &buffer, ConstBuffer<int8_t> src)
+/**
+ * Convert floating point samples to 32 bit integers, with 24 bit
+ * precision.
+ */
+gcc_always_inline
+static inline void
+ConvertFromFloat32(int32_t *gcc_restrict dest,
+		   const float *gcc_restrict src, size_t n)
 {
-	auto dest = buffer.GetT<int16_t>(src.size);
-	pcm_convert_8_to_16(dest, src.data, src.size);
-	return { dest, src.size };
-}
+	ConvertFromFloat<SampleFormat::S24_P32>(dest, src, n);
 
-static ConstBuffer<int16_t>
-pcm_allocate_24p32_to_16(PcmBuffer &buffer, PcmDither &dither,
-			 ConstBuffer<int32_t> src)
+	for (size_t i = 0; i != n; ++i)
+		dest[i] <<= 8;
+}
+
+struct PcmFormatKernels {
+	void (*s8_to_16)(int16_t *out, const int8_t *in, size_t n);
+	void (*s24_to_16)(PcmDither &dither, int16_t *out,
+			  const int32_t *in, const int32_t *in_end);
+	void (*s32_to_16)(PcmDither &dither, int16_t *out,
+			  const int32_t *in, const int32_t *in_end);
+	void (*float_to_16)(int16_t *out, const float *in, size_t n);
+
+	void (*s8_to_24)(int32_t *out, const int8_t *in, size_t n);
+	void (*s16_to_24)(int32_t *out, const int16_t *in, size_t n);
+	void (*s32_to_24)(int32_t *out, const int32_t *in, size_t n);
+	void (*float_to_24)(int32_t *out, const float *in, size_t n);
+
+	void (*s8_to_32)(int32_t *out, const int8_t *in, size_t n);
+	void (*s16_to_32)(int32_t *out, const int16_t *in, size_t n);
+	void (*s24_to_32)(int32_t *out, const int32_t *in, size_t n);
+	void (*float_to_32)(int32_t *out, const float *in, size_t n);
+
+	void (*s8_to_float)(float *out, const int8_t *in, size_t n);
+	void (*s16_to_float)(float *out, const int16_t *in, size_t n);
+	void (*s24_to_float)(float *out, const int32_t *in, size_t n);
+	void (*s32_to_float)(float *out, const int32_t *in, size_t n);
+};
+
+/**
+ * Instantiate the converters for one instruction set.
+ */
+#define PCM_FORMAT_KERNELS(NAME, ATTRIBUTES) \
+	ATTRIBUTES static void \
+	NAME##_8_to_16(int16_t *out, const int8_t *in, size_t n) \
+	{ \
+		ShiftLeft<int16_t, int8_t, 8>(out, in, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_24_to_16(PcmDither &dither, int16_t *out, \
+			const int32_t *in, const int32_t *in_end) \
+	{ \
+		dither.Dither24To16(out, in, in_end); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_32_to_16(PcmDither &dither, int16_t *out, \
+			const int32_t *in, const int32_t *in_end) \
+	{ \
+		dither.Dither32To16(out, in, in_end); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_float_to_16(int16_t *out, const float *in, size_t n) \
+	{ \
+		ConvertFromFloat<SampleFormat::S16>(out, in, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_8_to_24(int32_t *out, const int8_t *in, size_t n) \
+	{ \
+		ShiftLeft<int32_t, int8_t, 16>(out, in, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_16_to_24(int32_t *out, const int16_t *in, size_t n) \
+	{ \
+		ShiftLeft<int32_t, int16_t, 8>(out, in, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_32_to_24(int32_t *out, const int32_t *in, size_t n) \
+	{ \
+		ShiftRight<int32_t, int32_t, 8>(out, in, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_float_to_24(int32_t *out, const float *in, size_t n) \
+	{ \
+		ConvertFromFloat<SampleFormat::S24_P32>(out, in, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_8_to_32(int32_t *out, const int8_t *in, size_t n) \
+	{ \
+		ShiftLeft<int32_t, int8_t, 24>(out, in, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_16_to_32(int32_t *out, const int16_t *in, size_t n) \
+	{ \
+		ShiftLeft<int32_t, int16_t, 16>(out, in, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_24_to_32(int32_t *out, const int32_t *in, size_t n) \
+	{ \
+		ShiftLeft<int32_t, int32_t, 8>(out, in, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_float_to_32(int32_t *out, const float *in, size_t n) \
+	{ \
+		ConvertFromFloat32(out, in, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_8_to_float(float *out, const int8_t *in, size_t n) \
+	{ \
+		ConvertToFloat<SampleFormat::S8>(out, in, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_16_to_float(float *out, const int16_t *in, size_t n) \
+	{ \
+		ConvertToFloat<SampleFormat::S16>(out, in, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_24_to_float(float *out, const int32_t *in, size_t n) \
+	{ \
+		ConvertToFloat<SampleFormat::S24_P32>(out, in, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_32_to_float(float *out, const int32_t *in, size_t n) \
+	{ \
+		ConvertToFloat<SampleFormat::S32>(out, in, n); \
+	} \
+	static constexpr PcmFormatKernels NAME = { \
+		NAME##_8_to_16, NAME##_24_to_16, \
+		NAME##_32_to_16, NAME##_float_to_16, \
+		NAME##_8_to_24, NAME##_16_to_24, \
+		NAME##_32_to_24, NAME##_float_to_24, \
+		NAME##_8_to_32, NAME##_16_to_32, \
+		NAME##_24_to_32, NAME##_float_to_32, \
+		NAME##_8_to_float, NAME##_16_to_float, \
+		NAME##_24_to_float, NAME##_32_to_float, \
+	};
+
+CPU_KERNELS(PCM_FORMAT_KERNELS, PcmFormatKernels, pcm_format, sse2,
+	    pcm_format_kernels)
+
+/**
+ * Allocate a destination buffer and convert all samples with the
+ * given kernel.
+ */
+template<typename D, typename S>
+static WritableBuffer<D>
+AllocateConvert(PcmBuffer &buffer, ConstBuffer<S> src,
+		void (*convert)(D *out, const S *in, size_t n))
 {
-	auto dest = buffer.GetT<int16_t>(src.size);
-	pcm_convert_24_to_16(dither, dest, src.data, src.end());
+	auto dest = buffer.GetT<D>(src.size);
+	convert(dest, src.data, src.size);
 	return { dest, src.size };
 }
 
 static ConstBuffer<int16_t>
-pcm_allocate_32_to_16(PcmBuffer &buffer, PcmDither &dither,
-		      ConstBuffer<int32_t> src)
+pcm_allocate_dither_to_16(PcmBuffer &buffer, PcmDither &dither,
+			  ConstBuffer<int32_t> src,
+			  void (*convert)(PcmDither &dither, int16_t *out,
+					  const int32_t *in,
+					  const int32_t *in_end))
 {
 	auto dest = buffer.GetT<int16_t>(src.size);
-	pcm_convert_32_to_16(dither, dest, src.data, src.end());
+	convert(dither, dest, src.data, src.end());
 	return { dest, src.size };
 }
 
-static ConstBuffer<int16_t>
-pcm_allocate_float_to_16(PcmBuffer &buffer, ConstBuffer<float> src)
-{
-	return ToConst(AllocateFromFloat<SampleFormat::S16>(buffer, src));
-}
-
 ConstBuffer<int16_t>
 pcm_convert_to_16(PcmBuffer &buffer, PcmDither &dither,
 		  SampleFormat src_format, ConstBuffer<void> src)
 {
+	const PcmFormatKernels &kernels = pcm_format_kernels();
+
 	switch (src_format) {
 	case SampleFormat::UNDEFINED:
 	case SampleFormat::DSD:
 		break;
 
 	case SampleFormat::S8:
-		return pcm_allocate_8_to_16(buffer,
-					    ConstBuffer<int8_t>::FromVoid(src));
+		return ToConst(AllocateConvert(buffer,
+					       ConstBuffer<int8_t>::FromVoid(src),
+					       kernels.s8_to_16));
 
 	case SampleFormat::S16:
 		return ConstBuffer<int16_t>::FromVoid(src);
 
 	case SampleFormat::S24_P32:
-		return pcm_allocate_24p32_to_16(buffer, dither,
-						ConstBuffer<int32_t>::FromVoid(src));
+		return pcm_allocate_dither_to_16(buffer, dither,
+						 ConstBuffer<int32_t>::FromVoid(src),
+						 kernels.s24_to_16);
 
 	case SampleFormat::S32:
-		return pcm_allocate_32_to_16(buffer, dither,
-					     ConstBuffer<int32_t>::FromVoid(src));
+		return pcm_allocate_dither_to_16(buffer, dither,
+						 ConstBuffer<int32_t>::FromVoid(src),
+						 kernels.s32_to_16);
 
 	case SampleFormat::FLOAT:
-		return pcm_allocate_float_to_16(buffer,
-						ConstBuffer<float>::FromVoid(src));
+		return ToConst(AllocateConvert(buffer,
+					       ConstBuffer<float>::FromVoid(src),
+					       kernels.float_to_16));
 	}
 
 	return nullptr;
 }
 
-static void
-pcm_convert_8_to_24(int32_t *out, const int8_t *in, size_t n)
-{
-	for (size_t i = 0; i != n; ++i)
-		out[i] = in[i] << 16;
-}
-
-static void
-pcm_convert_16_to_24(int32_t *out, const int16_t *in, size_t n)
-{
-	for (size_t i = 0; i != n; ++i)
-		out[i] = in[i] << 8;
-}
-
-static void
-pcm_convert_32_to_24(int32_t *gcc_restrict out,
-		     const int32_t *gcc_restrict in,
-		     size_t n)
-{
-	for (size_t i = 0; i != n; ++i)
-		out[i] = in[i] >> 8;
-}
-
-static ConstBuffer<int32_t>
-pcm_allocate_8_to_24(PcmBuffer &buffer, ConstBuffer<int8_t> src)
-{
-	auto dest = buffer.GetT<int32_t>(src.size);
-	pcm_convert_8_to_24(dest, src.data, src.size);
-	return { dest, src.size };
-}
-
-static ConstBuffer<int32_t>
-pcm_allocate_16_to_24(PcmBuffer &buffer, ConstBuffer<int16_t> src)
-{
-	auto dest = buffer.GetT<int32_t>(src.size);
-	pcm_convert_16_to_24(dest, src.data, src.size);
-	return { dest, src.size };
-}
-
-static ConstBuffer<int32_t>
-pcm_allocate_32_to_24(PcmBuffer &buffer, ConstBuffer<int32_t> src)
-{
-	auto dest = buffer.GetT<int32_t>(src.size);
-	pcm_convert_32_to_24(dest, src.data, src.size);
-	return { dest, src.size };
-}
-
-static WritableBuffer<int32_t>
-pcm_allocate_float_to_24(PcmBuffer &buffer, ConstBuffer<float> src)
-{
-	return AllocateFromFloat<SampleFormat::S24_P32>(buffer, src);
-}
-
 ConstBuffer<int32_t>
 pcm_convert_to_24(PcmBuffer &buffer,
 		  SampleFormat src_format, ConstBuffer<void> src)
 {
+	const PcmFormatKernels &kernels = pcm_format_kernels();
+
 	switch (src_format) {
 	case SampleFormat::UNDEFINED:
 	case SampleFormat::DSD:
 		break;
 
 	case SampleFormat::S8:
-		return pcm_allocate_8_to_24(buffer,
-					    ConstBuffer<int8_t>::FromVoid(src));
+		return ToConst(AllocateConvert(buffer,
+					       ConstBuffer<int8_t>::FromVoid(src),
+					       kernels.s8_to_24));
 
 	case SampleFormat::S16:
-		return pcm_allocate_16_to_24(buffer,
-					     ConstBuffer<int16_t>::FromVoid(src));
+		return ToConst(AllocateConvert(buffer,
+					       ConstBuffer<int16_t>::FromVoid(src),
+					       kernels.s16_to_24));
 
 	case SampleFormat::S24_P32:
 		return ConstBuffer<int32_t>::FromVoid(src);
 
 	case SampleFormat::S32:
-		return pcm_allocate_32_to_24(buffer,
-					     ConstBuffer<int32_t>::FromVoid(src));
+		return ToConst(AllocateConvert(buffer,
+					       ConstBuffer<int32_t>::FromVoid(src),
+					       kernels.s32_to_24));
 
 	case SampleFormat::FLOAT:
-		return ToConst(pcm_allocate_float_to_24(buffer,
-							ConstBuffer<float>::FromVoid(src)));
+		return ToConst(AllocateConvert(buffer,
+					       ConstBuffer<float>::FromVoid(src),
+					       kernels.float_to_24));
 	}
 
 	return nullptr;
 }
 
-static void
-pcm_convert_8_to_32(int32_t *out, const int8_t *in, size_t n)
-{
-	for (size_t i = 0; i != n; ++i)
-		out[i] = in[i] << 24;
-}
-
-static void
-pcm_convert_16_to_32(int32_t *out, const int16_t *in, size_t n)
-{
-	for (size_t i = 0; i != n; ++i)
-		out[i] = in[i] << 16;
-}
-
-static void
-pcm_convert_24_to_32(int32_t *gcc_restrict out,
-		     const int32_t *gcc_restrict in,
-		     size_t n)
-{
-	for (size_t i = 0; i != n; ++i)
-		out[i] = in[i] << 8;
-}
-
-static ConstBuffer<int32_t>
-pcm_allocate_8_to_32(PcmBuffer &buffer, ConstBuffer<int8_t> src)
-{
-	auto dest = buffer.GetT<int32_t>(src.size);
-	pcm_convert_8_to_32(dest, src.data, src.size);
-	return { dest, src.size };
-}
-
-static ConstBuffer<int32_t>
-pcm_allocate_16_to_32(PcmBuffer &buffer, ConstBuffer<int16_t> src)
-{
-	auto dest = buffer.GetT<int32_t>(src.size);
-	pcm_convert_16_to_32(dest, src.data, src.size);
-	return { dest, src.size };
-}
-
-static ConstBuffer<int32_t>
-pcm_allocate_24p32_to_32(PcmBuffer &buffer, ConstBuffer<int32_t> src)
-{
-	auto dest = buffer.GetT<int32_t>(src.size);
-	pcm_convert_24_to_32(dest, src.data, src.size);
-	return { dest, src.size };
-}
-
-static ConstBuffer<int32_t>
-pcm_allocate_float_to_32(PcmBuffer &buffer, ConstBuffer<float> src)
-{
-	/* convert to S24_P32 first */
-	auto dest = pcm_allocate_float_to_24(buffer, src);
-
-	/* convert to 32 bit in-place */
-	pcm_convert_24_to_32(dest.data, dest.data, src.size);
-	return ToConst(dest);
-}
-
 ConstBuffer<int32_t>
 pcm_convert_to_32(PcmBuffer &buffer,
 		  SampleFormat src_format, ConstBuffer<void> src)
 {
+	const PcmFormatKernels &kernels = pcm_format_kernels();
+
 	switch (src_format) {
 	case SampleFormat::UNDEFINED:
 	case SampleFormat::DSD:
 		break;
 
 	case SampleFormat::S8:
-		return pcm_allocate_8_to_32(buffer,
-					    ConstBuffer<int8_t>::FromVoid(src));
+		return ToConst(AllocateConvert(buffer,
+					       ConstBuffer<int8_t>::FromVoid(src),
+					       kernels.s8_to_32));
 
 	case SampleFormat::S16:
-		return pcm_allocate_16_to_32(buffer,
-					     ConstBuffer<int16_t>::FromVoid(src));
+		return ToConst(AllocateConvert(buffer,
+					       ConstBuffer<int16_t>::FromVoid(src),
+					       kernels.s16_to_32));
 
 	case SampleFormat::S24_P32:
-		return pcm_allocate_24p32_to_32(buffer,
-						ConstBuffer<int32_t>::FromVoid(src));
+		return ToConst(AllocateConvert(buffer,
+					       ConstBuffer<int32_t>::FromVoid(src),
+					       kernels.s24_to_32));
 
 	case SampleFormat::S32:
 		return ConstBuffer<int32_t>::FromVoid(src);
 
 	case SampleFormat::FLOAT:
-		return pcm_allocate_float_to_32(buffer,
-						ConstBuffer<float>::FromVoid(src));
+		return ToConst(AllocateConvert(buffer,
+					       ConstBuffer<float>::FromVoid(src),
+					       kernels.float_to_32));
 	}
 
 	return nullptr;
 }
 
-template<SampleFormat F, class Traits=SampleTraits<F>>
-static void
-ConvertToFloat(float *dest,
-	       typename Traits::const_pointer_type src,
-	       size_t n)
-{
-	constexpr float factor = 0.5 / (1 << (Traits::BITS - 2));
-	for (size_t i = 0; i != n; ++i)
-		dest[i] = float(src[i]) * factor;
-}
-
-template<SampleFormat F, class Traits=SampleTraits<F>>
-static ConstBuffer<float>
-AllocateToFloat(PcmBuffer &buffer,
-		ConstBuffer<typename Traits::value_type> src)
-{
-	float *dest = buffer.GetT<float>(src.size);
-	ConvertToFloat<F, Traits>(dest, src.data, src.size);
-	return { dest, src.size };
-}
-
-static ConstBuffer<float>
-pcm_allocate_8_to_float(PcmBuffer &buffer, ConstBuffer<int8_t> src)
-{
-	return AllocateToFloat<SampleFormat::S8>(buffer, src);
-}
-
-static ConstBuffer<float>
-pcm_allocate_16_to_float(PcmBuffer &buffer, ConstBuffer<int16_t> src)
-{
-	return AllocateToFloat<SampleFormat::S16>(buffer, src);
-}
-
-static ConstBuffer<float>
-pcm_allocate_24p32_to_float(PcmBuffer &buffer, ConstBuffer<int32_t> src)
-{
-	return AllocateToFloat<SampleFormat::S24_P32>(buffer, src);
-}
-
-static ConstBuffer<float>
-pcm_allocate_32_to_float(PcmBuffer &buffer, ConstBuffer<int32_t> src)
-{
-	return AllocateToFloat<SampleFormat::S32>(buffer, src);
-}
-
 ConstBuffer<float>
 pcm_convert_to_float(PcmBuffer &buffer,
 		     SampleFormat src_format, ConstBuffer<void> src)
 {
+	const PcmFormatKernels &kernels = pcm_format_kernels();
+
 	switch (src_format) {
 	case SampleFormat::UNDEFINED:
 	case SampleFormat::DSD:
 		break;
 
 	case SampleFormat::S8:
-		return pcm_allocate_8_to_float(buffer,
-					       ConstBuffer<int8_t>::FromVoid(src));
+		return ToConst(AllocateConvert(buffer,
+					       ConstBuffer<int8_t>::FromVoid(src),
+					       kernels.s8_to_float));
 
 	case SampleFormat::S16:
-		return pcm_allocate_16_to_float(buffer,
-					       ConstBuffer<int16_t>::FromVoid(src));
+		return ToConst(AllocateConvert(buffer,
+					       ConstBuffer<int16_t>::FromVoid(src),
+					       kernels.s16_to_float));
 
 	case SampleFormat::S32:
-		return pcm_allocate_32_to_float(buffer,
-					       ConstBuffer<int32_t>::FromVoid(src));
+		return ToConst(AllocateConvert(buffer,
+					       ConstBuffer<int32_t>::FromVoid(src),
+					       kernels.s32_to_float));
 
 	case SampleFormat::S24_P32:
-		return pcm_allocate_24p32_to_float(buffer,
-						   ConstBuffer<int32_t>::FromVoid(src));
+		return ToConst(AllocateConvert(buffer,
+					       ConstBuffer<int32_t>::FromVoid(src),
+					       kernels.s24_to_float));
 
 	case SampleFormat::FLOAT:
 		return ConstBuffer<float>::FromVoid(src);
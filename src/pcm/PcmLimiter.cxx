@@ -0,0 +1,401 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "PcmLimiter.hxx"
+#include "Domain.hxx"
+#include "PcmUtils.hxx"
+#include "Traits.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/CpuFeatures.hxx"
+#include "util/Error.hxx"
+#include "util/Macros.hxx"
+
+#include <algorithm>
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * The limiter keeps the peak level below this value, relative to
+ * full scale.
+ */
+static constexpr float LIMITER_CEILING = 1;
+
+/**
+ * Determine the peak level relative to full scale.  The absolute
+ * values are compared as unsigned integers, because GCC vectorizes
+ * integer maximum reductions, but not floating point ones.
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>>
+gcc_always_inline
+static inline float
+pcm_limiter_peak(const void *_src, size_t n)
+{
+	const auto *src = (typename Traits::const_pointer_type)_src;
+
+	uint32_t peak = 0;
+	for (size_t i = 0; i != n; ++i) {
+		const uint32_t value = src[i] < 0
+			? 0u - uint32_t(src[i])
+			: uint32_t(src[i]);
+		peak = value > peak ? value : peak;
+	}
+
+	return float(peak) / float(uint32_t(1) << (Traits::BITS - 1));
+}
+
+template<>
+gcc_always_inline
+inline float
+pcm_limiter_peak<SampleFormat::FLOAT>(const void *_src, size_t n)
+{
+	/* the bits of non-negative IEEE 754 numbers are ordered
+	   like their values */
+	const uint32_t *src = (const uint32_t *)_src;
+
+	uint32_t peak = 0;
+	for (size_t i = 0; i != n; ++i) {
+		const uint32_t value = src[i] & 0x7fffffff;
+		peak = value > peak ? value : peak;
+	}
+
+	float result;
+	memcpy(&result, &peak, sizeof(result));
+	return result;
+}
+
+/**
+ * Multiply each sample with the gain, which changes linearly:
+ * gain + delta * ramp[i].  Integer samples are rounded to the
+ * nearest value and clamped.
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>,
+	 typename A=typename PcmAccumulator<F>::type>
+gcc_always_inline
+static inline void
+pcm_limiter_apply(void *gcc_restrict _dest, const void *gcc_restrict _src,
+		  const float *gcc_restrict ramp, size_t n,
+		  float gain, float delta)
+{
+	auto *dest = (typename Traits::pointer_type)_dest;
+	const auto *src = (typename Traits::const_pointer_type)_src;
+
+	for (size_t i = 0; i != n; ++i)
+		dest[i] = PcmRoundClamp<F>(A(src[i]) *
+					   A(gain + delta * ramp[i]));
+}
+
+template<>
+gcc_always_inline
+inline void
+pcm_limiter_apply<SampleFormat::FLOAT>(void *gcc_restrict _dest,
+				       const void *gcc_restrict _src,
+				       const float *gcc_restrict ramp,
+				       size_t n, float gain, float delta)
+{
+	float *dest = (float *)_dest;
+	const float *src = (const float *)_src;
+
+	for (size_t i = 0; i != n; ++i)
+		dest[i] = src[i] * (gain + delta * ramp[i]);
+}
+
+struct PcmLimiterKernels {
+	float (*peak)(const void *src, size_t n);
+	void (*apply)(void *dest, const void *src, const float *ramp,
+		      size_t n, float gain, float delta);
+};
+
+typedef PcmLimiterKernels PcmLimiterTable[4];
+
+/**
+ * Instantiate the kernels for one instruction set; there is one
+ * entry for each sample format, in the order of
+ * pcm_limiter_format_index().
+ */
+#define PCM_LIMITER_KERNEL(NAME, ATTRIBUTES, SUFFIX, FORMAT) \
+	ATTRIBUTES static float \
+	NAME##_peak_##SUFFIX(const void *src, size_t n) \
+	{ \
+		return pcm_limiter_peak<FORMAT>(src, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_apply_##SUFFIX(void *dest, const void *src, \
+			      const float *ramp, size_t n, \
+			      float gain, float delta) \
+	{ \
+		pcm_limiter_apply<FORMAT>(dest, src, ramp, n, gain, delta); \
+	}
+
+#define PCM_LIMITER_KERNELS(NAME, ATTRIBUTES) \
+	PCM_LIMITER_KERNEL(NAME, ATTRIBUTES, 16, SampleFormat::S16) \
+	PCM_LIMITER_KERNEL(NAME, ATTRIBUTES, 24, SampleFormat::S24_P32) \
+	PCM_LIMITER_KERNEL(NAME, ATTRIBUTES, 32, SampleFormat::S32) \
+	PCM_LIMITER_KERNEL(NAME, ATTRIBUTES, float, SampleFormat::FLOAT) \
+	static constexpr PcmLimiterTable NAME = { \
+		{ NAME##_peak_16, NAME##_apply_16 }, \
+		{ NAME##_peak_24, NAME##_apply_24 }, \
+		{ NAME##_peak_32, NAME##_apply_32 }, \
+		{ NAME##_peak_float, NAME##_apply_float }, \
+	};
+
+CPU_KERNELS(PCM_LIMITER_KERNELS, PcmLimiterTable, pcm_limiter, sse2,
+	    pcm_limiter_kernels)
+
+/**
+ * @return the index into the kernel table, or -1 if the format is
+ * not supported
+ */
+gcc_const
+static int
+pcm_limiter_format_index(SampleFormat format)
+{
+	switch (format) {
+	case SampleFormat::S16:
+		return 0;
+
+	case SampleFormat::S24_P32:
+		return 1;
+
+	case SampleFormat::S32:
+		return 2;
+
+	case SampleFormat::FLOAT:
+		return 3;
+
+	case SampleFormat::UNDEFINED:
+	case SampleFormat::S8:
+	case SampleFormat::DSD:
+		break;
+	}
+
+	return -1;
+}
+
+bool
+PcmLimiter::Open(SampleFormat _format, unsigned _channels,
+		 unsigned sample_rate, Error &error)
+{
+	assert(format == SampleFormat::UNDEFINED);
+	assert(audio_valid_channel_count(_channels));
+	assert(sample_rate > 0);
+
+	const int index = pcm_limiter_format_index(_format);
+	if (index < 0) {
+		error.Format(pcm_domain,
+			     "Limiter does not support sample format %s",
+			     sample_format_to_string(_format));
+		return false;
+	}
+
+	kernels = pcm_limiter_kernels() + index;
+
+	look_ahead = (uint64_t(config.look_ahead) * sample_rate / 1000
+		      + PCM_LIMITER_BLOCK - 1) / PCM_LIMITER_BLOCK;
+	look_ahead = std::max(look_ahead, 1u);
+	look_ahead = std::min(look_ahead, PCM_LIMITER_MAX_LOOK_AHEAD);
+
+	const double release_frames =
+		std::max(config.release, 1u) * sample_rate / 1000.;
+	release = 1 - exp(-double(PCM_LIMITER_BLOCK) / release_frames);
+
+	/* two more blocks than the look-ahead: the gain of each
+	   output block is interpolated between its two boundaries,
+	   and each boundary depends on the blocks around it */
+	delay_frames = (look_ahead + 2) * PCM_LIMITER_BLOCK;
+
+	delay = (uint8_t *)delay_buffer.Get(delay_frames * _channels *
+					    sample_format_size(_format));
+
+	for (unsigned i = 0; i < PCM_LIMITER_BLOCK; ++i)
+		std::fill_n(ramp + i * _channels, _channels,
+			    float(i) / PCM_LIMITER_BLOCK);
+
+	gain_start = gain_end = 1;
+
+	slot_peak = 0;
+	std::fill_n(history, PCM_LIMITER_HISTORY, 0.f);
+	history_position = 0;
+	makeup = 1;
+
+	format = _format;
+	channels = _channels;
+
+	Reset();
+	return true;
+}
+
+void
+PcmLimiter::Reset()
+{
+	assert(format != SampleFormat::UNDEFINED);
+
+	memset(delay, 0,
+	       delay_frames * channels * sample_format_size(format));
+	position = 0;
+	pending = false;
+
+	block_peak = 0;
+	n_blocks = 0;
+	std::fill_n(limits, ARRAY_SIZE(limits), config.max_gain);
+}
+
+void
+PcmLimiter::FinishSlot()
+{
+	history[history_position] = slot_peak;
+	history_position = (history_position + 1) % PCM_LIMITER_HISTORY;
+	slot_peak = 0;
+
+	const float peak = *std::max_element(history,
+					     history + PCM_LIMITER_HISTORY);
+
+	/* amplify up to the target level, but never attenuate */
+	makeup = peak * config.max_gain > config.target
+		? config.target / peak
+		: config.max_gain;
+	makeup = std::max(makeup, 1.f);
+}
+
+float
+PcmLimiter::NextGain() const
+{
+	const float previous = gain_end;
+
+	/* approach the normalizer's gain slowly */
+	float gain = previous + (makeup - previous) * release;
+	if (fabsf(makeup - gain) < 1e-4f)
+		/* snap to the exact value; this makes a gain of 1
+		   bit-exact */
+		gain = makeup;
+
+	/* this boundary is shared by the blocks x-1 and x, and
+	   must not clip either */
+	const unsigned x = n_blocks - 1 - look_ahead;
+	gain = std::min(gain, GetLimit(x - 1));
+	gain = std::min(gain, GetLimit(x));
+
+	/* ramp down linearly towards peaks within the look-ahead,
+	   so the gain reaches their limit in time */
+	for (unsigned j = 1; j <= look_ahead; ++j) {
+		const float limit = GetLimit(x + j);
+		if (limit < previous)
+			gain = std::min(gain,
+					previous + (limit - previous) / (j + 1));
+	}
+
+	return gain;
+}
+
+void
+PcmLimiter::FinishBlock()
+{
+	limits[n_blocks % ARRAY_SIZE(limits)] =
+		block_peak * config.max_gain > LIMITER_CEILING
+		? LIMITER_CEILING / block_peak
+		: config.max_gain;
+	++n_blocks;
+
+	slot_peak = std::max(slot_peak, block_peak);
+	block_peak = 0;
+
+	if (n_blocks % PCM_LIMITER_SLOT == 0)
+		FinishSlot();
+
+	gain_start = gain_end;
+	gain_end = NextGain();
+}
+
+void
+PcmLimiter::Process(uint8_t *dest, const uint8_t *src, size_t n_frames)
+{
+	const size_t frame_size = channels * sample_format_size(format);
+
+	while (n_frames > 0) {
+		/* each segment is within one block, which never wraps
+		   around the end of the delay buffer */
+		const size_t offset = position % PCM_LIMITER_BLOCK;
+		const size_t n = std::min(n_frames,
+					  PCM_LIMITER_BLOCK - offset);
+		const size_t n_samples = n * channels;
+
+		uint8_t *const d = delay + position * frame_size;
+		if (gain_start == 1 && gain_end == 1)
+			/* the common case with loud music */
+			memcpy(dest, d, n * frame_size);
+		else
+			kernels->apply(dest, d, ramp + offset * channels,
+				       n_samples, gain_start,
+				       gain_end - gain_start);
+
+		if (src != nullptr) {
+			block_peak = std::max(block_peak,
+					      kernels->peak(src, n_samples));
+			memcpy(d, src, n * frame_size);
+			src += n * frame_size;
+		} else
+			memset(d, 0, n * frame_size);
+
+		dest += n * frame_size;
+		n_frames -= n;
+
+		position += n;
+		if (position % PCM_LIMITER_BLOCK == 0) {
+			if (position == delay_frames)
+				position = 0;
+
+			FinishBlock();
+		}
+	}
+}
+
+ConstBuffer<void>
+PcmLimiter::Apply(ConstBuffer<void> src)
+{
+	assert(format != SampleFormat::UNDEFINED);
+
+	const size_t frame_size = channels * sample_format_size(format);
+	assert(src.size % frame_size == 0);
+
+	void *dest = buffer.Get(src.size);
+	Process((uint8_t *)dest, (const uint8_t *)src.data,
+		src.size / frame_size);
+	pending = pending || src.size > 0;
+	return { dest, src.size };
+}
+
+ConstBuffer<void>
+PcmLimiter::Flush()
+{
+	assert(format != SampleFormat::UNDEFINED);
+
+	if (!pending)
+		return { nullptr, 0 };
+
+	/* push silence through the delay line; this returns all
+	   frames which are still in it */
+	const size_t size =
+		delay_frames * channels * sample_format_size(format);
+	void *dest = buffer.Get(size);
+	Process((uint8_t *)dest, nullptr, delay_frames);
+	pending = false;
+	return { dest, size };
+}
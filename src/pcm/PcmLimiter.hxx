@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_LIMITER_HXX
+#define MPD_PCM_LIMITER_HXX
+
+#include "AudioFormat.hxx"
+#include "PcmBuffer.hxx"
+#include "Compiler.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef NDEBUG
+#include <assert.h>
+#endif
+
+class Error;
+template<typename T> struct ConstBuffer;
+
+/**
+ * The number of frames which share one gain step.  The gain is
+ * interpolated linearly within each block.
+ */
+static constexpr unsigned PCM_LIMITER_BLOCK = 32;
+
+/**
+ * The maximum look-ahead, in blocks.
+ */
+static constexpr unsigned PCM_LIMITER_MAX_LOOK_AHEAD = 64;
+
+/**
+ * The number of blocks in one slot of the normalizer's history.
+ */
+static constexpr unsigned PCM_LIMITER_SLOT = 64;
+
+/**
+ * The number of slots in the normalizer's history.
+ */
+static constexpr unsigned PCM_LIMITER_HISTORY = 128;
+
+struct PcmLimiterConfig {
+	/**
+	 * The level which the normalizer aims for, relative to full
+	 * scale.
+	 */
+	float target;
+
+	/**
+	 * The maximum amplification.
+	 */
+	float max_gain;
+
+	/**
+	 * The look-ahead of the limiter in milliseconds.  The gain
+	 * starts to decrease this long before a peak.
+	 */
+	unsigned look_ahead;
+
+	/**
+	 * The time constant of gain changes in milliseconds, after
+	 * a peak and while the normalizer adapts to the loudness.
+	 */
+	unsigned release;
+
+	constexpr PcmLimiterConfig()
+		:target(0.5), max_gain(32), look_ahead(5), release(200) {}
+};
+
+struct PcmLimiterKernels;
+
+/**
+ * A loudness normalizer with a look-ahead peak limiter.  It amplifies
+ * quiet music up to PcmLimiterConfig::target, based on the peak level
+ * of the last few seconds, and reduces the gain smoothly before
+ * peaks which would clip.  Samples are processed in their own format,
+ * and the output is delayed by the look-ahead.
+ */
+class PcmLimiter {
+	SampleFormat format;
+
+	unsigned channels;
+
+	PcmLimiterConfig config;
+
+	/**
+	 * The look-ahead in blocks.
+	 */
+	unsigned look_ahead;
+
+	/**
+	 * The coefficient for gain changes per block, derived from
+	 * PcmLimiterConfig::release.
+	 */
+	float release;
+
+	/**
+	 * The SIMD kernels chosen by Open() for this CPU.
+	 */
+	const PcmLimiterKernels *kernels;
+
+	/**
+	 * A ring buffer with the last #delay_frames input frames,
+	 * which have not been returned yet.
+	 */
+	uint8_t *delay;
+	size_t delay_frames;
+
+	/**
+	 * The current frame index in #delay.  It is always inside
+	 * the current input block.
+	 */
+	size_t position;
+
+	/**
+	 * Does #delay contain input frames which have not been
+	 * returned yet?
+	 */
+	bool pending;
+
+	/**
+	 * The peak level of the current (incomplete) input block.
+	 */
+	float block_peak;
+
+	/**
+	 * The number of completed input blocks.
+	 */
+	unsigned n_blocks;
+
+	/**
+	 * The maximum gain which will not clip, for the last input
+	 * blocks; indexed by the block number modulo the array size.
+	 */
+	float limits[PCM_LIMITER_MAX_LOOK_AHEAD * 2];
+
+	gcc_pure
+	float GetLimit(unsigned block) const {
+		return limits[block % (PCM_LIMITER_MAX_LOOK_AHEAD * 2)];
+	}
+
+	/**
+	 * The gain at the start and at the end of the current output
+	 * block.
+	 */
+	float gain_start, gain_end;
+
+	/**
+	 * The normalizer's peak level of the current history slot.
+	 */
+	float slot_peak;
+
+	/**
+	 * The peak levels of the last history slots.
+	 */
+	float history[PCM_LIMITER_HISTORY];
+	unsigned history_position;
+
+	/**
+	 * The gain chosen by the normalizer, without the limiter.
+	 */
+	float makeup;
+
+	/**
+	 * The position of each sample within a block, relative to
+	 * the block size.  The gain within a block is interpolated
+	 * with these factors.
+	 */
+	float ramp[PCM_LIMITER_BLOCK * MAX_CHANNELS];
+
+	PcmBuffer delay_buffer;
+	PcmScratchBuffer buffer;
+
+public:
+	PcmLimiter() {
+#ifndef NDEBUG
+		format = SampleFormat::UNDEFINED;
+#endif
+	}
+
+#ifndef NDEBUG
+	~PcmLimiter() {
+		assert(format == SampleFormat::UNDEFINED);
+	}
+#endif
+
+	/**
+	 * Change the configuration.  Call this before Open().
+	 */
+	void Configure(const PcmLimiterConfig &_config) {
+		config = _config;
+	}
+
+	/**
+	 * Opens the object, prepare for Apply().
+	 *
+	 * @param format the sample format; only 16, 24 and 32 bit
+	 * integer and floating point samples are supported
+	 * @param error location to store the error
+	 * @return true on success
+	 */
+	bool Open(SampleFormat format, unsigned channels,
+		  unsigned sample_rate, Error &error);
+
+	/**
+	 * Closes the object.  After that, you may call Open() again.
+	 */
+	void Close() {
+#ifndef NDEBUG
+		assert(format != SampleFormat::UNDEFINED);
+		format = SampleFormat::UNDEFINED;
+#endif
+	}
+
+	/**
+	 * Returns the latency in frames.
+	 */
+	size_t GetDelay() const {
+		return delay_frames;
+	}
+
+	/**
+	 * Discard the frames in the delay line, e.g. after a seek.
+	 * The normalizer keeps its loudness history.
+	 */
+	void Reset();
+
+	/**
+	 * Process a buffer of frames, and return the same number of
+	 * frames delayed by GetDelay().
+	 */
+	ConstBuffer<void> Apply(ConstBuffer<void> src);
+
+	/**
+	 * Return the frames remaining in the delay line, e.g. at the
+	 * end of playback.  The result is empty if there are none.
+	 */
+	ConstBuffer<void> Flush();
+
+private:
+	/**
+	 * Process #n_frames frames.
+	 *
+	 * @param src the input frames, or nullptr for silence
+	 */
+	void Process(uint8_t *dest, const uint8_t *src, size_t n_frames);
+
+	void FinishBlock();
+	void FinishSlot();
+
+	gcc_pure
+	float NextGain() const;
+};
+
+#endif
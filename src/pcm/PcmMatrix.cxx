@@ -0,0 +1,404 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "PcmMatrix.hxx"
+#include "PcmUtils.hxx"
+#include "Traits.hxx"
+#include "util/CpuFeatures.hxx"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <stdint.h>
+
+void
+PcmMatrix::Clear(unsigned _src_channels, unsigned _dest_channels)
+{
+	assert(audio_valid_channel_count(_src_channels));
+	assert(audio_valid_channel_count(_dest_channels));
+
+	src_channels = _src_channels;
+	dest_channels = _dest_channels;
+
+	for (auto &row : gain)
+		std::fill_n(row, MAX_CHANNELS, 0.f);
+}
+
+enum ChannelPosition : uint8_t {
+	FL, FR, FC, LFE, BL, BR, BC, SL, SR,
+	N_POSITIONS,
+};
+
+/**
+ * The speaker positions for each channel count.
+ */
+static constexpr ChannelPosition channel_layouts[MAX_CHANNELS][MAX_CHANNELS] = {
+	{ FC },
+	{ FL, FR },
+	{ FL, FR, FC },
+	{ FL, FR, BL, BR },
+	{ FL, FR, FC, BL, BR },
+	{ FL, FR, FC, LFE, BL, BR },
+	{ FL, FR, FC, LFE, BC, SL, SR },
+	{ FL, FR, FC, LFE, BL, BR, SL, SR },
+};
+
+/**
+ * -3 dB, the ITU-R BS.775 coefficient for folding a channel into two
+ * neighbours.
+ */
+static constexpr float MATRIX_FOLD = 0.70710678f;
+
+/**
+ * Add input channel #s with the given gain to the output channel at
+ * position #p.  If the output doesn't have this position, fold it
+ * into the nearest ones.
+ *
+ * @param index the output channel index of each position, or -1
+ */
+static void
+MatrixFold(PcmMatrix &matrix, const int8_t *index,
+	   unsigned s, ChannelPosition p, float g)
+{
+	if (index[p] >= 0) {
+		matrix.gain[unsigned(index[p])][s] += g;
+		return;
+	}
+
+	switch (p) {
+	case FL:
+	case FR:
+		MatrixFold(matrix, index, s, FC, g * MATRIX_FOLD);
+		break;
+
+	case FC:
+		MatrixFold(matrix, index, s, FL, g * MATRIX_FOLD);
+		MatrixFold(matrix, index, s, FR, g * MATRIX_FOLD);
+		break;
+
+	case LFE:
+	case N_POSITIONS:
+		/* dropped */
+		break;
+
+	case BL:
+	case SL:
+		if (index[p == BL ? SL : BL] >= 0)
+			MatrixFold(matrix, index, s, p == BL ? SL : BL, g);
+		else
+			MatrixFold(matrix, index, s, FL, g * MATRIX_FOLD);
+		break;
+
+	case BR:
+	case SR:
+		if (index[p == BR ? SR : BR] >= 0)
+			MatrixFold(matrix, index, s, p == BR ? SR : BR, g);
+		else
+			MatrixFold(matrix, index, s, FR, g * MATRIX_FOLD);
+		break;
+
+	case BC:
+		if (index[BL] >= 0 && index[BR] >= 0) {
+			MatrixFold(matrix, index, s, BL, g * MATRIX_FOLD);
+			MatrixFold(matrix, index, s, BR, g * MATRIX_FOLD);
+		} else if (index[SL] >= 0 && index[SR] >= 0) {
+			MatrixFold(matrix, index, s, SL, g * MATRIX_FOLD);
+			MatrixFold(matrix, index, s, SR, g * MATRIX_FOLD);
+		} else {
+			MatrixFold(matrix, index, s, FL, g * MATRIX_FOLD);
+			MatrixFold(matrix, index, s, FR, g * MATRIX_FOLD);
+		}
+		break;
+	}
+}
+
+void
+PcmMatrix::SetDefault(unsigned _src_channels, unsigned _dest_channels)
+{
+	Clear(_src_channels, _dest_channels);
+
+	if (src_channels == 1) {
+		/* mono is played on the front speakers, not on the
+		   center speaker */
+		gain[0][0] = 1;
+		if (dest_channels > 1)
+			gain[1][0] = 1;
+		return;
+	}
+
+	int8_t index[N_POSITIONS];
+	std::fill_n(index, N_POSITIONS, -1);
+	for (unsigned d = 0; d < dest_channels; ++d)
+		index[channel_layouts[dest_channels - 1][d]] = d;
+
+	for (unsigned s = 0; s < src_channels; ++s)
+		MatrixFold(*this, index, s,
+			   channel_layouts[src_channels - 1][s], 1);
+
+	/* attenuate outputs which mix several channels, so they
+	   can't clip */
+	for (unsigned d = 0; d < dest_channels; ++d) {
+		float sum = 0;
+		for (unsigned s = 0; s < src_channels; ++s)
+			sum += gain[d][s];
+
+		if (sum > 1)
+			for (unsigned s = 0; s < src_channels; ++s)
+				gain[d][s] /= sum;
+	}
+}
+
+bool
+PcmMatrix::IsRoute() const
+{
+	for (unsigned d = 0; d < dest_channels; ++d) {
+		unsigned n = 0;
+		for (unsigned s = 0; s < src_channels; ++s) {
+			if (gain[d][s] == 0)
+				continue;
+
+			if (gain[d][s] != 1 || ++n > 1)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * The number of frames mixed at a time by MatrixMixBlocks().
+ */
+static constexpr size_t MATRIX_BLOCK_FRAMES = 64;
+
+/**
+ * The mixer loop.  It converts blocks of interleaved frames to planar
+ * samples, which are easier to vectorize.  When inlined with
+ * constant channel counts, the compiler can unroll the channel loops.
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>,
+	 typename A=typename PcmAccumulator<F>::type>
+gcc_always_inline
+static inline void
+MatrixMixBlocks(typename Traits::pointer_type gcc_restrict dest,
+		typename Traits::const_pointer_type gcc_restrict src,
+		size_t n_frames, const PcmMatrix &matrix,
+		const unsigned n_src, const unsigned n_dest)
+{
+	A in[MAX_CHANNELS][MATRIX_BLOCK_FRAMES];
+	A out[MAX_CHANNELS][MATRIX_BLOCK_FRAMES];
+
+	while (n_frames > 0) {
+		const size_t n = std::min(n_frames, MATRIX_BLOCK_FRAMES);
+
+		for (unsigned s = 0; s < n_src; ++s)
+			for (size_t f = 0; f != n; ++f)
+				in[s][f] = A(src[f * n_src + s]);
+
+		for (unsigned d = 0; d < n_dest; ++d) {
+			const A g0 = matrix.gain[d][0];
+			for (size_t f = 0; f != n; ++f)
+				out[d][f] = g0 * in[0][f];
+
+			for (unsigned s = 1; s < n_src; ++s) {
+				const A g = matrix.gain[d][s];
+				for (size_t f = 0; f != n; ++f)
+					out[d][f] += g * in[s][f];
+			}
+		}
+
+		for (unsigned d = 0; d < n_dest; ++d)
+			for (size_t f = 0; f != n; ++f)
+				dest[f * n_dest + d] =
+					PcmRoundClamp<F>(out[d][f]);
+
+		src += n * n_src;
+		dest += n * n_dest;
+		n_frames -= n;
+	}
+}
+
+template<SampleFormat F, unsigned N, unsigned M,
+	 class Traits=SampleTraits<F>>
+gcc_always_inline
+static inline void
+MatrixMixN(typename Traits::pointer_type dest,
+	   typename Traits::const_pointer_type src,
+	   size_t n_frames, const PcmMatrix &matrix)
+{
+	MatrixMixBlocks<F>(dest, src, n_frames, matrix, N, M);
+}
+
+template<SampleFormat F, unsigned M, class Traits=SampleTraits<F>>
+gcc_always_inline
+static inline bool
+MatrixMixDown(typename Traits::pointer_type dest,
+	      typename Traits::const_pointer_type src,
+	      size_t n_frames, const PcmMatrix &matrix)
+{
+	switch (matrix.src_channels) {
+	case 2:
+		MatrixMixN<F, 2, M>(dest, src, n_frames, matrix);
+		return true;
+
+	case 3:
+		MatrixMixN<F, 3, M>(dest, src, n_frames, matrix);
+		return true;
+
+	case 4:
+		MatrixMixN<F, 4, M>(dest, src, n_frames, matrix);
+		return true;
+
+	case 5:
+		MatrixMixN<F, 5, M>(dest, src, n_frames, matrix);
+		return true;
+
+	case 6:
+		MatrixMixN<F, 6, M>(dest, src, n_frames, matrix);
+		return true;
+
+	case 7:
+		MatrixMixN<F, 7, M>(dest, src, n_frames, matrix);
+		return true;
+
+	case 8:
+		MatrixMixN<F, 8, M>(dest, src, n_frames, matrix);
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/**
+ * Choose a specialized loop for downmixing to stereo or mono, or
+ * fall back to the generic one.
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>>
+gcc_always_inline
+static inline void
+MatrixMix(typename Traits::pointer_type dest,
+	  typename Traits::const_pointer_type src,
+	  size_t n_frames, const PcmMatrix &matrix)
+{
+	if (matrix.dest_channels == 2 &&
+	    MatrixMixDown<F, 2>(dest, src, n_frames, matrix))
+		return;
+
+	if (matrix.dest_channels == 1 &&
+	    MatrixMixDown<F, 1>(dest, src, n_frames, matrix))
+		return;
+
+	MatrixMixBlocks<F>(dest, src, n_frames, matrix,
+			   matrix.src_channels, matrix.dest_channels);
+}
+
+struct PcmMatrixKernels {
+	void (*s8)(int8_t *dest, const int8_t *src, size_t n_frames,
+		   const PcmMatrix &matrix);
+	void (*s16)(int16_t *dest, const int16_t *src, size_t n_frames,
+		    const PcmMatrix &matrix);
+	void (*s24)(int32_t *dest, const int32_t *src, size_t n_frames,
+		    const PcmMatrix &matrix);
+	void (*s32)(int32_t *dest, const int32_t *src, size_t n_frames,
+		    const PcmMatrix &matrix);
+	void (*f)(float *dest, const float *src, size_t n_frames,
+		  const PcmMatrix &matrix);
+};
+
+/**
+ * Instantiate the kernels for one instruction set.
+ */
+#define PCM_MATRIX_KERNELS(NAME, ATTRIBUTES) \
+	ATTRIBUTES static void \
+	NAME##_8(int8_t *dest, const int8_t *src, size_t n_frames, \
+		 const PcmMatrix &matrix) \
+	{ \
+		MatrixMix<SampleFormat::S8>(dest, src, n_frames, matrix); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_16(int16_t *dest, const int16_t *src, size_t n_frames, \
+		  const PcmMatrix &matrix) \
+	{ \
+		MatrixMix<SampleFormat::S16>(dest, src, n_frames, matrix); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_24(int32_t *dest, const int32_t *src, size_t n_frames, \
+		  const PcmMatrix &matrix) \
+	{ \
+		MatrixMix<SampleFormat::S24_P32>(dest, src, n_frames, \
+						 matrix); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_32(int32_t *dest, const int32_t *src, size_t n_frames, \
+		  const PcmMatrix &matrix) \
+	{ \
+		MatrixMix<SampleFormat::S32>(dest, src, n_frames, matrix); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_float(float *dest, const float *src, size_t n_frames, \
+		     const PcmMatrix &matrix) \
+	{ \
+		MatrixMix<SampleFormat::FLOAT>(dest, src, n_frames, matrix); \
+	} \
+	static constexpr PcmMatrixKernels NAME = { \
+		NAME##_8, NAME##_16, NAME##_24, NAME##_32, NAME##_float, \
+	};
+
+CPU_KERNELS(PCM_MATRIX_KERNELS, PcmMatrixKernels, pcm_matrix, sse2,
+	    pcm_matrix_kernels)
+
+void
+pcm_matrix_mix(SampleFormat format, void *dest, const void *src,
+	       size_t n_frames, const PcmMatrix &matrix)
+{
+	const PcmMatrixKernels &kernels = pcm_matrix_kernels();
+
+	switch (format) {
+	case SampleFormat::UNDEFINED:
+	case SampleFormat::DSD:
+		assert(false);
+		gcc_unreachable();
+
+	case SampleFormat::S8:
+		kernels.s8((int8_t *)dest, (const int8_t *)src,
+			   n_frames, matrix);
+		break;
+
+	case SampleFormat::S16:
+		kernels.s16((int16_t *)dest, (const int16_t *)src,
+			    n_frames, matrix);
+		break;
+
+	case SampleFormat::S24_P32:
+		kernels.s24((int32_t *)dest, (const int32_t *)src,
+			    n_frames, matrix);
+		break;
+
+	case SampleFormat::S32:
+		kernels.s32((int32_t *)dest, (const int32_t *)src,
+			    n_frames, matrix);
+		break;
+
+	case SampleFormat::FLOAT:
+		kernels.f((float *)dest, (const float *)src,
+			  n_frames, matrix);
+		break;
+	}
+}
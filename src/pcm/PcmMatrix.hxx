@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_MATRIX_HXX
+#define MPD_PCM_MATRIX_HXX
+
+#include "AudioFormat.hxx"
+#include "Compiler.h"
+
+#include <stddef.h>
+
+/**
+ * A gain matrix which mixes #src_channels input channels into
+ * #dest_channels output channels.
+ *
+ * The channel order is the one used by WAVE, FLAC and ALSA: front
+ * left, front right, front center, LFE, back left, back right, side
+ * left, side right (for 7 channels: back center instead of back
+ * left/right).
+ */
+struct PcmMatrix {
+	unsigned src_channels, dest_channels;
+
+	/**
+	 * The gain of input channel s in output channel d is
+	 * gain[d][s].
+	 */
+	float gain[MAX_CHANNELS][MAX_CHANNELS];
+
+	/**
+	 * Initialize a matrix which mutes all channels.
+	 */
+	void Clear(unsigned _src_channels, unsigned _dest_channels);
+
+	/**
+	 * Initialize the standard downmix or upmix matrix for the
+	 * given channel counts.  Channels which do not exist in the
+	 * output are folded into their neighbours (ITU-R BS.775
+	 * coefficients, without LFE), and each output is attenuated
+	 * to avoid clipping.  Mono is copied to front left and right.
+	 */
+	void SetDefault(unsigned _src_channels, unsigned _dest_channels);
+
+	/**
+	 * Does each output channel copy at most one input channel,
+	 * without changing its level?
+	 */
+	gcc_pure
+	bool IsRoute() const;
+};
+
+/**
+ * Mix interleaved PCM frames with the given matrix, with SIMD kernels
+ * chosen at runtime.  Integer samples are rounded to the nearest value
+ * and clamped.
+ *
+ * @param format the sample format; DSD is not supported
+ * @param dest the destination buffer with room for n_frames *
+ * matrix.dest_channels samples; it must not overlap with #src
+ * @param src the source buffer
+ * @param n_frames the number of frames
+ */
+void
+pcm_matrix_mix(SampleFormat format, void *dest, const void *src,
+	       size_t n_frames, const PcmMatrix &matrix);
+
+#endif
@@ -29,20 +29,7 @@
 
 #include <assert.h>
 #include <math.h>
-
-template<SampleFormat F, class Traits=SampleTraits<F>>
-static typename Traits::value_type
-PcmAddVolume(PcmDither &dither,
-	     typename Traits::value_type _a, typename Traits::value_type _b,
-	     int volume1, int volume2)
-{
-	typename Traits::long_type a(_a), b(_b);
-	typename Traits::long_type c(a * volume1 + b * volume2);
-
-	return dither.DitherShift<typename Traits::long_type,
-				  Traits::BITS + PCM_VOLUME_BITS,
-				  Traits::BITS>(c);
-}
+#include <string.h>
 
 template<SampleFormat F, class Traits=SampleTraits<F>>
 static void
@@ -51,9 +38,13 @@ PcmAddVolume(PcmDither &dither,
 	     typename Traits::const_pointer_type b,
 	     size_t n, int volume1, int volume2)
 {
-	for (size_t i = 0; i != n; ++i)
-		a[i] = PcmAddVolume<F, Traits>(dither, a[i], b[i],
-					       volume1, volume2);
+	typedef typename Traits::long_type long_type;
+
+	dither.DitherShift<long_type,
+			   Traits::BITS + PCM_VOLUME_BITS,
+			   Traits::BITS>(a, n, [=](size_t i){
+		return long_type(a[i]) * volume1 + long_type(b[i]) * volume2;
+	});
 }
 
 template<SampleFormat F, class Traits=SampleTraits<F>>
@@ -230,3 +221,217 @@ pcm_mix(PcmDither &dither, void *buffer1, const void *buffer2, size_t size,
 	return pcm_add_vol(dither, buffer1, buffer2, size,
 			   vol1, PCM_VOLUME_1S - vol1, format);
 }
+
+bool
+mix_curve_parse(const char *name, MixCurve &curve_r)
+{
+	if (strcmp(name, "sine") == 0)
+		curve_r = MixCurve::SINE;
+	else if (strcmp(name, "linear") == 0)
+		curve_r = MixCurve::LINEAR;
+	else if (strcmp(name, "equal_power") == 0)
+		curve_r = MixCurve::EQUAL_POWER;
+	else
+		return false;
+
+	return true;
+}
+
+/**
+ * Calculate the gains of both buffers for the given portion of the
+ * first one.
+ */
+static void
+mix_curve_gains(MixCurve curve, float portion1, float &gain1, float &gain2)
+{
+	portion1 = Clamp<float>(portion1, 0, 1);
+
+	switch (curve) {
+	case MixCurve::SINE:
+		gain1 = sin(M_PI_2 * portion1);
+		gain1 *= gain1;
+		gain2 = 1 - gain1;
+		return;
+
+	case MixCurve::LINEAR:
+		gain1 = portion1;
+		gain2 = 1 - portion1;
+		return;
+
+	case MixCurve::EQUAL_POWER:
+		gain1 = sin(M_PI_2 * portion1);
+		gain2 = cos(M_PI_2 * portion1);
+		return;
+	}
+
+	assert(false);
+	gcc_unreachable();
+}
+
+/**
+ * The number of fraction bits of the per-frame volume steps of the
+ * integer kernels.
+ */
+static constexpr unsigned RAMP_FRACTION_BITS = 16;
+
+template<SampleFormat F, class Traits=SampleTraits<F>>
+static void
+PcmAddVolumeRamp(PcmDither &dither,
+		 typename Traits::pointer_type a,
+		 typename Traits::const_pointer_type b,
+		 size_t n_frames, unsigned channels,
+		 int32_t volume1, int32_t step1,
+		 int32_t volume2, int32_t step2)
+{
+	typedef typename Traits::long_type long_type;
+
+	/* the volumes are calculated from the frame index, so the
+	   samples can be dithered in parallel */
+	dither.DitherShift<long_type,
+			   Traits::BITS + PCM_VOLUME_BITS,
+			   Traits::BITS>(a, n_frames * channels, [=](size_t i){
+		const int32_t frame = i / channels;
+		const int v1 = (volume1 + step1 * frame) >> RAMP_FRACTION_BITS;
+		const int v2 = (volume2 + step2 * frame) >> RAMP_FRACTION_BITS;
+
+		return long_type(a[i]) * v1 + long_type(b[i]) * v2;
+	});
+}
+
+template<SampleFormat F, class Traits=SampleTraits<F>>
+static void
+PcmAddVolumeRampVoid(PcmDither &dither,
+		     void *a, const void *b, size_t size, unsigned channels,
+		     float gain1_start, float gain1_end,
+		     float gain2_start, float gain2_end)
+{
+	const size_t frame_size = Traits::SAMPLE_SIZE * channels;
+	assert(size % frame_size == 0);
+
+	const size_t n_frames = size / frame_size;
+	if (n_frames == 0)
+		return;
+
+	/* the volumes are rounded to the nearest integer when
+	   shifting out the fraction bits */
+	constexpr float scale = PCM_VOLUME_1S << RAMP_FRACTION_BITS;
+	constexpr int32_t half = 1 << (RAMP_FRACTION_BITS - 1);
+	const int32_t volume1 = int32_t(gain1_start * scale) + half;
+	const int32_t volume2 = int32_t(gain2_start * scale) + half;
+	const int32_t step1 = (gain1_end - gain1_start) * scale / n_frames;
+	const int32_t step2 = (gain2_end - gain2_start) * scale / n_frames;
+
+	PcmAddVolumeRamp<F, Traits>(dither,
+				    typename Traits::pointer_type(a),
+				    typename Traits::const_pointer_type(b),
+				    n_frames, channels,
+				    volume1, step1, volume2, step2);
+}
+
+/**
+ * The floating point kernel.  The gains are calculated from the frame
+ * index instead of being accumulated, so there is no loop-carried
+ * dependency, and the compiler is free to vectorize it.
+ */
+static void
+pcm_add_vol_ramp_float(float *gcc_restrict a, const float *gcc_restrict b,
+		       size_t n_frames, unsigned channels,
+		       float gain1, float step1, float gain2, float step2)
+{
+	if (channels == 2) {
+		/* the common case: let the compiler see the frame
+		   layout */
+		for (size_t i = 0; i != n_frames; ++i) {
+			const float v1 = gain1 + step1 * i;
+			const float v2 = gain2 + step2 * i;
+			a[2 * i] = a[2 * i] * v1 + b[2 * i] * v2;
+			a[2 * i + 1] = a[2 * i + 1] * v1 + b[2 * i + 1] * v2;
+		}
+
+		return;
+	}
+
+	for (size_t i = 0; i != n_frames; ++i) {
+		const float v1 = gain1 + step1 * i;
+		const float v2 = gain2 + step2 * i;
+
+		for (unsigned c = 0; c != channels; ++c, ++a, ++b)
+			*a = *a * v1 + *b * v2;
+	}
+}
+
+bool
+pcm_mix_ramp(PcmDither &dither, void *buffer1, const void *buffer2,
+	     size_t size, SampleFormat format, unsigned channels,
+	     float portion1_start, float portion1_end, MixCurve curve)
+{
+	assert(channels > 0);
+
+	if (portion1_start < 0 || portion1_end < 0)
+		return pcm_add(buffer1, buffer2, size, format);
+
+	float gain1_start, gain2_start, gain1_end, gain2_end;
+	mix_curve_gains(curve, portion1_start, gain1_start, gain2_start);
+	mix_curve_gains(curve, portion1_end, gain1_end, gain2_end);
+
+	dither.SetChannels(channels);
+
+	switch (format) {
+	case SampleFormat::UNDEFINED:
+	case SampleFormat::DSD:
+		/* not implemented */
+		return false;
+
+	case SampleFormat::S8:
+		PcmAddVolumeRampVoid<SampleFormat::S8>(dither,
+						       buffer1, buffer2, size,
+						       channels,
+						       gain1_start, gain1_end,
+						       gain2_start, gain2_end);
+		return true;
+
+	case SampleFormat::S16:
+		PcmAddVolumeRampVoid<SampleFormat::S16>(dither,
+							buffer1, buffer2, size,
+							channels,
+							gain1_start, gain1_end,
+							gain2_start, gain2_end);
+		return true;
+
+	case SampleFormat::S24_P32:
+		PcmAddVolumeRampVoid<SampleFormat::S24_P32>(dither,
+							    buffer1, buffer2,
+							    size, channels,
+							    gain1_start,
+							    gain1_end,
+							    gain2_start,
+							    gain2_end);
+		return true;
+
+	case SampleFormat::S32:
+		PcmAddVolumeRampVoid<SampleFormat::S32>(dither,
+							buffer1, buffer2, size,
+							channels,
+							gain1_start, gain1_end,
+							gain2_start, gain2_end);
+		return true;
+
+	case SampleFormat::FLOAT: {
+		const size_t n_frames = size / (sizeof(float) * channels);
+		if (n_frames == 0)
+			return true;
+
+		pcm_add_vol_ramp_float((float *)buffer1,
+				       (const float *)buffer2,
+				       n_frames, channels,
+				       gain1_start,
+				       (gain1_end - gain1_start) / n_frames,
+				       gain2_start,
+				       (gain2_end - gain2_start) / n_frames);
+		return true;
+	}
+	}
+
+	assert(false);
+	gcc_unreachable();
+}
@@ -24,9 +24,42 @@
 #include "Compiler.h"
 
 #include <stddef.h>
+#include <stdint.h>
 
 class PcmDither;
 
+/**
+ * The gain curve of a cross-fade, see pcm_mix_ramp().
+ */
+enum class MixCurve : uint8_t {
+	/**
+	 * portion1 is mapped to sin²(portion1 * pi/2); both gains
+	 * add up to 1.  This was the only curve in earlier MPD
+	 * versions.
+	 */
+	SINE,
+
+	/**
+	 * The gains are portion1 and (1 - portion1).
+	 */
+	LINEAR,
+
+	/**
+	 * The gains are sin(portion1 * pi/2) and cos(portion1 *
+	 * pi/2); the sum of their powers is constant, which keeps
+	 * the loudness of uncorrelated signals constant.
+	 */
+	EQUAL_POWER,
+};
+
+/**
+ * Parse a #MixCurve name ("sine", "linear", "equal_power").
+ *
+ * @return false if the name is not recognized
+ */
+bool
+mix_curve_parse(const char *name, MixCurve &curve_r);
+
 /*
  * Linearly mixes two PCM buffers.  Both must have the same length and
  * the same audio format.  The formula is:
@@ -42,6 +75,8 @@ class PcmDither;
  * Negative values are used by the MixRamp code to specify that simple
  * addition is required.
  *
+ * The number of channels is taken from PcmDither::SetChannels().
+ *
  * @return true on success, false if the format is not supported
  */
 gcc_warn_unused_result
@@ -49,4 +84,22 @@ bool
 pcm_mix(PcmDither &dither, void *buffer1, const void *buffer2, size_t size,
 	SampleFormat format, float portion1);
 
+/**
+ * Like pcm_mix(), but the portion changes smoothly from
+ * #portion1_start at the first frame towards #portion1_end at the
+ * frame after the last one, so consecutive calls produce a
+ * continuous fade.  The curve is evaluated at both ends, and the
+ * gains are interpolated linearly for each frame in between.
+ *
+ * Negative portions request simple addition, like in pcm_mix().
+ *
+ * @param channels the number of channels in both buffers
+ * @return true on success, false if the format is not supported
+ */
+gcc_warn_unused_result
+bool
+pcm_mix_ramp(PcmDither &dither, void *buffer1, const void *buffer2,
+	     size_t size, SampleFormat format, unsigned channels,
+	     float portion1_start, float portion1_end, MixCurve curve);
+
 #endif
@@ -19,58 +19,85 @@
 
 #include "PcmPack.hxx"
 #include "system/ByteOrder.hxx"
+#include "util/CpuFeatures.hxx"
+#include "Compiler.h"
 
-static void
-pack_sample(uint8_t *dest, const int32_t *src0)
+#include <stddef.h>
+
+/**
+ * Copy the three significant bytes of each sample.  The loop works
+ * on byte indices without a dependency between two samples, so the
+ * compiler can vectorize it with byte shuffles (e.g. SSSE3
+ * "pshufb").
+ */
+gcc_always_inline
+static inline void
+pack_24(uint8_t *dest, const int32_t *src0, size_t n)
 {
 	const uint8_t *src = (const uint8_t *)src0;
 
 	if (IsBigEndian())
 		++src;
 
-	*dest++ = *src++;
-	*dest++ = *src++;
-	*dest++ = *src++;
+	for (size_t i = 0; i != n; ++i) {
+		dest[3 * i] = src[4 * i];
+		dest[3 * i + 1] = src[4 * i + 1];
+		dest[3 * i + 2] = src[4 * i + 2];
+	}
 }
 
-void
-pcm_pack_24(uint8_t *dest, const int32_t *src, const int32_t *src_end)
+gcc_always_inline
+static inline void
+unpack_24(int32_t *dest, const uint8_t *src, size_t n)
 {
-	/* duplicate loop to help the compiler's optimizer (constant
-	   parameter to the pack_sample() inline function) */
+	for (size_t i = 0; i != n; ++i) {
+		const uint32_t a = src[3 * i], b = src[3 * i + 1],
+			c = src[3 * i + 2];
 
-	while (src < src_end) {
-		pack_sample(dest, src++);
-		dest += 3;
+		/* move the sample to the upper 24 bits, and let the
+		   arithmetic shift extend the sign bit */
+		const uint32_t x = IsBigEndian()
+			? (a << 24) | (b << 16) | (c << 8)
+			: (c << 24) | (b << 16) | (a << 8);
+		dest[i] = int32_t(x) >> 8;
 	}
 }
 
-static void
-unpack_sample(int32_t *dest0, const uint8_t *src)
-{
-	uint8_t *dest = (uint8_t *)dest0;
+struct PcmPackKernels {
+	void (*pack)(uint8_t *dest, const int32_t *src, size_t n);
+	void (*unpack)(int32_t *dest, const uint8_t *src, size_t n);
+};
 
-	if (IsBigEndian())
-		/* extend the sign bit to the most fourth byte */
-		*dest++ = *src & 0x80 ? 0xff : 0x00;
+/**
+ * Instantiate the kernels for one instruction set.
+ */
+#define PCM_PACK_KERNELS(NAME, ATTRIBUTES) \
+	ATTRIBUTES static void \
+	NAME##_pack_24(uint8_t *dest, const int32_t *src, size_t n) \
+	{ \
+		pack_24(dest, src, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_unpack_24(int32_t *dest, const uint8_t *src, size_t n) \
+	{ \
+		unpack_24(dest, src, n); \
+	} \
+	static constexpr PcmPackKernels NAME = { \
+		NAME##_pack_24, NAME##_unpack_24, \
+	};
 
-	*dest++ = *src++;
-	*dest++ = *src++;
-	*dest++ = *src;
+/* byte shuffles need SSSE3 on x86 */
+CPU_KERNELS(PCM_PACK_KERNELS, PcmPackKernels, pcm_pack, ssse3,
+	    pcm_pack_kernels)
 
-	if (IsLittleEndian())
-		/* extend the sign bit to the most fourth byte */
-		*dest++ = *src & 0x80 ? 0xff : 0x00;
+void
+pcm_pack_24(uint8_t *dest, const int32_t *src, const int32_t *src_end)
+{
+	pcm_pack_kernels().pack(dest, src, src_end - src);
 }
 
 void
 pcm_unpack_24(int32_t *dest, const uint8_t *src, const uint8_t *src_end)
 {
-	/* duplicate loop to help the compiler's optimizer (constant
-	   parameter to the unpack_sample() inline function) */
-
-	while (src < src_end) {
-		unpack_sample(dest++, src);
-		src += 3;
-	}
+	pcm_pack_kernels().unpack(dest, src, (src_end - src) / 3);
 }
@@ -20,6 +20,8 @@
 #ifndef MPD_PCM_PRNG_HXX
 #define MPD_PCM_PRNG_HXX
 
+#include <stdint.h>
+
 /**
  * A very simple linear congruential PRNG.  It's good enough for PCM
  * dithering.
@@ -30,4 +32,14 @@ pcm_prng(unsigned long state)
 	return (state * 0x0019660dL + 0x3c6ef35fL) & 0xffffffffL;
 }
 
+/**
+ * Same as pcm_prng(), but with 32 bit arithmetic, which is easier to
+ * vectorize.
+ */
+constexpr static inline uint32_t
+pcm_prng32(uint32_t state)
+{
+	return state * 0x0019660du + 0x3c6ef35fu;
+}
+
 #endif
@@ -20,15 +20,13 @@
 #ifndef MPD_PCM_UTILS_H
 #define MPD_PCM_UTILS_H
 
+#include "Traits.hxx"
 #include "Compiler.h"
 
 #include <limits>
 
 #include <stdint.h>
 
-enum class SampleFormat : uint8_t;
-template<SampleFormat F> struct SampleTraits;
-
 /**
  * Check if the value is within the range of the provided bit size,
  * and caps it if necessary.
@@ -53,4 +51,44 @@ PcmClamp(typename Traits::long_type x)
 	return T(x);
 }
 
+/**
+ * The floating point type used to calculate with samples (e.g. to
+ * apply a gain or to sum them up).  32 bit integers need double
+ * precision, all others fit into the mantissa of a float.
+ */
+template<SampleFormat F>
+struct PcmAccumulator {
+	typedef float type;
+};
+
+template<>
+struct PcmAccumulator<SampleFormat::S32> {
+	typedef double type;
+};
+
+/**
+ * Convert a #PcmAccumulator value to the sample type: clamp it and
+ * round to the nearest value.  Clamping comes first, because
+ * out-of-range floating point to integer conversions are undefined.
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>,
+	 typename A=typename PcmAccumulator<F>::type>
+gcc_const gcc_always_inline
+static inline typename Traits::value_type
+PcmRoundClamp(A x)
+{
+	x = x < A(Traits::MIN) ? A(Traits::MIN) : x;
+	x = x > A(Traits::MAX) ? A(Traits::MAX) : x;
+	return typename Traits::value_type(x + (x < 0 ? A(-0.5) : A(0.5)));
+}
+
+template<>
+gcc_const gcc_always_inline
+inline float
+PcmRoundClamp<SampleFormat::FLOAT>(float x)
+{
+	/* floating point samples may exceed 1.0 */
+	return x;
+}
+
 #endif
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "SincFilter.hxx"
+#include "thread/Mutex.hxx"
+
+#include <list>
+
+#include <assert.h>
+#include <math.h>
+
+struct SincPreset {
+	const char *name;
+
+	/**
+	 * The upper end of the pass band, relative to the Nyquist
+	 * frequency of the lower sample rate.
+	 */
+	double pass_band;
+
+	/**
+	 * The stop band attenuation [dB].
+	 */
+	double attenuation;
+};
+
+static constexpr SincPreset sinc_presets[] = {
+	{ "low", 0.80, 70 },
+	{ "medium", 0.87, 90 },
+	{ "high", 0.91, 110 },
+	{ "very high", 0.95, 130 },
+};
+
+/**
+ * Up to this number of phases, the filter has one phase for each
+ * distinct output position.  Beyond that (odd sample rate ratios),
+ * a table of #SINC_INTERPOLATED_PHASES phases is used, and the
+ * output is interpolated linearly between two neighbouring phases.
+ */
+static constexpr unsigned SINC_MAX_PHASES = 1024;
+static constexpr unsigned SINC_INTERPOLATED_PHASES = 256;
+
+/**
+ * The zeroth order modified Bessel function of the first kind, for
+ * the Kaiser window.
+ */
+gcc_const
+static double
+BesselI0(double x)
+{
+	double sum = 1, term = 1;
+	const double q = x * x / 4;
+
+	for (unsigned k = 1; term > sum * 1e-12; ++k) {
+		term *= q / (double(k) * double(k));
+		sum += term;
+	}
+
+	return sum;
+}
+
+gcc_const
+static double
+KaiserBeta(double attenuation)
+{
+	if (attenuation > 50)
+		return 0.1102 * (attenuation - 8.7);
+	else if (attenuation > 21)
+		return 0.5842 * pow(attenuation - 21, 0.4)
+			+ 0.07886 * (attenuation - 21);
+	else
+		return 0;
+}
+
+SincFilter::SincFilter(SincQuality _quality, unsigned _up, unsigned _down)
+	:quality(_quality), up(_up), down(_down), refs(0)
+{
+	const SincPreset &preset = sinc_presets[unsigned(quality)];
+
+	/* the transition band ends at the Nyquist frequency; its
+	   width determines the filter length (Kaiser's formula) */
+	const double transition = 1 - preset.pass_band;
+	const double cutoff_base = (1 + preset.pass_band) / 2;
+	const double half_base = (preset.attenuation - 8) /
+		(7.18 * transition);
+
+	/* when downsampling, the filter must remove everything above
+	   the new Nyquist frequency */
+	const double scale = up < down ? double(up) / double(down) : 1.;
+	const double cutoff = cutoff_base * scale;
+
+	unsigned half = unsigned(ceil(half_base / scale));
+	half = (half + SINC_BLOCK / 2 - 1) / (SINC_BLOCK / 2) * (SINC_BLOCK / 2);
+	taps = half * 2;
+
+	interpolate = up > SINC_MAX_PHASES;
+	phases = interpolate ? SINC_INTERPOLATED_PHASES : up;
+
+	const unsigned rows = phases + interpolate;
+	coefficients = new float[rows * taps];
+
+	const double beta = KaiserBeta(preset.attenuation);
+	const double i0_beta = BesselI0(beta);
+
+	double *row = new double[taps];
+	for (unsigned p = 0; p < rows; ++p) {
+		const double offset = double(p) / double(phases);
+
+		double sum = 0;
+		for (unsigned k = 0; k < taps; ++k) {
+			/* distance of this tap from the output
+			   position, in input frames */
+			const double d = double(k) - double(half - 1) - offset;
+			const double x = d / double(half);
+			if (x <= -1 || x >= 1) {
+				row[k] = 0;
+				continue;
+			}
+
+			const double t = M_PI * cutoff * d;
+			const double sinc = t == 0 ? 1 : sin(t) / t;
+			const double window =
+				BesselI0(beta * sqrt(1 - x * x)) / i0_beta;
+			row[k] = cutoff * sinc * window;
+			sum += row[k];
+		}
+
+		/* normalize each phase to unity gain at DC */
+		float *dest = coefficients + p * taps;
+		for (unsigned k = 0; k < taps; ++k)
+			dest[k] = row[k] / sum;
+	}
+
+	delete[] row;
+}
+
+const char *
+sinc_quality_name(SincQuality quality)
+{
+	return sinc_presets[unsigned(quality)].name;
+}
+
+/**
+ * Keep up to this number of unused filters in the cache.
+ */
+static constexpr unsigned SINC_FILTER_MAX_UNUSED = 4;
+
+static Mutex sinc_filter_mutex;
+
+/**
+ * All cached filters, the most recently used first.  Protected by
+ * #sinc_filter_mutex.
+ */
+static std::list<SincFilter *> sinc_filters;
+
+const SincFilter &
+sinc_filter_get(SincQuality quality, unsigned up, unsigned down)
+{
+	const ScopeLock protect(sinc_filter_mutex);
+
+	for (auto i = sinc_filters.begin(); i != sinc_filters.end(); ++i) {
+		SincFilter &filter = **i;
+		if (filter.quality == quality &&
+		    filter.up == up && filter.down == down) {
+			sinc_filters.splice(sinc_filters.begin(),
+					    sinc_filters, i);
+			++filter.refs;
+			return filter;
+		}
+	}
+
+	SincFilter *filter = new SincFilter(quality, up, down);
+	filter->refs = 1;
+	sinc_filters.push_front(filter);
+	return *filter;
+}
+
+void
+sinc_filter_release(const SincFilter &filter)
+{
+	const ScopeLock protect(sinc_filter_mutex);
+
+	assert(filter.refs > 0);
+	if (--filter.refs > 0)
+		return;
+
+	/* evict the least recently used filters which are not in
+	   use */
+	unsigned n_unused = 0;
+	for (auto i = sinc_filters.begin(); i != sinc_filters.end();) {
+		SincFilter *f = *i;
+		if (f->refs == 0 && ++n_unused > SINC_FILTER_MAX_UNUSED) {
+			i = sinc_filters.erase(i);
+			delete f;
+		} else
+			++i;
+	}
+}
+
+void
+sinc_filter_cache_clear()
+{
+	const ScopeLock protect(sinc_filter_mutex);
+
+	for (auto i = sinc_filters.begin(); i != sinc_filters.end();) {
+		SincFilter *f = *i;
+		if (f->refs == 0) {
+			i = sinc_filters.erase(i);
+			delete f;
+		} else
+			++i;
+	}
+}
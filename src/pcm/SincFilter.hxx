@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_SINC_FILTER_HXX
+#define MPD_PCM_SINC_FILTER_HXX
+
+#include "Compiler.h"
+
+#include <stdint.h>
+
+/**
+ * Quality presets of #SincPcmResampler.  They differ in the width of
+ * the pass band and in the stop band attenuation, and thus in the
+ * length of the filter.
+ */
+enum class SincQuality {
+	LOW,
+	MEDIUM,
+	HIGH,
+	VERY_HIGH,
+};
+
+/**
+ * The number of taps is a multiple of this, so the inner loop of the
+ * resampler needs no remainder handling.
+ */
+static constexpr unsigned SINC_BLOCK = 8;
+
+/**
+ * The coefficient table of a polyphase Kaiser windowed sinc filter
+ * for one sample rate ratio.  Instances are shared by all resamplers
+ * with the same parameters; obtain them with sinc_filter_get(), and
+ * do not modify them.
+ */
+struct SincFilter {
+	const SincQuality quality;
+
+	/**
+	 * The reduced ratio of output and input sample rate.
+	 */
+	const unsigned up, down;
+
+	unsigned phases, taps;
+	bool interpolate;
+
+	/**
+	 * The coefficients of all phases, #taps for each; there is
+	 * one extra phase at the end when #interpolate is set.
+	 */
+	float *coefficients;
+
+	/**
+	 * The number of sinc_filter_get() callers which have not yet
+	 * called sinc_filter_release().  Protected by the cache's
+	 * mutex.
+	 */
+	mutable unsigned refs;
+
+	SincFilter(SincQuality _quality, unsigned _up, unsigned _down);
+
+	~SincFilter() {
+		delete[] coefficients;
+	}
+
+	SincFilter(const SincFilter &) = delete;
+	SincFilter &operator=(const SincFilter &) = delete;
+};
+
+gcc_const
+const char *
+sinc_quality_name(SincQuality quality);
+
+/**
+ * Look up the filter for the given parameters in the process-wide
+ * cache, and calculate it if it is not there yet.  The caller must
+ * call sinc_filter_release() when done.
+ *
+ * @param up the reduced output sample rate
+ * @param down the reduced input sample rate
+ */
+const SincFilter &
+sinc_filter_get(SincQuality quality, unsigned up, unsigned down);
+
+/**
+ * Release a reference obtained with sinc_filter_get().  The filter
+ * stays in the cache for a while, so the next song with the same
+ * sample rate can reuse it.
+ */
+void
+sinc_filter_release(const SincFilter &filter);
+
+/**
+ * Free all cached filters which are not in use.
+ */
+void
+sinc_filter_cache_clear();
+
+#endif
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "SincResampler.hxx"
+#include "AudioFormat.hxx"
+#include "util/CpuFeatures.hxx"
+#include "util/Error.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <string.h>
+
+static constexpr Domain sinc_domain("sinc");
+
+static SincQuality sinc_quality = SincQuality::HIGH;
+
+/**
+ * The dot product of the input window and one phase of the filter.
+ * The partial sums are independent of each other, which allows the
+ * compiler to keep them in one vector register.
+ */
+gcc_always_inline
+static inline float
+SincDot(const float *gcc_restrict x, const float *gcc_restrict h,
+	unsigned taps)
+{
+	float sum[SINC_BLOCK] = {};
+
+	for (const float *end = x + taps; x != end;
+	     x += SINC_BLOCK, h += SINC_BLOCK)
+		for (unsigned j = 0; j < SINC_BLOCK; ++j)
+			sum[j] += x[j] * h[j];
+
+	return ((sum[0] + sum[4]) + (sum[1] + sum[5])) +
+		((sum[2] + sum[6]) + (sum[3] + sum[7]));
+}
+
+gcc_always_inline
+static inline void
+SincConvolve(float *gcc_restrict dest, unsigned stride,
+	     const float *gcc_restrict src,
+	     const SincStep *steps, unsigned n,
+	     const float *gcc_restrict coefficients, unsigned taps)
+{
+	for (unsigned i = 0; i < n; ++i, dest += stride)
+		*dest = SincDot(src + steps[i].position,
+				coefficients + steps[i].phase * taps, taps);
+}
+
+gcc_always_inline
+static inline void
+SincConvolveInterpolated(float *gcc_restrict dest, unsigned stride,
+			 const float *gcc_restrict src,
+			 const SincStep *steps, unsigned n,
+			 const float *gcc_restrict coefficients,
+			 unsigned taps)
+{
+	for (unsigned i = 0; i < n; ++i, dest += stride) {
+		const float *x = src + steps[i].position;
+		const float *h = coefficients + steps[i].phase * taps;
+		const float a = SincDot(x, h, taps);
+		const float b = SincDot(x, h + taps, taps);
+		*dest = a + steps[i].fraction * (b - a);
+	}
+}
+
+struct SincKernels {
+	void (*convolve)(float *dest, unsigned stride, const float *src,
+			 const SincStep *steps, unsigned n,
+			 const float *coefficients, unsigned taps);
+	void (*convolve_interpolated)(float *dest, unsigned stride,
+				      const float *src,
+				      const SincStep *steps, unsigned n,
+				      const float *coefficients,
+				      unsigned taps);
+};
+
+/**
+ * Instantiate the filter loops for one instruction set.
+ */
+#define SINC_KERNELS(NAME, ATTRIBUTES) \
+	ATTRIBUTES static void \
+	NAME##_convolve(float *dest, unsigned stride, const float *src, \
+			const SincStep *steps, unsigned n, \
+			const float *coefficients, unsigned taps) \
+	{ \
+		SincConvolve(dest, stride, src, steps, n, \
+			     coefficients, taps); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_convolve_interpolated(float *dest, unsigned stride, \
+				     const float *src, \
+				     const SincStep *steps, unsigned n, \
+				     const float *coefficients, \
+				     unsigned taps) \
+	{ \
+		SincConvolveInterpolated(dest, stride, src, steps, n, \
+					 coefficients, taps); \
+	} \
+	static constexpr SincKernels NAME = { \
+		NAME##_convolve, NAME##_convolve_interpolated, \
+	};
+
+CPU_KERNELS(SINC_KERNELS, SincKernels, sinc, sse2,
+	    sinc_kernels)
+
+static bool
+sinc_parse_converter(const char *converter)
+{
+	assert(converter != nullptr);
+
+	assert(memcmp(converter, "sinc", 4) == 0);
+	if (converter[4] == '\0')
+		return true;
+	if (converter[4] != ' ')
+		return false;
+
+	const char *quality = converter + 5;
+	for (unsigned i = 0; i <= unsigned(SincQuality::VERY_HIGH); ++i) {
+		if (strcmp(quality, sinc_quality_name(SincQuality(i))) == 0) {
+			sinc_quality = SincQuality(i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool
+pcm_resample_sinc_global_init(const char *converter, Error &error)
+{
+	if (!sinc_parse_converter(converter)) {
+		error.Format(sinc_domain,
+			     "unknown samplerate converter '%s'", converter);
+		return false;
+	}
+
+	FormatDebug(sinc_domain, "sinc converter '%s'",
+		    sinc_quality_name(sinc_quality));
+
+	return true;
+}
+
+gcc_const
+static unsigned
+gcd(unsigned a, unsigned b)
+{
+	while (b != 0) {
+		const unsigned t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+SincPcmResampler::SincPcmResampler()
+	:SincPcmResampler(sinc_quality) {}
+
+AudioFormat
+SincPcmResampler::Open(AudioFormat &af, unsigned new_sample_rate,
+		       gcc_unused Error &error)
+{
+	assert(af.IsValid());
+	assert(audio_valid_sample_rate(new_sample_rate));
+
+	const unsigned divisor = gcd(af.sample_rate, new_sample_rate);
+	up = new_sample_rate / divisor;
+	down = af.sample_rate / divisor;
+
+	filter = &sinc_filter_get(quality, up, down);
+
+	FormatDebug(sinc_domain, "%u taps, %u phases%s",
+		    filter->taps, filter->phases,
+		    filter->interpolate ? " (interpolated)" : "");
+
+	channels = af.channels;
+
+	/* start with silence in the first half of the window, so the
+	   first output frame is centered on the first input frame */
+	history = new float[channels * filter->taps];
+	kept = filter->taps / 2 - 1;
+	std::fill_n(history, channels * kept, 0.f);
+	position = 0;
+	phase = 0;
+
+	/* the filter works with floating point samples */
+	af.format = SampleFormat::FLOAT;
+
+	AudioFormat result = af;
+	result.sample_rate = new_sample_rate;
+	return result;
+}
+
+void
+SincPcmResampler::Close()
+{
+	sinc_filter_release(*filter);
+	filter = nullptr;
+
+	delete[] history;
+	history = nullptr;
+}
+
+ConstBuffer<void>
+SincPcmResampler::Resample(ConstBuffer<void> _src, gcc_unused Error &error)
+{
+	const auto src = ConstBuffer<float>::FromVoid(_src);
+	assert(src.size % channels == 0);
+
+	const unsigned n_frames = src.size / channels;
+	const unsigned available = kept + n_frames;
+	const unsigned taps = filter->taps;
+
+	/* calculate the filter position of each output frame; this
+	   is the same for all channels */
+	const size_t max_steps = uint64_t(available) * up / down + 2;
+	SincStep *const step_array = steps.Get(max_steps);
+	unsigned n = 0;
+	while (position + taps <= available) {
+		assert(n < max_steps);
+
+		SincStep &s = step_array[n++];
+		s.position = position;
+
+		if (filter->interpolate) {
+			const uint64_t x = phase * filter->phases;
+			s.phase = x / up;
+			s.fraction = float(x % up) / float(up);
+		} else {
+			s.phase = phase;
+			s.fraction = 0;
+		}
+
+		phase += down;
+		position += phase / up;
+		phase %= up;
+	}
+
+	/* deinterleave the new input, after the history */
+	float *const planar =
+		(float *)input_buffer.Get(channels * available * sizeof(float));
+	for (unsigned c = 0; c < channels; ++c) {
+		float *p = std::copy_n(history + c * kept, kept,
+				       planar + c * available);
+		for (unsigned i = 0; i < n_frames; ++i)
+			p[i] = src.data[i * channels + c];
+	}
+
+	float *const dest =
+		(float *)output_buffer.Get(n * channels * sizeof(float));
+
+	const auto &kernels = sinc_kernels();
+	const auto convolve = filter->interpolate
+		? kernels.convolve_interpolated
+		: kernels.convolve;
+	for (unsigned c = 0; c < channels; ++c)
+		convolve(dest + c, channels, planar + c * available,
+			 step_array, n, filter->coefficients, taps);
+
+	/* keep the input which is still needed for the next call */
+	if (position <= available) {
+		kept = available - position;
+		position = 0;
+	} else {
+		position -= available;
+		kept = 0;
+	}
+
+	assert(kept < taps);
+
+	for (unsigned c = 0; c < channels; ++c)
+		std::copy_n(planar + c * available + available - kept, kept,
+			    history + c * kept);
+
+	return { dest, n * channels * sizeof(float) };
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_SINC_RESAMPLER_HXX
+#define MPD_PCM_SINC_RESAMPLER_HXX
+
+#include "Resampler.hxx"
+#include "SincFilter.hxx"
+#include "PcmBuffer.hxx"
+#include "util/ReusableArray.hxx"
+
+#include <stdint.h>
+
+/**
+ * The filter parameters of one output frame: where its window
+ * begins in the input, and which phase of the filter to use.
+ */
+struct SincStep {
+	unsigned position;
+	unsigned phase;
+
+	/**
+	 * The weight of the following phase; only used when the
+	 * filter interpolates between phases.
+	 */
+	float fraction;
+};
+
+/**
+ * A built-in band limited resampler: a polyphase FIR filter with a
+ * Kaiser windowed sinc kernel.  The coefficients of all phases are
+ * obtained from a process-wide cache (see sinc_filter_get()), and the
+ * inner loop uses SIMD instructions if the CPU supports them.
+ */
+class SincPcmResampler final : public PcmResampler {
+	const SincQuality quality;
+
+	const SincFilter *filter;
+
+	unsigned channels;
+
+	/**
+	 * The reduced ratio of input and output sample rate: each
+	 * output frame advances the input position by #down/#up
+	 * frames.
+	 */
+	unsigned up, down;
+
+	/**
+	 * The number of history frames in #history (per channel).
+	 */
+	unsigned kept;
+
+	/**
+	 * The input frame (relative to the start of #history) where
+	 * the filter window of the next output frame begins.
+	 */
+	unsigned position;
+
+	/**
+	 * The fractional part of the input position in units of
+	 * 1/#up frames.
+	 */
+	uint64_t phase;
+
+	/**
+	 * Planar samples which are still needed for the next call,
+	 * #kept per channel.
+	 */
+	float *history;
+
+	PcmScratchBuffer input_buffer, output_buffer;
+	ReusableArray<SincStep> steps;
+
+public:
+	/**
+	 * Construct an instance with the quality configured in
+	 * "samplerate_converter".
+	 */
+	SincPcmResampler();
+
+	explicit SincPcmResampler(SincQuality _quality)
+		:quality(_quality), filter(nullptr), history(nullptr) {}
+
+	virtual AudioFormat Open(AudioFormat &af, unsigned new_sample_rate,
+				 Error &error) override;
+	virtual void Close() override;
+	virtual ConstBuffer<void> Resample(ConstBuffer<void> src,
+					   Error &error) override;
+};
+
+/**
+ * Parse a "samplerate_converter" value which begins with "sinc",
+ * e.g. "sinc medium".
+ */
+bool
+pcm_resample_sinc_global_init(const char *converter, Error &error);
+
+#endif
@@ -23,10 +23,13 @@
 #include "util/ASCII.hxx"
 #include "util/Error.hxx"
 #include "util/Domain.hxx"
+#include "thread/Mutex.hxx"
 #include "Log.hxx"
 
 #include <soxr.h>
 
+#include <list>
+
 #include <assert.h>
 
 static constexpr Domain soxr_domain("soxr");
@@ -97,6 +100,76 @@ pcm_resample_soxr_global_init(const char *converter, Error &error)
 	return true;
 }
 
+/**
+ * An idle soxr instance.  Creating one calculates the filter, which
+ * is expensive; Close() keeps instances here, and the next Open()
+ * with the same parameters (e.g. at the next song, or in another
+ * audio output) resets and reuses it.
+ */
+struct SoxrCacheItem {
+	unsigned src_rate, dest_rate, channels;
+	unsigned long recipe;
+	soxr_t soxr;
+};
+
+/**
+ * Keep up to this number of idle soxr instances.
+ */
+static constexpr unsigned SOXR_CACHE_SIZE = 4;
+
+static Mutex soxr_cache_mutex;
+
+/**
+ * The idle soxr instances, the most recently used first.  Protected
+ * by #soxr_cache_mutex.
+ */
+static std::list<SoxrCacheItem> soxr_cache;
+
+static soxr_t
+soxr_cache_take(unsigned src_rate, unsigned dest_rate, unsigned channels)
+{
+	const ScopeLock protect(soxr_cache_mutex);
+
+	for (auto i = soxr_cache.begin(); i != soxr_cache.end(); ++i) {
+		if (i->src_rate == src_rate && i->dest_rate == dest_rate &&
+		    i->channels == channels &&
+		    i->recipe == soxr_quality_recipe) {
+			soxr_t soxr = i->soxr;
+			soxr_cache.erase(i);
+			return soxr;
+		}
+	}
+
+	return nullptr;
+}
+
+static void
+soxr_cache_put(unsigned src_rate, unsigned dest_rate, unsigned channels,
+	       soxr_t soxr)
+{
+	soxr_clear(soxr);
+
+	const ScopeLock protect(soxr_cache_mutex);
+
+	soxr_cache.push_front({src_rate, dest_rate, channels,
+				soxr_quality_recipe, soxr});
+
+	if (soxr_cache.size() > SOXR_CACHE_SIZE) {
+		soxr_delete(soxr_cache.back().soxr);
+		soxr_cache.pop_back();
+	}
+}
+
+void
+pcm_resample_soxr_global_finish()
+{
+	const ScopeLock protect(soxr_cache_mutex);
+
+	for (const auto &i : soxr_cache)
+		soxr_delete(i.soxr);
+	soxr_cache.clear();
+}
+
 AudioFormat
 SoxrPcmResampler::Open(AudioFormat &af, unsigned new_sample_rate,
 		       Error &error)
@@ -104,19 +177,25 @@ SoxrPcmResampler::Open(AudioFormat &af, unsigned new_sample_rate,
 	assert(af.IsValid());
 	assert(audio_valid_sample_rate(new_sample_rate));
 
-	soxr_error_t e;
-	soxr_quality_spec_t quality = soxr_quality_spec(soxr_quality_recipe, 0);
-	soxr = soxr_create(af.sample_rate, new_sample_rate,
-			   af.channels, &e,
-			   nullptr, &quality, nullptr);
+	soxr = soxr_cache_take(af.sample_rate, new_sample_rate, af.channels);
 	if (soxr == nullptr) {
-		error.Format(soxr_domain,
-			     "soxr initialization has failed: %s", e);
-		return AudioFormat::Undefined();
+		soxr_error_t e;
+		soxr_quality_spec_t quality =
+			soxr_quality_spec(soxr_quality_recipe, 0);
+		soxr = soxr_create(af.sample_rate, new_sample_rate,
+				   af.channels, &e,
+				   nullptr, &quality, nullptr);
+		if (soxr == nullptr) {
+			error.Format(soxr_domain,
+				     "soxr initialization has failed: %s", e);
+			return AudioFormat::Undefined();
+		}
 	}
 
 	FormatDebug(soxr_domain, "soxr engine '%s'", soxr_engine(soxr));
 
+	src_rate = af.sample_rate;
+	dest_rate = new_sample_rate;
 	channels = af.channels;
 
 	ratio = float(new_sample_rate) / float(af.sample_rate);
@@ -135,7 +214,7 @@ SoxrPcmResampler::Open(AudioFormat &af, unsigned new_sample_rate,
 void
 SoxrPcmResampler::Close()
 {
-	soxr_delete(soxr);
+	soxr_cache_put(src_rate, dest_rate, channels, soxr);
 }
 
 ConstBuffer<void>
@@ -31,10 +31,11 @@ struct AudioFormat;
 class SoxrPcmResampler final : public PcmResampler {
 	struct soxr *soxr;
 
+	unsigned src_rate, dest_rate;
 	unsigned channels;
 	float ratio;
 
-	PcmBuffer buffer;
+	PcmScratchBuffer buffer;
 
 public:
 	virtual AudioFormat Open(AudioFormat &af, unsigned new_sample_rate,
@@ -47,4 +48,10 @@ public:
 bool
 pcm_resample_soxr_global_init(const char *converter, Error &error);
 
+/**
+ * Free the idle soxr instances kept by SoxrPcmResampler::Close().
+ */
+void
+pcm_resample_soxr_global_finish();
+
 #endif
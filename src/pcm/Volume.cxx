@@ -23,6 +23,7 @@
 #include "PcmUtils.hxx"
 #include "Traits.hxx"
 #include "util/ConstBuffer.hxx"
+#include "util/CpuFeatures.hxx"
 #include "util/Error.hxx"
 
 #include "PcmDither.cxx" // including the .cxx file to get inlined templates
@@ -30,74 +31,171 @@
 #include <stdint.h>
 #include <string.h>
 
+/**
+ * Apply the volume with dithering.  PcmDither processes the channels
+ * of a frame in parallel, so the compiler may vectorize this.
+ */
 template<SampleFormat F, class Traits=SampleTraits<F>>
-static inline typename Traits::value_type
-pcm_volume_sample(PcmDither &dither,
-		  typename Traits::value_type _sample,
-		  int volume)
-{
-	typename Traits::long_type sample(_sample);
-
-	return dither.DitherShift<typename Traits::long_type,
-				  Traits::BITS + PCM_VOLUME_BITS,
-				  Traits::BITS>(sample * volume);
-}
-
-template<SampleFormat F, class Traits=SampleTraits<F>>
-static void
+gcc_always_inline
+static inline void
 pcm_volume_change(PcmDither &dither,
 		  typename Traits::pointer_type dest,
 		  typename Traits::const_pointer_type src,
 		  size_t n,
 		  int volume)
 {
-	for (size_t i = 0; i != n; ++i)
-		dest[i] = pcm_volume_sample<F, Traits>(dither, src[i], volume);
-}
+	typedef typename Traits::long_type long_type;
 
-static void
-pcm_volume_change_8(PcmDither &dither,
-		    int8_t *dest, const int8_t *src, size_t n,
-		    int volume)
-{
-	pcm_volume_change<SampleFormat::S8>(dither, dest, src, n, volume);
+	dither.DitherShift<long_type,
+			   Traits::BITS + PCM_VOLUME_BITS,
+			   Traits::BITS>(dest, n, [src, volume](size_t i){
+		return long_type(src[i]) * volume;
+	});
 }
 
-static void
-pcm_volume_change_16(PcmDither &dither,
-		     int16_t *dest, const int16_t *src, size_t n,
-		     int volume)
+/**
+ * Apply the volume without dithering: round to the nearest value
+ * and clamp.  This is cheaper than pcm_volume_change(), because
+ * there is no noise generator and no error feedback.
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>>
+gcc_always_inline
+static inline void
+pcm_volume_change_nodither(typename Traits::pointer_type gcc_restrict dest,
+			   typename Traits::const_pointer_type gcc_restrict src,
+			   size_t n, int volume)
 {
-	pcm_volume_change<SampleFormat::S16>(dither, dest, src, n, volume);
+	typedef typename Traits::long_type long_type;
+
+	constexpr long_type round = long_type(1) << (PCM_VOLUME_BITS - 1);
+
+	for (size_t i = 0; i != n; ++i) {
+		long_type sample = (long_type(src[i]) * volume + round)
+			>> PCM_VOLUME_BITS;
+
+		/* not using PcmClamp(), because its branches get in
+		   the way of the vectorizer */
+		sample = sample < Traits::MIN ? Traits::MIN : sample;
+		sample = sample > Traits::MAX ? Traits::MAX : sample;
+		dest[i] = sample;
+	}
 }
 
-static void
-pcm_volume_change_24(PcmDither &dither,
-		     int32_t *dest, const int32_t *src, size_t n,
-		     int volume)
+gcc_always_inline
+static inline void
+pcm_volume_change_float(float *gcc_restrict dest,
+			const float *gcc_restrict src, size_t n,
+			float volume)
 {
-	pcm_volume_change<SampleFormat::S24_P32>(dither, dest, src, n,
-						 volume);
+	for (size_t i = 0; i != n; ++i)
+		dest[i] = src[i] * volume;
 }
 
+/**
+ * The dithering 8 bit kernel is shared by all instruction sets,
+ * because GCC doesn't vectorize it well, and the SIMD variants turned
+ * out to be slower.
+ */
 static void
-pcm_volume_change_32(PcmDither &dither,
-		     int32_t *dest, const int32_t *src, size_t n,
-		     int volume)
+pcm_volume_dither_8(PcmDither &dither,
+		    int8_t *dest, const int8_t *src, size_t n, int volume)
 {
-	pcm_volume_change<SampleFormat::S32>(dither, dest, src, n, volume);
+	pcm_volume_change<SampleFormat::S8>(dither, dest, src, n, volume);
 }
 
-static void
-pcm_volume_change_float(float *dest, const float *src, size_t n,
-			float volume)
+/**
+ * Instantiate the kernels for one instruction set.
+ */
+#define PCM_VOLUME_KERNELS(NAME, ATTRIBUTES) \
+	ATTRIBUTES static void \
+	NAME##_dither_16(PcmDither &dither, \
+			 int16_t *dest, const int16_t *src, size_t n, \
+			 int volume) \
+	{ \
+		pcm_volume_change<SampleFormat::S16>(dither, dest, src, \
+						     n, volume); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_dither_24(PcmDither &dither, \
+			 int32_t *dest, const int32_t *src, size_t n, \
+			 int volume) \
+	{ \
+		pcm_volume_change<SampleFormat::S24_P32>(dither, dest, src, \
+							 n, volume); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_dither_32(PcmDither &dither, \
+			 int32_t *dest, const int32_t *src, size_t n, \
+			 int volume) \
+	{ \
+		pcm_volume_change<SampleFormat::S32>(dither, dest, src, \
+						     n, volume); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_8(int8_t *dest, const int8_t *src, size_t n, int volume) \
+	{ \
+		pcm_volume_change_nodither<SampleFormat::S8>(dest, src, \
+							    n, volume); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_16(int16_t *dest, const int16_t *src, size_t n, int volume) \
+	{ \
+		pcm_volume_change_nodither<SampleFormat::S16>(dest, src, \
+							     n, volume); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_24(int32_t *dest, const int32_t *src, size_t n, int volume) \
+	{ \
+		pcm_volume_change_nodither<SampleFormat::S24_P32>(dest, src, \
+								 n, volume); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_32(int32_t *dest, const int32_t *src, size_t n, int volume) \
+	{ \
+		pcm_volume_change_nodither<SampleFormat::S32>(dest, src, \
+							     n, volume); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_float(float *dest, const float *src, size_t n, float volume) \
+	{ \
+		pcm_volume_change_float(dest, src, n, volume); \
+	} \
+	static constexpr PcmVolumeKernels NAME = { \
+		pcm_volume_dither_8, NAME##_dither_16, \
+		NAME##_dither_24, NAME##_dither_32, \
+		NAME##_8, NAME##_16, NAME##_24, NAME##_32, NAME##_float, \
+	};
+
+struct PcmVolumeKernels {
+	void (*d8)(PcmDither &dither,
+		   int8_t *dest, const int8_t *src, size_t n, int volume);
+	void (*d16)(PcmDither &dither,
+		    int16_t *dest, const int16_t *src, size_t n, int volume);
+	void (*d24)(PcmDither &dither,
+		    int32_t *dest, const int32_t *src, size_t n, int volume);
+	void (*d32)(PcmDither &dither,
+		    int32_t *dest, const int32_t *src, size_t n, int volume);
+
+	void (*s8)(int8_t *dest, const int8_t *src, size_t n, int volume);
+	void (*s16)(int16_t *dest, const int16_t *src, size_t n, int volume);
+	void (*s24)(int32_t *dest, const int32_t *src, size_t n, int volume);
+	void (*s32)(int32_t *dest, const int32_t *src, size_t n, int volume);
+	void (*f)(float *dest, const float *src, size_t n, float volume);
+};
+
+CPU_KERNELS(PCM_VOLUME_KERNELS, PcmVolumeKernels, pcm_volume, sse2,
+	    pcm_volume_select_kernels)
+
+static bool pcm_volume_dither = true;
+
+void
+pcm_volume_global_init(bool dither)
 {
-	for (size_t i = 0; i != n; ++i)
-		dest[i] = src[i] * volume;
+	pcm_volume_dither = dither;
 }
 
 bool
-PcmVolume::Open(SampleFormat _format, Error &error)
+PcmVolume::Open(SampleFormat _format, unsigned channels, Error &error)
 {
 	assert(format == SampleFormat::UNDEFINED);
 
@@ -121,23 +219,26 @@ PcmVolume::Open(SampleFormat _format, Error &error)
 	}
 
 	format = _format;
+	dither.SetChannels(channels);
+	dither_enabled = pcm_volume_dither;
+	kernels = &pcm_volume_select_kernels();
 	return true;
 }
 
-ConstBuffer<void>
-PcmVolume::Apply(ConstBuffer<void> src)
+void
+PcmVolume::Apply(void *data, ConstBuffer<void> src)
 {
-	if (volume == PCM_VOLUME_1)
-		return src;
-
-	void *data = buffer.Get(src.size);
+	if (volume == PCM_VOLUME_1) {
+		memcpy(data, src.data, src.size);
+		return;
+	}
 
 	if (volume == 0) {
 		/* optimized special case: 0% volume = memset(0) */
 		/* TODO: is this valid for all sample formats? What
 		   about floating point? */
 		memset(data, 0, src.size);
-		return { data, src.size };
+		return;
 	}
 
 	switch (format) {
@@ -146,44 +247,69 @@ PcmVolume::Apply(ConstBuffer<void> src)
 		gcc_unreachable();
 
 	case SampleFormat::S8:
-		pcm_volume_change_8(dither, (int8_t *)data,
+		if (dither_enabled)
+			kernels->d8(dither, (int8_t *)data,
 				    (const int8_t *)src.data,
-				    src.size / sizeof(int8_t),
-				    volume);
+				    src.size / sizeof(int8_t), volume);
+		else
+			kernels->s8((int8_t *)data, (const int8_t *)src.data,
+				    src.size / sizeof(int8_t), volume);
 		break;
 
 	case SampleFormat::S16:
-		pcm_volume_change_16(dither, (int16_t *)data,
+		if (dither_enabled)
+			kernels->d16(dither, (int16_t *)data,
+				     (const int16_t *)src.data,
+				     src.size / sizeof(int16_t), volume);
+		else
+			kernels->s16((int16_t *)data,
 				     (const int16_t *)src.data,
-				     src.size / sizeof(int16_t),
-				     volume);
+				     src.size / sizeof(int16_t), volume);
 		break;
 
 	case SampleFormat::S24_P32:
-		pcm_volume_change_24(dither, (int32_t *)data,
+		if (dither_enabled)
+			kernels->d24(dither, (int32_t *)data,
 				     (const int32_t *)src.data,
-				     src.size / sizeof(int32_t),
-				     volume);
+				     src.size / sizeof(int32_t), volume);
+		else
+			kernels->s24((int32_t *)data,
+				     (const int32_t *)src.data,
+				     src.size / sizeof(int32_t), volume);
 		break;
 
 	case SampleFormat::S32:
-		pcm_volume_change_32(dither, (int32_t *)data,
+		if (dither_enabled)
+			kernels->d32(dither, (int32_t *)data,
+				     (const int32_t *)src.data,
+				     src.size / sizeof(int32_t), volume);
+		else
+			kernels->s32((int32_t *)data,
 				     (const int32_t *)src.data,
-				     src.size / sizeof(int32_t),
-				     volume);
+				     src.size / sizeof(int32_t), volume);
 		break;
 
 	case SampleFormat::FLOAT:
-		pcm_volume_change_float((float *)data,
-					(const float *)src.data,
-					src.size / sizeof(float),
-					pcm_volume_to_float(volume));
+		kernels->f((float *)data, (const float *)src.data,
+			   src.size / sizeof(float),
+			   pcm_volume_to_float(volume));
 		break;
 
 	case SampleFormat::DSD:
 		// TODO: implement this; currently, it's a no-op
-		return src;
+		memcpy(data, src.data, src.size);
+		break;
 	}
+}
 
+ConstBuffer<void>
+PcmVolume::Apply(ConstBuffer<void> src)
+{
+	if (volume == PCM_VOLUME_1 ||
+	    (format == SampleFormat::DSD && volume != 0))
+		return src;
+
+	void *data = buffer.Get(src.size);
+	Apply(data, src);
 	return { data, src.size };
 }
@@ -66,12 +66,33 @@ pcm_volume_to_float(int volume)
 /**
  * A class that converts samples from one format to another.
  */
+/**
+ * Configure whether #PcmVolume instances opened after this call
+ * shall apply dithering to integer samples.  Without dithering, the
+ * volume is applied by SIMD kernels chosen at runtime.
+ */
+void
+pcm_volume_global_init(bool dither);
+
+struct PcmVolumeKernels;
+
 class PcmVolume {
 	SampleFormat format;
 
 	unsigned volume;
 
-	PcmBuffer buffer;
+	/**
+	 * Apply dithering to integer samples?  If not, they are only
+	 * rounded.
+	 */
+	bool dither_enabled;
+
+	/**
+	 * The SIMD kernels chosen by Open() for this CPU.
+	 */
+	const PcmVolumeKernels *kernels;
+
+	PcmScratchBuffer buffer;
 	PcmDither dither;
 
 public:
@@ -101,14 +122,33 @@ public:
 		volume = _volume;
 	}
 
+	/**
+	 * Override the setting of pcm_volume_global_init() for this
+	 * object.  Call this after Open().
+	 */
+	void SetDither(bool _dither) {
+		dither_enabled = _dither;
+	}
+
+	/**
+	 * Change the number of channels of the samples passed to
+	 * Apply(), e.g. after they have been routed.  Call this after
+	 * Open().
+	 */
+	void SetChannels(unsigned channels) {
+		dither.SetChannels(channels);
+	}
+
 	/**
 	 * Opens the object, prepare for Apply().
 	 *
 	 * @param format the sample format
+	 * @param channels the number of channels; the dithering state
+	 * is kept per channel
 	 * @param error location to store the error
 	 * @return true on success
 	 */
-	bool Open(SampleFormat format, Error &error);
+	bool Open(SampleFormat format, unsigned channels, Error &error);
 
 	/**
 	 * Closes the object.  After that, you may call Open() again.
@@ -125,6 +165,12 @@ public:
 	 */
 	gcc_pure
 	ConstBuffer<void> Apply(ConstBuffer<void> src);
+
+	/**
+	 * Apply the volume level, writing the result to the given
+	 * buffer, which must not overlap with the source buffer.
+	 */
+	void Apply(void *dest, ConstBuffer<void> src);
 };
 
 #endif
@@ -182,3 +182,9 @@ extern void dsd2pcm_translate(
 	ptr->fifopos = ffp;
 }
 
+
+extern const float *dsd2pcm_get_ctable(unsigned i)
+{
+	if (!precalculated) precalc();
+	return i < CTABLES ? ctables[i] : NULL;
+}
@@ -56,6 +56,16 @@ extern void dsd2pcm_translate(dsd2pcm_ctx *ctx,
 	int lsbitfirst,
 	float *dst, ptrdiff_t dst_stride);
 
+/**
+ * returns the lookup table for the filter taps 8*i..8*i+7 (counting
+ * from the outer end of the second half of the filter), indexed by
+ * an msb-first octet; there are 6 tables
+ *
+ * The tables are computed during the first call, like in
+ * dsd2pcm_init().
+ */
+extern const float *dsd2pcm_get_ctable(unsigned i);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -18,51 +18,87 @@
  */
 
 #include "ByteReverse.hxx"
+#include "CpuFeatures.hxx"
 #include "system/ByteOrder.hxx"
 #include "Compiler.h"
 
 #include <assert.h>
 
+/**
+ * Swap the bytes of each value.  The compiler recognizes the
+ * ByteSwap*() patterns and can vectorize this loop with byte shuffles
+ * (e.g. SSSE3 "pshufb").
+ */
+template<typename T, T (*swap)(T)>
+gcc_always_inline
+static inline void
+ByteSwapLoop(T *dest, const T *src, size_t n)
+{
+	for (size_t i = 0; i != n; ++i)
+		dest[i] = swap(src[i]);
+}
+
+struct ByteReverseKernels {
+	void (*r16)(uint16_t *dest, const uint16_t *src, size_t n);
+	void (*r32)(uint32_t *dest, const uint32_t *src, size_t n);
+	void (*r64)(uint64_t *dest, const uint64_t *src, size_t n);
+};
+
+/**
+ * Instantiate the kernels for one instruction set.
+ */
+#define BYTE_REVERSE_KERNELS(NAME, ATTRIBUTES) \
+	ATTRIBUTES static void \
+	NAME##_16(uint16_t *dest, const uint16_t *src, size_t n) \
+	{ \
+		ByteSwapLoop<uint16_t, ByteSwap16>(dest, src, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_32(uint32_t *dest, const uint32_t *src, size_t n) \
+	{ \
+		ByteSwapLoop<uint32_t, ByteSwap32>(dest, src, n); \
+	} \
+	ATTRIBUTES static void \
+	NAME##_64(uint64_t *dest, const uint64_t *src, size_t n) \
+	{ \
+		ByteSwapLoop<uint64_t, ByteSwap64>(dest, src, n); \
+	} \
+	static constexpr ByteReverseKernels NAME = { \
+		NAME##_16, NAME##_32, NAME##_64, \
+	};
+
+/* byte shuffles need SSSE3 on x86 */
+CPU_KERNELS(BYTE_REVERSE_KERNELS, ByteReverseKernels, byte_reverse, ssse3,
+	    byte_reverse_kernels)
+
 void
-reverse_bytes_16(uint16_t *gcc_restrict dest,
-		 const uint16_t *gcc_restrict src, const uint16_t *src_end)
+reverse_bytes_16(uint16_t *dest, const uint16_t *src, const uint16_t *src_end)
 {
 	assert(dest != nullptr);
 	assert(src != nullptr);
 	assert(src_end >= src);
 
-	while (src < src_end) {
-		const uint16_t x = *src++;
-		*dest++ = ByteSwap16(x);
-	}
+	byte_reverse_kernels().r16(dest, src, src_end - src);
 }
 
 void
-reverse_bytes_32(uint32_t *gcc_restrict dest,
-		 const uint32_t *gcc_restrict src, const uint32_t *src_end)
+reverse_bytes_32(uint32_t *dest, const uint32_t *src, const uint32_t *src_end)
 {
 	assert(dest != nullptr);
 	assert(src != nullptr);
 	assert(src_end >= src);
 
-	while (src < src_end) {
-		const uint32_t x = *src++;
-		*dest++ = ByteSwap32(x);
-	}
+	byte_reverse_kernels().r32(dest, src, src_end - src);
 }
 
 void
-reverse_bytes_64(uint64_t *gcc_restrict dest,
-		 const uint64_t *gcc_restrict src, const uint64_t *src_end)
+reverse_bytes_64(uint64_t *dest, const uint64_t *src, const uint64_t *src_end)
 {
 	assert(dest != nullptr);
 	assert(src != nullptr);
 	assert(src_end >= src);
 
-	while (src < src_end) {
-		const uint64_t x = *src++;
-		*dest++ = ByteSwap64(x);
-	}
+	byte_reverse_kernels().r64(dest, src, src_end - src);
 }
 
 static void
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "CpuFeatures.hxx"
+
+static unsigned cpu_feature_mask = ~0u;
+
+static unsigned
+DetectCpuFeatures()
+{
+	unsigned features = 0;
+
+#ifdef HAVE_X86_DISPATCH
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("sse2"))
+		features |= CPU_FEATURE_SSE2;
+
+	if (__builtin_cpu_supports("ssse3"))
+		features |= CPU_FEATURE_SSSE3;
+
+	if (__builtin_cpu_supports("avx2"))
+		features |= CPU_FEATURE_AVX2;
+#endif
+
+#ifdef HAVE_NEON
+	features |= CPU_FEATURE_NEON;
+#endif
+
+	return features;
+}
+
+unsigned
+GetCpuFeatures()
+{
+	static const unsigned detected = DetectCpuFeatures();
+	return detected & cpu_feature_mask;
+}
+
+void
+SetCpuFeatureMask(unsigned mask)
+{
+	cpu_feature_mask = mask;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_CPU_FEATURES_HXX
+#define MPD_CPU_FEATURES_HXX
+
+#include "Compiler.h"
+
+#include <stddef.h>
+
+/**
+ * Optional instruction set extensions which may be used by SIMD
+ * kernels.
+ */
+enum CpuFeature : unsigned {
+	CPU_FEATURE_SSE2 = 0x1,
+	CPU_FEATURE_SSSE3 = 0x2,
+	CPU_FEATURE_AVX2 = 0x4,
+	CPU_FEATURE_NEON = 0x8,
+};
+
+#if GCC_CHECK_VERSION(4,9) && !defined(__clang__) && \
+	(defined(__x86_64__) || defined(__i386__))
+
+/**
+ * Functions with one of these attributes are compiled for the given
+ * instruction set, with the auto-vectorizer enabled.  The caller is
+ * responsible for checking GetCpuFeatures() before calling them.
+ */
+#define HAVE_X86_DISPATCH
+#define gcc_target_sse2 \
+	__attribute__((target("sse2"), optimize("tree-vectorize")))
+#define gcc_target_ssse3 \
+	__attribute__((target("ssse3"), optimize("tree-vectorize")))
+#define gcc_target_avx2 \
+	__attribute__((target("avx2"), optimize("tree-vectorize")))
+
+/* the x86 baselines accepted by CPU_KERNELS() */
+#define CPU_KERNELS_FEATURE_sse2 CPU_FEATURE_SSE2
+#define CPU_KERNELS_FEATURE_ssse3 CPU_FEATURE_SSSE3
+
+#define CPU_KERNELS_X86(KERNELS, PREFIX, BASELINE) \
+	KERNELS(PREFIX##_##BASELINE, gcc_target_##BASELINE) \
+	KERNELS(PREFIX##_avx2, gcc_target_avx2)
+#define CPU_KERNELS_X86_TABLE(PREFIX, BASELINE) \
+	{ CPU_FEATURE_AVX2, &PREFIX##_avx2 }, \
+	{ CPU_KERNELS_FEATURE_##BASELINE, &PREFIX##_##BASELINE },
+
+#else
+
+#define CPU_KERNELS_X86(KERNELS, PREFIX, BASELINE)
+#define CPU_KERNELS_X86_TABLE(PREFIX, BASELINE)
+
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+/**
+ * NEON is enabled at compile time; there is no runtime dispatch on
+ * ARM.  Functions with this attribute get the auto-vectorizer.
+ */
+#define HAVE_NEON
+#if !defined(__clang__) && GCC_CHECK_VERSION(4,9)
+#define gcc_target_neon __attribute__((optimize("tree-vectorize")))
+#else
+#define gcc_target_neon
+#endif
+
+#define CPU_KERNELS_NEON(KERNELS, PREFIX) \
+	KERNELS(PREFIX##_neon, gcc_target_neon)
+#define CPU_KERNELS_NEON_TABLE(PREFIX) \
+	{ CPU_FEATURE_NEON, &PREFIX##_neon },
+
+#else
+
+#define CPU_KERNELS_NEON(KERNELS, PREFIX)
+#define CPU_KERNELS_NEON_TABLE(PREFIX)
+
+#endif
+
+/**
+ * Returns the #CpuFeature bit mask of the running CPU, restricted by
+ * SetCpuFeatureMask().  The detection is done only once.
+ */
+gcc_pure
+unsigned
+GetCpuFeatures();
+
+/**
+ * Pretend that the CPU supports only the features in the given bit
+ * mask.  This is used by unit tests and benchmarks to compare the
+ * SIMD kernels with the portable ones.  It affects only objects
+ * which are set up after this call.
+ */
+void
+SetCpuFeatureMask(unsigned mask);
+
+/**
+ * One entry in the table passed to SelectCpuKernels().
+ */
+template<typename T>
+struct CpuKernels {
+	/**
+	 * The #CpuFeature bits required by these kernels.
+	 */
+	unsigned features;
+
+	const T *kernels;
+};
+
+/**
+ * Returns the first kernels in the table which are supported by the
+ * running CPU.  The last entry must require no features.
+ */
+template<typename T, size_t N>
+gcc_pure
+static inline const T &
+SelectCpuKernels(const CpuKernels<T> (&table)[N])
+{
+	const unsigned features = GetCpuFeatures();
+
+	for (size_t i = 0; i < N - 1; ++i)
+		if ((features & table[i].features) == table[i].features)
+			return *table[i].kernels;
+
+	return *table[N - 1].kernels;
+}
+
+/**
+ * Instantiate a set of SIMD kernels once for each instruction set
+ * enabled in this build, and define a function SELECT() which
+ * returns the fastest set supported by the running CPU.
+ *
+ * @param KERNELS a macro KERNELS(NAME, ATTRIBUTES) which defines
+ * the functions with the given attributes and a static constexpr
+ * TYPE object called NAME which refers to them
+ * @param PREFIX the name prefix of the objects, e.g. "pcm_pack"
+ * defines pcm_pack_generic, pcm_pack_avx2 etc.
+ * @param X86_BASELINE the x86 instruction set below AVX2: sse2, or
+ * ssse3 for kernels which need byte shuffles
+ */
+#define CPU_KERNELS(KERNELS, TYPE, PREFIX, X86_BASELINE, SELECT) \
+	KERNELS(PREFIX##_generic,) \
+	CPU_KERNELS_X86(KERNELS, PREFIX, X86_BASELINE) \
+	CPU_KERNELS_NEON(KERNELS, PREFIX) \
+	gcc_pure \
+	static const TYPE & \
+	SELECT() \
+	{ \
+		static constexpr CpuKernels<TYPE> table[] = { \
+			CPU_KERNELS_X86_TABLE(PREFIX, X86_BASELINE) \
+			CPU_KERNELS_NEON_TABLE(PREFIX) \
+			{ 0, &PREFIX##_generic }, \
+		}; \
+		return SelectCpuKernels(table); \
+	}
+
+#endif
@@ -30,14 +30,118 @@
 #include "HugeAllocator.hxx"
 
 #ifdef __linux__
+#include <atomic>
+
 #include <sys/mman.h>
 #include <unistd.h>
+#include <stdio.h>
 #else
 #include <stdlib.h>
 #endif
 
 #ifdef __linux__
 
+static HugePages huge_pages = HugePages::TRANSPARENT;
+static bool huge_lock = false;
+
+/**
+ * A record of an allocation, for HugeGetStats().
+ */
+struct HugeAllocation {
+	/**
+	 * The address of the allocation, nullptr if this slot is
+	 * free, or #RESERVED while another thread fills it.
+	 */
+	std::atomic<uint8_t *> p;
+
+	std::atomic<size_t> size;
+
+	std::atomic_bool locked;
+};
+
+static uint8_t *const RESERVED = (uint8_t *)1;
+
+/**
+ * A table of allocations.  There are usually only a few of them (one
+ * per #MusicBuffer and one per #PcmBuffer if locking is enabled), but
+ * when all slots are occupied, another table is appended to the
+ * list.  Tables are never freed, so the list can be walked without
+ * locking.
+ */
+struct HugeAllocationTable {
+	HugeAllocation slots[64];
+
+	std::atomic<HugeAllocationTable *> next;
+};
+
+static HugeAllocationTable huge_allocations;
+
+static void
+Register(void *p, size_t size, bool locked)
+{
+	HugeAllocationTable *table = &huge_allocations;
+
+	while (true) {
+		for (auto &i : table->slots) {
+			uint8_t *expected = nullptr;
+			if (i.p.compare_exchange_strong(expected, RESERVED,
+							std::memory_order_relaxed)) {
+				i.size.store(size, std::memory_order_relaxed);
+				i.locked.store(locked,
+					       std::memory_order_relaxed);
+				i.p.store((uint8_t *)p,
+					  std::memory_order_release);
+				return;
+			}
+		}
+
+		HugeAllocationTable *next =
+			table->next.load(std::memory_order_acquire);
+		if (next == nullptr) {
+			/* all tables are full: append a new one; if
+			   another thread was faster, use its table */
+			HugeAllocationTable *new_table =
+				new HugeAllocationTable();
+			if (table->next.compare_exchange_strong(next,
+								new_table,
+								std::memory_order_acq_rel))
+				next = new_table;
+			else
+				delete new_table;
+		}
+
+		table = next;
+	}
+}
+
+static void
+Unregister(void *p)
+{
+	for (HugeAllocationTable *table = &huge_allocations;
+	     table != nullptr;
+	     table = table->next.load(std::memory_order_acquire)) {
+		for (auto &i : table->slots) {
+			if (i.p.load(std::memory_order_relaxed) == p) {
+				i.p.store(nullptr, std::memory_order_relaxed);
+				return;
+			}
+		}
+	}
+}
+
+void
+HugeConfigure(HugePages pages, bool lock)
+{
+	huge_pages = pages;
+	huge_lock = lock;
+}
+
+bool
+HugeIsLocking()
+{
+	return huge_lock;
+}
+
 /**
  * Round up the parameter, make it page-aligned.
  */
@@ -46,30 +150,99 @@ static size_t
 AlignToPageSize(size_t size)
 {
 	static const long page_size = sysconf(_SC_PAGESIZE);
-	if (page_size > 0)
+	if (page_size <= 0)
 		return size;
 
 	size_t ps(page_size);
 	return (size + ps - 1) / ps * ps;
 }
 
+/**
+ * Determine the size of the kernel's default huge page size from
+ * /proc/meminfo.  Returns 0 on error.
+ */
+static size_t
+ReadHugePageSize()
+{
+	FILE *file = fopen("/proc/meminfo", "r");
+	if (file == nullptr)
+		return 0;
+
+	size_t result = 0;
+	char line[256];
+	while (fgets(line, sizeof(line), file) != nullptr) {
+		unsigned long kb;
+		if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1) {
+			result = size_t(kb) * 1024;
+			break;
+		}
+	}
+
+	fclose(file);
+	return result;
+}
+
+/**
+ * Round up the size of an allocation.  Explicit huge pages are only
+ * used for allocations which are at least one huge page big, and
+ * these are rounded up to a multiple of the huge page size.
+ *
+ * @param hugetlb_r set to true if MAP_HUGETLB shall be attempted
+ */
+static size_t
+AlignAllocationSize(size_t size, bool &hugetlb_r)
+{
+	hugetlb_r = false;
+
+	if (huge_pages == HugePages::EXPLICIT) {
+		static const size_t huge_page_size = ReadHugePageSize();
+		if (huge_page_size > 0 && size >= huge_page_size) {
+			hugetlb_r = true;
+			return (size + huge_page_size - 1) / huge_page_size
+				* huge_page_size;
+		}
+	}
+
+	return AlignToPageSize(size);
+}
+
 void *
 HugeAllocate(size_t size)
 {
-	size = AlignToPageSize(size);
+	bool hugetlb;
+	size = AlignAllocationSize(size, hugetlb);
 
 	constexpr int flags = MAP_ANONYMOUS|MAP_PRIVATE|MAP_NORESERVE;
-	void *p = mmap(nullptr, size,
-		       PROT_READ|PROT_WRITE, flags,
-		       -1, 0);
-	if (p == (void *)-1)
-		return nullptr;
+	void *p = (void *)-1;
+
+#ifdef MAP_HUGETLB
+	if (hugetlb)
+		/* without MAP_NORESERVE, this fails if the huge page
+		   pool is exhausted (instead of raising SIGBUS later);
+		   fall back to normal pages then */
+		p = mmap(nullptr, size,
+			 PROT_READ|PROT_WRITE,
+			 MAP_ANONYMOUS|MAP_PRIVATE|MAP_HUGETLB,
+			 -1, 0);
+#else
+	(void)hugetlb;
+#endif
+
+	if (p == (void *)-1) {
+		p = mmap(nullptr, size,
+			 PROT_READ|PROT_WRITE, flags,
+			 -1, 0);
+		if (p == (void *)-1)
+			return nullptr;
 
 #ifdef MADV_HUGEPAGE
-	/* allow the Linux kernel to use "Huge Pages", which reduces page
-	   table overhead for this big chunk of data */
-	madvise(p, size, MADV_HUGEPAGE);
+		/* allow the Linux kernel to use "Huge Pages", which
+		   reduces page table overhead for this big chunk of
+		   data */
+		if (huge_pages != HugePages::NONE)
+			madvise(p, size, MADV_HUGEPAGE);
 #endif
+	}
 
 #ifdef MADV_DONTFORK
 	/* just in case MPD needs to fork, don't copy this allocation
@@ -77,21 +250,97 @@ HugeAllocate(size_t size)
 	madvise(p, size, MADV_DONTFORK);
 #endif
 
+	/* this fails if RLIMIT_MEMLOCK is too small; the allocation
+	   is usable anyway, it's just not protected from being paged
+	   out */
+	const bool locked = huge_lock && mlock(p, size) == 0;
+
+	Register(p, size, locked);
 	return p;
 }
 
 void
 HugeFree(void *p, size_t size)
 {
-	munmap(p, AlignToPageSize(size));
+	bool hugetlb;
+	size = AlignAllocationSize(size, hugetlb);
+
+	Unregister(p);
+	munmap(p, size);
 }
 
 void
 HugeDiscard(void *p, size_t size)
 {
+	if (huge_lock)
+		/* locked pages cannot be discarded; keeping them is
+		   the whole point of locking */
+		return;
+
 #ifdef MADV_DONTNEED
-	madvise(p, AlignToPageSize(size), MADV_DONTNEED);
+	bool hugetlb;
+	madvise(p, AlignAllocationSize(size, hugetlb), MADV_DONTNEED);
 #endif
 }
 
+/**
+ * Count the bytes of the given allocation which are in physical
+ * memory.
+ */
+static size_t
+GetResidentSize(void *p, size_t size)
+{
+	static const long page_size = sysconf(_SC_PAGESIZE);
+	if (page_size <= 0)
+		return 0;
+
+	const size_t n_pages = (size + page_size - 1) / page_size;
+
+	size_t n_resident = 0;
+	unsigned char vec[256];
+	for (size_t i = 0; i < n_pages;) {
+		size_t n = n_pages - i;
+		if (n > sizeof(vec))
+			n = sizeof(vec);
+
+		if (mincore((uint8_t *)p + i * page_size, n * page_size,
+			    vec) != 0)
+			/* it was freed meanwhile */
+			return 0;
+
+		for (size_t j = 0; j < n; ++j)
+			if (vec[j] & 1)
+				++n_resident;
+
+		i += n;
+	}
+
+	return n_resident * page_size;
+}
+
+HugeStats
+HugeGetStats()
+{
+	HugeStats stats{0, 0, 0};
+
+	for (const HugeAllocationTable *table = &huge_allocations;
+	     table != nullptr;
+	     table = table->next.load(std::memory_order_acquire)) {
+		for (auto &i : table->slots) {
+			uint8_t *p = i.p.load(std::memory_order_acquire);
+			if (p == nullptr || p == RESERVED)
+				continue;
+
+			const size_t size =
+				i.size.load(std::memory_order_relaxed);
+			stats.size += size;
+			stats.resident += GetResidentSize(p, size);
+			if (i.locked.load(std::memory_order_relaxed))
+				stats.locked += size;
+		}
+	}
+
+	return stats;
+}
+
 #endif
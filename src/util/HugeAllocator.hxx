@@ -33,9 +33,76 @@
 #include "Compiler.h"
 
 #include <stddef.h>
+#include <stdint.h>
+
+/**
+ * How HugeAllocate() shall use the kernel's "huge pages".
+ */
+enum class HugePages : uint8_t {
+	/**
+	 * Use normal pages only.
+	 */
+	NONE,
+
+	/**
+	 * Allow the kernel to use transparent huge pages (the
+	 * default).
+	 */
+	TRANSPARENT,
+
+	/**
+	 * Attempt to allocate from the explicitly reserved huge page
+	 * pool (MAP_HUGETLB), and fall back to #TRANSPARENT if that
+	 * fails.
+	 */
+	EXPLICIT,
+};
+
+struct HugeStats {
+	/**
+	 * The total size of all allocations.
+	 */
+	size_t size;
+
+	/**
+	 * The number of bytes which are currently in physical
+	 * memory.
+	 */
+	size_t resident;
+
+	/**
+	 * The number of bytes which are locked into memory.
+	 */
+	size_t locked;
+};
 
 #ifdef __linux__
 
+/**
+ * Configure all subsequent HugeAllocate() calls.  This must be called
+ * before the first allocation; changing the settings later on is not
+ * allowed, because HugeFree() relies on them.
+ *
+ * @param lock lock allocations into memory with mlock(), to protect
+ * them from being paged out; this implies that HugeDiscard() does
+ * nothing
+ */
+void
+HugeConfigure(HugePages pages, bool lock);
+
+/**
+ * Were allocations configured to be locked into memory?
+ */
+gcc_pure
+bool
+HugeIsLocking();
+
+/**
+ * Obtain statistics about all existing allocations.
+ */
+HugeStats
+HugeGetStats();
+
 /**
  * Allocate a huge amount of memory.  This will be done in a way that
  * allows giving the memory back to the kernel as soon as we don't
@@ -69,6 +136,23 @@ HugeDiscard(void *p, size_t size);
 
 #include <stdlib.h>
 
+static inline void
+HugeConfigure(HugePages, bool)
+{
+}
+
+static inline bool
+HugeIsLocking()
+{
+	return false;
+}
+
+static inline HugeStats
+HugeGetStats()
+{
+	return HugeStats{0, 0, 0};
+}
+
 gcc_malloc
 static inline void *
 HugeAllocate(size_t size)
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_LATENCY_HISTOGRAM_HXX
+#define MPD_LATENCY_HISTOGRAM_HXX
+
+#include "Compiler.h"
+
+#include <atomic>
+
+#include <stdint.h>
+
+/**
+ * A histogram of durations in microseconds with logarithmic buckets:
+ * bucket 0 counts values below 2us, bucket i counts values in the
+ * range [2^i, 2^(i+1)), and the last bucket counts everything above.
+ *
+ * There may be only one thread which adds values, but any thread
+ * may read them at any time without locking.  A reader may see a
+ * value which has been counted in one attribute but not yet in the
+ * others.
+ */
+class LatencyHistogram {
+public:
+	static constexpr unsigned N_BUCKETS = 24;
+
+private:
+	std::atomic<uint64_t> count, sum, max;
+	std::atomic<uint64_t> buckets[N_BUCKETS];
+
+public:
+	LatencyHistogram() {
+		Reset();
+	}
+
+	LatencyHistogram(const LatencyHistogram &) = delete;
+	LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+	gcc_const
+	static unsigned GetBucketIndex(uint64_t us) {
+		unsigned i = 0;
+		while (us >= 2 && i < N_BUCKETS - 1) {
+			us >>= 1;
+			++i;
+		}
+
+		return i;
+	}
+
+	/**
+	 * Returns the (exclusive) upper bound of the specified
+	 * bucket in microseconds, or 0 for the last bucket, which
+	 * has no upper bound.
+	 */
+	gcc_const
+	static uint64_t GetBucketLimit(unsigned i) {
+		return i < N_BUCKETS - 1
+			? uint64_t(2) << i
+			: 0;
+	}
+
+	void Reset() {
+		count.store(0, std::memory_order_relaxed);
+		sum.store(0, std::memory_order_relaxed);
+		max.store(0, std::memory_order_relaxed);
+		for (auto &i : buckets)
+			i.store(0, std::memory_order_relaxed);
+	}
+
+	void Add(uint64_t us) {
+		buckets[GetBucketIndex(us)].fetch_add(1,
+						     std::memory_order_relaxed);
+		sum.fetch_add(us, std::memory_order_relaxed);
+		if (us > max.load(std::memory_order_relaxed))
+			max.store(us, std::memory_order_relaxed);
+		count.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Add the time which has passed since the given
+	 * MonotonicClockUS() value.  A zero start time means "not
+	 * recorded" and is ignored.
+	 */
+	void AddSince(uint64_t start, uint64_t now) {
+		if (start != 0 && now >= start)
+			Add(now - start);
+	}
+
+	uint64_t GetCount() const {
+		return count.load(std::memory_order_relaxed);
+	}
+
+	uint64_t GetSum() const {
+		return sum.load(std::memory_order_relaxed);
+	}
+
+	uint64_t GetMax() const {
+		return max.load(std::memory_order_relaxed);
+	}
+
+	uint64_t GetAverage() const {
+		const uint64_t n = GetCount();
+		return n > 0 ? GetSum() / n : 0;
+	}
+
+	uint64_t GetBucket(unsigned i) const {
+		return buckets[i].load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Estimate a percentile: the upper bound of the bucket which
+	 * contains it, capped at the maximum value.
+	 *
+	 * @param percent a number between 0 and 100
+	 */
+	gcc_pure
+	uint64_t GetPercentile(unsigned percent) const {
+		uint64_t total = 0;
+		for (unsigned i = 0; i < N_BUCKETS; ++i)
+			total += GetBucket(i);
+
+		if (total == 0)
+			return 0;
+
+		const uint64_t threshold = (total * percent + 99) / 100;
+		const uint64_t _max = GetMax();
+
+		uint64_t n = 0;
+		for (unsigned i = 0; i < N_BUCKETS - 1; ++i) {
+			n += GetBucket(i);
+			if (n >= threshold && n > 0) {
+				const uint64_t limit = GetBucketLimit(i);
+				return limit < _max ? limit : _max;
+			}
+		}
+
+		return _max;
+	}
+};
+
+#endif
@@ -23,58 +23,129 @@
 #include "HugeAllocator.hxx"
 #include "Compiler.h"
 
+#include <atomic>
+#include <thread>
 #include <utility>
 #include <new>
 
 #include <assert.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * This class pre-allocates a certain number of objects, and allows
  * callers to allocate and free these objects ("slices").
+ *
+ * Allocate() and Free() are lock-free and may be called from any
+ * number of threads concurrently.  The free slices are kept in a
+ * lock-free stack, and the stack head carries a modification counter
+ * to avoid the ABA problem.
+ *
+ * The slice size may be chosen at runtime, to leave room for a
+ * variable-sized payload after each object.
  */
 template<typename T>
 class SliceBuffer {
 	union Slice {
-		Slice *next;
+		/**
+		 * The index of the next free slice, or #END.
+		 */
+		unsigned next;
 
 		T value;
 	};
 
+	/**
+	 * A slice index meaning "no slice".
+	 */
+	static constexpr unsigned END = ~0u;
+
+	/**
+	 * A special value for #n_allocated while the last Free()
+	 * call gives the memory back to the kernel.  Allocate() waits
+	 * until that is finished.
+	 */
+	static constexpr unsigned DISCARDING = ~0u;
+
 	/**
 	 * The maximum number of slices in this container.
 	 */
 	const unsigned n_max;
 
+	/**
+	 * The distance between two slices in bytes.  This is at least
+	 * sizeof(Slice), and a multiple of its alignment.
+	 */
+	const size_t stride;
+
 	/**
 	 * The number of slices that are initialized.  This is used to
 	 * avoid page faulting on the new allocation, so the kernel
 	 * does not need to reserve physical memory pages.
 	 */
-	unsigned n_initialized;
+	std::atomic_uint n_initialized;
 
 	/**
-	 * The number of slices currently allocated.
+	 * The number of slices currently allocated (or reserved by an
+	 * Allocate() call which is in progress).
 	 */
-	unsigned n_allocated;
+	std::atomic_uint n_allocated;
 
-	Slice *const data;
+	uint8_t *const data;
 
 	/**
-	 * Pointer to the first free element in the chain.
+	 * The first free element in the chain: the lower 32 bits are
+	 * its index, the upper 32 bits are a counter which is
+	 * incremented on each modification.
 	 */
-	Slice *available;
+	std::atomic<uint64_t> available;
 
 	size_t CalcAllocationSize() const {
-		return n_max * sizeof(Slice);
+		return n_max * stride;
+	}
+
+	static constexpr size_t CalcStride(size_t slice_size) {
+		return slice_size < sizeof(Slice)
+			? sizeof(Slice)
+			: (slice_size + alignof(Slice) - 1) / alignof(Slice)
+			* alignof(Slice);
+	}
+
+	Slice &GetSlice(unsigned i) {
+		return *reinterpret_cast<Slice *>(data + i * stride);
+	}
+
+	unsigned GetSliceIndex(const Slice *slice) const {
+		return (reinterpret_cast<const uint8_t *>(slice) - data)
+			/ stride;
+	}
+
+	static constexpr uint64_t MakeHead(unsigned index, unsigned tag) {
+		return uint64_t(tag) << 32 | index;
+	}
+
+	static constexpr unsigned GetIndex(uint64_t head) {
+		return unsigned(head);
+	}
+
+	static constexpr unsigned GetTag(uint64_t head) {
+		return unsigned(head >> 32);
 	}
 
 public:
-	SliceBuffer(unsigned _count)
-		:n_max(_count), n_initialized(0), n_allocated(0),
-		 data((Slice *)HugeAllocate(CalcAllocationSize())),
-		 available(nullptr) {
+	/**
+	 * @param _count the number of slices
+	 * @param slice_size the size of each slice in bytes; values
+	 * bigger than sizeof(T) leave room for a payload after each
+	 * object
+	 */
+	SliceBuffer(unsigned _count, size_t slice_size=sizeof(T))
+		:n_max(_count), stride(CalcStride(slice_size)),
+		 n_initialized(0), n_allocated(0),
+		 data((uint8_t *)HugeAllocate(CalcAllocationSize())),
+		 available(MakeHead(END, 0)) {
 		assert(n_max > 0);
+		assert(n_max < END);
 	}
 
 	~SliceBuffer() {
@@ -99,63 +170,144 @@ public:
 		return n_max;
 	}
 
+	/**
+	 * Returns the number of bytes available to each slice,
+	 * starting at the address returned by Allocate().
+	 */
+	size_t GetSliceSize() const {
+		return stride;
+	}
+
 	bool IsEmpty() const {
-		return n_allocated == 0;
+		return n_allocated.load(std::memory_order_relaxed) == 0;
 	}
 
 	bool IsFull() const {
-		return n_allocated == n_max;
+		return n_allocated.load(std::memory_order_relaxed) == n_max;
 	}
 
 	template<typename... Args>
 	T *Allocate(Args&&... args) {
-		assert(n_initialized <= n_max);
-		assert(n_allocated <= n_initialized);
-
-		if (available == nullptr) {
-			if (n_initialized == n_max) {
-				/* out of (internal) memory, buffer is full */
-				assert(n_allocated == n_max);
-				return nullptr;
-			}
-
-			available = &data[n_initialized++];
-			available->next = nullptr;
-		}
+		if (!Reserve())
+			/* out of (internal) memory, buffer is full */
+			return nullptr;
 
 		/* allocate a slice */
-		T *value = &available->value;
-		available = available->next;
-		++n_allocated;
+		T *value = &PopSlice()->value;
 
 		/* construct the object */
 		return ::new((void *)value) T(std::forward<Args>(args)...);
 	}
 
 	void Free(T *value) {
-		assert(n_initialized <= n_max);
-		assert(n_allocated > 0);
-		assert(n_allocated <= n_initialized);
-
 		Slice *slice = reinterpret_cast<Slice *>(value);
-		assert(slice >= data && slice < data + n_max);
+		assert((uint8_t *)slice >= data);
+		assert(GetSliceIndex(slice) < n_max);
+		assert(((uint8_t *)slice - data) % stride == 0);
+		assert(n_allocated > 0);
+		assert(n_allocated <= n_max);
 
 		/* destruct the object */
 		value->~T();
 
 		/* insert the slice in the "available" linked list */
-		slice->next = available;
-		available = slice;
-		--n_allocated;
+		PushSlice(slice);
 
 		/* give memory back to the kernel when the last slice
 		   was freed */
-		if (n_allocated == 0) {
-			HugeDiscard(data, CalcAllocationSize());
-			n_initialized = 0;
-			available = nullptr;
+		if (n_allocated.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			Discard();
+	}
+
+private:
+	/**
+	 * Reserve one slice by incrementing #n_allocated.
+	 *
+	 * @return false if the buffer is full
+	 */
+	bool Reserve() {
+		unsigned n = n_allocated.load(std::memory_order_relaxed);
+		while (true) {
+			if (gcc_unlikely(n == DISCARDING)) {
+				std::this_thread::yield();
+				n = n_allocated.load(std::memory_order_relaxed);
+			} else if (n >= n_max)
+				return false;
+			else if (n_allocated.compare_exchange_weak(n, n + 1,
+								   std::memory_order_acquire,
+								   std::memory_order_relaxed))
+				return true;
 		}
 	}
+
+	/**
+	 * Obtain a free slice.  The caller must have reserved it with
+	 * Reserve(), which guarantees that there is one.
+	 */
+	Slice *PopSlice() {
+		while (true) {
+			uint64_t head = available.load(std::memory_order_acquire);
+			const unsigned i = GetIndex(head);
+			if (i != END) {
+				/* if another thread pops this slice
+				   meanwhile, "next" may be garbage, but
+				   then the tag has changed and the CAS
+				   fails */
+				const unsigned next = GetSlice(i).next;
+				if (available.compare_exchange_weak(head,
+								    MakeHead(next, GetTag(head) + 1),
+								    std::memory_order_acquire,
+								    std::memory_order_relaxed))
+					return &GetSlice(i);
+
+				continue;
+			}
+
+			/* the chain is empty: initialize a new slice */
+			unsigned n = n_initialized.load(std::memory_order_relaxed);
+			if (n < n_max &&
+			    n_initialized.compare_exchange_weak(n, n + 1,
+								std::memory_order_relaxed))
+				return &GetSlice(n);
+
+			/* all slices are initialized, and a concurrent
+			   Free() has not yet finished pushing the slice
+			   we have reserved; try again */
+		}
+	}
+
+	void PushSlice(Slice *slice) {
+		const unsigned i = GetSliceIndex(slice);
+
+		uint64_t head = available.load(std::memory_order_relaxed);
+		do {
+			slice->next = GetIndex(head);
+		} while (!available.compare_exchange_weak(head,
+							  MakeHead(i, GetTag(head) + 1),
+							  std::memory_order_release,
+							  std::memory_order_relaxed));
+	}
+
+	/**
+	 * Give all memory back to the kernel, unless another thread
+	 * has allocated a slice meanwhile.
+	 */
+	void Discard() {
+		unsigned expected = 0;
+		if (!n_allocated.compare_exchange_strong(expected, DISCARDING,
+							 std::memory_order_acquire,
+							 std::memory_order_relaxed))
+			return;
+
+		HugeDiscard(data, CalcAllocationSize());
+
+		const uint64_t head = available.load(std::memory_order_relaxed);
+		available.store(MakeHead(END, GetTag(head) + 1),
+				std::memory_order_relaxed);
+		n_initialized.store(0, std::memory_order_relaxed);
+
+		n_allocated.store(0, std::memory_order_release);
+	}
 };
 
 #endif
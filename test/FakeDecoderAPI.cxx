@@ -113,6 +113,25 @@ decoder_data(gcc_unused Decoder &decoder,
 	return DecoderCommand::NONE;
 }
 
+static uint8_t write_buffer[4096];
+
+DecoderCommand
+decoder_write_begin(gcc_unused Decoder &decoder,
+		    gcc_unused InputStream *is,
+		    WritableBuffer<void> &buffer)
+{
+	buffer = { write_buffer, sizeof(write_buffer) };
+	return DecoderCommand::NONE;
+}
+
+DecoderCommand
+decoder_write_end(gcc_unused Decoder &decoder, size_t length,
+		  gcc_unused uint16_t kbit_rate)
+{
+	gcc_unused ssize_t nbytes = write(1, write_buffer, length);
+	return DecoderCommand::NONE;
+}
+
 DecoderCommand
 decoder_tag(gcc_unused Decoder &decoder,
 	    gcc_unused InputStream *is,
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * A copy of the mutex-protected linked list which #MusicPipe was
+ * before it became a lock-free ring.  It is only used by
+ * test/bench_pipe.cxx to compare both implementations.
+ */
+
+#ifndef MPD_TEST_OLD_MUSIC_PIPE_HXX
+#define MPD_TEST_OLD_MUSIC_PIPE_HXX
+
+#include "MusicChunk.hxx"
+#include "thread/Mutex.hxx"
+#include "Compiler.h"
+
+#ifndef NDEBUG
+#include "AudioFormat.hxx"
+#endif
+
+#include <assert.h>
+
+/**
+ * A #music_chunk with the "next" pointer which #music_chunk had at
+ * that time.
+ */
+struct OldMusicChunk : music_chunk {
+	/** the next chunk in a linked list */
+	OldMusicChunk *next;
+};
+
+class OldMusicPipe {
+	/** the first chunk */
+	OldMusicChunk *head;
+
+	/** a pointer to the tail of the chunk */
+	OldMusicChunk **tail_r;
+
+	/** the current number of chunks */
+	unsigned size;
+
+	/** a mutex which protects #head and #tail_r */
+	mutable Mutex mutex;
+
+#ifndef NDEBUG
+	AudioFormat audio_format;
+#endif
+
+public:
+	OldMusicPipe()
+		:head(nullptr), tail_r(&head), size(0) {
+#ifndef NDEBUG
+		audio_format.Clear();
+#endif
+	}
+
+	~OldMusicPipe() {
+		assert(head == nullptr);
+		assert(tail_r == &head);
+	}
+
+	OldMusicChunk *Shift();
+
+	void Push(OldMusicChunk *chunk);
+
+	gcc_pure
+	unsigned GetSize() const {
+		return size;
+	}
+};
+
+#endif
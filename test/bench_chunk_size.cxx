@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the per-chunk overhead of the decoder ->
+ * player path with a range of chunk sizes: each second of audio is
+ * written into #music_chunk objects like decoder_data() does,
+ * pushed into a #MusicPipe, shifted and returned to the
+ * #MusicBuffer.
+ *
+ */
+
+#include "config.h"
+#include "MusicBuffer.hxx"
+#include "MusicPipe.hxx"
+#include "MusicChunk.hxx"
+#include "AudioFormat.hxx"
+#include "AudioParser.hxx"
+#include "system/Clock.hxx"
+#include "util/Error.hxx"
+#include "util/Macros.hxx"
+#include "Log.hxx"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr unsigned N_CHUNKS = 64;
+
+static constexpr size_t chunk_sizes[] = {
+	1024, 4096, 16384, 65536, 262144, 1048576,
+};
+
+/**
+ * Feed the specified number of bytes through the buffer and the
+ * pipe, and return the number of chunks which were used.
+ */
+static unsigned
+Feed(MusicBuffer &buffer, MusicPipe &pipe, AudioFormat af,
+     const uint8_t *src, size_t length)
+{
+	unsigned n_chunks = 0;
+	music_chunk *chunk = nullptr;
+
+	while (length > 0) {
+		if (chunk == nullptr) {
+			chunk = buffer.Allocate(af);
+			if (chunk == nullptr)
+				abort();
+		}
+
+		const auto dest = chunk->Write(af, 0, 0);
+		size_t nbytes = dest.size;
+		if (nbytes > length)
+			nbytes = length;
+
+		memcpy(dest.data, src, nbytes);
+		length -= nbytes;
+
+		if (chunk->Expand(af, nbytes) || length == 0) {
+			pipe.Push(chunk);
+			chunk = nullptr;
+			++n_chunks;
+
+			/* the player thread would consume it now */
+			buffer.Return(pipe.Shift());
+		}
+	}
+
+	return n_chunks;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 3) {
+		fprintf(stderr,
+			"Usage: bench_chunk_size [FORMAT] [SECONDS]\n");
+		return EXIT_FAILURE;
+	}
+
+	AudioFormat af(384000, SampleFormat::S32, 8);
+	if (argc > 1) {
+		Error error;
+		if (!audio_format_parse(af, argv[1], false, error)) {
+			LogError(error, "Failed to parse audio format");
+			return EXIT_FAILURE;
+		}
+	}
+
+	const unsigned seconds = argc > 2
+		? strtoul(argv[2], nullptr, 10)
+		: 10;
+
+	const size_t second_size = af.GetTimeToSize();
+
+	/* a source buffer which is big enough for the largest
+	   chunk */
+	const size_t src_size = chunk_sizes[ARRAY_SIZE(chunk_sizes) - 1];
+	uint8_t *src = new uint8_t[src_size];
+	memset(src, 0x55, src_size);
+
+	printf("%-10s %12s %12s %12s\n",
+	       "size", "chunks/s", "ns/chunk", "us/s");
+
+	for (size_t chunk_size : chunk_sizes) {
+		MusicBuffer buffer(N_CHUNKS, chunk_size);
+		MusicPipe pipe(N_CHUNKS);
+
+		/* hold one chunk all the time, or else the buffer
+		   would give its memory back to the kernel after each
+		   chunk; this doesn't happen during playback */
+		music_chunk *pin = buffer.Allocate(af);
+
+		unsigned n_chunks = 0;
+		const uint64_t start = MonotonicClockUS();
+		for (unsigned i = 0; i < seconds; ++i)
+			n_chunks += Feed(buffer, pipe, af,
+					 src, second_size);
+		const uint64_t us = MonotonicClockUS() - start;
+
+		buffer.Return(pin);
+
+		printf("%-10lu %12.0f %12.1f %12.1f\n",
+		       (unsigned long)chunk_size,
+		       double(n_chunks) / seconds,
+		       us * 1e3 / n_chunks,
+		       double(us) / seconds);
+	}
+
+	delete[] src;
+	return EXIT_SUCCESS;
+}
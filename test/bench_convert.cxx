@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the throughput of the sample format
+ * converters (pcm/PcmFormat.cxx) for every pair of source and
+ * destination format, with the portable and with the SIMD kernels.
+ *
+ */
+
+#include "config.h"
+#include "pcm/PcmFormat.hxx"
+#include "pcm/PcmBuffer.hxx"
+#include "pcm/PcmDither.hxx"
+#include "AudioFormat.hxx"
+#include "system/Clock.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/CpuFeatures.hxx"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static constexpr SampleFormat formats[] = {
+	SampleFormat::S8,
+	SampleFormat::S16,
+	SampleFormat::S24_P32,
+	SampleFormat::S32,
+	SampleFormat::FLOAT,
+};
+
+/**
+ * The number of samples of each call, like a typical #music_chunk.
+ */
+static constexpr size_t BLOCK_SAMPLES = 2048;
+
+static volatile uint8_t sink;
+
+/**
+ * Convert one block with pcm_convert_to_16(), pcm_convert_to_24(),
+ * pcm_convert_to_32() or pcm_convert_to_float(), and return the
+ * first byte of the result.
+ */
+static uint8_t
+Convert(PcmBuffer &buffer, PcmDither &dither,
+	SampleFormat src_format, SampleFormat dest_format,
+	ConstBuffer<void> src)
+{
+	ConstBuffer<void> dest = nullptr;
+
+	switch (dest_format) {
+	case SampleFormat::S16:
+		dest = pcm_convert_to_16(buffer, dither, src_format,
+					 src).ToVoid();
+		break;
+
+	case SampleFormat::S24_P32:
+		dest = pcm_convert_to_24(buffer, src_format, src).ToVoid();
+		break;
+
+	case SampleFormat::S32:
+		dest = pcm_convert_to_32(buffer, src_format, src).ToVoid();
+		break;
+
+	case SampleFormat::FLOAT:
+		dest = pcm_convert_to_float(buffer, src_format,
+					    src).ToVoid();
+		break;
+
+	default:
+		abort();
+	}
+
+	if (dest.IsNull())
+		abort();
+
+	return *(const uint8_t *)dest.data;
+}
+
+/**
+ * Convert the specified number of samples, and return the throughput
+ * in million samples per second.
+ */
+static double
+Run(SampleFormat src_format, SampleFormat dest_format,
+    unsigned cpu_features, size_t total, ConstBuffer<void> src)
+{
+	/* the lowest byte of the first sample is modified in each
+	   iteration; this doesn't make the sample invalid */
+	uint8_t *const first = (uint8_t *)const_cast<void *>(src.data);
+
+	SetCpuFeatureMask(cpu_features);
+
+	PcmBuffer buffer;
+	PcmDither dither;
+
+	/* pcm_convert_to_*() are declared "pure"; modify the input
+	   and consume the result, so the compiler doesn't merge the
+	   calls or optimize them away */
+	uint8_t sum = 0;
+
+	const uint64_t start = MonotonicClockUS();
+	for (size_t i = 0; i < total; i += BLOCK_SAMPLES) {
+		*first = i;
+		sum ^= Convert(buffer, dither, src_format, dest_format, src);
+	}
+	const uint64_t us = MonotonicClockUS() - start;
+
+	sink ^= sum;
+	return us > 0 ? double(total) / us : 0;
+}
+
+/**
+ * Fill the buffer with valid random samples of the given format.
+ */
+static ConstBuffer<void>
+Generate(SampleFormat format, void *p)
+{
+	const size_t size = BLOCK_SAMPLES * sample_format_size(format);
+
+	switch (format) {
+	case SampleFormat::S24_P32:
+		for (size_t i = 0; i < BLOCK_SAMPLES; ++i)
+			((int32_t *)p)[i] = (rand() & 0xffffff) - 0x800000;
+		break;
+
+	case SampleFormat::FLOAT:
+		for (size_t i = 0; i < BLOCK_SAMPLES; ++i)
+			((float *)p)[i] = float(rand()) / RAND_MAX * 2 - 1;
+		break;
+
+	default:
+		for (size_t i = 0; i < size; ++i)
+			((uint8_t *)p)[i] = rand();
+		break;
+	}
+
+	return { p, size };
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 2) {
+		fprintf(stderr, "Usage: bench_convert [MEGASAMPLES]\n");
+		return EXIT_FAILURE;
+	}
+
+	const size_t total = (argc > 1
+			      ? strtoul(argv[1], nullptr, 10)
+			      : 256) * 1000000;
+
+	static uint32_t src_buffer[BLOCK_SAMPLES];
+
+	printf("%-6s %-6s %12s %12s\n", "from", "to", "generic", "simd");
+
+	for (SampleFormat src_format : formats) {
+		const auto src = Generate(src_format, src_buffer);
+
+		for (SampleFormat dest_format : formats) {
+			if (dest_format == src_format ||
+			    dest_format == SampleFormat::S8)
+				/* no converter */
+				continue;
+
+			printf("%-6s %-6s %12.1f %12.1f\n",
+			       sample_format_to_string(src_format),
+			       sample_format_to_string(dest_format),
+			       Run(src_format, dest_format, 0, total, src),
+			       Run(src_format, dest_format, ~0u, total, src));
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the throughput of the DSD to PCM conversion
+ * (pcm/PcmDsd.cxx), compared with calling dsd2pcm_translate() for
+ * each channel.
+ *
+ */
+
+#include "config.h"
+#include "pcm/PcmDsd.hxx"
+#include "pcm/dsd2pcm/dsd2pcm.h"
+#include "util/ConstBuffer.hxx"
+#include "system/Clock.hxx"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * The size of each call in bytes, like a typical #music_chunk.
+ */
+static constexpr size_t BLOCK_SIZE = 4096;
+
+/**
+ * The data rate of one DSD256 channel in bytes per second.
+ */
+static constexpr double DSD256_RATE = 44100. * 256 / 8;
+
+static uint8_t src[BLOCK_SIZE];
+static float dest[BLOCK_SIZE];
+
+static volatile float sink;
+
+/**
+ * Convert the specified number of bytes with dsd2pcm_translate(),
+ * and return the throughput in MB/s.
+ */
+static double
+RunDsd2pcm(unsigned channels, size_t total)
+{
+	dsd2pcm_ctx *ctx[PcmDsd::MAX_CHANNELS];
+	for (unsigned c = 0; c < channels; ++c)
+		ctx[c] = dsd2pcm_init();
+
+	const size_t n_frames = BLOCK_SIZE / channels;
+
+	const uint64_t start = MonotonicClockUS();
+	for (size_t i = 0; i < total; i += BLOCK_SIZE) {
+		for (unsigned c = 0; c < channels; ++c)
+			dsd2pcm_translate(ctx[c], n_frames,
+					  src + c, channels, false,
+					  dest + c, channels);
+		sink = dest[0];
+	}
+	const uint64_t us = MonotonicClockUS() - start;
+
+	for (unsigned c = 0; c < channels; ++c)
+		dsd2pcm_destroy(ctx[c]);
+
+	return us > 0 ? double(total) / us : 0;
+}
+
+/**
+ * Convert the specified number of bytes with #PcmDsd, and return the
+ * throughput in MB/s.
+ */
+static double
+RunPcmDsd(unsigned channels, size_t total)
+{
+	PcmDsd dsd;
+	const size_t size = BLOCK_SIZE / channels * channels;
+
+	const uint64_t start = MonotonicClockUS();
+	for (size_t i = 0; i < total; i += BLOCK_SIZE)
+		sink = dsd.ToFloat(channels, false, { src, size }).data[0];
+	const uint64_t us = MonotonicClockUS() - start;
+
+	return us > 0 ? double(total) / us : 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 2) {
+		fprintf(stderr, "Usage: bench_dsd [MEGABYTES]\n");
+		return EXIT_FAILURE;
+	}
+
+	const size_t total = (argc > 1
+			      ? strtoul(argv[1], nullptr, 10)
+			      : 256) << 20;
+
+	for (auto &i : src)
+		i = rand();
+
+	printf("%-9s %12s %12s %14s\n", "channels",
+	       "dsd2pcm", "PcmDsd", "DSD256 ch/core");
+
+	static constexpr unsigned channel_counts[] = { 1, 2, 6 };
+	for (const unsigned channels : channel_counts) {
+		const double result = RunPcmDsd(channels, total);
+		printf("%-9u %12.1f %12.1f %14.1f\n", channels,
+		       RunDsd2pcm(channels, total),
+		       result, result * 1e6 / DSD256_RATE);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the throughput of the channel matrix mixer
+ * (pcm/PcmMatrix.cxx) for common downmixes, with the portable and
+ * with the SIMD kernels.
+ *
+ */
+
+#include "config.h"
+#include "pcm/PcmMatrix.hxx"
+#include "util/CpuFeatures.hxx"
+#include "system/Clock.hxx"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * The number of frames in each call, like a typical #music_chunk.
+ */
+static constexpr size_t BLOCK_FRAMES = 512;
+
+static float src[BLOCK_FRAMES * MAX_CHANNELS];
+static float dest[BLOCK_FRAMES * MAX_CHANNELS];
+
+static constexpr struct {
+	const char *name;
+	unsigned src_channels, dest_channels;
+} layouts[] = {
+	{ "5.1>stereo", 6, 2 },
+	{ "7.1>stereo", 8, 2 },
+	{ "7.1>5.1", 8, 6 },
+	{ "stereo>mono", 2, 1 },
+};
+
+static constexpr struct {
+	const char *name;
+	SampleFormat format;
+} formats[] = {
+	{ "16", SampleFormat::S16 },
+	{ "24", SampleFormat::S24_P32 },
+	{ "32", SampleFormat::S32 },
+	{ "float", SampleFormat::FLOAT },
+};
+
+/**
+ * Mix the specified number of input frames, and return the
+ * throughput in million frames per second.
+ */
+static double
+Run(SampleFormat format, const PcmMatrix &matrix,
+    unsigned cpu_features, size_t total)
+{
+	SetCpuFeatureMask(cpu_features);
+
+	const uint64_t start = MonotonicClockUS();
+	for (size_t i = 0; i < total; i += BLOCK_FRAMES)
+		pcm_matrix_mix(format, dest, src, BLOCK_FRAMES, matrix);
+	const uint64_t us = MonotonicClockUS() - start;
+
+	return us > 0 ? double(total) / us : 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 2) {
+		fprintf(stderr, "Usage: bench_matrix [MEGAFRAMES]\n");
+		return EXIT_FAILURE;
+	}
+
+	const size_t total = (argc > 1
+			      ? strtoul(argv[1], nullptr, 10)
+			      : 64) << 20;
+
+	/* small values which are valid in all sample formats */
+	for (auto &i : src)
+		i = (rand() & 0x7fff) / 32768.f;
+
+	printf("%-12s %-6s %12s %12s\n", "layout", "format",
+	       "generic", "simd");
+
+	for (const auto &l : layouts) {
+		PcmMatrix matrix;
+		matrix.SetDefault(l.src_channels, l.dest_channels);
+
+		for (const auto &f : formats)
+			printf("%-12s %-6s %12.1f %12.1f\n", l.name, f.name,
+			       Run(f.format, matrix, 0, total),
+			       Run(f.format, matrix, ~0u, total));
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the throughput of the 24 bit packing
+ * (pcm/PcmPack.cxx) and byte swapping (util/ByteReverse.cxx) kernels
+ * used by PcmExport, with the portable and with the SIMD kernels.
+ *
+ */
+
+#include "config.h"
+#include "pcm/PcmPack.hxx"
+#include "util/ByteReverse.hxx"
+#include "util/CpuFeatures.hxx"
+#include "system/Clock.hxx"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * The size of each call in bytes, like a typical #music_chunk.
+ */
+static constexpr size_t BLOCK_SIZE = 4096;
+
+static uint8_t src[BLOCK_SIZE], dest[BLOCK_SIZE];
+
+static void
+Pack24()
+{
+	pcm_pack_24(dest, (const int32_t *)src,
+		    (const int32_t *)(src + BLOCK_SIZE));
+}
+
+static void
+Unpack24()
+{
+	/* a multiple of 3 bytes which fits into the destination */
+	constexpr size_t size = BLOCK_SIZE / 4 * 3;
+	pcm_unpack_24((int32_t *)dest, src, src + size);
+}
+
+static void
+Reverse16()
+{
+	reverse_bytes_16((uint16_t *)dest, (const uint16_t *)src,
+			 (const uint16_t *)(src + BLOCK_SIZE));
+}
+
+static void
+Reverse32()
+{
+	reverse_bytes_32((uint32_t *)dest, (const uint32_t *)src,
+			 (const uint32_t *)(src + BLOCK_SIZE));
+}
+
+static void
+Reverse64()
+{
+	reverse_bytes_64((uint64_t *)dest, (const uint64_t *)src,
+			 (const uint64_t *)(src + BLOCK_SIZE));
+}
+
+static constexpr struct {
+	const char *name;
+	void (*function)();
+} kernels[] = {
+	{ "pack_24", Pack24 },
+	{ "unpack_24", Unpack24 },
+	{ "reverse_16", Reverse16 },
+	{ "reverse_32", Reverse32 },
+	{ "reverse_64", Reverse64 },
+};
+
+/**
+ * Run the kernel on the specified number of bytes, and return the
+ * throughput in MB/s.
+ */
+static double
+Run(void (*function)(), unsigned cpu_features, size_t total)
+{
+	SetCpuFeatureMask(cpu_features);
+
+	const uint64_t start = MonotonicClockUS();
+	for (size_t i = 0; i < total; i += BLOCK_SIZE)
+		function();
+	const uint64_t us = MonotonicClockUS() - start;
+
+	return us > 0 ? double(total) / us : 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 2) {
+		fprintf(stderr, "Usage: bench_pack [MEGABYTES]\n");
+		return EXIT_FAILURE;
+	}
+
+	const size_t total = (argc > 1
+			      ? strtoul(argv[1], nullptr, 10)
+			      : 1024) << 20;
+
+	for (size_t i = 0; i < sizeof(src); ++i)
+		src[i] = rand();
+
+	printf("%-12s %12s %12s\n", "kernel", "generic", "simd");
+
+	for (const auto &i : kernels)
+		printf("%-12s %12.1f %12.1f\n", i.name,
+		       Run(i.function, 0, total),
+		       Run(i.function, ~0u, total));
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the cost of cross-fading: it mixes one
+ * second of stereo audio per iteration with the constant-gain
+ * pcm_mix() and with each curve of pcm_mix_ramp(), for every
+ * sample format.
+ *
+ */
+
+#include "config.h"
+#include "pcm/PcmMix.hxx"
+#include "pcm/PcmDither.hxx"
+#include "AudioFormat.hxx"
+#include "system/Clock.hxx"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr unsigned SAMPLE_RATE = 44100;
+static constexpr unsigned CHANNELS = 2;
+
+/**
+ * The size of each call, like a typical #music_chunk.
+ */
+static constexpr size_t BLOCK_FRAMES = 1024;
+
+static constexpr SampleFormat formats[] = {
+	SampleFormat::S8,
+	SampleFormat::S16,
+	SampleFormat::S24_P32,
+	SampleFormat::S32,
+	SampleFormat::FLOAT,
+};
+
+static constexpr struct {
+	const char *name;
+	MixCurve curve;
+} curves[] = {
+	{ "sine", MixCurve::SINE },
+	{ "linear", MixCurve::LINEAR },
+	{ "equal_power", MixCurve::EQUAL_POWER },
+};
+
+/**
+ * Mix the specified number of seconds with the given curve (or with
+ * pcm_mix() if curve is nullptr), and return the elapsed time in
+ * microseconds.
+ */
+static uint64_t
+Run(SampleFormat format, const MixCurve *curve, unsigned seconds,
+    uint8_t *dest, const uint8_t *src)
+{
+	const size_t block_size = BLOCK_FRAMES * CHANNELS *
+		sample_format_size(format);
+	const unsigned n_blocks = seconds * SAMPLE_RATE / BLOCK_FRAMES;
+
+	PcmDither dither;
+
+	const uint64_t start = MonotonicClockUS();
+	for (unsigned i = 0; i < n_blocks; ++i) {
+		const float portion = float(i) / n_blocks;
+		const float portion_end = float(i + 1) / n_blocks;
+
+		bool success = curve != nullptr
+			? pcm_mix_ramp(dither, dest, src, block_size,
+				       format, CHANNELS,
+				       portion, portion_end, *curve)
+			: pcm_mix(dither, dest, src, block_size,
+				  format, portion);
+		if (!success)
+			abort();
+	}
+
+	return MonotonicClockUS() - start;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 2) {
+		fprintf(stderr, "Usage: bench_pcm_mix [SECONDS]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned seconds = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: 60;
+
+	/* large enough for one block of the widest format */
+	const size_t buffer_size = BLOCK_FRAMES * CHANNELS * 4;
+	uint8_t *dest = new uint8_t[buffer_size];
+	uint8_t *src = new uint8_t[buffer_size];
+	memset(dest, 0x11, buffer_size);
+	memset(src, 0x22, buffer_size);
+
+	printf("%-8s %-12s %12s\n", "format", "curve", "us/s");
+
+	for (SampleFormat format : formats) {
+		uint64_t us = Run(format, nullptr, seconds, dest, src);
+		printf("%-8s %-12s %12.1f\n",
+		       sample_format_to_string(format), "constant",
+		       double(us) / seconds);
+
+		for (const auto &i : curves) {
+			us = Run(format, &i.curve, seconds, dest, src);
+			printf("%-8s %-12s %12.1f\n",
+			       sample_format_to_string(format), i.name,
+			       double(us) / seconds);
+		}
+	}
+
+	delete[] dest;
+	delete[] src;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the throughput of the lock-free #MusicPipe
+ * and compares it with #OldMusicPipe, a copy of the mutex-protected
+ * linked list which #MusicPipe used to be.  One thread pushes chunks,
+ * and another one shifts them, like the decoder and the player
+ * thread do.
+ *
+ */
+
+#include "config.h"
+#include "OldMusicPipe.hxx"
+#include "MusicPipe.hxx"
+#include "MusicChunk.hxx"
+#include "AudioFormat.hxx"
+#include "thread/Thread.hxx"
+#include "system/Clock.hxx"
+#include "util/Error.hxx"
+#include "Log.hxx"
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static constexpr unsigned N_CHUNKS = 1024;
+
+/**
+ * The chunk type pushed into a pipe.
+ */
+template<typename P>
+struct PipeChunk {
+	typedef music_chunk type;
+};
+
+template<>
+struct PipeChunk<OldMusicPipe> {
+	typedef OldMusicChunk type;
+};
+
+template<typename P>
+struct Context {
+	typedef typename PipeChunk<P>::type Chunk;
+
+	P &pipe;
+	Chunk *const chunks;
+	const unsigned n;
+
+	Context(P &_pipe, Chunk *_chunks, unsigned _n)
+		:pipe(_pipe), chunks(_chunks), n(_n) {}
+};
+
+template<typename P>
+static void
+Producer(void *ctx)
+{
+	auto &c = *(Context<P> *)ctx;
+
+	for (unsigned i = 0; i < c.n; ++i) {
+		/* the consumer must have returned the chunk by now;
+		   wait for it just like the decoder waits for a free
+		   chunk in the MusicBuffer */
+		while (c.pipe.GetSize() >= N_CHUNKS)
+			sched_yield();
+
+		c.pipe.Push(&c.chunks[i % N_CHUNKS]);
+	}
+}
+
+template<typename P>
+static uint64_t
+Run(P &pipe, unsigned n)
+{
+	typedef typename PipeChunk<P>::type Chunk;
+
+	Chunk *chunks = new Chunk[N_CHUNKS];
+	for (unsigned i = 0; i < N_CHUNKS; ++i) {
+		chunks[i].length = DEFAULT_CHUNK_SIZE;
+#ifndef NDEBUG
+		chunks[i].audio_format = AudioFormat(44100, SampleFormat::S16, 2);
+#endif
+	}
+
+	Context<P> ctx(pipe, chunks, n);
+
+	const uint64_t start = MonotonicClockUS();
+
+	Thread thread;
+	Error error;
+	if (!thread.Start(Producer<P>, &ctx, error)) {
+		LogError(error);
+		exit(EXIT_FAILURE);
+	}
+
+	for (unsigned i = 0; i < n;) {
+		if (pipe.Shift() != nullptr)
+			++i;
+		else
+			sched_yield();
+	}
+
+	thread.Join();
+
+	const uint64_t duration = MonotonicClockUS() - start;
+	delete[] chunks;
+	return duration;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 2) {
+		fprintf(stderr, "Usage: bench_pipe [COUNT]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned n = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: 10000000;
+
+	OldMusicPipe old_pipe;
+	const uint64_t old_us = Run(old_pipe, n);
+
+	MusicPipe lockfree_pipe(N_CHUNKS);
+	const uint64_t lockfree_us = Run(lockfree_pipe, n);
+
+	printf("%-10s %12s %10s\n", "pipe", "chunks/s", "ns/chunk");
+	printf("%-10s %12.0f %10.1f\n", "old",
+	       n * 1e6 / old_us, old_us * 1e3 / n);
+	printf("%-10s %12.0f %10.1f\n", "lock-free",
+	       n * 1e6 / lockfree_us, lockfree_us * 1e3 / n);
+
+	return EXIT_SUCCESS;
+}
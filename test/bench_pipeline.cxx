@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program compares the CPU cost of the integer pipeline with the
+ * floating point pipeline ("float_pipeline").  The decoder stage
+ * converts the decoder's samples to the pipe format; the output stage
+ * applies replay gain and the software volume, and converts the
+ * result to the device format.  The result is in CPU seconds per
+ * hour of stereo audio.
+ *
+ */
+
+#include "config.h"
+#include "pcm/FormatConverter.hxx"
+#include "pcm/Volume.hxx"
+#include "AudioFormat.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/Error.hxx"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static constexpr unsigned SAMPLE_RATE = 44100;
+static constexpr unsigned CHANNELS = 2;
+
+/**
+ * The number of frames per call, like a typical #music_chunk.
+ */
+static constexpr unsigned BLOCK_FRAMES = 1024;
+static constexpr unsigned BLOCK_SAMPLES = BLOCK_FRAMES * CHANNELS;
+
+static constexpr struct {
+	SampleFormat decoder, device;
+} pairs[] = {
+	{ SampleFormat::S16, SampleFormat::S16 },
+	{ SampleFormat::S24_P32, SampleFormat::S16 },
+	{ SampleFormat::S24_P32, SampleFormat::S24_P32 },
+	{ SampleFormat::FLOAT, SampleFormat::S16 },
+	{ SampleFormat::FLOAT, SampleFormat::S24_P32 },
+};
+
+static volatile uint8_t sink;
+
+/**
+ * Convert between two sample formats, or pass the data through if
+ * they are equal.
+ */
+class Converter {
+	PcmFormatConverter converter;
+	bool active;
+
+public:
+	Converter(SampleFormat src_format, SampleFormat dest_format)
+		:active(src_format != dest_format) {
+		Error error;
+		if (active && !converter.Open(src_format, dest_format,
+						  CHANNELS, error)) {
+			fprintf(stderr, "%s\n", error.GetMessage());
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	~Converter() {
+		if (active)
+			converter.Close();
+	}
+
+	ConstBuffer<void> Convert(ConstBuffer<void> src) {
+		if (!active)
+			return src;
+
+		Error error;
+		return converter.Convert(src, error);
+	}
+};
+
+/**
+ * The replay gain and software volume stages of an output.
+ */
+class OutputStage {
+	PcmVolume replay_gain, volume;
+	Converter convert;
+
+public:
+	OutputStage(SampleFormat pipe_format, SampleFormat device_format)
+		:convert(pipe_format, device_format) {
+		Error error;
+		replay_gain.Open(pipe_format, CHANNELS, error);
+		volume.Open(pipe_format, CHANNELS, error);
+
+		replay_gain.SetVolume(pcm_float_to_volume(0.71));
+		volume.SetVolume(pcm_float_to_volume(0.5));
+	}
+
+	~OutputStage() {
+		replay_gain.Close();
+		volume.Close();
+	}
+
+	ConstBuffer<void> Apply(ConstBuffer<void> src) {
+		return convert.Convert(volume.Apply(replay_gain.Apply(src)));
+	}
+};
+
+/**
+ * Fill the buffer with valid random samples of the given format.
+ */
+static ConstBuffer<void>
+Generate(SampleFormat format, void *p)
+{
+	const size_t size = BLOCK_SAMPLES * sample_format_size(format);
+
+	switch (format) {
+	case SampleFormat::S24_P32:
+		for (size_t i = 0; i < BLOCK_SAMPLES; ++i)
+			((int32_t *)p)[i] = (rand() & 0xffffff) - 0x800000;
+		break;
+
+	case SampleFormat::FLOAT:
+		for (size_t i = 0; i < BLOCK_SAMPLES; ++i)
+			((float *)p)[i] = float(rand()) / RAND_MAX * 2 - 1;
+		break;
+
+	default:
+		for (size_t i = 0; i < size; ++i)
+			((uint8_t *)p)[i] = rand();
+		break;
+	}
+
+	return { p, size };
+}
+
+struct Result {
+	double decoder, output;
+};
+
+/**
+ * Run the decoder and the output stage for the specified duration,
+ * and return the CPU seconds per hour of each.
+ */
+static Result
+Run(SampleFormat decoder_format, SampleFormat pipe_format,
+    SampleFormat device_format, unsigned seconds)
+{
+	static uint32_t src_buffer[BLOCK_SAMPLES];
+	const auto src = Generate(decoder_format, src_buffer);
+
+	Converter decoder(decoder_format, pipe_format);
+	OutputStage output(pipe_format, device_format);
+
+	const unsigned n = SAMPLE_RATE * seconds / BLOCK_FRAMES;
+	clock_t decoder_cpu = 0, output_cpu = 0;
+	uint8_t sum = 0;
+
+	for (unsigned i = 0; i < n; ++i) {
+		const clock_t start = clock();
+		const auto pipe = decoder.Convert(src);
+		const clock_t middle = clock();
+		const auto device = output.Apply(pipe);
+		const clock_t end = clock();
+
+		sum ^= *(const uint8_t *)device.data;
+		decoder_cpu += middle - start;
+		output_cpu += end - middle;
+	}
+
+	sink ^= sum;
+
+	const double factor = 3600. / (double(CLOCKS_PER_SEC) * seconds);
+	return { decoder_cpu * factor, output_cpu * factor };
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 2) {
+		fprintf(stderr, "Usage: bench_pipeline [SECONDS]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned seconds = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: 3600;
+
+	pcm_volume_global_init(true);
+
+	printf("%-6s %-6s %10s %10s %10s %10s\n", "from", "to",
+	       "int dec", "int out", "float dec", "float out");
+
+	for (const auto &p : pairs) {
+		const auto integer = Run(p.decoder, p.decoder, p.device,
+					 seconds);
+		const auto floating = Run(p.decoder, SampleFormat::FLOAT,
+					  p.device, seconds);
+
+		printf("%-6s %-6s %10.3f %10.3f %10.3f %10.3f\n",
+		       sample_format_to_string(p.decoder),
+		       sample_format_to_string(p.device),
+		       integer.decoder, integer.output,
+		       floating.decoder, floating.output);
+	}
+
+	return EXIT_SUCCESS;
+}
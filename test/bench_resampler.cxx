@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the CPU cost of the built-in sinc resampler
+ * (pcm/SincResampler.cxx) for each quality preset and some common
+ * sample rate pairs, with the portable and with the SIMD kernels.
+ * The result is in CPU seconds per hour of stereo audio.
+ *
+ */
+
+#include "config.h"
+#include "pcm/SincResampler.hxx"
+#include "AudioFormat.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/CpuFeatures.hxx"
+#include "util/Error.hxx"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static constexpr unsigned CHANNELS = 2;
+
+/**
+ * The number of frames per call, like a typical #music_chunk.
+ */
+static constexpr unsigned BLOCK_FRAMES = 1024;
+
+static constexpr struct {
+	SincQuality quality;
+	const char *name;
+} qualities[] = {
+	{ SincQuality::LOW, "low" },
+	{ SincQuality::MEDIUM, "medium" },
+	{ SincQuality::HIGH, "high" },
+	{ SincQuality::VERY_HIGH, "very high" },
+};
+
+static constexpr struct {
+	unsigned in_rate, out_rate;
+} ratios[] = {
+	{ 44100, 48000 },
+	{ 48000, 44100 },
+	{ 44100, 96000 },
+	{ 96000, 48000 },
+	{ 44100, 44101 },
+};
+
+static float src[BLOCK_FRAMES * CHANNELS];
+
+static volatile float sink;
+
+/**
+ * Resample the specified duration of audio, and return the CPU
+ * seconds per hour.
+ */
+static double
+Run(SincQuality quality, unsigned in_rate, unsigned out_rate,
+    unsigned cpu_features, unsigned seconds)
+{
+	SetCpuFeatureMask(cpu_features);
+
+	SincPcmResampler resampler(quality);
+	AudioFormat af(in_rate, SampleFormat::FLOAT, CHANNELS);
+	Error error;
+	if (!resampler.Open(af, out_rate, error).IsValid()) {
+		fprintf(stderr, "%s\n", error.GetMessage());
+		exit(EXIT_FAILURE);
+	}
+
+	const ConstBuffer<void> in(src, sizeof(src));
+	const uint64_t total = uint64_t(in_rate) * seconds;
+
+	const clock_t start = clock();
+	for (uint64_t i = 0; i < total; i += BLOCK_FRAMES) {
+		const auto out =
+			ConstBuffer<float>::FromVoid(resampler.Resample(in,
+									error));
+		if (out.size > 0)
+			sink = out.data[0];
+	}
+	const clock_t cpu = clock() - start;
+
+	resampler.Close();
+
+	return double(cpu) / CLOCKS_PER_SEC * 3600 / seconds;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 2) {
+		fprintf(stderr, "Usage: bench_resampler [SECONDS]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned seconds = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: 600;
+
+	for (auto &i : src)
+		i = rand() / float(RAND_MAX) - 0.5f;
+
+	printf("%-10s %-14s %10s %10s\n", "quality", "rates",
+	       "generic", "simd");
+
+	for (const auto &q : qualities) {
+		for (const auto &r : ratios) {
+			char rates[32];
+			snprintf(rates, sizeof(rates), "%u:%u",
+				 r.in_rate, r.out_rate);
+
+			printf("%-10s %-14s %10.2f %10.2f\n", q.name, rates,
+			       Run(q.quality, r.in_rate, r.out_rate,
+				   0, seconds),
+			       Run(q.quality, r.in_rate, r.out_rate,
+				   ~0u, seconds));
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
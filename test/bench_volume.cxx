@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the throughput of MPD's software volume
+ * (pcm/Volume.cxx) for each sample format, with and without
+ * dithering, using the portable and the SIMD kernels.
+ *
+ */
+
+#include "config.h"
+#include "pcm/Volume.hxx"
+#include "AudioFormat.hxx"
+#include "system/Clock.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/CpuFeatures.hxx"
+#include "util/Error.hxx"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr SampleFormat formats[] = {
+	SampleFormat::S8,
+	SampleFormat::S16,
+	SampleFormat::S24_P32,
+	SampleFormat::S32,
+	SampleFormat::FLOAT,
+};
+
+static volatile uint8_t sink;
+
+/**
+ * The size of each Apply() call, like a typical #music_chunk.
+ */
+static constexpr size_t BLOCK_SIZE = 4096;
+
+/**
+ * Apply the volume to the specified number of bytes, and return the
+ * throughput in MB/s.
+ */
+static double
+Run(SampleFormat format, bool dither, unsigned cpu_features,
+    size_t total, const void *src)
+{
+	SetCpuFeatureMask(cpu_features);
+
+	PcmVolume pv;
+	if (!pv.Open(format, 2, IgnoreError()))
+		abort();
+
+	pv.SetDither(dither);
+	pv.SetVolume(PCM_VOLUME_1 / 3);
+
+	/* PcmVolume::Apply() is declared "pure"; consume its result
+	   so the compiler doesn't optimize the calls away */
+	uint8_t sum = 0;
+
+	const uint64_t start = MonotonicClockUS();
+	for (size_t i = 0; i < total; i += BLOCK_SIZE) {
+		const auto dest = pv.Apply({src, BLOCK_SIZE});
+		sum ^= ((const uint8_t *)dest.data)[i % dest.size];
+	}
+	const uint64_t us = MonotonicClockUS() - start;
+
+	sink ^= sum;
+
+	pv.Close();
+	return us > 0 ? double(total) / us : 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 2) {
+		fprintf(stderr, "Usage: bench_volume [MEGABYTES]\n");
+		return EXIT_FAILURE;
+	}
+
+	const size_t total = (argc > 1
+			      ? strtoul(argv[1], nullptr, 10)
+			      : 1024) << 20;
+
+	static uint8_t src[BLOCK_SIZE];
+	for (size_t i = 0; i < sizeof(src); ++i)
+		src[i] = rand();
+
+	printf("%-8s %12s %12s %12s %12s\n",
+	       "format", "dither", "dither simd", "round", "round simd");
+
+	for (SampleFormat format : formats) {
+		printf("%-8s %12.1f %12.1f %12.1f %12.1f\n",
+		       sample_format_to_string(format),
+		       Run(format, true, 0, total, src),
+		       Run(format, true, ~0u, total, src),
+		       Run(format, false, 0, total, src),
+		       Run(format, false, ~0u, total, src));
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -27,6 +27,8 @@
 #include "AudioFormat.hxx"
 #include "util/Error.hxx"
 #include "thread/Cond.hxx"
+#include "system/Clock.hxx"
+#include "MusicChunk.hxx"
 #include "Log.hxx"
 #include "stdbin.h"
 
@@ -45,6 +47,23 @@ struct Decoder {
 	const struct DecoderPlugin *plugin;
 
 	bool initialized;
+
+	/**
+	 * The number of bytes submitted with decoder_data(), which
+	 * MPD copies into the music pipe.
+	 */
+	uint64_t copied_bytes;
+
+	/**
+	 * The number of bytes submitted with decoder_write_end(),
+	 * which the plugin has decoded into the music pipe directly.
+	 */
+	uint64_t direct_bytes;
+
+	/**
+	 * Emulates the free space of a music pipe chunk.
+	 */
+	uint8_t write_buffer[DEFAULT_CHUNK_SIZE];
 };
 
 void
@@ -136,15 +155,36 @@ decoder_timestamp(gcc_unused Decoder &decoder,
 }
 
 DecoderCommand
-decoder_data(gcc_unused Decoder &decoder,
+decoder_data(Decoder &decoder,
 	     gcc_unused InputStream *is,
 	     const void *data, size_t datalen,
 	     gcc_unused uint16_t kbit_rate)
 {
+	decoder.copied_bytes += datalen;
+
 	gcc_unused ssize_t nbytes = write(1, data, datalen);
 	return DecoderCommand::NONE;
 }
 
+DecoderCommand
+decoder_write_begin(Decoder &decoder,
+		    gcc_unused InputStream *is,
+		    WritableBuffer<void> &buffer)
+{
+	buffer = { decoder.write_buffer, sizeof(decoder.write_buffer) };
+	return DecoderCommand::NONE;
+}
+
+DecoderCommand
+decoder_write_end(Decoder &decoder, size_t length,
+		  gcc_unused uint16_t kbit_rate)
+{
+	decoder.direct_bytes += length;
+
+	gcc_unused ssize_t nbytes = write(1, decoder.write_buffer, length);
+	return DecoderCommand::NONE;
+}
+
 DecoderCommand
 decoder_tag(gcc_unused Decoder &decoder,
 	    gcc_unused InputStream *is,
@@ -210,6 +250,9 @@ int main(int argc, char **argv)
 	}
 
 	decoder.initialized = false;
+	decoder.copied_bytes = decoder.direct_bytes = 0;
+
+	const uint64_t start = MonotonicClockUS();
 
 	if (decoder.plugin->file_decode != NULL) {
 		decoder.plugin->FileDecode(decoder, Path::FromFS(decoder.uri));
@@ -245,5 +288,16 @@ int main(int argc, char **argv)
 		return EXIT_FAILURE;
 	}
 
+	/* the bytes which were written directly would have been
+	   copied one more time with decoder_data() */
+	const uint64_t us = MonotonicClockUS() - start;
+	fprintf(stderr, "decoded %llu bytes in %.3fs, %llu bytes copied, "
+		"%llu bytes without a copy\n",
+		(unsigned long long)(decoder.copied_bytes +
+				     decoder.direct_bytes),
+		us / 1e6,
+		(unsigned long long)decoder.copied_bytes,
+		(unsigned long long)decoder.direct_bytes);
+
 	return 0;
 }
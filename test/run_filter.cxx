@@ -23,8 +23,12 @@
 #include "fs/Path.hxx"
 #include "AudioParser.hxx"
 #include "AudioFormat.hxx"
-#include "filter/FilterPlugin.hxx"
+#include "filter/FilterConfig.hxx"
 #include "filter/FilterInternal.hxx"
+#include "filter/FilterPlugin.hxx"
+#include "filter/FilterRegistry.hxx"
+#include "filter/plugins/ChainFilterPlugin.hxx"
+#include "filter/plugins/VolumeFilterPlugin.hxx"
 #include "pcm/Volume.hxx"
 #include "mixer/MixerControl.hxx"
 #include "stdbin.h"
@@ -36,8 +40,12 @@
 #include <glib.h>
 #endif
 
+#include <vector>
+#include <algorithm>
+
 #include <assert.h>
 #include <string.h>
+#include <time.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
@@ -51,23 +59,94 @@ mixer_set_volume(gcc_unused Mixer *mixer,
 }
 
 static Filter *
-load_filter(const char *name)
+load_filter(const char *names)
 {
-	const config_param *param =
-		config_find_block(CONF_AUDIO_FILTER, "name", name);
-	if (param == NULL) {
-		fprintf(stderr, "No such configured filter: %s\n", name);
+	Filter *chain = filter_chain_new();
+
+	Error error;
+	if (!filter_chain_parse(*chain, names, error)) {
+		LogError(error, "Failed to load filter");
+		delete chain;
 		return nullptr;
 	}
 
+	return chain;
+}
+
+/**
+ * Filter the whole input in chunks of the size MPD uses, and return
+ * the CPU time it took.
+ */
+static double
+benchmark_filter(Filter &filter, const AudioFormat &audio_format,
+		 const std::vector<char> &input, unsigned repeat)
+{
+	const size_t frame_size = audio_format.GetFrameSize();
+	const size_t chunk_size = 4096 - 4096 % frame_size;
+
+	AudioFormat in_audio_format = audio_format;
 	Error error;
-	Filter *filter = filter_configured_new(*param, error);
-	if (filter == NULL) {
-		LogError(error, "Failed to load filter");
-		return NULL;
+	if (!filter.Open(in_audio_format, error).IsDefined())
+		FatalError(error);
+
+	const clock_t start = clock();
+
+	for (unsigned r = 0; r < repeat; ++r) {
+		for (size_t i = 0; i + frame_size <= input.size();
+		     i += chunk_size) {
+			const size_t size = std::min(chunk_size,
+						     input.size() - i);
+			size_t length;
+			if (filter.FilterPCM(&input[i], size, &length,
+					     error) == nullptr)
+				FatalError(error);
+		}
 	}
 
-	return filter;
+	const clock_t end = clock();
+	filter.Close();
+
+	return double(end - start) / CLOCKS_PER_SEC;
+}
+
+/**
+ * Compare the CPU time of the filter with and without fusing
+ * per-sample operations.  Like an output with a software mixer, a
+ * "volume" and a "convert" filter are appended to the chain.
+ */
+static void
+benchmark(Filter &filter, const AudioFormat &audio_format)
+{
+	Filter *volume_filter = filter_new(&volume_filter_plugin,
+					   config_param(), IgnoreError());
+	volume_filter_set(volume_filter, PCM_VOLUME_1 / 2);
+	filter_chain_append(filter, "software_mixer", volume_filter);
+	filter_chain_append(filter, "convert",
+			    filter_new(&convert_filter_plugin, config_param(),
+				       IgnoreError()));
+
+	std::vector<char> input;
+	char buffer[4096];
+	ssize_t nbytes;
+	while ((nbytes = read(0, buffer, sizeof(buffer))) > 0)
+		input.insert(input.end(), buffer, buffer + nbytes);
+
+	static constexpr unsigned REPEAT = 16;
+	const double seconds = double(input.size()) /
+		(audio_format.GetFrameSize() * audio_format.sample_rate);
+
+	filter_chain_global_init(false);
+	const double unfused = benchmark_filter(filter, audio_format,
+						input, REPEAT);
+
+	filter_chain_global_init(true);
+	const double fused = benchmark_filter(filter, audio_format,
+					      input, REPEAT);
+
+	printf("unfused: %.3f CPU seconds per hour\n",
+	       unfused * 3600 / (seconds * REPEAT));
+	printf("fused: %.3f CPU seconds per hour\n",
+	       fused * 3600 / (seconds * REPEAT));
 }
 
 int main(int argc, char **argv)
@@ -76,8 +155,15 @@ int main(int argc, char **argv)
 	Error error2;
 	char buffer[4096];
 
+	const bool benchmark_mode = argc > 1 &&
+		strcmp(argv[1], "--benchmark") == 0;
+	if (benchmark_mode) {
+		--argc;
+		++argv;
+	}
+
 	if (argc < 3 || argc > 4) {
-		fprintf(stderr, "Usage: run_filter CONFIG NAME [FORMAT] <IN\n");
+		fprintf(stderr, "Usage: run_filter [--benchmark] CONFIG NAME[,NAME...] [FORMAT] <IN\n");
 		return EXIT_FAILURE;
 	}
 
@@ -115,6 +201,13 @@ int main(int argc, char **argv)
 	if (filter == NULL)
 		return EXIT_FAILURE;
 
+	if (benchmark_mode) {
+		benchmark(*filter, audio_format);
+		delete filter;
+		config_global_finish();
+		return EXIT_SUCCESS;
+	}
+
 	/* open the filter */
 
 	Error error;
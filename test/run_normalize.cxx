@@ -18,31 +18,79 @@
  */
 
 /*
- * This program is a command line interface to MPD's normalize library
- * (based on AudioCompress).
+ * This program is a command line interface to MPD's loudness
+ * normalizer (pcm/PcmLimiter.cxx).  With --benchmark, it measures the
+ * CPU time instead of writing the output.
  *
  */
 
 #include "config.h"
-#include "AudioCompress/compress.h"
+#include "pcm/PcmLimiter.hxx"
 #include "AudioParser.hxx"
 #include "AudioFormat.hxx"
+#include "util/ConstBuffer.hxx"
 #include "util/Error.hxx"
 #include "stdbin.h"
 
+#include <algorithm>
+#include <vector>
+
 #include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
 
-int main(int argc, char **argv)
+/**
+ * Normalize the whole input in chunks of the size MPD uses, and
+ * print the CPU time it took.
+ */
+static void
+benchmark(PcmLimiter &limiter, const AudioFormat &audio_format)
 {
-	struct Compressor *compressor;
-	static char buffer[4096];
+	std::vector<char> input;
+	char buffer[4096];
 	ssize_t nbytes;
+	while ((nbytes = read(0, buffer, sizeof(buffer))) > 0)
+		input.insert(input.end(), buffer, buffer + nbytes);
+
+	const size_t frame_size = audio_format.GetFrameSize();
+	const size_t chunk_size = 4096 - 4096 % frame_size;
+	input.resize(input.size() - input.size() % frame_size);
+
+	static constexpr unsigned REPEAT = 16;
+	const double seconds = double(input.size()) /
+		(frame_size * audio_format.sample_rate);
+
+	const clock_t start = clock();
+
+	for (unsigned r = 0; r < REPEAT; ++r) {
+		for (size_t i = 0; i < input.size(); i += chunk_size) {
+			const size_t size = std::min(chunk_size,
+						     input.size() - i);
+			limiter.Apply({&input[i], size});
+		}
+	}
+
+	const double cpu = double(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("%.3f CPU seconds per hour\n",
+	       cpu * 3600 / (seconds * REPEAT));
+}
+
+int main(int argc, char **argv)
+{
+	const bool benchmark_mode = argc > 1 &&
+		strcmp(argv[1], "--benchmark") == 0;
+	if (benchmark_mode) {
+		++argv;
+		--argc;
+	}
 
 	if (argc > 2) {
-		fprintf(stderr, "Usage: run_normalize [FORMAT] <IN >OUT\n");
+		fprintf(stderr,
+			"Usage: run_normalize [--benchmark] [FORMAT] <IN >OUT\n");
 		return 1;
 	}
 
@@ -56,14 +104,39 @@ int main(int argc, char **argv)
 		}
 	}
 
-	compressor = Compressor_new(0);
+	PcmLimiter limiter;
+
+	Error error;
+	if (!limiter.Open(audio_format.format, audio_format.channels,
+			  audio_format.sample_rate, error)) {
+		fprintf(stderr, "%s\n", error.GetMessage());
+		return 1;
+	}
+
+	if (benchmark_mode) {
+		benchmark(limiter, audio_format);
+		limiter.Close();
+		return 0;
+	}
+
+	const size_t frame_size = audio_format.GetFrameSize();
+	static char buffer[4096];
+	size_t length = 0;
+	ssize_t nbytes;
+
+	while ((nbytes = read(0, buffer + length,
+			      sizeof(buffer) - length)) > 0) {
+		length += nbytes;
+
+		/* only whole frames */
+		const size_t size = length - length % frame_size;
+		const auto dest = limiter.Apply({buffer, size});
 
-	while ((nbytes = read(0, buffer, sizeof(buffer))) > 0) {
-		Compressor_Process_int16(compressor,
-					 (int16_t *)buffer, nbytes / 2);
+		gcc_unused ssize_t ignored = write(1, dest.data, dest.size);
 
-		gcc_unused ssize_t ignored = write(1, buffer, nbytes);
+		length -= size;
+		memmove(buffer, buffer + size, length);
 	}
 
-	Compressor_delete(compressor);
+	limiter.Close();
 }
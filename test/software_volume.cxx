@@ -57,7 +57,7 @@ int main(int argc, char **argv)
 	}
 
 	PcmVolume pv;
-	if (!pv.Open(audio_format.format, error)) {
+	if (!pv.Open(audio_format.format, audio_format.channels, error)) {
 		fprintf(stderr, "%s\n", error.GetMessage());
 		return EXIT_FAILURE;
 	}
@@ -18,7 +18,9 @@
  */
 
 #include "util/ByteReverse.hxx"
+#include "util/CpuFeatures.hxx"
 #include "util/Macros.hxx"
+#include "system/ByteOrder.hxx"
 #include "Compiler.h"
 
 #include <cppunit/TestFixture.h>
@@ -35,6 +37,9 @@ class ByteReverseTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(TestByteReverse3);
 	CPPUNIT_TEST(TestByteReverse4);
 	CPPUNIT_TEST(TestByteReverse5);
+	CPPUNIT_TEST(TestByteReverse16Simd);
+	CPPUNIT_TEST(TestByteReverse32Simd);
+	CPPUNIT_TEST(TestByteReverse64Simd);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -42,6 +47,9 @@ public:
 	void TestByteReverse3();
 	void TestByteReverse4();
 	void TestByteReverse5();
+	void TestByteReverse16Simd();
+	void TestByteReverse32Simd();
+	void TestByteReverse64Simd();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(ByteReverseTest);
@@ -94,6 +102,55 @@ ByteReverseTest::TestByteReverse5()
 	CPPUNIT_ASSERT(strcmp(result, (const char *)dest) == 0);
 }
 
+/**
+ * Compare the portable and the SIMD kernels with ByteSwap*(), both
+ * with separate buffers and in-place.
+ */
+template<typename T, T (*swap)(T),
+	 void (*reverse)(T *dest, const T *src, const T *src_end)>
+static void
+TestByteReverseSimd()
+{
+	/* an odd size to cover the kernels' tail loops */
+	constexpr size_t N = 1021;
+
+	T src[N], expected[N];
+	for (size_t i = 0; i < N; ++i) {
+		src[i] = T(random()) * T(0x0123456789abcdefULL);
+		expected[i] = swap(src[i]);
+	}
+
+	for (unsigned mask : { 0u, ~0u }) {
+		SetCpuFeatureMask(mask);
+
+		T dest[N];
+		reverse(dest, src, src + N);
+		CPPUNIT_ASSERT(memcmp(expected, dest, sizeof(dest)) == 0);
+
+		memcpy(dest, src, sizeof(dest));
+		reverse(dest, dest, dest + N);
+		CPPUNIT_ASSERT(memcmp(expected, dest, sizeof(dest)) == 0);
+	}
+}
+
+void
+ByteReverseTest::TestByteReverse16Simd()
+{
+	TestByteReverseSimd<uint16_t, ByteSwap16, reverse_bytes_16>();
+}
+
+void
+ByteReverseTest::TestByteReverse32Simd()
+{
+	TestByteReverseSimd<uint32_t, ByteSwap32, reverse_bytes_32>();
+}
+
+void
+ByteReverseTest::TestByteReverse64Simd()
+{
+	TestByteReverseSimd<uint64_t, ByteSwap64, reverse_bytes_64>();
+}
+
 int
 main(gcc_unused int argc, gcc_unused char **argv)
 {
@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "decoder/DecoderCache.hxx"
+#include "Compiler.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+
+static constexpr AudioFormat test_format(44100, SampleFormat::S16, 2);
+
+/**
+ * Record a ramp of the given duration, starting with the given value.
+ */
+static DecoderCacheEntry *
+Record(const char *uri, uint16_t value, unsigned seconds=1,
+       time_t mtime=0)
+{
+	DecoderCacheEntry *entry = decoder_cache_begin(uri, mtime, 0, 0);
+	CPPUNIT_ASSERT(entry != nullptr);
+	entry->SetAudioFormat(test_format);
+
+	uint16_t buffer[2 * 441];
+	for (unsigned i = 0; i < seconds * 100; ++i) {
+		for (auto &sample : buffer)
+			sample = value++;
+
+		if (!entry->Append(buffer, sizeof(buffer))) {
+			decoder_cache_discard(entry);
+			return nullptr;
+		}
+	}
+
+	return entry;
+}
+
+class DecoderCacheTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(DecoderCacheTest);
+	CPPUNIT_TEST(TestDisabled);
+	CPPUNIT_TEST(TestRead);
+	CPPUNIT_TEST(TestTimeToOffset);
+	CPPUNIT_TEST(TestTooLarge);
+	CPPUNIT_TEST(TestEvict);
+	CPPUNIT_TEST(TestModified);
+	CPPUNIT_TEST(TestRecordingSize);
+	CPPUNIT_TEST(TestEvictedSize);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void tearDown() {
+		decoder_cache_global_finish();
+	}
+
+	void TestDisabled();
+	void TestRead();
+	void TestTimeToOffset();
+	void TestTooLarge();
+	void TestEvict();
+	void TestModified();
+	void TestRecordingSize();
+	void TestEvictedSize();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DecoderCacheTest);
+
+void
+DecoderCacheTest::TestDisabled()
+{
+	decoder_cache_init(0);
+	CPPUNIT_ASSERT(!decoder_cache_is_enabled());
+	CPPUNIT_ASSERT(decoder_cache_begin("a", 0, 0, 0) == nullptr);
+	CPPUNIT_ASSERT(decoder_cache_lookup("a", 0, 0, 0) == nullptr);
+	CPPUNIT_ASSERT_EQUAL(0ul, decoder_cache_get_stats().misses);
+}
+
+void
+DecoderCacheTest::TestRead()
+{
+	decoder_cache_init(16 * 1024 * 1024);
+
+	CPPUNIT_ASSERT(decoder_cache_lookup("a", 0, 0, 0) == nullptr);
+	decoder_cache_store(Record("a", 0, 2));
+
+	/* a different range of the same file is a different song */
+	CPPUNIT_ASSERT(decoder_cache_lookup("a", 0, 1000, 0) == nullptr);
+
+	DecoderCacheEntry *entry = decoder_cache_lookup("a", 0, 0, 0);
+	CPPUNIT_ASSERT(entry != nullptr);
+	CPPUNIT_ASSERT_EQUAL(size_t(2 * test_format.GetTimeToSize()),
+			     entry->GetSize());
+
+	/* the data must be read back exactly, across block
+	   boundaries */
+	uint16_t expected = 0;
+	size_t offset = 0;
+	while (true) {
+		const auto src = entry->Read(offset);
+		if (src.IsEmpty())
+			break;
+
+		CPPUNIT_ASSERT(src.size % test_format.GetFrameSize() == 0);
+
+		const uint16_t *p = (const uint16_t *)src.data;
+		for (size_t i = 0; i < src.size / sizeof(*p); ++i)
+			CPPUNIT_ASSERT_EQUAL(expected++, p[i]);
+
+		offset += src.size;
+	}
+
+	CPPUNIT_ASSERT_EQUAL(entry->GetSize(), offset);
+	decoder_cache_release(*entry);
+
+	const DecoderCacheStats stats = decoder_cache_get_stats();
+	CPPUNIT_ASSERT_EQUAL(1ul, stats.hits);
+	CPPUNIT_ASSERT_EQUAL(2ul, stats.misses);
+	CPPUNIT_ASSERT_EQUAL(1u, stats.n_entries);
+}
+
+void
+DecoderCacheTest::TestTimeToOffset()
+{
+	DecoderCacheEntry entry("a", 0, 2000, 0);
+	entry.SetAudioFormat(test_format);
+
+	CPPUNIT_ASSERT_EQUAL(uint64_t(0), entry.TimeToOffset(0));
+	CPPUNIT_ASSERT_EQUAL(uint64_t(0), entry.TimeToOffset(2));
+	CPPUNIT_ASSERT_EQUAL(uint64_t(test_format.GetTimeToSize()),
+			     entry.TimeToOffset(3));
+	CPPUNIT_ASSERT_EQUAL(uint64_t(test_format.GetTimeToSize() / 2),
+			     entry.TimeToOffset(2.5));
+}
+
+void
+DecoderCacheTest::TestTooLarge()
+{
+	decoder_cache_init(64 * 1024);
+
+	/* one second doesn't fit into 64 kB */
+	CPPUNIT_ASSERT(Record("a", 0) == nullptr);
+}
+
+void
+DecoderCacheTest::TestEvict()
+{
+	/* room for two songs (one 256 kB block each) */
+	decoder_cache_init(2 * 256 * 1024);
+
+	decoder_cache_store(Record("a", 0));
+	decoder_cache_store(Record("b", 0));
+	CPPUNIT_ASSERT_EQUAL(2u, decoder_cache_get_stats().n_entries);
+
+	/* "a" is being played, which makes it the most recently
+	   used one */
+	DecoderCacheEntry *a = decoder_cache_lookup("a", 0, 0, 0);
+	CPPUNIT_ASSERT(a != nullptr);
+
+	decoder_cache_store(Record("c", 0));
+	CPPUNIT_ASSERT_EQUAL(2u, decoder_cache_get_stats().n_entries);
+
+	/* "b" was the least recently used one */
+	CPPUNIT_ASSERT(decoder_cache_lookup("b", 0, 0, 0) == nullptr);
+
+	DecoderCacheEntry *c = decoder_cache_lookup("c", 0, 0, 0);
+	CPPUNIT_ASSERT(c != nullptr);
+	decoder_cache_release(*c);
+
+	/* "a" is the least recently used one, but it is skipped,
+	   because it is still being played and evicting it would
+	   not free any memory */
+	decoder_cache_store(Record("d", 0));
+	CPPUNIT_ASSERT(decoder_cache_lookup("c", 0, 0, 0) == nullptr);
+	CPPUNIT_ASSERT_EQUAL(size_t(2 * 256 * 1024),
+			     decoder_cache_get_stats().size);
+
+	decoder_cache_release(*a);
+	a = decoder_cache_lookup("a", 0, 0, 0);
+	CPPUNIT_ASSERT(a != nullptr);
+	decoder_cache_release(*a);
+}
+
+void
+DecoderCacheTest::TestModified()
+{
+	decoder_cache_init(16 * 1024 * 1024);
+
+	decoder_cache_store(Record("a", 0, 1, 1));
+	DecoderCacheEntry *old = decoder_cache_lookup("a", 1, 0, 0);
+	CPPUNIT_ASSERT(old != nullptr);
+
+	/* the file has been modified: the old entry is stale and
+	   gets evicted */
+	CPPUNIT_ASSERT(decoder_cache_lookup("a", 2, 0, 0) == nullptr);
+	CPPUNIT_ASSERT_EQUAL(0u, decoder_cache_get_stats().n_entries);
+	CPPUNIT_ASSERT(decoder_cache_lookup("a", 1, 0, 0) == nullptr);
+
+	/* the stale entry remains readable until it is released */
+	CPPUNIT_ASSERT_EQUAL(size_t(test_format.GetTimeToSize()),
+			     old->GetSize());
+	decoder_cache_release(*old);
+
+	/* the new version replaces it */
+	decoder_cache_store(Record("a", 1000, 1, 2));
+	CPPUNIT_ASSERT_EQUAL(1u, decoder_cache_get_stats().n_entries);
+
+	DecoderCacheEntry *entry = decoder_cache_lookup("a", 2, 0, 0);
+	CPPUNIT_ASSERT(entry != nullptr);
+	CPPUNIT_ASSERT_EQUAL(uint16_t(1000),
+			     *(const uint16_t *)entry->Read(0).data);
+	decoder_cache_release(*entry);
+
+	/* a recording of the old version that finishes late must not
+	   replace the new one */
+	decoder_cache_store(Record("a", 0, 1, 1));
+	CPPUNIT_ASSERT_EQUAL(1u, decoder_cache_get_stats().n_entries);
+	entry = decoder_cache_lookup("a", 2, 0, 0);
+	CPPUNIT_ASSERT(entry != nullptr);
+	decoder_cache_release(*entry);
+}
+
+void
+DecoderCacheTest::TestRecordingSize()
+{
+	/* room for two songs (one 256 kB block each) */
+	decoder_cache_init(2 * 256 * 1024);
+
+	decoder_cache_store(Record("a", 0));
+
+	/* two decoders are recording at the same time (look-ahead,
+	   or another partition); the second one evicts "a" */
+	DecoderCacheEntry *b = Record("b", 0);
+	CPPUNIT_ASSERT(b != nullptr);
+	DecoderCacheEntry *c = Record("c", 0);
+	CPPUNIT_ASSERT(c != nullptr);
+	CPPUNIT_ASSERT_EQUAL(0u, decoder_cache_get_stats().n_entries);
+	CPPUNIT_ASSERT_EQUAL(size_t(2 * 256 * 1024),
+			     decoder_cache_get_stats().size);
+
+	/* a third recording does not fit */
+	CPPUNIT_ASSERT(Record("d", 0) == nullptr);
+	CPPUNIT_ASSERT_EQUAL(size_t(2 * 256 * 1024),
+			     decoder_cache_get_stats().size);
+
+	/* discarding a recording makes room again */
+	decoder_cache_discard(b);
+	decoder_cache_store(c);
+	decoder_cache_store(Record("d", 0));
+	CPPUNIT_ASSERT_EQUAL(2u, decoder_cache_get_stats().n_entries);
+	CPPUNIT_ASSERT_EQUAL(size_t(2 * 256 * 1024),
+			     decoder_cache_get_stats().size);
+}
+
+void
+DecoderCacheTest::TestEvictedSize()
+{
+	/* room for two songs (one 256 kB block each) */
+	decoder_cache_init(2 * 256 * 1024);
+
+	decoder_cache_store(Record("a", 0, 1, 1));
+	DecoderCacheEntry *a = decoder_cache_lookup("a", 1, 0, 0);
+	CPPUNIT_ASSERT(a != nullptr);
+
+	/* "a" is stale, but it is still being played: its memory
+	   stays in use */
+	CPPUNIT_ASSERT(decoder_cache_lookup("a", 2, 0, 0) == nullptr);
+	CPPUNIT_ASSERT_EQUAL(0u, decoder_cache_get_stats().n_entries);
+	CPPUNIT_ASSERT_EQUAL(size_t(256 * 1024),
+			     decoder_cache_get_stats().size);
+
+	DecoderCacheEntry *b = Record("b", 0);
+	CPPUNIT_ASSERT(b != nullptr);
+	CPPUNIT_ASSERT(Record("c", 0) == nullptr);
+
+	/* an entry which is being played is not evicted for a
+	   recording either, because that would not free memory */
+	decoder_cache_store(b);
+	b = decoder_cache_lookup("b", 0, 0, 0);
+	CPPUNIT_ASSERT(b != nullptr);
+	CPPUNIT_ASSERT(Record("c", 0) == nullptr);
+	CPPUNIT_ASSERT_EQUAL(1u, decoder_cache_get_stats().n_entries);
+
+	decoder_cache_release(*a);
+	CPPUNIT_ASSERT_EQUAL(size_t(256 * 1024),
+			     decoder_cache_get_stats().size);
+
+	decoder_cache_store(Record("c", 0));
+	CPPUNIT_ASSERT_EQUAL(2u, decoder_cache_get_stats().n_entries);
+	decoder_cache_release(*b);
+}
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,410 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "filter/FilterPlugin.hxx"
+#include "filter/FilterInternal.hxx"
+#include "filter/FilterRegistry.hxx"
+#include "filter/plugins/ChainFilterPlugin.hxx"
+#include "filter/plugins/VolumeFilterPlugin.hxx"
+#include "config/ConfigData.hxx"
+#include "mixer/MixerControl.hxx"
+#include "pcm/Volume.hxx"
+#include "pcm/PcmArena.hxx"
+#include "pcm/Traits.hxx"
+#include "AudioFormat.hxx"
+#include "util/Error.hxx"
+#include "Compiler.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include "test_pcm_util.hxx"
+
+#include <algorithm>
+
+#include <stdlib.h>
+
+class FilterChainTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(FilterChainTest);
+	CPPUNIT_TEST(TestRouteVolume8);
+	CPPUNIT_TEST(TestRouteVolume16);
+	CPPUNIT_TEST(TestRouteVolume24);
+	CPPUNIT_TEST(TestRouteVolume32);
+	CPPUNIT_TEST(TestRouteVolumeFloat);
+	CPPUNIT_TEST(TestRouteVolumeNoDither);
+	CPPUNIT_TEST(TestVolumeVolume);
+	CPPUNIT_TEST(TestUpmixVolume);
+	CPPUNIT_TEST(TestRouteMatrix);
+	CPPUNIT_TEST(TestArena);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestRouteVolume8();
+	void TestRouteVolume16();
+	void TestRouteVolume24();
+	void TestRouteVolume32();
+	void TestRouteVolumeFloat();
+	void TestRouteVolumeNoDither();
+	void TestVolumeVolume();
+	void TestUpmixVolume();
+	void TestRouteMatrix();
+	void TestArena();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FilterChainTest);
+
+bool
+mixer_set_volume(gcc_unused Mixer *mixer,
+		 gcc_unused unsigned volume, gcc_unused Error &error)
+{
+	return true;
+}
+
+static Filter *
+NewRouteFilter(const char *routes)
+{
+	config_param param;
+	param.AddBlockParam("routes", routes);
+
+	Error error;
+	Filter *filter = filter_new(&route_filter_plugin, param, error);
+	CPPUNIT_ASSERT(filter != nullptr);
+	return filter;
+}
+
+static Filter *
+NewVolumeFilter(unsigned volume)
+{
+	Error error;
+	Filter *filter = filter_new(&volume_filter_plugin, config_param(),
+				    error);
+	CPPUNIT_ASSERT(filter != nullptr);
+	volume_filter_set(filter, volume);
+	return filter;
+}
+
+/**
+ * Build the chain "route, volume, convert"; the "convert" filter is
+ * a no-op, just like in an output which doesn't need conversion.
+ */
+static Filter *
+NewRouteVolumeChain(unsigned volume,
+		    const char *routes="1>0, 0>1, 0>2, 3>3")
+{
+	Filter *chain = filter_chain_new();
+	filter_chain_append(*chain, "route", NewRouteFilter(routes));
+	filter_chain_append(*chain, "volume", NewVolumeFilter(volume));
+
+	Error error;
+	filter_chain_append(*chain, "convert",
+			    filter_new(&convert_filter_plugin, config_param(),
+				       error));
+	return chain;
+}
+
+static Filter *
+NewVolumeVolumeChain(unsigned a, unsigned b)
+{
+	Filter *chain = filter_chain_new();
+	filter_chain_append(*chain, "volume", NewVolumeFilter(a));
+	filter_chain_append(*chain, "volume", NewVolumeFilter(b));
+	return chain;
+}
+
+/**
+ * Feed the same input into a chain with and without fusing, and
+ * compare the outputs sample by sample.  The input is split into
+ * chunks of odd sizes, to verify that the dither state is carried
+ * over correctly.
+ */
+template<typename T, size_t N>
+static void
+TestFusion(Filter &unfused, Filter &fused, AudioFormat audio_format,
+	   const TestDataBuffer<T, N> &src, T tolerance)
+{
+	Error error;
+	AudioFormat af = audio_format;
+	const AudioFormat out_audio_format = unfused.Open(af, error);
+	CPPUNIT_ASSERT(out_audio_format.IsDefined());
+	af = audio_format;
+	CPPUNIT_ASSERT(fused.Open(af, error) == out_audio_format);
+
+	static constexpr size_t chunk_frames[] = { 1, 7, 13, 64, 333 };
+	const size_t frame_size = audio_format.GetFrameSize();
+	const size_t n_frames = N / audio_format.channels;
+
+	size_t position = 0;
+	for (size_t i = 0; position < n_frames; ++i) {
+		const size_t n = std::min(chunk_frames[i % 5],
+					  n_frames - position);
+		const void *in = src + position * audio_format.channels;
+
+		filter_chain_global_init(false);
+		size_t unfused_size;
+		const T *a = (const T *)
+			unfused.FilterPCM(in, n * frame_size,
+					  &unfused_size, error);
+		CPPUNIT_ASSERT(a != nullptr);
+
+		filter_chain_global_init(true);
+		size_t fused_size;
+		const T *b = (const T *)
+			fused.FilterPCM(in, n * frame_size,
+					&fused_size, error);
+		CPPUNIT_ASSERT(b != nullptr);
+
+		CPPUNIT_ASSERT_EQUAL(unfused_size, fused_size);
+		CPPUNIT_ASSERT_EQUAL(n * out_audio_format.GetFrameSize(),
+				     fused_size);
+
+		for (size_t j = 0; j < fused_size / sizeof(T); ++j) {
+			CPPUNIT_ASSERT(b[j] >= a[j] - tolerance);
+			CPPUNIT_ASSERT(b[j] <= a[j] + tolerance);
+		}
+
+		position += n;
+	}
+
+	unfused.Close();
+	fused.Close();
+}
+
+template<SampleFormat F,
+	 typename G=RandomInt<typename SampleTraits<F>::value_type>>
+static void
+TestRouteVolume(typename SampleTraits<F>::value_type tolerance=0)
+{
+	typedef typename SampleTraits<F>::value_type value_type;
+
+	const AudioFormat audio_format(48000, F, 4);
+	const TestDataBuffer<value_type, 4096 * 4> src{G()};
+
+	Filter *unfused = NewRouteVolumeChain(PCM_VOLUME_1 / 3);
+	Filter *fused = NewRouteVolumeChain(PCM_VOLUME_1 / 3);
+	TestFusion(*unfused, *fused, audio_format, src, tolerance);
+	delete unfused;
+	delete fused;
+}
+
+void
+FilterChainTest::TestRouteVolume8()
+{
+	TestRouteVolume<SampleFormat::S8>();
+}
+
+void
+FilterChainTest::TestRouteVolume16()
+{
+	TestRouteVolume<SampleFormat::S16>();
+}
+
+void
+FilterChainTest::TestRouteVolume24()
+{
+	TestRouteVolume<SampleFormat::S24_P32, RandomInt24>();
+}
+
+void
+FilterChainTest::TestRouteVolume32()
+{
+	TestRouteVolume<SampleFormat::S32>();
+}
+
+void
+FilterChainTest::TestRouteVolumeFloat()
+{
+	TestRouteVolume<SampleFormat::FLOAT, RandomFloat>(1e-6);
+}
+
+void
+FilterChainTest::TestRouteVolumeNoDither()
+{
+	pcm_volume_global_init(false);
+	TestRouteVolume<SampleFormat::S16>();
+	TestRouteVolume<SampleFormat::S24_P32, RandomInt24>();
+	pcm_volume_global_init(true);
+}
+
+void
+FilterChainTest::TestVolumeVolume()
+{
+	/* two volume stages are fused into one, which rounds only
+	   once; without dithering, the result may differ by one
+	   step */
+	pcm_volume_global_init(false);
+
+	const AudioFormat audio_format(44100, SampleFormat::S16, 2);
+	const TestDataBuffer<int16_t, 4096 * 2> src;
+
+	Filter *unfused = NewVolumeVolumeChain(PCM_VOLUME_1 / 2,
+					       PCM_VOLUME_1 * 3 / 4);
+	Filter *fused = NewVolumeVolumeChain(PCM_VOLUME_1 / 2,
+					     PCM_VOLUME_1 * 3 / 4);
+	TestFusion(*unfused, *fused, audio_format, src, int16_t(1));
+	delete unfused;
+	delete fused;
+
+	pcm_volume_global_init(true);
+}
+
+template<unsigned IN_CHANNELS>
+static void
+TestUpmixVolume(const char *routes)
+{
+	const AudioFormat audio_format(44100, SampleFormat::S16,
+				       IN_CHANNELS);
+	const TestDataBuffer<int16_t, 4096 * IN_CHANNELS> src;
+
+	Filter *unfused = NewRouteVolumeChain(PCM_VOLUME_1 / 3, routes);
+	Filter *fused = NewRouteVolumeChain(PCM_VOLUME_1 / 3, routes);
+	TestFusion(*unfused, *fused, audio_format, src, int16_t(0));
+	delete unfused;
+	delete fused;
+}
+
+void
+FilterChainTest::TestUpmixVolume()
+{
+	/* the fused volume is applied after routing, i.e. with the
+	   dither state of the output channels */
+	::TestUpmixVolume<1>("0>0, 0>1");
+	::TestUpmixVolume<2>("0>0, 1>1, 0>2, 1>3, 0>4, 1>5");
+}
+
+void
+FilterChainTest::TestRouteMatrix()
+{
+	/* a route with gain factors is not a plain copy; it is
+	   mixed, and the chain must not fuse it */
+	const AudioFormat audio_format(44100, SampleFormat::S16, 3);
+	const int16_t src[] = {
+		1000, 2000, 10000,
+		-1000, 0, -20000,
+		32000, 32000, 32000,
+	};
+
+	Filter *chain = filter_chain_new();
+	filter_chain_append(*chain, "route",
+			    NewRouteFilter("0>0, 2>0*0.5, 1>1, 2 > 1 * 0.25"));
+	filter_chain_append(*chain, "volume", NewVolumeFilter(PCM_VOLUME_1));
+
+	Error error;
+	AudioFormat af = audio_format;
+	const AudioFormat out_audio_format = chain->Open(af, error);
+	CPPUNIT_ASSERT(out_audio_format.IsDefined());
+	CPPUNIT_ASSERT_EQUAL(2u, unsigned(out_audio_format.channels));
+
+	size_t dest_size;
+	const int16_t *dest = (const int16_t *)
+		chain->FilterPCM(src, sizeof(src), &dest_size, error);
+	CPPUNIT_ASSERT(dest != nullptr);
+	CPPUNIT_ASSERT_EQUAL(sizeof(int16_t) * 6, dest_size);
+
+	CPPUNIT_ASSERT_EQUAL(int16_t(6000), dest[0]);
+	CPPUNIT_ASSERT_EQUAL(int16_t(4500), dest[1]);
+	CPPUNIT_ASSERT_EQUAL(int16_t(-11000), dest[2]);
+	CPPUNIT_ASSERT_EQUAL(int16_t(-5000), dest[3]);
+	CPPUNIT_ASSERT_EQUAL(int16_t(32767), dest[4]);
+	CPPUNIT_ASSERT_EQUAL(int16_t(32767), dest[5]);
+
+	chain->Close();
+	delete chain;
+}
+
+void
+FilterChainTest::TestArena()
+{
+	/* with scratch memory from a PcmArena, which reuses the
+	   memory of earlier stages, the result must be the same as
+	   with separate buffers */
+	const AudioFormat audio_format(48000, SampleFormat::S16, 4);
+	const TestDataBuffer<int16_t, 4096 * 4> src;
+
+	Filter *chains[2];
+	for (auto &chain : chains) {
+		chain = filter_chain_new();
+		filter_chain_append(*chain, "route",
+				    NewRouteFilter("0>0*0.5, 1>0*0.5, "
+						   "1>1, 2>2, 3>3"));
+		filter_chain_append(*chain, "volume",
+				    NewVolumeFilter(PCM_VOLUME_1 / 2));
+		filter_chain_append(*chain, "volume",
+				    NewVolumeFilter(PCM_VOLUME_1 / 3));
+
+		Error error;
+		filter_chain_append(*chain, "convert",
+				    filter_new(&convert_filter_plugin,
+					       config_param(), error));
+
+		AudioFormat af = audio_format;
+		CPPUNIT_ASSERT(chain->Open(af, error).IsDefined());
+	}
+
+	/* don't fuse, to get as many stages as possible */
+	filter_chain_global_init(false);
+
+	PcmArena arena;
+	const size_t frame_size = audio_format.GetFrameSize();
+	for (size_t position = 0; position < 4096; position += 512) {
+		const void *in = src + position * audio_format.channels;
+		Error error;
+
+		size_t expected_size;
+		const int16_t *expected = (const int16_t *)
+			chains[0]->FilterPCM(in, 512 * frame_size,
+					     &expected_size, error);
+		CPPUNIT_ASSERT(expected != nullptr);
+
+		arena.Reset();
+		const PcmArena::Scope scope(arena);
+
+		size_t size;
+		const int16_t *result = (const int16_t *)
+			chains[1]->FilterPCM(in, 512 * frame_size,
+					     &size, error);
+		CPPUNIT_ASSERT(result != nullptr);
+		CPPUNIT_ASSERT_EQUAL(expected_size, size);
+		CPPUNIT_ASSERT(std::equal(expected,
+					  expected + size / sizeof(*expected),
+					  result));
+	}
+
+	/* three buffers: the route output and both volume outputs;
+	   only two of them are in use at a time */
+	CPPUNIT_ASSERT(arena.GetHighWaterMark() < 3 * 512 * frame_size);
+
+	filter_chain_global_init(true);
+
+	for (auto chain : chains) {
+		chain->Close();
+		delete chain;
+	}
+}
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Unit tests for the partition commands, for the isolation of
+ * partitions (including their idle events) and for their sections in
+ * the state file.
+ */
+
+#include "config.h"
+#include "Main.hxx"
+#include "Instance.hxx"
+#include "Partition.hxx"
+#include "PlayerThread.hxx"
+#include "StateFile.hxx"
+#include "GlobalEvents.hxx"
+#include "Idle.hxx"
+#include "Permission.hxx"
+#include "DetachedSong.hxx"
+#include "client/Client.hxx"
+#include "client/ClientList.hxx"
+#include "command/AllCommands.hxx"
+#include "command/CommandResult.hxx"
+#include "event/Loop.hxx"
+#include "event/IdleMonitor.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "Compiler.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <string>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+Instance *instance;
+
+/**
+ * Breaks the #EventLoop as soon as all pending #IdleMonitor
+ * instances (i.e. the client's output buffer flush) have run.
+ */
+class BreakMonitor final : public IdleMonitor {
+public:
+	explicit BreakMonitor(EventLoop &_loop):IdleMonitor(_loop) {}
+
+protected:
+	virtual void OnIdle() override {
+		GetEventLoop().Break();
+	}
+};
+
+static Partition &
+AddPartition(const char *name)
+{
+	Partition *partition = new Partition(*instance, name,
+					     16, 64, 4096, 0, 8);
+	instance->partitions.push_back(partition);
+	player_create(partition->pc);
+	return *partition;
+}
+
+/**
+ * A client connected over a socket pair.
+ */
+class TestClient {
+	int fds[2];
+
+	Client *client;
+
+public:
+	TestClient() {
+		CPPUNIT_ASSERT_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM,
+						   0, fds));
+		client = new Client(*instance->event_loop,
+				    *instance->partition, fds[0], -1, 0);
+		instance->client_list->Add(*client);
+	}
+
+	~TestClient() {
+		instance->client_list->Remove(*client);
+		delete client;
+		close(fds[1]);
+	}
+
+	Client &operator*() {
+		return *client;
+	}
+
+	CommandResult Process(const char *line) {
+		std::string buffer(line);
+		return command_process(*client, 0, &buffer.front());
+	}
+
+	/**
+	 * Process a command and return its output.
+	 */
+	std::string Query(const char *line) {
+		CPPUNIT_ASSERT(Process(line) == CommandResult::OK);
+
+		BreakMonitor flushed(*instance->event_loop);
+		flushed.Schedule();
+		instance->event_loop->Run();
+
+		char buffer[4096];
+		ssize_t nbytes = recv(fds[1], buffer, sizeof(buffer),
+				      MSG_DONTWAIT);
+		return std::string(buffer, nbytes > 0 ? nbytes : 0);
+	}
+};
+
+class PartitionTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(PartitionTest);
+	CPPUNIT_TEST(TestPartition);
+	CPPUNIT_TEST(TestListPartitions);
+	CPPUNIT_TEST(TestNewPartition);
+	CPPUNIT_TEST(TestIsolation);
+	CPPUNIT_TEST(TestIdle);
+	CPPUNIT_TEST(TestStateFile);
+	CPPUNIT_TEST_SUITE_END();
+
+	char state_path[32];
+
+public:
+	void setUp() {
+		instance = new Instance();
+		instance->event_loop = new EventLoop();
+		instance->client_list = new ClientList(16);
+		GlobalEvents::Initialize(*instance->event_loop);
+
+		instance->partition = &AddPartition(Partition::DEFAULT_NAME);
+		AddPartition("b");
+
+		strcpy(state_path, "/tmp/mpd_state_XXXXXX");
+		close(mkstemp(state_path));
+	}
+
+	void tearDown() {
+		unlink(state_path);
+
+		for (auto *partition : instance->partitions) {
+			partition->pc.Kill();
+			delete partition;
+		}
+
+		GlobalEvents::Deinitialize();
+		delete instance->client_list;
+		delete instance->event_loop;
+		delete instance;
+	}
+
+	void TestPartition();
+	void TestListPartitions();
+	void TestNewPartition();
+	void TestIsolation();
+	void TestIdle();
+	void TestStateFile();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PartitionTest);
+
+void
+PartitionTest::TestPartition()
+{
+	TestClient client;
+	CPPUNIT_ASSERT_EQUAL(instance->partition, &(*client).GetPartition());
+
+	CPPUNIT_ASSERT(client.Process("partition b") == CommandResult::OK);
+	CPPUNIT_ASSERT_EQUAL(instance->FindPartition("b"),
+			     &(*client).GetPartition());
+
+	/* a failed switch leaves the client where it was */
+	CPPUNIT_ASSERT(client.Process("partition c") == CommandResult::ERROR);
+	CPPUNIT_ASSERT_EQUAL(instance->FindPartition("b"),
+			     &(*client).GetPartition());
+
+	CPPUNIT_ASSERT(client.Process("partition default") == CommandResult::OK);
+	CPPUNIT_ASSERT_EQUAL(instance->partition, &(*client).GetPartition());
+}
+
+void
+PartitionTest::TestListPartitions()
+{
+	TestClient client;
+	CPPUNIT_ASSERT_EQUAL(std::string("partition: default\n"
+					 "partition: b\n"),
+			     client.Query("listpartitions"));
+}
+
+void
+PartitionTest::TestNewPartition()
+{
+	TestClient client;
+
+	CPPUNIT_ASSERT(client.Process("newpartition c") == CommandResult::OK);
+	Partition *c = instance->FindPartition("c");
+	CPPUNIT_ASSERT(c != nullptr);
+	CPPUNIT_ASSERT_EQUAL(instance->partition->pc.buffer_chunks,
+			     c->pc.buffer_chunks);
+	CPPUNIT_ASSERT_EQUAL(0u, c->outputs.Size());
+
+	/* the new partition is not selected automatically */
+	CPPUNIT_ASSERT_EQUAL(instance->partition, &(*client).GetPartition());
+
+	CPPUNIT_ASSERT_EQUAL(std::string("partition: default\n"
+					 "partition: b\n"
+					 "partition: c\n"),
+			     client.Query("listpartitions"));
+
+	/* duplicate and malformed names */
+	CPPUNIT_ASSERT(client.Process("newpartition c") == CommandResult::ERROR);
+	CPPUNIT_ASSERT(client.Process("newpartition default") == CommandResult::ERROR);
+	CPPUNIT_ASSERT(client.Process("newpartition \"a b\"") == CommandResult::ERROR);
+	CPPUNIT_ASSERT(client.Process("newpartition \"\"") == CommandResult::ERROR);
+	CPPUNIT_ASSERT_EQUAL(size_t(3), instance->partitions.size());
+
+	CPPUNIT_ASSERT(client.Process("partition c") == CommandResult::OK);
+	CPPUNIT_ASSERT_EQUAL(c, &(*client).GetPartition());
+}
+
+void
+PartitionTest::TestIsolation()
+{
+	Partition &a = *instance->partition;
+	Partition &b = *instance->FindPartition("b");
+
+	TestClient client1, client2;
+	CPPUNIT_ASSERT(client2.Process("partition b") == CommandResult::OK);
+
+	CPPUNIT_ASSERT(client1.Process("repeat 1") == CommandResult::OK);
+	CPPUNIT_ASSERT(client2.Process("consume 1") == CommandResult::OK);
+	CPPUNIT_ASSERT(client2.Process("crossfade 5") == CommandResult::OK);
+
+	CPPUNIT_ASSERT(a.playlist.GetRepeat());
+	CPPUNIT_ASSERT(!a.playlist.GetConsume());
+	CPPUNIT_ASSERT_EQUAL(0.f, a.pc.GetCrossFade());
+	CPPUNIT_ASSERT(!b.playlist.GetRepeat());
+	CPPUNIT_ASSERT(b.playlist.GetConsume());
+	CPPUNIT_ASSERT_EQUAL(5.f, b.pc.GetCrossFade());
+
+	/* each partition has its own play queue */
+	a.playlist.AppendSong(a.pc, DetachedSong("http://a/1.ogg"));
+	a.playlist.AppendSong(a.pc, DetachedSong("http://a/2.ogg"));
+	b.playlist.AppendSong(b.pc, DetachedSong("http://b/1.ogg"));
+	CPPUNIT_ASSERT_EQUAL(2u, a.playlist.GetLength());
+	CPPUNIT_ASSERT_EQUAL(1u, b.playlist.GetLength());
+
+	CPPUNIT_ASSERT(client2.Process("clear") == CommandResult::OK);
+	CPPUNIT_ASSERT_EQUAL(2u, a.playlist.GetLength());
+	CPPUNIT_ASSERT_EQUAL(0u, b.playlist.GetLength());
+
+	CPPUNIT_ASSERT(client1.Process("delete 0") == CommandResult::OK);
+	CPPUNIT_ASSERT_EQUAL(1u, a.playlist.GetLength());
+	CPPUNIT_ASSERT_EQUAL(std::string("http://a/2.ogg"),
+			     std::string(a.playlist.queue.Get(0).GetURI()));
+}
+
+void
+PartitionTest::TestIdle()
+{
+	Partition &a = *instance->partition;
+	Partition &b = *instance->FindPartition("b");
+
+	TestClient client1, client2;
+	CPPUNIT_ASSERT(client2.Process("partition b") == CommandResult::OK);
+	(*client1).idle_flags = (*client2).idle_flags = 0;
+
+	/* events of one partition reach only its own clients */
+	b.SetRepeat(true);
+	b.pc.SetCrossFade(2);
+	instance->FlushIdle();
+	CPPUNIT_ASSERT_EQUAL(0u, (*client1).idle_flags);
+	CPPUNIT_ASSERT_EQUAL(IDLE_OPTIONS, (*client2).idle_flags);
+
+	(*client2).idle_flags = 0;
+	a.playlist.AppendSong(a.pc, DetachedSong("http://a/1.ogg"));
+	instance->FlushIdle();
+	CPPUNIT_ASSERT_EQUAL(IDLE_PLAYLIST, (*client1).idle_flags);
+	CPPUNIT_ASSERT_EQUAL(0u, (*client2).idle_flags);
+
+	/* global events reach everybody */
+	(*client1).idle_flags = 0;
+	idle_add(IDLE_STORED_PLAYLIST);
+	instance->FlushIdle();
+	CPPUNIT_ASSERT_EQUAL(IDLE_STORED_PLAYLIST, (*client1).idle_flags);
+	CPPUNIT_ASSERT_EQUAL(IDLE_STORED_PLAYLIST, (*client2).idle_flags);
+}
+
+void
+PartitionTest::TestStateFile()
+{
+	Partition &a = *instance->partition;
+	Partition &b = *instance->FindPartition("b");
+
+	a.SetRepeat(true);
+	a.pc.SetCrossFade(3);
+	b.SetConsume(true);
+	b.pc.SetCrossFade(7);
+
+	/* a section of a partition which doesn't exist anymore */
+	AddPartition("gone").SetRandom(true);
+
+	{
+		StateFile state_file(AllocatedPath::FromFS(state_path),
+				     *instance, *instance->event_loop);
+		state_file.Write();
+	}
+
+	Partition *gone = instance->partitions.back();
+	gone->pc.Kill();
+	instance->partitions.pop_back();
+	delete gone;
+
+	a.SetRepeat(false);
+	a.pc.SetCrossFade(0);
+	b.SetConsume(false);
+	b.pc.SetCrossFade(0);
+
+	StateFile state_file(AllocatedPath::FromFS(state_path),
+			     *instance, *instance->event_loop);
+	state_file.Read();
+
+	CPPUNIT_ASSERT(a.playlist.GetRepeat());
+	CPPUNIT_ASSERT(!a.playlist.GetConsume());
+	CPPUNIT_ASSERT(!a.playlist.GetRandom());
+	CPPUNIT_ASSERT_EQUAL(3.f, a.pc.GetCrossFade());
+
+	CPPUNIT_ASSERT(!b.playlist.GetRepeat());
+	CPPUNIT_ASSERT(b.playlist.GetConsume());
+	CPPUNIT_ASSERT(!b.playlist.GetRandom());
+	CPPUNIT_ASSERT_EQUAL(7.f, b.pc.GetCrossFade());
+}
+
+static void
+FlushIdle()
+{
+	instance->FlushIdle();
+}
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	GlobalEvents::Register(GlobalEvents::IDLE, FlushIdle);
+
+	initPermissions();
+	client_manager_init();
+	command_init();
+
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	const bool success = runner.run();
+
+	command_finish();
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -27,11 +27,19 @@ class PcmDitherTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST_SUITE(PcmDitherTest);
 	CPPUNIT_TEST(TestDither24);
 	CPPUNIT_TEST(TestDither32);
+	CPPUNIT_TEST(TestDitherNoise);
+	CPPUNIT_TEST(TestDitherResolution);
+	CPPUNIT_TEST(TestDitherSplit);
+	CPPUNIT_TEST(TestDitherSpectrum);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
 	void TestDither24();
 	void TestDither32();
+	void TestDitherNoise();
+	void TestDitherResolution();
+	void TestDitherSplit();
+	void TestDitherSpectrum();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(PcmDitherTest);
@@ -40,11 +48,15 @@ class PcmPackTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST_SUITE(PcmPackTest);
 	CPPUNIT_TEST(TestPack24);
 	CPPUNIT_TEST(TestUnpack24);
+	CPPUNIT_TEST(TestPack24Simd);
+	CPPUNIT_TEST(TestUnpack24Simd);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
 	void TestPack24();
 	void TestUnpack24();
+	void TestPack24Simd();
+	void TestUnpack24Simd();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(PcmPackTest);
@@ -53,11 +65,17 @@ class PcmChannelsTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST_SUITE(PcmChannelsTest);
 	CPPUNIT_TEST(TestChannels16);
 	CPPUNIT_TEST(TestChannels32);
+	CPPUNIT_TEST(TestDownmix);
+	CPPUNIT_TEST(TestMatrixClamp);
+	CPPUNIT_TEST(TestMatrixKernels);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
 	void TestChannels16();
 	void TestChannels32();
+	void TestDownmix();
+	void TestMatrixClamp();
+	void TestMatrixKernels();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(PcmChannelsTest);
@@ -69,6 +87,12 @@ class PcmVolumeTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(TestVolume24);
 	CPPUNIT_TEST(TestVolume32);
 	CPPUNIT_TEST(TestVolumeFloat);
+	CPPUNIT_TEST(TestVolumeNoDither8);
+	CPPUNIT_TEST(TestVolumeNoDither16);
+	CPPUNIT_TEST(TestVolumeNoDither24);
+	CPPUNIT_TEST(TestVolumeNoDither32);
+	CPPUNIT_TEST(TestVolumeNoDitherFloat);
+	CPPUNIT_TEST(TestVolumeDitherSimd);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -77,6 +101,12 @@ public:
 	void TestVolume24();
 	void TestVolume32();
 	void TestVolumeFloat();
+	void TestVolumeNoDither8();
+	void TestVolumeNoDither16();
+	void TestVolumeNoDither24();
+	void TestVolumeNoDither32();
+	void TestVolumeNoDitherFloat();
+	void TestVolumeDitherSimd();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(PcmVolumeTest);
@@ -87,6 +117,8 @@ class PcmFormatTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(TestFormat16to24);
 	CPPUNIT_TEST(TestFormat16to32);
 	CPPUNIT_TEST(TestFormatFloat);
+	CPPUNIT_TEST(TestFormatSimd);
+	CPPUNIT_TEST(TestFormatFloatClamp);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -94,6 +126,8 @@ public:
 	void TestFormat16to24();
 	void TestFormat16to32();
 	void TestFormatFloat();
+	void TestFormatSimd();
+	void TestFormatFloatClamp();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(PcmFormatTest);
@@ -104,6 +138,9 @@ class PcmMixTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(TestMix16);
 	CPPUNIT_TEST(TestMix24);
 	CPPUNIT_TEST(TestMix32);
+	CPPUNIT_TEST(TestMixRamp16);
+	CPPUNIT_TEST(TestMixRampFloat);
+	CPPUNIT_TEST(TestMixRampConstant);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -111,8 +148,73 @@ public:
 	void TestMix16();
 	void TestMix24();
 	void TestMix32();
+	void TestMixRamp16();
+	void TestMixRampFloat();
+	void TestMixRampConstant();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(PcmMixTest);
 
+class PcmDsdTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(PcmDsdTest);
+	CPPUNIT_TEST(TestDsd);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestDsd();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PcmDsdTest);
+
+class PcmResamplerTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(PcmResamplerTest);
+	CPPUNIT_TEST(TestSincSnr);
+	CPPUNIT_TEST(TestSincStopBand);
+	CPPUNIT_TEST(TestSincSimd);
+	CPPUNIT_TEST(TestSincFilterCache);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestSincSnr();
+	void TestSincStopBand();
+	void TestSincSimd();
+	void TestSincFilterCache();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PcmResamplerTest);
+
+class PcmLimiterTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(PcmLimiterTest);
+	CPPUNIT_TEST(TestTransparent);
+	CPPUNIT_TEST(TestNormalize);
+	CPPUNIT_TEST(TestFlush);
+	CPPUNIT_TEST(TestReset);
+	CPPUNIT_TEST(TestLimiterSimd);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestTransparent();
+	void TestNormalize();
+	void TestFlush();
+	void TestReset();
+	void TestLimiterSimd();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PcmLimiterTest);
+
+class PcmArenaTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(PcmArenaTest);
+	CPPUNIT_TEST(TestAllocate);
+	CPPUNIT_TEST(TestStages);
+	CPPUNIT_TEST(TestBuffer);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestAllocate();
+	void TestStages();
+	void TestBuffer();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PcmArenaTest);
+
 #endif
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "test_pcm_all.hxx"
+#include "pcm/PcmArena.hxx"
+#include "pcm/PcmBuffer.hxx"
+
+#include <string.h>
+
+void
+PcmArenaTest::TestAllocate()
+{
+	PcmArena arena;
+	CPPUNIT_ASSERT_EQUAL(size_t(0), arena.GetHighWaterMark());
+
+	/* the first chunk doesn't fit into the empty arena */
+	uint8_t *a = (uint8_t *)arena.Allocate(100);
+	uint8_t *b = (uint8_t *)arena.Allocate(0);
+	CPPUNIT_ASSERT(a != nullptr);
+	CPPUNIT_ASSERT(b != nullptr);
+	CPPUNIT_ASSERT(a != b);
+	memset(a, 1, 100);
+	CPPUNIT_ASSERT_EQUAL(size_t(192), arena.GetHighWaterMark());
+
+	/* now the arena has grown to the high-water mark; the first
+	   stage allocates from the bottom */
+	arena.Reset();
+	a = (uint8_t *)arena.Allocate(64);
+
+	/* the next stage reads a, and allocates from the top */
+	arena.NextStage(a);
+	b = (uint8_t *)arena.Allocate(64);
+	CPPUNIT_ASSERT_EQUAL(a + 128, b);
+
+	/* a is not needed anymore, its memory is reused */
+	arena.NextStage(b);
+	CPPUNIT_ASSERT_EQUAL(a, (uint8_t *)arena.Allocate(64));
+	CPPUNIT_ASSERT_EQUAL(size_t(192), arena.GetHighWaterMark());
+
+	/* Clear() frees the memory, but keeps the high-water mark */
+	arena.Clear();
+	CPPUNIT_ASSERT_EQUAL(size_t(192), arena.GetHighWaterMark());
+}
+
+void
+PcmArenaTest::TestStages()
+{
+	/* the footprint of a chain of stages is the largest pair of
+	   adjacent stages, even on the first chunk, which doesn't fit
+	   into the arena */
+	static constexpr size_t sizes[] = { 1024, 4096, 2048, 1024, 512 };
+	static const uint8_t chunk[64] = { 0 };
+
+	PcmArena arena;
+	for (unsigned i = 0; i < 3; ++i) {
+		arena.Reset();
+
+		const void *data = chunk;
+		for (size_t size : sizes) {
+			arena.NextStage(data);
+			uint8_t *dest = (uint8_t *)arena.Allocate(size);
+			memset(dest, 0, size);
+			data = dest;
+		}
+
+		CPPUNIT_ASSERT_EQUAL(size_t(4096 + 2048),
+				     arena.GetHighWaterMark());
+	}
+
+	/* a stage which returns its input: the input's side must not
+	   be released */
+	arena.Reset();
+	arena.NextStage(chunk);
+	uint8_t *a = (uint8_t *)arena.Allocate(64);
+	memset(a, 0x42, 64);
+	arena.NextStage(a);
+	arena.NextStage(a);
+	uint8_t *b = (uint8_t *)arena.Allocate(64);
+	CPPUNIT_ASSERT(b != a);
+	memset(b, 0, 64);
+	CPPUNIT_ASSERT_EQUAL(uint8_t(0x42), a[63]);
+}
+
+void
+PcmArenaTest::TestBuffer()
+{
+	PcmBuffer buffer;
+	PcmScratchBuffer scratch;
+
+	CPPUNIT_ASSERT(PcmArena::GetCurrent() == nullptr);
+
+	PcmArena arena;
+
+	{
+		const PcmArena::Scope scope(arena);
+		CPPUNIT_ASSERT_EQUAL(&arena, PcmArena::GetCurrent());
+
+		void *p = scratch.Get(1000);
+		CPPUNIT_ASSERT_EQUAL(size_t(1024), arena.GetHighWaterMark());
+
+		/* a plain PcmBuffer never uses the arena */
+		buffer.Get(4000);
+		CPPUNIT_ASSERT_EQUAL(size_t(1024), arena.GetHighWaterMark());
+
+		/* a nested scope */
+		PcmArena inner;
+		{
+			const PcmArena::Scope inner_scope(inner);
+			CPPUNIT_ASSERT_EQUAL(&inner, PcmArena::GetCurrent());
+			CPPUNIT_ASSERT(scratch.Get(10) != p);
+			CPPUNIT_ASSERT_EQUAL(size_t(64),
+					     inner.GetHighWaterMark());
+		}
+
+		CPPUNIT_ASSERT_EQUAL(&arena, PcmArena::GetCurrent());
+	}
+
+	CPPUNIT_ASSERT(PcmArena::GetCurrent() == nullptr);
+
+	/* without a scope, the buffer's own memory is used */
+	scratch.Get(100000);
+	CPPUNIT_ASSERT_EQUAL(size_t(1024), arena.GetHighWaterMark());
+}
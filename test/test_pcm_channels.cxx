@@ -22,7 +22,12 @@
 #include "test_pcm_util.hxx"
 #include "pcm/PcmChannels.hxx"
 #include "pcm/PcmBuffer.hxx"
+#include "pcm/PcmMatrix.hxx"
 #include "util/ConstBuffer.hxx"
+#include "util/CpuFeatures.hxx"
+
+#include <math.h>
+#include <string.h>
 
 void
 PcmChannelsTest::TestChannels16()
@@ -79,3 +84,122 @@ PcmChannelsTest::TestChannels32()
 		CPPUNIT_ASSERT_EQUAL(src[i], dest.data[i * 2 + 1]);
 	}
 }
+
+void
+PcmChannelsTest::TestDownmix()
+{
+	constexpr size_t N = 256;
+	const auto src = TestDataBuffer<int16_t, N * 6>();
+
+	PcmBuffer buffer;
+
+	/* 5.1 to stereo: center and back folded in at -3 dB, no LFE,
+	   normalized to avoid clipping */
+
+	auto dest = pcm_convert_channels_16(buffer, 2, 6, { src, N * 6 });
+	CPPUNIT_ASSERT(!dest.IsNull());
+	CPPUNIT_ASSERT_EQUAL(N * 2, dest.size);
+
+	const double k = sqrt(0.5), sum = 1 + 2 * k;
+	for (unsigned i = 0; i < N; ++i) {
+		const int16_t *frame = src + i * 6;
+
+		const double left = (frame[0] + k * frame[2] +
+				     k * frame[4]) / sum;
+		const double right = (frame[1] + k * frame[2] +
+				      k * frame[5]) / sum;
+		CPPUNIT_ASSERT(fabs(left - dest.data[i * 2]) <= 1);
+		CPPUNIT_ASSERT(fabs(right - dest.data[i * 2 + 1]) <= 1);
+	}
+
+	/* the same conversion, in floating point */
+
+	const auto fsrc = TestDataBuffer<float, N * 6>(RandomFloat());
+	auto fdest = pcm_convert_channels_float(buffer, 2, 6,
+						{ fsrc, N * 6 });
+	CPPUNIT_ASSERT_EQUAL(N * 2, fdest.size);
+	for (unsigned i = 0; i < N; ++i) {
+		const float *frame = fsrc + i * 6;
+
+		const double left = (frame[0] + k * frame[2] +
+				     k * frame[4]) / sum;
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(left, fdest.data[i * 2], 1e-6);
+	}
+
+	/* stereo to 5.1 copies front left and right, the other
+	   channels are silent */
+
+	auto udest = pcm_convert_channels_16(buffer, 6, 2, { src, N * 2 });
+	CPPUNIT_ASSERT_EQUAL(N * 6, udest.size);
+	for (unsigned i = 0; i < N; ++i) {
+		CPPUNIT_ASSERT_EQUAL(src[i * 2], udest.data[i * 6]);
+		CPPUNIT_ASSERT_EQUAL(src[i * 2 + 1], udest.data[i * 6 + 1]);
+		for (unsigned c = 2; c < 6; ++c)
+			CPPUNIT_ASSERT_EQUAL(int16_t(0), udest.data[i * 6 + c]);
+	}
+}
+
+void
+PcmChannelsTest::TestMatrixClamp()
+{
+	/* two full-scale channels summed without attenuation must
+	   clip, not wrap around */
+	PcmMatrix matrix;
+	matrix.Clear(2, 1);
+	matrix.gain[0][0] = matrix.gain[0][1] = 1;
+	CPPUNIT_ASSERT(!matrix.IsRoute());
+
+	const int16_t src16[] = { 30000, 30000, -30000, -30000 };
+	int16_t dest16[2];
+	pcm_matrix_mix(SampleFormat::S16, dest16, src16, 2, matrix);
+	CPPUNIT_ASSERT_EQUAL(int16_t(32767), dest16[0]);
+	CPPUNIT_ASSERT_EQUAL(int16_t(-32768), dest16[1]);
+
+	const int32_t src32[] = { 0x7fffffff, 1, -0x7fffffff, -2 };
+	int32_t dest32[2];
+	pcm_matrix_mix(SampleFormat::S32, dest32, src32, 2, matrix);
+	CPPUNIT_ASSERT_EQUAL(int32_t(0x7fffffff), dest32[0]);
+	CPPUNIT_ASSERT_EQUAL(int32_t(-0x7fffffff - 1), dest32[1]);
+
+	matrix.SetDefault(2, 2);
+	CPPUNIT_ASSERT(matrix.IsRoute());
+}
+
+template<typename T, typename G=RandomInt<T>>
+static void
+CompareMatrixKernels(SampleFormat format, G g=G())
+{
+	static constexpr size_t n_frames = 509;
+	const auto src = TestDataBuffer<T, n_frames * MAX_CHANNELS>(g);
+
+	for (unsigned n = 1; n <= MAX_CHANNELS; ++n) {
+		for (unsigned m = 1; m <= MAX_CHANNELS; ++m) {
+			PcmMatrix matrix;
+			matrix.SetDefault(n, m);
+
+			T expected[n_frames * MAX_CHANNELS];
+			SetCpuFeatureMask(0);
+			pcm_matrix_mix(format, expected, src, n_frames,
+				       matrix);
+
+			T result[n_frames * MAX_CHANNELS];
+			SetCpuFeatureMask(~0u);
+			pcm_matrix_mix(format, result, src, n_frames,
+				       matrix);
+
+			CPPUNIT_ASSERT_EQUAL(0, memcmp(expected, result,
+						       n_frames * m *
+						       sizeof(T)));
+		}
+	}
+}
+
+void
+PcmChannelsTest::TestMatrixKernels()
+{
+	CompareMatrixKernels<int8_t>(SampleFormat::S8);
+	CompareMatrixKernels<int16_t>(SampleFormat::S16);
+	CompareMatrixKernels<int32_t, RandomInt24>(SampleFormat::S24_P32);
+	CompareMatrixKernels<int32_t>(SampleFormat::S32);
+	CompareMatrixKernels<float, RandomFloat>(SampleFormat::FLOAT);
+}
@@ -21,6 +21,11 @@
 #include "test_pcm_util.hxx"
 #include "pcm/PcmDither.cxx"
 
+#include <vector>
+
+#include <math.h>
+#include <string.h>
+
 void
 PcmDitherTest::TestDither24()
 {
@@ -52,3 +57,253 @@ PcmDitherTest::TestDither32()
 		CPPUNIT_ASSERT(dest[i] < (src[i] >> 16) + 8);
 	}
 }
+
+/**
+ * The serial dither implementation of MPD 0.18, with only one error
+ * feedback and PRNG state.  TestDitherNoise() compares the new
+ * implementation with it.
+ */
+class ReferenceDither {
+	int32_t error[3];
+	int32_t random;
+
+public:
+	ReferenceDither():error{0, 0, 0}, random(0) {}
+
+	int16_t Dither24To16(int32_t sample) {
+		constexpr int32_t MIN = -(1 << 23), MAX = (1 << 23) - 1;
+		constexpr unsigned scale_bits = 8;
+		constexpr int32_t round = 1 << (scale_bits - 1);
+		constexpr int32_t mask = (1 << scale_bits) - 1;
+
+		sample += error[0] - error[1] + error[2];
+
+		error[2] = error[1];
+		error[1] = error[0] / 2;
+
+		int32_t output = sample + round;
+
+		const int32_t rnd = pcm_prng(random);
+		output += (rnd & mask) - (random & mask);
+
+		random = rnd;
+
+		if (output > MAX) {
+			output = MAX;
+
+			if (sample > MAX)
+				sample = MAX;
+		} else if (output < MIN) {
+			output = MIN;
+
+			if (sample < MIN)
+				sample = MIN;
+		}
+
+		output &= ~mask;
+
+		error[0] = sample - output;
+
+		return output >> scale_bits;
+	}
+};
+
+struct NoiseStats {
+	/**
+	 * The mean and the RMS of the error in 24 bit units.
+	 */
+	double mean, rms;
+
+	/**
+	 * The correlation of the error of two adjacent stereo
+	 * channels.
+	 */
+	double correlation;
+
+	NoiseStats(const int32_t *src, const int16_t *dest, size_t n) {
+		double sum = 0, sum2 = 0, sum_lr = 0;
+		for (size_t i = 0; i < n; i += 2) {
+			const double l = (dest[i] << 8) - src[i];
+			const double r = (dest[i + 1] << 8) - src[i + 1];
+			sum += l + r;
+			sum2 += l * l + r * r;
+			sum_lr += l * r;
+		}
+
+		mean = sum / n;
+		rms = sqrt(sum2 / n);
+		correlation = (sum_lr / (n / 2) - mean * mean) /
+			(rms * rms - mean * mean);
+	}
+};
+
+void
+PcmDitherTest::TestDitherNoise()
+{
+	constexpr unsigned N = 65536;
+
+	/* a stereo signal with independent channels */
+	static int32_t src[N];
+	RandomInt24 r;
+	for (unsigned i = 0; i < N; ++i)
+		src[i] = r() / 4;
+
+	static int16_t dest[N], reference[N];
+
+	PcmDither dither;
+	dither.SetChannels(2);
+	dither.Dither24To16(dest, src, src + N);
+
+	ReferenceDither reference_dither;
+	for (unsigned i = 0; i < N; ++i)
+		reference[i] = reference_dither.Dither24To16(src[i]);
+
+	const NoiseStats a(src, dest, N), b(src, reference, N);
+
+	/* no DC offset */
+	CPPUNIT_ASSERT(fabs(a.mean) < 2);
+	CPPUNIT_ASSERT(fabs(b.mean) < 2);
+
+	/* the same amount of noise */
+	CPPUNIT_ASSERT(a.rms > b.rms * 0.9);
+	CPPUNIT_ASSERT(a.rms < b.rms * 1.1);
+
+	/* the old implementation fed the error of one channel into
+	   the next one; now each channel has its own state, and the
+	   channels are seeded differently */
+	CPPUNIT_ASSERT(fabs(a.correlation) < 0.1);
+	CPPUNIT_ASSERT(fabs(a.correlation) < fabs(b.correlation));
+}
+
+void
+PcmDitherTest::TestDitherResolution()
+{
+	/* a constant value between two 16 bit steps: dithering must
+	   preserve it on average */
+	constexpr unsigned N = 16384;
+	constexpr int32_t value = (18 << 8) + 0x40;
+
+	static int32_t src[N];
+	for (auto &i : src)
+		i = value;
+
+	static int16_t dest[N];
+	PcmDither dither;
+	dither.Dither24To16(dest, src, src + N);
+
+	ReferenceDither reference_dither;
+	double sum = 0, reference_sum = 0;
+	for (unsigned i = 0; i < N; ++i) {
+		sum += dest[i];
+		reference_sum += reference_dither.Dither24To16(src[i]);
+	}
+
+	CPPUNIT_ASSERT(fabs(sum / N - 18.25) < 0.01);
+	CPPUNIT_ASSERT(fabs(reference_sum / N - 18.25) < 0.01);
+}
+
+void
+PcmDitherTest::TestDitherSplit()
+{
+	/* the result must not depend on how the input is split into
+	   buffers */
+	constexpr unsigned N = 1021;
+	const auto src = TestDataBuffer<int32_t, N>(RandomInt24());
+
+	int16_t a[N], b[N];
+
+	PcmDither dither1;
+	dither1.SetChannels(2);
+	dither1.Dither24To16(a, src.begin(), src.end());
+
+	PcmDither dither2;
+	dither2.SetChannels(2);
+	static constexpr unsigned sizes[] = { 3, 1, 17, 8, 100 };
+	unsigned i = 0;
+	for (unsigned size : sizes) {
+		dither2.Dither24To16(b + i, src.begin() + i,
+				     src.begin() + i + size);
+		i += size;
+	}
+
+	dither2.Dither24To16(b + i, src.begin() + i, src.end());
+
+	CPPUNIT_ASSERT(memcmp(a, b, sizeof(a)) == 0);
+}
+
+/**
+ * Returns the energy of the dither error of one channel between 4
+ * and 8 kHz (assuming 44.1 kHz), summed over blocks of 256 frames.
+ */
+static double
+BandNoise(const int32_t *src, const int16_t *dest, size_t n_frames,
+	  unsigned channels, unsigned channel)
+{
+	constexpr unsigned M = 256;
+	constexpr unsigned first = M * 4000 / 44100;
+	constexpr unsigned last = M * 8000 / 44100;
+
+	double energy = 0;
+	for (size_t block = 0; block + M <= n_frames; block += M) {
+		for (unsigned k = first; k <= last; ++k) {
+			double re = 0, im = 0;
+			for (unsigned j = 0; j < M; ++j) {
+				const size_t i = (block + j) * channels
+					+ channel;
+				const double e = (dest[i] << 8) - src[i];
+				const double phi = 2 * M_PI * k * j / M;
+				re += e * cos(phi);
+				im -= e * sin(phi);
+			}
+
+			energy += re * re + im * im;
+		}
+	}
+
+	return energy;
+}
+
+/**
+ * Compare the noise spectrum of each channel with the reference
+ * implementation applied to that channel alone.  If the error
+ * feedback of a channel came from the wrong sample, the shaped noise
+ * would move into the audible band.
+ */
+static void
+TestDitherSpectrum(unsigned channels)
+{
+	constexpr unsigned N_FRAMES = 16384;
+	const size_t n = N_FRAMES * channels;
+
+	std::vector<int32_t> src(n);
+	RandomInt24 r;
+	for (auto &i : src)
+		i = r() / 4;
+
+	std::vector<int16_t> dest(n), reference(n);
+
+	PcmDither dither;
+	dither.SetChannels(channels);
+	dither.Dither24To16(&dest.front(), &src.front(), &src.front() + n);
+
+	for (unsigned c = 0; c < channels; ++c) {
+		ReferenceDither reference_dither;
+		for (unsigned i = c; i < n; i += channels)
+			reference[i] = reference_dither.Dither24To16(src[i]);
+
+		const double a = BandNoise(&src.front(), &dest.front(),
+					   N_FRAMES, channels, c);
+		const double b = BandNoise(&src.front(), &reference.front(),
+					   N_FRAMES, channels, c);
+
+		CPPUNIT_ASSERT(a > b * 0.8);
+		CPPUNIT_ASSERT(a < b * 1.25);
+	}
+}
+
+void
+PcmDitherTest::TestDitherSpectrum()
+{
+	::TestDitherSpectrum(2);
+	::TestDitherSpectrum(6);
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "test_pcm_all.hxx"
+#include "test_pcm_util.hxx"
+#include "pcm/PcmDsd.hxx"
+#include "pcm/dsd2pcm/dsd2pcm.h"
+#include "util/ConstBuffer.hxx"
+
+#include <algorithm>
+#include <vector>
+
+#include <math.h>
+
+/**
+ * Convert with #PcmDsd, in blocks of varying size.
+ */
+template<size_t N>
+static std::vector<float>
+ConvertDsd(unsigned channels, bool lsbfirst,
+	   const TestDataBuffer<uint8_t, N> &src)
+{
+	PcmDsd dsd;
+	std::vector<float> dest;
+
+	size_t frames = 1;
+	const size_t n_frames = N / channels;
+	for (size_t i = 0; i < n_frames;) {
+		const size_t n = std::min(frames, n_frames - i);
+		const auto out = dsd.ToFloat(channels, lsbfirst,
+					     { src + i * channels,
+					       n * channels });
+		CPPUNIT_ASSERT(!out.IsNull());
+		CPPUNIT_ASSERT_EQUAL(n * channels, out.size);
+		dest.insert(dest.end(), out.data, out.data + out.size);
+
+		i += n;
+		frames = frames * 2 + 3;
+	}
+
+	return dest;
+}
+
+void
+PcmDsdTest::TestDsd()
+{
+	constexpr size_t N = 6 * 1021;
+	const auto src = TestDataBuffer<uint8_t, N>();
+
+	static constexpr unsigned channel_counts[] = { 1, 2, 3, 6 };
+	for (const unsigned channels : channel_counts) {
+		for (unsigned lsbfirst = 0; lsbfirst < 2; ++lsbfirst) {
+			const auto dest = ConvertDsd(channels, lsbfirst, src);
+			const size_t n_frames = N / channels;
+
+			for (unsigned c = 0; c < channels; ++c) {
+				dsd2pcm_ctx *ctx = dsd2pcm_init();
+				CPPUNIT_ASSERT(ctx != nullptr);
+
+				std::vector<float> expected(n_frames);
+				dsd2pcm_translate(ctx, n_frames,
+						  src + c, channels,
+						  lsbfirst, &expected.front(),
+						  1);
+				dsd2pcm_destroy(ctx);
+
+				/* dsd2pcm sums in double precision */
+				for (size_t i = 0; i < n_frames; ++i) {
+					const float d = dest[i * channels + c];
+					CPPUNIT_ASSERT(fabs(d - expected[i]) < 1e-6);
+				}
+			}
+		}
+	}
+}
@@ -25,6 +25,9 @@
 #include "pcm/PcmUtils.hxx"
 #include "pcm/PcmBuffer.hxx"
 #include "AudioFormat.hxx"
+#include "util/CpuFeatures.hxx"
+
+#include <string.h>
 
 void
 PcmFormatTest::TestFormat8to16()
@@ -98,3 +101,121 @@ PcmFormatTest::TestFormatFloat()
 	for (size_t i = 0; i < N; ++i)
 		CPPUNIT_ASSERT_EQUAL(src[i], d.data[i]);
 }
+
+static ConstBuffer<void>
+ConvertTo(PcmBuffer &buffer, PcmDither &dither,
+	  SampleFormat src_format, SampleFormat dest_format,
+	  ConstBuffer<void> src)
+{
+	switch (dest_format) {
+	case SampleFormat::S16:
+		return pcm_convert_to_16(buffer, dither, src_format,
+					 src).ToVoid();
+
+	case SampleFormat::S24_P32:
+		return pcm_convert_to_24(buffer, src_format, src).ToVoid();
+
+	case SampleFormat::S32:
+		return pcm_convert_to_32(buffer, src_format, src).ToVoid();
+
+	case SampleFormat::FLOAT:
+		return pcm_convert_to_float(buffer, src_format, src).ToVoid();
+
+	default:
+		return nullptr;
+	}
+}
+
+/**
+ * Compare the SIMD converters with the portable ones for every pair
+ * of formats; the results must be bit-exact.
+ */
+void
+PcmFormatTest::TestFormatSimd()
+{
+	/* an odd size to cover the kernels' tail loops */
+	constexpr size_t N = 1021;
+	const auto src8 = TestDataBuffer<int8_t, N>();
+	const auto src16 = TestDataBuffer<int16_t, N>();
+	const auto src24 = TestDataBuffer<int32_t, N>(RandomInt24());
+	const auto src32 = TestDataBuffer<int32_t, N>();
+	const auto src_float = TestDataBuffer<float, N>(RandomFloat());
+
+	const struct {
+		SampleFormat format;
+		ConstBuffer<void> src;
+	} sources[] = {
+		{ SampleFormat::S8, src8 },
+		{ SampleFormat::S16, src16 },
+		{ SampleFormat::S24_P32, src24 },
+		{ SampleFormat::S32, src32 },
+		{ SampleFormat::FLOAT, src_float },
+	};
+
+	static constexpr SampleFormat dest_formats[] = {
+		SampleFormat::S16,
+		SampleFormat::S24_P32,
+		SampleFormat::S32,
+		SampleFormat::FLOAT,
+	};
+
+	for (const auto &source : sources) {
+		for (const auto dest_format : dest_formats) {
+			PcmBuffer buffer1, buffer2;
+			PcmDither dither1, dither2;
+
+			SetCpuFeatureMask(0);
+			const auto expected =
+				ConvertTo(buffer1, dither1, source.format,
+					  dest_format, source.src);
+
+			SetCpuFeatureMask(~0u);
+			const auto result =
+				ConvertTo(buffer2, dither2, source.format,
+					  dest_format, source.src);
+
+			CPPUNIT_ASSERT(!expected.IsNull());
+			CPPUNIT_ASSERT_EQUAL(expected.size, result.size);
+			CPPUNIT_ASSERT_EQUAL(0, memcmp(expected.data,
+						       result.data,
+						       expected.size));
+		}
+	}
+}
+
+/**
+ * Out-of-range floating point samples must be clamped.
+ */
+void
+PcmFormatTest::TestFormatFloatClamp()
+{
+	constexpr size_t N = 256;
+	auto src = TestDataBuffer<float, N>(RandomFloat());
+	src[0] = 1;
+	src[1] = -1;
+	src[2] = 1.5;
+	src[3] = -1.5;
+	src[4] = 1e10;
+	src[5] = -1e10;
+
+	PcmBuffer buffer;
+	PcmDither dither;
+
+	for (unsigned mask : { 0u, ~0u }) {
+		SetCpuFeatureMask(mask);
+
+		auto d = pcm_convert_to_16(buffer, dither,
+					   SampleFormat::FLOAT, src);
+		CPPUNIT_ASSERT_EQUAL(N, d.size);
+
+		for (size_t i = 0; i < N; ++i) {
+			int32_t expected = src[i] * 32768;
+			if (src[i] >= 1)
+				expected = 32767;
+			else if (src[i] <= -1)
+				expected = -32768;
+
+			CPPUNIT_ASSERT_EQUAL(int(expected), int(d.data[i]));
+		}
+	}
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "test_pcm_all.hxx"
+#include "test_pcm_util.hxx"
+#include "pcm/PcmLimiter.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/CpuFeatures.hxx"
+#include "util/Error.hxx"
+
+#include <algorithm>
+#include <vector>
+
+#include <math.h>
+#include <string.h>
+
+/**
+ * Process with #PcmLimiter, in blocks of varying size.
+ */
+template<typename T>
+static std::vector<T>
+Limit(SampleFormat format, unsigned channels, const T *src, size_t n)
+{
+	PcmLimiter limiter;
+	CPPUNIT_ASSERT(limiter.Open(format, channels, 48000,
+				    IgnoreError()));
+
+	static constexpr size_t chunk_frames[] = { 1, 7, 13, 64, 333 };
+
+	std::vector<T> result;
+	for (size_t i = 0, position = 0; position < n; ++i) {
+		const size_t size = std::min(chunk_frames[i % 5] * channels,
+					     n - position);
+		const auto dest = limiter.Apply({src + position,
+						 size * sizeof(T)});
+		CPPUNIT_ASSERT_EQUAL(size * sizeof(T), dest.size);
+
+		const T *p = (const T *)dest.data;
+		result.insert(result.end(), p, p + size);
+		position += size;
+	}
+
+	limiter.Close();
+	return result;
+}
+
+void
+PcmLimiterTest::TestTransparent()
+{
+	/* loud music is not modified, only delayed */
+	constexpr size_t N = 48000 * 2;
+	TestDataBuffer<int32_t, N> src;
+
+	const auto dest = Limit(SampleFormat::S32, 2, src.begin(), N);
+
+	PcmLimiter limiter;
+	limiter.Open(SampleFormat::S32, 2, 48000, IgnoreError());
+	const size_t delay = limiter.GetDelay() * 2;
+	limiter.Close();
+
+	for (size_t i = 0; i < delay; ++i)
+		CPPUNIT_ASSERT_EQUAL(0, dest[i]);
+
+	for (size_t i = delay; i < N; ++i)
+		CPPUNIT_ASSERT_EQUAL(src[i - delay], dest[i]);
+}
+
+void
+PcmLimiterTest::TestNormalize()
+{
+	/* a quiet sine with loud bursts */
+	constexpr size_t N = 48000 * 4;
+	std::vector<float> src(N);
+	for (size_t i = 0; i < N; ++i) {
+		const float amplitude = i >= N / 2 && i % 24000 < 100
+			? 0.9
+			: 0.05;
+		src[i] = amplitude * sin(i * 0.05);
+	}
+
+	const auto dest = Limit(SampleFormat::FLOAT, 1, &src.front(), N);
+
+	/* the bursts are much louder than the amplified sine, but
+	   the limiter doesn't let them clip */
+	for (float i : dest)
+		CPPUNIT_ASSERT(fabs(i) <= 1);
+
+	/* the quiet part is amplified to the target level */
+	const float peak = fabs(*std::max_element(dest.begin() + N / 4,
+						  dest.begin() + N / 2,
+						  [](float a, float b){
+							  return fabs(a) < fabs(b);
+						  }));
+	CPPUNIT_ASSERT(peak > 0.45);
+	CPPUNIT_ASSERT(peak <= 0.5 + 1e-6);
+}
+
+void
+PcmLimiterTest::TestFlush()
+{
+	/* the frames left in the delay line are returned at the
+	   end */
+	constexpr size_t N = 4800 * 2;
+	TestDataBuffer<int32_t, N> src;
+
+	PcmLimiter limiter;
+	limiter.Open(SampleFormat::S32, 2, 48000, IgnoreError());
+	const size_t delay = limiter.GetDelay() * 2;
+
+	limiter.Apply({src.begin(), sizeof(src)});
+
+	const auto dest = limiter.Flush();
+	CPPUNIT_ASSERT_EQUAL(delay * sizeof(int32_t), dest.size);
+
+	const int32_t *p = (const int32_t *)dest.data;
+	for (size_t i = 0; i < delay; ++i)
+		CPPUNIT_ASSERT_EQUAL(src[N - delay + i], p[i]);
+
+	/* nothing is left */
+	CPPUNIT_ASSERT_EQUAL(size_t(0), limiter.Flush().size);
+
+	limiter.Close();
+}
+
+void
+PcmLimiterTest::TestReset()
+{
+	/* after a reset, the old frames are not returned */
+	constexpr size_t N = 4800 * 2;
+	TestDataBuffer<int32_t, N> src;
+
+	PcmLimiter limiter;
+	limiter.Open(SampleFormat::S32, 2, 48000, IgnoreError());
+	const size_t delay = limiter.GetDelay() * 2;
+
+	limiter.Apply({src.begin(), sizeof(src)});
+	limiter.Reset();
+	CPPUNIT_ASSERT_EQUAL(size_t(0), limiter.Flush().size);
+
+	const auto dest = limiter.Apply({src.begin(), sizeof(src)});
+	const int32_t *p = (const int32_t *)dest.data;
+	for (size_t i = 0; i < delay; ++i)
+		CPPUNIT_ASSERT_EQUAL(0, p[i]);
+
+	for (size_t i = delay; i < N; ++i)
+		CPPUNIT_ASSERT_EQUAL(src[i - delay], p[i]);
+
+	limiter.Close();
+}
+
+/**
+ * Compare the SIMD kernels with the portable ones bit-exactly.
+ */
+template<typename T, typename G=RandomInt<T>>
+static void
+CompareLimiterKernels(SampleFormat format, G g=G())
+{
+	/* quiet random samples with loud bursts, so the normalizer
+	   and the limiter both have something to do */
+	constexpr size_t N = 48000 * 2;
+	std::vector<T> src(N);
+	for (size_t i = 0; i < N; ++i) {
+		src[i] = g();
+		if (i % 20000 > 500)
+			src[i] /= 64;
+	}
+
+	SetCpuFeatureMask(0);
+	const auto expected = Limit(format, 2, &src.front(), N);
+
+	SetCpuFeatureMask(~0u);
+	const auto result = Limit(format, 2, &src.front(), N);
+
+	CPPUNIT_ASSERT(expected == result);
+}
+
+void
+PcmLimiterTest::TestLimiterSimd()
+{
+	CompareLimiterKernels<int16_t>(SampleFormat::S16);
+	CompareLimiterKernels<int32_t, RandomInt24>(SampleFormat::S24_P32);
+	CompareLimiterKernels<int32_t>(SampleFormat::S32);
+	CompareLimiterKernels<float, RandomFloat>(SampleFormat::FLOAT);
+}
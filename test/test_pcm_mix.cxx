@@ -84,3 +84,93 @@ PcmMixTest::TestMix32()
 {
 	TestPcmMix<int32_t, SampleFormat::S32>();
 }
+
+/**
+ * A linear fade from src1 (1000) to src2 (-1000) over 8 stereo
+ * frames; the expected values are the exact gains at each frame.
+ */
+static constexpr int16_t mix_ramp_golden[8] = {
+	1000, 750, 500, 250, 0, -250, -500, -750,
+};
+
+void
+PcmMixTest::TestMixRamp16()
+{
+	constexpr unsigned N_FRAMES = 8, CHANNELS = 2;
+
+	int16_t result[N_FRAMES * CHANNELS], src2[N_FRAMES * CHANNELS];
+	for (unsigned i = 0; i < N_FRAMES * CHANNELS; ++i) {
+		result[i] = 1000;
+		src2[i] = -1000;
+	}
+
+	PcmDither dither;
+	bool success = pcm_mix_ramp(dither, result, src2, sizeof(result),
+				    SampleFormat::S16, CHANNELS,
+				    1.0, 0.0, MixCurve::LINEAR);
+	CPPUNIT_ASSERT(success);
+
+	for (unsigned i = 0; i < N_FRAMES; ++i) {
+		for (unsigned c = 0; c < CHANNELS; ++c) {
+			const int actual = result[i * CHANNELS + c];
+			CPPUNIT_ASSERT(actual >= mix_ramp_golden[i] - 3);
+			CPPUNIT_ASSERT(actual <= mix_ramp_golden[i] + 3);
+		}
+	}
+}
+
+void
+PcmMixTest::TestMixRampFloat()
+{
+	constexpr unsigned N_FRAMES = 8, CHANNELS = 3;
+
+	float result[N_FRAMES * CHANNELS], src2[N_FRAMES * CHANNELS];
+	for (unsigned i = 0; i < N_FRAMES * CHANNELS; ++i) {
+		result[i] = 1000;
+		src2[i] = -1000;
+	}
+
+	PcmDither dither;
+	bool success = pcm_mix_ramp(dither, result, src2, sizeof(result),
+				    SampleFormat::FLOAT, CHANNELS,
+				    1.0, 0.0, MixCurve::LINEAR);
+	CPPUNIT_ASSERT(success);
+
+	for (unsigned i = 0; i < N_FRAMES; ++i)
+		for (unsigned c = 0; c < CHANNELS; ++c)
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(mix_ramp_golden[i],
+						     result[i * CHANNELS + c],
+						     0.01);
+}
+
+void
+PcmMixTest::TestMixRampConstant()
+{
+	/* with a constant portion, the default curve must behave
+	   exactly like pcm_mix() */
+
+	constexpr unsigned N = 256;
+	RandomInt<int16_t> g;
+	const auto src1 = TestDataBuffer<int16_t, N>(g);
+	const auto src2 = TestDataBuffer<int16_t, N>(g);
+
+	for (float portion : { 0.0f, 0.3f, 0.5f, 1.0f }) {
+		PcmDither dither1, dither2;
+		dither1.SetChannels(2);
+
+		auto expected = src1;
+		bool success = pcm_mix(dither1, expected.begin(), src2.begin(),
+				       sizeof(expected),
+				       SampleFormat::S16, portion);
+		CPPUNIT_ASSERT(success);
+
+		auto result = src1;
+		success = pcm_mix_ramp(dither2, result.begin(), src2.begin(),
+				       sizeof(result),
+				       SampleFormat::S16, 2,
+				       portion, portion, MixCurve::SINE);
+		CPPUNIT_ASSERT(success);
+
+		AssertEqualWithTolerance(result, expected, 3);
+	}
+}
@@ -21,6 +21,11 @@
 #include "test_pcm_util.hxx"
 #include "pcm/PcmPack.hxx"
 #include "system/ByteOrder.hxx"
+#include "util/CpuFeatures.hxx"
+
+#include <algorithm>
+
+#include <string.h>
 
 void
 PcmPackTest::TestPack24()
@@ -69,3 +74,45 @@ PcmPackTest::TestUnpack24()
 		CPPUNIT_ASSERT_EQUAL(s, dest[i]);
 	}
 }
+
+void
+PcmPackTest::TestPack24Simd()
+{
+	/* an odd size to cover the kernels' tail loops */
+	constexpr unsigned N = 1021;
+	const auto src = TestDataBuffer<int32_t, N>(RandomInt24());
+
+	uint8_t expected[N * 3], result[N * 3];
+
+	SetCpuFeatureMask(0);
+	pcm_pack_24(expected, src.begin(), src.end());
+
+	SetCpuFeatureMask(~0u);
+	pcm_pack_24(result, src.begin(), src.end());
+
+	CPPUNIT_ASSERT(memcmp(expected, result, sizeof(expected)) == 0);
+
+	/* in-place */
+	int32_t buffer[N];
+	std::copy(src.begin(), src.end(), buffer);
+	pcm_pack_24((uint8_t *)buffer, buffer, buffer + N);
+
+	CPPUNIT_ASSERT(memcmp(expected, buffer, sizeof(expected)) == 0);
+}
+
+void
+PcmPackTest::TestUnpack24Simd()
+{
+	constexpr unsigned N = 1021;
+	const auto src = TestDataBuffer<uint8_t, N * 3>();
+
+	int32_t expected[N], result[N];
+
+	SetCpuFeatureMask(0);
+	pcm_unpack_24(expected, src.begin(), src.end());
+
+	SetCpuFeatureMask(~0u);
+	pcm_unpack_24(result, src.begin(), src.end());
+
+	CPPUNIT_ASSERT(memcmp(expected, result, sizeof(expected)) == 0);
+}
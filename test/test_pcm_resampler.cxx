@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "test_pcm_all.hxx"
+#include "pcm/SincResampler.hxx"
+#include "pcm/SincFilter.hxx"
+#include "AudioFormat.hxx"
+#include "util/CpuFeatures.hxx"
+#include "util/Error.hxx"
+
+#include <vector>
+
+#include <math.h>
+
+/**
+ * Resample a stereo sine wave, feeding the resampler with blocks of
+ * varying size.  Both channels get the same signal, the right one
+ * with inverted polarity.
+ */
+static std::vector<float>
+ResampleSine(SincQuality quality, unsigned in_rate, unsigned out_rate,
+	     double frequency, size_t n_frames)
+{
+	std::vector<float> src(n_frames * 2);
+	for (size_t i = 0; i < n_frames; ++i) {
+		const float s = 0.5 * sin(2 * M_PI * frequency * i / in_rate);
+		src[i * 2] = s;
+		src[i * 2 + 1] = -s;
+	}
+
+	SincPcmResampler resampler(quality);
+	AudioFormat af(in_rate, SampleFormat::FLOAT, 2);
+	Error error;
+	const AudioFormat out_format = resampler.Open(af, out_rate, error);
+	CPPUNIT_ASSERT(out_format.IsValid());
+	CPPUNIT_ASSERT_EQUAL(out_rate, out_format.sample_rate);
+	CPPUNIT_ASSERT(af.format == SampleFormat::FLOAT);
+
+	std::vector<float> dest;
+	size_t block = 1;
+	for (size_t i = 0; i < n_frames;) {
+		const size_t n = std::min(block, n_frames - i);
+		const ConstBuffer<void> in(&src[i * 2], n * 2 * sizeof(float));
+		const auto out =
+			ConstBuffer<float>::FromVoid(resampler.Resample(in,
+									error));
+		CPPUNIT_ASSERT(!out.IsNull() || out.size == 0);
+		dest.insert(dest.end(), out.data, out.data + out.size);
+
+		i += n;
+		block = block * 3 + 7;
+		if (block > 4096)
+			block = 1;
+	}
+
+	resampler.Close();
+	return dest;
+}
+
+/**
+ * Calculate the signal-to-noise ratio [dB] of the output of
+ * ResampleSine(), skipping the filter's settling time at the edges.
+ */
+static double
+SineSnr(const std::vector<float> &dest, unsigned out_rate,
+	double frequency)
+{
+	const size_t n_frames = dest.size() / 2;
+	const size_t margin = out_rate / 50;
+	CPPUNIT_ASSERT(n_frames > margin * 3);
+
+	double signal = 0, noise = 0;
+	for (size_t i = margin; i < n_frames - margin; ++i) {
+		const double s = 0.5 * sin(2 * M_PI * frequency * i / out_rate);
+		const double l = dest[i * 2] - s, r = dest[i * 2 + 1] + s;
+		signal += 2 * s * s;
+		noise += l * l + r * r;
+	}
+
+	return 10 * log10(signal / noise);
+}
+
+void
+PcmResamplerTest::TestSincSnr()
+{
+	static constexpr struct {
+		unsigned in_rate, out_rate;
+	} ratios[] = {
+		{ 44100, 48000 },
+		{ 48000, 44100 },
+		{ 44100, 96000 },
+		{ 96000, 44100 },
+		{ 22050, 44100 },
+		/* odd ratio: interpolated phases */
+		{ 44100, 44101 },
+	};
+
+	static constexpr struct {
+		SincQuality quality;
+		double min_snr;
+	} qualities[] = {
+		{ SincQuality::LOW, 75 },
+		{ SincQuality::MEDIUM, 100 },
+		{ SincQuality::HIGH, 110 },
+		{ SincQuality::VERY_HIGH, 110 },
+	};
+
+	for (const auto &r : ratios) {
+		for (const auto &q : qualities) {
+			/* a frequency well inside the pass band */
+			const double frequency =
+				std::min(r.in_rate, r.out_rate) * 0.17;
+			const auto dest = ResampleSine(q.quality,
+						       r.in_rate, r.out_rate,
+						       frequency,
+						       r.in_rate / 2);
+			CPPUNIT_ASSERT(SineSnr(dest, r.out_rate,
+					       frequency) >= q.min_snr);
+		}
+	}
+}
+
+void
+PcmResamplerTest::TestSincStopBand()
+{
+	/* a tone between the new and the old Nyquist frequency must
+	   be removed, not folded back into the pass band */
+	const auto dest = ResampleSine(SincQuality::HIGH, 48000, 44100,
+				       23000, 24000);
+	const size_t n_frames = dest.size() / 2;
+	const size_t margin = 44100 / 50;
+
+	double power = 0;
+	for (size_t i = margin; i < n_frames - margin; ++i)
+		power += dest[i * 2] * dest[i * 2];
+	power /= n_frames - 2 * margin;
+
+	/* the input has a power of 0.125 (-9 dB) */
+	CPPUNIT_ASSERT(10 * log10(power) < -110);
+}
+
+void
+PcmResamplerTest::TestSincSimd()
+{
+	SetCpuFeatureMask(0);
+	const auto expected = ResampleSine(SincQuality::HIGH, 44100, 48000,
+					   1000, 20000);
+	const auto expected_odd = ResampleSine(SincQuality::LOW, 44100,
+					       44101, 1000, 20000);
+
+	SetCpuFeatureMask(~0u);
+	const auto result = ResampleSine(SincQuality::HIGH, 44100, 48000,
+					 1000, 20000);
+	const auto result_odd = ResampleSine(SincQuality::LOW, 44100,
+					     44101, 1000, 20000);
+
+	/* the SIMD kernels may round differently (fused
+	   multiply-add) */
+	CPPUNIT_ASSERT_EQUAL(expected.size(), result.size());
+	for (size_t i = 0; i < expected.size(); ++i)
+		CPPUNIT_ASSERT(fabs(expected[i] - result[i]) < 1e-6);
+
+	CPPUNIT_ASSERT_EQUAL(expected_odd.size(), result_odd.size());
+	for (size_t i = 0; i < expected_odd.size(); ++i)
+		CPPUNIT_ASSERT(fabs(expected_odd[i] - result_odd[i]) < 1e-6);
+}
+
+void
+PcmResamplerTest::TestSincFilterCache()
+{
+	const SincFilter &a = sinc_filter_get(SincQuality::LOW, 160, 147);
+	const SincFilter &b = sinc_filter_get(SincQuality::LOW, 160, 147);
+	CPPUNIT_ASSERT_EQUAL(&a, &b);
+
+	const SincFilter &c = sinc_filter_get(SincQuality::MEDIUM, 160, 147);
+	const SincFilter &d = sinc_filter_get(SincQuality::LOW, 147, 160);
+	CPPUNIT_ASSERT(&c != &a);
+	CPPUNIT_ASSERT(&d != &a);
+	CPPUNIT_ASSERT(&d != &c);
+
+	sinc_filter_release(a);
+	sinc_filter_release(b);
+	sinc_filter_release(c);
+	sinc_filter_release(d);
+
+	/* unused filters stay in the cache */
+	const SincFilter &e = sinc_filter_get(SincQuality::LOW, 160, 147);
+	CPPUNIT_ASSERT_EQUAL(&a, &e);
+	sinc_filter_release(e);
+
+	/* resamplers with the same ratio share the filter */
+	SincPcmResampler r1(SincQuality::LOW), r2(SincQuality::LOW);
+	AudioFormat af1(44100, SampleFormat::FLOAT, 2);
+	AudioFormat af2(88200, SampleFormat::FLOAT, 1);
+	Error error;
+	CPPUNIT_ASSERT(r1.Open(af1, 48000, error).IsValid());
+	CPPUNIT_ASSERT(r2.Open(af2, 96000, error).IsValid());
+	CPPUNIT_ASSERT_EQUAL(2u, a.refs);
+	r1.Close();
+	r2.Close();
+	CPPUNIT_ASSERT_EQUAL(0u, a.refs);
+
+	sinc_filter_cache_clear();
+}
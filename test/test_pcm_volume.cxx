@@ -22,6 +22,7 @@
 #include "pcm/Volume.hxx"
 #include "pcm/Traits.hxx"
 #include "util/ConstBuffer.hxx"
+#include "util/CpuFeatures.hxx"
 #include "util/Error.hxx"
 #include "test_pcm_util.hxx"
 
@@ -37,7 +38,7 @@ TestVolume(G g=G())
 	typedef typename Traits::value_type value_type;
 
 	PcmVolume pv;
-	CPPUNIT_ASSERT(pv.Open(F, IgnoreError()));
+	CPPUNIT_ASSERT(pv.Open(F, 2, IgnoreError()));
 
 	constexpr size_t N = 256;
 	static value_type zero[N];
@@ -96,7 +97,7 @@ void
 PcmVolumeTest::TestVolumeFloat()
 {
 	PcmVolume pv;
-	CPPUNIT_ASSERT(pv.Open(SampleFormat::FLOAT, IgnoreError()));
+	CPPUNIT_ASSERT(pv.Open(SampleFormat::FLOAT, 2, IgnoreError()));
 
 	constexpr size_t N = 256;
 	static float zero[N];
@@ -123,3 +124,143 @@ PcmVolumeTest::TestVolumeFloat()
 
 	pv.Close();
 }
+
+/**
+ * Apply the volume without dithering, once with the portable
+ * kernels and once with the SIMD kernels, and compare both
+ * bit-exactly.
+ */
+/**
+ * Compare the SIMD kernels with the portable ones; the results must
+ * be bit-exact, even with dithering.
+ */
+static void
+CompareVolumeKernels(SampleFormat format, ConstBuffer<void> src,
+		     bool dither)
+{
+	SetCpuFeatureMask(0);
+	PcmVolume generic;
+	CPPUNIT_ASSERT(generic.Open(format, 2, IgnoreError()));
+	generic.SetDither(dither);
+
+	SetCpuFeatureMask(~0u);
+	PcmVolume simd;
+	CPPUNIT_ASSERT(simd.Open(format, 2, IgnoreError()));
+	simd.SetDither(dither);
+
+	for (unsigned volume : { 1u, PCM_VOLUME_1 / 3, PCM_VOLUME_1 / 2,
+				 PCM_VOLUME_1 - 1, PCM_VOLUME_1 * 3 }) {
+		generic.SetVolume(volume);
+		simd.SetVolume(volume);
+
+		const auto expected = generic.Apply(src);
+		const auto result = simd.Apply(src);
+		CPPUNIT_ASSERT_EQUAL(src.size, expected.size);
+		CPPUNIT_ASSERT_EQUAL(src.size, result.size);
+		CPPUNIT_ASSERT_EQUAL(0, memcmp(expected.data, result.data,
+					       src.size));
+	}
+
+	generic.Close();
+	simd.Close();
+}
+
+template<SampleFormat F, class Traits=SampleTraits<F>,
+	 typename G=RandomInt<typename Traits::value_type>>
+static void
+TestVolumeNoDither(G g=G())
+{
+	typedef typename Traits::value_type value_type;
+
+	/* an odd size to cover the kernels' tail loops */
+	constexpr size_t N = 1021;
+	const auto _src = TestDataBuffer<value_type, N>(g);
+	const ConstBuffer<void> src(_src, sizeof(_src));
+
+	CompareVolumeKernels(F, src, false);
+
+	PcmVolume simd;
+	CPPUNIT_ASSERT(simd.Open(F, 2, IgnoreError()));
+	simd.SetDither(false);
+
+	/* without dithering, the result is exactly rounded */
+	simd.SetVolume(PCM_VOLUME_1 / 2);
+	const auto _dest = ConstBuffer<value_type>::FromVoid(simd.Apply(src));
+	for (unsigned i = 0; i < N; ++i) {
+		typename Traits::long_type expected =
+			(typename Traits::long_type(_src[i]) *
+			 (PCM_VOLUME_1 / 2) + PCM_VOLUME_1 / 2)
+			>> PCM_VOLUME_BITS;
+		CPPUNIT_ASSERT_EQUAL(value_type(expected), _dest.data[i]);
+	}
+
+	simd.Close();
+}
+
+void
+PcmVolumeTest::TestVolumeNoDither8()
+{
+	TestVolumeNoDither<SampleFormat::S8>();
+}
+
+void
+PcmVolumeTest::TestVolumeNoDither16()
+{
+	TestVolumeNoDither<SampleFormat::S16>();
+}
+
+void
+PcmVolumeTest::TestVolumeNoDither24()
+{
+	TestVolumeNoDither<SampleFormat::S24_P32>(RandomInt24());
+}
+
+void
+PcmVolumeTest::TestVolumeNoDither32()
+{
+	TestVolumeNoDither<SampleFormat::S32>();
+}
+
+void
+PcmVolumeTest::TestVolumeDitherSimd()
+{
+	constexpr size_t N = 1021;
+
+	const auto src8 = TestDataBuffer<int8_t, N>();
+	CompareVolumeKernels(SampleFormat::S8, src8, true);
+
+	const auto src16 = TestDataBuffer<int16_t, N>();
+	CompareVolumeKernels(SampleFormat::S16, src16, true);
+
+	const auto src24 = TestDataBuffer<int32_t, N>(RandomInt24());
+	CompareVolumeKernels(SampleFormat::S24_P32, src24, true);
+
+	const auto src32 = TestDataBuffer<int32_t, N>();
+	CompareVolumeKernels(SampleFormat::S32, src32, true);
+}
+
+void
+PcmVolumeTest::TestVolumeNoDitherFloat()
+{
+	constexpr size_t N = 1021;
+	const auto _src = TestDataBuffer<float, N>(RandomFloat());
+	const ConstBuffer<void> src(_src, sizeof(_src));
+
+	SetCpuFeatureMask(0);
+	PcmVolume generic;
+	CPPUNIT_ASSERT(generic.Open(SampleFormat::FLOAT, 2, IgnoreError()));
+
+	SetCpuFeatureMask(~0u);
+	PcmVolume simd;
+	CPPUNIT_ASSERT(simd.Open(SampleFormat::FLOAT, 2, IgnoreError()));
+
+	generic.SetVolume(PCM_VOLUME_1 / 3);
+	simd.SetVolume(PCM_VOLUME_1 / 3);
+
+	const auto expected = generic.Apply(src);
+	const auto result = simd.Apply(src);
+	CPPUNIT_ASSERT_EQUAL(0, memcmp(expected.data, result.data, src.size));
+
+	generic.Close();
+	simd.Close();
+}
@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Unit tests for the bookkeeping of SharedOutputFilter: which output
+ * filters a chunk, which ones play the shared result, and how they
+ * leave the group.
+ */
+
+#include "config.h"
+#include "output/SharedFilter.hxx"
+#include "MusicChunk.hxx"
+#include "thread/Thread.hxx"
+#include "util/Error.hxx"
+#include "Compiler.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef SharedOutputFilter::LookupResult LookupResult;
+
+static constexpr AudioFormat test_format(44100, SampleFormat::S16, 2);
+
+static SharedOutputFilter *
+NewGroup()
+{
+	return new SharedOutputFilter(nullptr, "", false,
+				      test_format, test_format);
+}
+
+/**
+ * Let the client filter the chunk (which must be its turn) and commit
+ * the given string as the result.
+ */
+static const char *
+FilterAndCommit(SharedOutputFilter &group, SharedFilterClient &client,
+		const music_chunk &chunk, const char *value)
+{
+	const void *data;
+	size_t length;
+	CPPUNIT_ASSERT(group.Lookup(client, chunk, data, length) ==
+		       LookupResult::FILTER);
+
+	return (const char *)group.Commit(client, chunk, value,
+					  strlen(value) + 1);
+}
+
+/**
+ * Look up a chunk which must have been filtered already.
+ */
+static const char *
+Found(SharedOutputFilter &group, SharedFilterClient &client,
+      const music_chunk &chunk)
+{
+	const void *data;
+	size_t length;
+	CPPUNIT_ASSERT(group.Lookup(client, chunk, data, length) ==
+		       LookupResult::FOUND);
+	CPPUNIT_ASSERT_EQUAL(strlen((const char *)data) + 1, length);
+	return (const char *)data;
+}
+
+class SharedFilterTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(SharedFilterTest);
+	CPPUNIT_TEST(TestSync);
+	CPPUNIT_TEST(TestDiverge);
+	CPPUNIT_TEST(TestCommitFailure);
+	CPPUNIT_TEST(TestRemove);
+	CPPUNIT_TEST_SUITE_END();
+
+	music_chunk chunks[4];
+
+public:
+	void TestSync();
+	void TestDiverge();
+	void TestCommitFailure();
+	void TestRemove();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SharedFilterTest);
+
+void
+SharedFilterTest::TestSync()
+{
+	SharedOutputFilter *group = NewGroup();
+	SharedFilterClient a, b;
+	group->AddClient(a);
+	group->AddClient(b);
+
+	/* "a" filters the first chunk, and "b" plays its copy */
+	const char *data = FilterAndCommit(*group, a, chunks[0], "0");
+	CPPUNIT_ASSERT_EQUAL(std::string("0"), std::string(data));
+	CPPUNIT_ASSERT_EQUAL(data, Found(*group, b, chunks[0]));
+	group->Release(a);
+	group->Release(b);
+
+	/* whoever comes first filters the next chunk */
+	data = FilterAndCommit(*group, b, chunks[1], "1");
+	group->Release(b);
+	CPPUNIT_ASSERT_EQUAL(data, Found(*group, a, chunks[1]));
+	group->Release(a);
+
+	/* an output may run ahead of the other one */
+	FilterAndCommit(*group, a, chunks[2], "2");
+	group->Release(a);
+	FilterAndCommit(*group, a, chunks[3], "3");
+	group->Release(a);
+
+	CPPUNIT_ASSERT_EQUAL(std::string("2"),
+			     std::string(Found(*group, b, chunks[2])));
+	group->Release(b);
+	CPPUNIT_ASSERT_EQUAL(std::string("3"),
+			     std::string(Found(*group, b, chunks[3])));
+	group->Release(b);
+
+	CPPUNIT_ASSERT(!group->RemoveClient(a));
+	CPPUNIT_ASSERT(group->RemoveClient(b));
+	delete group;
+}
+
+void
+SharedFilterTest::TestDiverge()
+{
+	SharedOutputFilter *group = NewGroup();
+	SharedFilterClient a, b;
+	group->AddClient(a);
+	group->AddClient(b);
+
+	FilterAndCommit(*group, a, chunks[0], "0");
+	Found(*group, b, chunks[0]);
+	group->Release(a);
+	group->Release(b);
+
+	FilterAndCommit(*group, a, chunks[1], "1");
+	group->Release(a);
+
+	/* the pipe of "b" has been cleared, and it continues with a
+	   chunk which the group doesn't know: it must leave the
+	   group's sequence and filter privately */
+	const void *data;
+	size_t length;
+	CPPUNIT_ASSERT(group->Lookup(b, chunks[3], data, length) ==
+		       LookupResult::PRIVATE);
+	CPPUNIT_ASSERT(!b.synced);
+
+	/* the same after an explicit Cancel() */
+	FilterAndCommit(*group, a, chunks[2], "2");
+	group->Release(a);
+	group->Cancel(a);
+	CPPUNIT_ASSERT(!a.synced);
+
+	/* with nobody synced, the next lookup takes over the
+	   group */
+	data = FilterAndCommit(*group, b, chunks[3], "3");
+	CPPUNIT_ASSERT(b.synced);
+	CPPUNIT_ASSERT_EQUAL(std::string("3"), std::string((const char *)data));
+
+	/* ... and "a" joins again as soon as it reaches a chunk
+	   which has already been filtered */
+	CPPUNIT_ASSERT_EQUAL(data, (const void *)Found(*group, a, chunks[3]));
+	CPPUNIT_ASSERT(a.synced);
+	group->Release(a);
+	group->Release(b);
+
+	CPPUNIT_ASSERT(!group->RemoveClient(a));
+	CPPUNIT_ASSERT(group->RemoveClient(b));
+	delete group;
+}
+
+struct WaitingLookup {
+	SharedOutputFilter *group;
+	SharedFilterClient *client;
+	const music_chunk *chunk;
+
+	LookupResult result;
+
+	static void Run(void *ctx) {
+		WaitingLookup &w = *(WaitingLookup *)ctx;
+		const void *data;
+		size_t length;
+		w.result = w.group->Lookup(*w.client, *w.chunk, data, length);
+	}
+};
+
+void
+SharedFilterTest::TestCommitFailure()
+{
+	SharedOutputFilter *group = NewGroup();
+	SharedFilterClient a, b;
+	group->AddClient(a);
+	group->AddClient(b);
+
+	FilterAndCommit(*group, a, chunks[0], "0");
+	Found(*group, b, chunks[0]);
+	group->Release(a);
+	group->Release(b);
+
+	/* "a" begins filtering the next chunk, while "b" waits for
+	   the result */
+	const void *data;
+	size_t length;
+	CPPUNIT_ASSERT(group->Lookup(a, chunks[1], data, length) ==
+		       LookupResult::FILTER);
+
+	WaitingLookup w{group, &b, &chunks[1], LookupResult::FOUND};
+	Thread thread;
+	CPPUNIT_ASSERT(thread.Start(WaitingLookup::Run, &w, IgnoreError()));
+	usleep(50000);
+
+	/* filtering fails; "a" leaves the group's sequence, and the
+	   waiting output wakes up and takes over */
+	CPPUNIT_ASSERT(group->Commit(a, chunks[1], nullptr, 0) == nullptr);
+	thread.Join();
+
+	CPPUNIT_ASSERT(!a.synced);
+	CPPUNIT_ASSERT(w.result == LookupResult::FILTER);
+	CPPUNIT_ASSERT(group->Commit(b, chunks[1], "1", 2) != nullptr);
+	group->Release(b);
+
+	CPPUNIT_ASSERT(!group->RemoveClient(a));
+	CPPUNIT_ASSERT(group->RemoveClient(b));
+	delete group;
+}
+
+void
+SharedFilterTest::TestRemove()
+{
+	SharedOutputFilter *group = NewGroup();
+	SharedFilterClient a, b;
+	group->AddClient(a);
+	group->AddClient(b);
+
+	const char *data = FilterAndCommit(*group, a, chunks[0], "0");
+	CPPUNIT_ASSERT_EQUAL(data, Found(*group, b, chunks[0]));
+	group->Release(a);
+	FilterAndCommit(*group, a, chunks[1], "1");
+
+	/* "a" closes while "b" is still playing the shared result
+	   (and "a" its own next one); the results must stay
+	   valid */
+	CPPUNIT_ASSERT(!group->RemoveClient(a));
+	CPPUNIT_ASSERT(a.group == nullptr);
+	CPPUNIT_ASSERT_EQUAL(std::string("0"), std::string(data));
+	group->Release(b);
+
+	/* the next result is not owned by "a" anymore either */
+	CPPUNIT_ASSERT_EQUAL(std::string("1"),
+			     std::string(Found(*group, b, chunks[1])));
+	group->Release(b);
+
+	CPPUNIT_ASSERT(group->RemoveClient(b));
+	delete group;
+}
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
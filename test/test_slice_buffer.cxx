@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2003-2014 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "util/SliceBuffer.hxx"
+#include "thread/Thread.hxx"
+#include "util/Error.hxx"
+#include "Compiler.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <stdlib.h>
+
+struct Item {
+	unsigned value;
+
+	Item(unsigned _value):value(_value) {}
+};
+
+class SliceBufferTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(SliceBufferTest);
+	CPPUNIT_TEST(TestAllocate);
+	CPPUNIT_TEST(TestConcurrent);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestAllocate();
+	void TestConcurrent();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SliceBufferTest);
+
+void
+SliceBufferTest::TestAllocate()
+{
+	SliceBuffer<Item> buffer(4);
+	CPPUNIT_ASSERT(!buffer.IsOOM());
+	CPPUNIT_ASSERT(buffer.IsEmpty());
+
+	Item *items[4];
+	for (unsigned i = 0; i < 4; ++i) {
+		items[i] = buffer.Allocate(i);
+		CPPUNIT_ASSERT(items[i] != nullptr);
+		CPPUNIT_ASSERT_EQUAL(i, items[i]->value);
+	}
+
+	CPPUNIT_ASSERT(buffer.IsFull());
+	CPPUNIT_ASSERT(buffer.Allocate(4u) == nullptr);
+
+	/* a freed slice is handed out again */
+	buffer.Free(items[2]);
+	CPPUNIT_ASSERT(!buffer.IsFull());
+	Item *again = buffer.Allocate(42u);
+	CPPUNIT_ASSERT(again == items[2]);
+	CPPUNIT_ASSERT_EQUAL(42u, again->value);
+
+	/* freeing everything resets the buffer */
+	for (unsigned i = 0; i < 4; ++i)
+		buffer.Free(items[i]);
+	CPPUNIT_ASSERT(buffer.IsEmpty());
+
+	Item *first = buffer.Allocate(0u);
+	CPPUNIT_ASSERT(first == items[0]);
+	buffer.Free(first);
+}
+
+static constexpr unsigned N_SLICES = 16;
+static constexpr unsigned N_ROUNDS = 100000;
+
+static void
+ConcurrentWorker(void *ctx)
+{
+	auto &buffer = *(SliceBuffer<Item> *)ctx;
+
+	Item *items[N_SLICES / 2];
+	unsigned values[N_SLICES / 2];
+
+	/* the address of this stack frame is unique to this thread,
+	   and is used to generate unique values */
+	const unsigned base = unsigned(size_t(&items) & 0xffff0000);
+
+	for (unsigned round = 0; round < N_ROUNDS; ++round) {
+		unsigned n = 0;
+		for (unsigned i = 0; i < N_SLICES / 2; ++i) {
+			const unsigned value = base + (round & 0xff) * 16 + i;
+			Item *item = buffer.Allocate(value);
+			if (item != nullptr) {
+				values[n] = value;
+				items[n++] = item;
+			}
+		}
+
+		/* each slice must still carry the value we wrote
+		   into it; if another thread got the same slice, it
+		   would have overwritten it */
+		for (unsigned i = 0; i < n; ++i) {
+			if (items[i]->value != values[i])
+				abort();
+			buffer.Free(items[i]);
+		}
+	}
+}
+
+void
+SliceBufferTest::TestConcurrent()
+{
+	SliceBuffer<Item> buffer(N_SLICES);
+
+	Thread threads[4];
+	Error error;
+	for (auto &thread : threads)
+		CPPUNIT_ASSERT(thread.Start(ConcurrentWorker, &buffer, error));
+
+	for (auto &thread : threads)
+		thread.Join();
+
+	CPPUNIT_ASSERT(buffer.IsEmpty());
+}
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -4,6 +4,7 @@
 
 #include "config.h"
 #include "util/UriUtil.hxx"
+#include "util/LatencyHistogram.hxx"
 
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/TestFactoryRegistry.h>
@@ -51,6 +52,55 @@ public:
 
 CPPUNIT_TEST_SUITE_REGISTRATION(UriUtilTest);
 
+class LatencyHistogramTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(LatencyHistogramTest);
+	CPPUNIT_TEST(TestBuckets);
+	CPPUNIT_TEST(TestStatistics);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestBuckets() {
+		CPPUNIT_ASSERT_EQUAL(0u, LatencyHistogram::GetBucketIndex(0));
+		CPPUNIT_ASSERT_EQUAL(0u, LatencyHistogram::GetBucketIndex(1));
+		CPPUNIT_ASSERT_EQUAL(1u, LatencyHistogram::GetBucketIndex(2));
+		CPPUNIT_ASSERT_EQUAL(1u, LatencyHistogram::GetBucketIndex(3));
+		CPPUNIT_ASSERT_EQUAL(10u, LatencyHistogram::GetBucketIndex(1024));
+		CPPUNIT_ASSERT_EQUAL(LatencyHistogram::N_BUCKETS - 1,
+				     LatencyHistogram::GetBucketIndex(uint64_t(1) << 40));
+		CPPUNIT_ASSERT_EQUAL(uint64_t(2048),
+				     LatencyHistogram::GetBucketLimit(10));
+	}
+
+	void TestStatistics() {
+		LatencyHistogram h;
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), h.GetAverage());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), h.GetPercentile(50));
+
+		for (unsigned i = 0; i < 99; ++i)
+			h.Add(100);
+		h.Add(5000);
+
+		CPPUNIT_ASSERT_EQUAL(uint64_t(100), h.GetCount());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(149), h.GetAverage());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(5000), h.GetMax());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(99), h.GetBucket(6));
+		CPPUNIT_ASSERT_EQUAL(uint64_t(128), h.GetPercentile(50));
+		CPPUNIT_ASSERT_EQUAL(uint64_t(128), h.GetPercentile(99));
+		CPPUNIT_ASSERT_EQUAL(uint64_t(5000), h.GetPercentile(100));
+
+		/* a zero start time is "not recorded" */
+		h.AddSince(0, 1000);
+		h.AddSince(2000, 1000);
+		CPPUNIT_ASSERT_EQUAL(uint64_t(100), h.GetCount());
+
+		h.Reset();
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), h.GetCount());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), h.GetMax());
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(LatencyHistogramTest);
+
 int
 main(gcc_unused int argc, gcc_unused char **argv)
 {